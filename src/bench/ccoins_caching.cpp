@@ -4,9 +4,13 @@
 
 #include <bench/bench.h>
 #include <coins.h>
+#include <crypto/common.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <script/signingprovider.h>
+#include <script/standard.h>
 
+#include <functional>
 #include <vector>
 
 // FIXME: Dedup with SetupDummyInputs in test/transaction_tests.cpp.
@@ -86,3 +90,92 @@ static void CCoinsCaching(benchmark::State& state)
 }
 
 BENCHMARK(CCoinsCaching, 170 * 1000);
+
+/** CCoinsMap as it was before its entries were carved from a PoolResource */
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMapStd;
+
+static const size_t COINS_MAP_BENCH_SIZE = 100 * 1000;
+
+static std::vector<COutPoint> CoinsMapBenchOutpoints()
+{
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(COINS_MAP_BENCH_SIZE);
+    for (size_t i = 0; i < COINS_MAP_BENCH_SIZE; ++i) {
+        uint256 hash;
+        WriteLE64(hash.begin(), i / 2);
+        outpoints.emplace_back(hash, i % 2);
+    }
+    return outpoints;
+}
+
+template <typename Map>
+static void FillCoinsMap(Map& map, const std::vector<COutPoint>& outpoints)
+{
+    const CScript script = GetScriptForDestination(PKHash(uint160()));
+    for (const auto& outpoint : outpoints) {
+        CCoinsCacheEntry& entry = map[outpoint];
+        entry.coin = Coin(CTxOut(COIN, script), 1, false, false);
+        entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+    }
+}
+
+// Insert COINS_MAP_BENCH_SIZE coins into an empty map.
+template <typename Map>
+static void CoinsMapFill(benchmark::State& state, std::function<Map()> make_map)
+{
+    const std::vector<COutPoint> outpoints = CoinsMapBenchOutpoints();
+    while (state.KeepRunning()) {
+        Map map = make_map();
+        FillCoinsMap(map, outpoints);
+    }
+}
+
+// Random lookups into a map holding COINS_MAP_BENCH_SIZE coins.
+template <typename Map>
+static void CoinsMapLookup(benchmark::State& state, Map& map)
+{
+    const std::vector<COutPoint> outpoints = CoinsMapBenchOutpoints();
+    FillCoinsMap(map, outpoints);
+
+    FastRandomContext rng(true);
+    std::vector<COutPoint> lookups;
+    for (size_t i = 0; i < 1024; ++i) {
+        lookups.emplace_back(outpoints[rng.randrange(outpoints.size())]);
+    }
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        auto it = map.find(lookups[i++ & 1023]);
+        assert(it != map.end());
+    }
+}
+
+static void CCoinsMapPoolFill(benchmark::State& state)
+{
+    CCoinsMapMemoryResource resource;
+    CoinsMapFill<CCoinsMap>(state, [&resource] {
+        return CCoinsMap{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
+    });
+}
+
+static void CCoinsMapStdFill(benchmark::State& state)
+{
+    CoinsMapFill<CCoinsMapStd>(state, [] { return CCoinsMapStd{}; });
+}
+
+static void CCoinsMapPoolLookup(benchmark::State& state)
+{
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
+    CoinsMapLookup(state, map);
+}
+
+static void CCoinsMapStdLookup(benchmark::State& state)
+{
+    CCoinsMapStd map;
+    CoinsMapLookup(state, map);
+}
+
+BENCHMARK(CCoinsMapPoolFill, 20);
+BENCHMARK(CCoinsMapStdFill, 20);
+BENCHMARK(CCoinsMapPoolLookup, 10 * 1000 * 1000);
+BENCHMARK(CCoinsMapStdLookup, 10 * 1000 * 1000);
@@ -0,0 +1,64 @@
+// Copyright (c) 2020 The BitCorn Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <net.h>
+#include <net_processing.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <sync.h>
+
+#include <vector>
+
+// Internal to net_processing.cpp, see also test/denialofservice_tests.cpp
+extern bool AddOrphanTx(const CTransactionRef& tx, NodeId peer);
+extern void EraseOrphansFor(NodeId peer);
+extern unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans);
+extern unsigned int LimitOrphanTxPerPeer(NodeId peer, unsigned int nMaxOrphansPerPeer);
+extern CCriticalSection g_cs_orphans;
+
+static const int ORPHAN_BENCH_PEERS = 8;
+static const int ORPHAN_BENCH_CHAIN_LENGTH = 40;
+
+// A burst of orphan chains relayed by several peers ahead of their parents, as seen when a
+// wallet sends a series of InstantSend locked transactions: every orphan is limited the way
+// the TX message handler does it, then the peers disconnect.
+static void OrphanPoolBurst(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    std::vector<std::vector<CTransactionRef>> vChains(ORPHAN_BENCH_PEERS);
+    for (auto& vChain : vChains) {
+        uint256 hashPrev = rng.rand256();
+        for (int i = 0; i < ORPHAN_BENCH_CHAIN_LENGTH; i++) {
+            CMutableTransaction tx;
+            tx.vin.resize(2);
+            tx.vin[0].prevout = COutPoint(hashPrev, 0);
+            tx.vin[1].prevout = COutPoint(rng.rand256(), 1);
+            tx.vout.resize(2);
+            tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+            tx.vout[1].scriptPubKey = CScript() << OP_TRUE;
+            vChain.push_back(MakeTransactionRef(tx));
+            hashPrev = vChain.back()->GetHash();
+        }
+    }
+
+    while (state.KeepRunning()) {
+        for (int i = 0; i < ORPHAN_BENCH_CHAIN_LENGTH; i++) {
+            for (NodeId peer = 0; peer < ORPHAN_BENCH_PEERS; peer++) {
+                {
+                    LOCK(g_cs_orphans);
+                    AddOrphanTx(vChains[peer][i], peer);
+                }
+                LimitOrphanTxPerPeer(peer, DEFAULT_MAX_ORPHAN_TRANSACTIONS_PER_PEER);
+                LimitOrphanTxSize(DEFAULT_MAX_ORPHAN_TRANSACTIONS);
+            }
+        }
+        for (NodeId peer = 0; peer < ORPHAN_BENCH_PEERS; peer++) {
+            EraseOrphansFor(peer);
+        }
+    }
+}
+
+BENCHMARK(OrphanPoolBurst, 100);
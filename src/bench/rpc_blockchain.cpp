@@ -9,16 +9,23 @@
 #include <streams.h>
 #include <consensus/validation.h>
 #include <rpc/blockchain.h>
+#include <rpc/jsonstream.h>
 
 #include <univalue.h>
 
-static void BlockToJsonVerbose(benchmark::State& state) {
+static CBlock LoadBlock()
+{
     CDataStream stream(benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION);
     char a = '\0';
     stream.write(&a, 1); // Prevent compaction
 
     CBlock block;
     stream >> block;
+    return block;
+}
+
+static void BlockToJsonVerbose(benchmark::State& state) {
+    CBlock block = LoadBlock();
 
     CBlockIndex blockindex;
     const uint256 blockHash = block.GetHash();
@@ -30,4 +37,41 @@ static void BlockToJsonVerbose(benchmark::State& state) {
     }
 }
 
+// getblock at verbosity 2 without streaming: the whole UniValue tree is built and
+// written to one string, both are held at the same time.
+static void BlockToJsonVerboseWrite(benchmark::State& state) {
+    CBlock block = LoadBlock();
+
+    CBlockIndex blockindex;
+    const uint256 blockHash = block.GetHash();
+    blockindex.phashBlock = &blockHash;
+    blockindex.nBits = 403014710;
+
+    while (state.KeepRunning()) {
+        std::string strReply = blockToJSON(block, &blockindex, &blockindex, /*verbose*/ true).write();
+        assert(!strReply.empty());
+    }
+}
+
+// getblock at verbosity 2 through JSONStreamWriter: only one transaction and one chunk
+// are held, the chunks are passed on like they are to the HTTP reply.
+static void BlockToJsonVerboseStream(benchmark::State& state) {
+    CBlock block = LoadBlock();
+
+    CBlockIndex blockindex;
+    const uint256 blockHash = block.GetHash();
+    blockindex.phashBlock = &blockHash;
+    blockindex.nBits = 403014710;
+
+    while (state.KeepRunning()) {
+        size_t nSize = 0;
+        JSONStreamWriter writer([&nSize](const char* pch, size_t nChunkSize) { nSize += nChunkSize; });
+        blockToJSON(block, &blockindex, &blockindex, /*verbose*/ true, writer);
+        writer.Flush();
+        assert(nSize > 0);
+    }
+}
+
 BENCHMARK(BlockToJsonVerbose, 10);
+BENCHMARK(BlockToJsonVerboseWrite, 10);
+BENCHMARK(BlockToJsonVerboseStream, 10);
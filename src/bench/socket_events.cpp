@@ -0,0 +1,141 @@
+// Copyright (c) 2020 The BitCorn Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <compat.h>
+#include <util/system.h>
+
+#ifdef USE_EPOLL
+
+#include <algorithm>
+#include <array>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Number of simulated peers, each one is a local socketpair
+static const int NUM_PEERS = 1000;
+// Number of peers which send a message on every socket handler iteration, the others are idle
+static const int NUM_BUSY_PEERS = 50;
+
+namespace {
+
+class SocketPairs
+{
+public:
+    std::vector<SOCKET> vLocal;
+    std::vector<SOCKET> vRemote;
+
+    explicit SocketPairs(int nPairs)
+    {
+        RaiseFileDescriptorLimit(2 * nPairs + 64);
+        for (int i = 0; i < nPairs; i++) {
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) != 0) {
+                break;
+            }
+            vLocal.push_back(fds[0]);
+            vRemote.push_back(fds[1]);
+        }
+    }
+
+    ~SocketPairs()
+    {
+        for (SOCKET hSocket : vLocal) close(hSocket);
+        for (SOCKET hSocket : vRemote) close(hSocket);
+    }
+
+    void SendFromBusyPeers() const
+    {
+        static const char msg[32] = {};
+        size_t nStep = std::max<size_t>(1, vRemote.size() / NUM_BUSY_PEERS);
+        for (size_t i = 0; i < vRemote.size(); i += nStep) {
+            (void)write(vRemote[i], msg, sizeof(msg));
+        }
+    }
+};
+
+void Drain(SOCKET hSocket)
+{
+    char pchBuf[0x10000];
+    while (recv(hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT) == (ssize_t)sizeof(pchBuf)) {}
+}
+
+} // namespace
+
+// What CConnman::SocketEvents and SocketHandler do with -socketevents=poll: collect the sockets
+// of all peers, poll them, then look every peer up in the result sets.
+static void SocketEventsPoll(benchmark::State& state)
+{
+    SocketPairs sockets(NUM_PEERS);
+    while (state.KeepRunning()) {
+        sockets.SendFromBusyPeers();
+
+        std::set<SOCKET> recv_select_set, error_select_set;
+        for (SOCKET hSocket : sockets.vLocal) {
+            error_select_set.insert(hSocket);
+            recv_select_set.insert(hSocket);
+        }
+        std::unordered_map<SOCKET, struct pollfd> pollfds;
+        for (SOCKET hSocket : recv_select_set) {
+            pollfds[hSocket].fd = hSocket;
+            pollfds[hSocket].events |= POLLIN;
+        }
+        for (SOCKET hSocket : error_select_set) {
+            pollfds[hSocket].fd = hSocket;
+            pollfds[hSocket].events |= POLLERR|POLLHUP;
+        }
+        std::vector<struct pollfd> vpollfds;
+        vpollfds.reserve(pollfds.size());
+        for (const auto& it : pollfds) {
+            vpollfds.push_back(it.second);
+        }
+        if (poll(vpollfds.data(), vpollfds.size(), 0) < 0) continue;
+
+        std::set<SOCKET> recv_set;
+        for (const struct pollfd& pollfd_entry : vpollfds) {
+            if (pollfd_entry.revents & POLLIN) recv_set.insert(pollfd_entry.fd);
+        }
+        for (SOCKET hSocket : sockets.vLocal) {
+            if (recv_set.count(hSocket)) Drain(hSocket);
+        }
+    }
+}
+
+// What CConnman::SocketHandlerEpoll does: the sockets are registered once, edge-triggered,
+// and only the peers with new data are visited.
+static void SocketEventsEpoll(benchmark::State& state)
+{
+    SocketPairs sockets(NUM_PEERS);
+    int epollfd = epoll_create1(EPOLL_CLOEXEC);
+    for (SOCKET hSocket : sockets.vLocal) {
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = hSocket;
+        epoll_ctl(epollfd, EPOLL_CTL_ADD, hSocket, &event);
+    }
+    std::array<struct epoll_event, 1024> events;
+    // Take the initial writability edges
+    while (epoll_wait(epollfd, events.data(), events.size(), 0) > 0) {}
+
+    while (state.KeepRunning()) {
+        sockets.SendFromBusyPeers();
+
+        int nEvents = epoll_wait(epollfd, events.data(), events.size(), 0);
+        for (int i = 0; i < nEvents; i++) {
+            if (events[i].events & EPOLLIN) Drain(events[i].data.fd);
+        }
+    }
+    close(epollfd);
+}
+
+BENCHMARK(SocketEventsPoll, 1000);
+BENCHMARK(SocketEventsEpoll, 10000);
+
+#endif // USE_EPOLL
@@ -0,0 +1,91 @@
+// Copyright (c) 2020 The BitCorn Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <interfaces/chain.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <util/system.h>
+#include <wallet/db.h>
+#include <wallet/ldb.h>
+#include <wallet/wallet.h>
+#include <wallet/walletdb.h>
+
+static const int WALLET_DB_BENCH_TXS = 2000;
+
+static std::unique_ptr<WalletDatabase> MakeBenchDatabase(bool leveldb)
+{
+    const fs::path path = GetDataDir() / (leveldb ? "wallet_leveldb" : "wallet_bdb");
+    fs::create_directories(path);
+    if (leveldb) {
+        return MakeUnique<LevelDBDatabase>(path);
+    }
+    std::string filename;
+    return MakeUnique<BerkeleyDatabase>(GetWalletEnv(path, filename), std::move(filename));
+}
+
+// What a staking wallet stores most: a coinstake paying to a key of the wallet
+static CTransactionRef MakeCoinStake(FastRandomContext& rng)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(rng.rand256(), 1);
+    tx.vin[0].scriptSig = CScript() << rng.randbytes(72);
+    tx.vout.resize(3);
+    tx.vout[0].SetEmpty();
+    for (int i = 1; i < 3; i++) {
+        tx.vout[i].nValue = 500 * COIN;
+        tx.vout[i].scriptPubKey = CScript() << rng.randbytes(33) << OP_CHECKSIG;
+    }
+    return MakeTransactionRef(tx);
+}
+
+// A batch for every transaction, flushed when it closes, the way a new stake is added
+static void WalletDBWriteTx(benchmark::State& state, bool leveldb)
+{
+    std::unique_ptr<WalletDatabase> database = MakeBenchDatabase(leveldb);
+    FastRandomContext rng(true);
+
+    while (state.KeepRunning()) {
+        WalletBatch batch(*database, "cr+");
+        batch.WriteTx(CWalletTx(nullptr, MakeCoinStake(rng)));
+    }
+    database->Flush(true);
+}
+
+// Loading a wallet with many transactions, from the database files to mapWallet
+static void WalletDBLoad(benchmark::State& state, bool leveldb)
+{
+    {
+        std::unique_ptr<WalletDatabase> database = MakeBenchDatabase(leveldb);
+        FastRandomContext rng(true);
+        {
+            WalletBatch batch(*database, "cr+");
+            for (int i = 0; i < WALLET_DB_BENCH_TXS; i++) {
+                batch.WriteTx(CWalletTx(nullptr, MakeCoinStake(rng)));
+            }
+        }
+        database->Flush(true);
+    }
+
+    std::unique_ptr<interfaces::Chain> chain = interfaces::MakeChain();
+    while (state.KeepRunning()) {
+        CWallet wallet(chain.get(), WalletLocation(), MakeBenchDatabase(leveldb));
+        bool first_run;
+        if (wallet.LoadWallet(first_run) != DBErrors::LOAD_OK) assert(false);
+        assert(wallet.mapWallet.size() == WALLET_DB_BENCH_TXS);
+        wallet.Flush(true);
+    }
+}
+
+static void WalletDBWriteTxBDB(benchmark::State& state) { WalletDBWriteTx(state, /* leveldb */ false); }
+static void WalletDBWriteTxLevelDB(benchmark::State& state) { WalletDBWriteTx(state, /* leveldb */ true); }
+static void WalletDBLoadBDB(benchmark::State& state) { WalletDBLoad(state, /* leveldb */ false); }
+static void WalletDBLoadLevelDB(benchmark::State& state) { WalletDBLoad(state, /* leveldb */ true); }
+
+BENCHMARK(WalletDBWriteTxBDB, 500);
+BENCHMARK(WalletDBWriteTxLevelDB, 500);
+BENCHMARK(WalletDBLoadBDB, 10);
+BENCHMARK(WalletDBLoadLevelDB, 10);
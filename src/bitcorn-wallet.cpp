@@ -12,6 +12,7 @@
 #include <util/strencodings.h>
 #include <util/system.h>
 #include <util/translation.h>
+#include <wallet/ldb.h>
 #include <wallet/wallettool.h>
 
 #include <functional>
@@ -26,11 +27,13 @@ static void SetupWalletToolArgs()
 
     gArgs.AddArg("-datadir=<dir>", "Specify data directory", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-wallet=<wallet-name>", "Specify wallet name", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-walletbackend=<backend>", strprintf("Storage backend of created wallets, \"bdb\" or \"leveldb\" (default: %s)", DEFAULT_WALLET_BACKEND), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-debug=<category>", "Output debugging information (default: 0).", false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-printtoconsole", "Send trace/debug info to console (default: 1 when no -debug is true, 0 otherwise.", false, OptionsCategory::DEBUG_TEST);
 
     gArgs.AddArg("info", "Get wallet info", false, OptionsCategory::COMMANDS);
     gArgs.AddArg("create", "Create new wallet file", false, OptionsCategory::COMMANDS);
+    gArgs.AddArg("migrate", "Move a Berkeley DB wallet to LevelDB, its wallet.dat file is kept as wallet.dat.migrated and the Berkeley DB log files are removed", false, OptionsCategory::COMMANDS);
 }
 
 static bool WalletAppInit(int argc, char* argv[])
@@ -0,0 +1,131 @@
+// Copyright (c) 2020 The BitCorn Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coinsprefetch.h>
+
+#include <logging.h>
+#include <primitives/block.h>
+#include <saltedhasher.h>
+#include <txdb.h>
+#include <util/threadnames.h>
+#include <util/time.h>
+
+#include <unordered_set>
+
+std::unique_ptr<CCoinsPrefetcher> g_coins_prefetcher;
+
+/** Minimum number of outpoints handed to a single worker */
+static const size_t MIN_PREFETCH_BATCH_SIZE = 16;
+
+CCoinsPrefetcher::CCoinsPrefetcher(CCoinsViewBackgroundFlush& _view, int nThreads) :
+    view(_view),
+    workerPool(nThreads)
+{
+    RenameThreadPool(workerPool, "prefetch");
+}
+
+CCoinsPrefetcher::~CCoinsPrefetcher()
+{
+    workerPool.clear_queue();
+    workerPool.stop(true);
+}
+
+void CCoinsPrefetcher::Prefetch(const CBlock& block, const CCoinsViewCache& cacheTip)
+{
+    const uint256 blockHash = block.GetHash();
+    {
+        LOCK(cs);
+        if (mapPending.count(blockHash)) {
+            return;
+        }
+    }
+
+    // Read the generation before looking at the cache, so that a flush which empties
+    // the cache after this point is guaranteed to invalidate the batches
+    PendingBlock pending;
+    pending.nWriteGeneration = view.GetWriteGeneration();
+
+    std::unordered_set<uint256, StaticSaltedHasher> setBlockTxids;
+    std::vector<COutPoint> vOutpoints;
+    for (const auto& tx : block.vtx) {
+        if (!tx->IsCoinBase()) {
+            for (const auto& txin : tx->vin) {
+                // outputs created in the same block are never in the database
+                if (!setBlockTxids.count(txin.prevout.hash) && !cacheTip.HaveCoinInCache(txin.prevout)) {
+                    vOutpoints.emplace_back(txin.prevout);
+                }
+            }
+        }
+        setBlockTxids.emplace(tx->GetHash());
+    }
+    if (vOutpoints.empty()) {
+        return;
+    }
+
+    size_t nBatchSize = std::max(MIN_PREFETCH_BATCH_SIZE, (vOutpoints.size() + workerPool.size() - 1) / workerPool.size());
+    for (size_t i = 0; i < vOutpoints.size(); i += nBatchSize) {
+        auto vBatch = std::make_shared<std::vector<COutPoint>>(vOutpoints.begin() + i, vOutpoints.begin() + std::min(i + nBatchSize, vOutpoints.size()));
+        pending.batches.emplace_back(workerPool.push([this, vBatch](int threadId) {
+            CoinsBatch coins;
+            coins.reserve(vBatch->size());
+            try {
+                for (const auto& outpoint : *vBatch) {
+                    Coin coin;
+                    if (view.GetCoin(outpoint, coin)) {
+                        coins.emplace_back(outpoint, std::move(coin));
+                    }
+                }
+            } catch (const std::exception& e) {
+                // read errors are reported when ConnectBlock fetches the coin itself
+                LogPrint(BCLog::COINDB, "CCoinsPrefetcher: read failed: %s\n", e.what());
+            }
+            return coins;
+        }));
+    }
+
+    LOCK(cs);
+    if (listPending.size() >= MAX_PENDING_BLOCKS) {
+        mapPending.erase(listPending.front());
+        listPending.pop_front();
+    }
+    mapPending.emplace(blockHash, std::move(pending));
+    listPending.emplace_back(blockHash);
+}
+
+void CCoinsPrefetcher::Apply(const uint256& blockHash, CCoinsViewCache& cacheTip)
+{
+    PendingBlock pending;
+    {
+        LOCK(cs);
+        auto it = mapPending.find(blockHash);
+        if (it == mapPending.end()) {
+            return;
+        }
+        pending = std::move(it->second);
+        mapPending.erase(it);
+        listPending.remove(blockHash);
+    }
+
+    int64_t nTimeStart = GetTimeMicros();
+    std::vector<CoinsBatch> vBatches;
+    vBatches.reserve(pending.batches.size());
+    for (auto& f : pending.batches) {
+        vBatches.emplace_back(f.get());
+    }
+
+    if (view.GetWriteGeneration() != pending.nWriteGeneration) {
+        // the view was written to while reading, the coins might be outdated
+        LogPrint(BCLog::COINDB, "CCoinsPrefetcher: discarding prefetched inputs of block %s\n", blockHash.ToString());
+        return;
+    }
+
+    size_t nCoins = 0;
+    for (auto& vCoins : vBatches) {
+        for (auto& p : vCoins) {
+            cacheTip.AddFetchedCoin(p.first, std::move(p.second));
+        }
+        nCoins += vCoins.size();
+    }
+    LogPrint(BCLog::BENCHMARK, "    - Prefetched %u inputs of block %s: waited %.2fms\n", nCoins, blockHash.ToString(), (GetTimeMicros() - nTimeStart) * 0.001);
+}
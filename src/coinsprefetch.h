@@ -0,0 +1,69 @@
+// Copyright (c) 2020 The BitCorn Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCORN_COINSPREFETCH_H
+#define BITCORN_COINSPREFETCH_H
+
+#include <coins.h>
+#include <ctpl.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class CBlock;
+class CCoinsViewBackgroundFlush;
+
+/** Default for -prefetchcoins, the number of threads reading block inputs ahead of ConnectBlock */
+static const int DEFAULT_COINS_PREFETCH_THREADS = 4;
+/** Maximum for -prefetchcoins */
+static const int MAX_COINS_PREFETCH_THREADS = 16;
+
+/**
+ * Reads the inputs of blocks which passed CheckBlock from the chainstate database on a pool
+ * of worker threads, so that the cache misses of ConnectBlock don't turn into sequential
+ * LevelDB reads.
+ *
+ * Coins are only handed to the coins tip cache if the view was not written to while
+ * they were read; outpoints absent from the cache always match the view in that case.
+ */
+class CCoinsPrefetcher
+{
+private:
+    typedef std::vector<std::pair<COutPoint, Coin>> CoinsBatch;
+
+    struct PendingBlock
+    {
+        uint64_t nWriteGeneration;
+        std::vector<std::future<CoinsBatch>> batches;
+    };
+
+    /** Number of blocks for which prefetched coins are kept until ConnectBlock asks for them */
+    static const size_t MAX_PENDING_BLOCKS = 16;
+
+    CCoinsViewBackgroundFlush& view;
+    ctpl::thread_pool workerPool;
+
+    mutable CCriticalSection cs;
+    std::map<uint256, PendingBlock> mapPending GUARDED_BY(cs);
+    std::list<uint256> listPending GUARDED_BY(cs);
+
+public:
+    CCoinsPrefetcher(CCoinsViewBackgroundFlush& _view, int nThreads);
+    ~CCoinsPrefetcher();
+
+    /** Start reading the inputs of block which are not already in cacheTip */
+    void Prefetch(const CBlock& block, const CCoinsViewCache& cacheTip);
+    /** Wait for the inputs of the block to be read and add them to cacheTip */
+    void Apply(const uint256& blockHash, CCoinsViewCache& cacheTip);
+};
+
+extern std::unique_ptr<CCoinsPrefetcher> g_coins_prefetcher;
+
+#endif // BITCORN_COINSPREFETCH_H
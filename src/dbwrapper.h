@@ -167,6 +167,20 @@ public:
         return true;
     }
 
+    /** Append the serialized key to ssKey, for keys which are not of a single type */
+    void GetKeyStream(CDataStream& ssKey) {
+        leveldb::Slice slKey = piter->key();
+        ssKey.write(slKey.data(), slKey.size());
+    }
+
+    /** Append the serialized value to ssValue */
+    void GetValueStream(CDataStream& ssValue) {
+        leveldb::Slice slValue = piter->value();
+        CDataStream ssRaw(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+        ssRaw.Xor(dbwrapper_private::GetObfuscateKey(parent));
+        ssValue << ssRaw;
+    }
+
     unsigned int GetValueSize() {
         return piter->value().size();
     }
@@ -372,6 +386,14 @@ public:
         pdb->CompactRange(&slKey1, &slKey2);
     }
 
+    /**
+     * Compact the whole database, this also writes out the log file.
+     */
+    void CompactFull() const
+    {
+        pdb->CompactRange(nullptr, nullptr);
+    }
+
 };
 
 template<typename CDBTransaction>
@@ -10,6 +10,7 @@
 #include <fs.h>
 #include <hash.h>
 #include <streams.h>
+#include <util/system.h>
 
 /**
 *   Generic Dumping and Loading
@@ -49,11 +50,13 @@ private:
         uint256 hash = Hash(ssObj.begin(), ssObj.end());
         ssObj << hash;
 
-        // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
+        // write to a temporary file first, so that a crash never leaves a truncated file behind
+        fs::path pathTmp = pathDB;
+        pathTmp += ".new";
+        FILE *file = fsbridge::fopen(pathTmp, "wb");
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
 
         // Write and commit header, data
         try {
@@ -62,8 +65,15 @@ private:
         catch (std::exception &e) {
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
+        if (!FileCommit(fileout.Get())) {
+            return error("%s: Failed to commit file %s", __func__, pathTmp.string());
+        }
         fileout.fclose();
 
+        if (!RenameOver(pathTmp, pathDB)) {
+            return error("%s: Rename-into-place failed for %s", __func__, pathDB.string());
+        }
+
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToSave.ToString());
 
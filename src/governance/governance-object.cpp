@@ -39,6 +39,8 @@ CGovernanceObject::CGovernanceObject() :
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    voteTallies(),
+    fInconsistentVoteTallies(false),
     cmmapOrphanVotes(),
     fileVotes()
 {
@@ -67,6 +69,8 @@ CGovernanceObject::CGovernanceObject(const uint256& nHashParentIn, int nRevision
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    voteTallies(),
+    fInconsistentVoteTallies(false),
     cmmapOrphanVotes(),
     fileVotes()
 {
@@ -95,12 +99,15 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other) :
     fExpired(other.fExpired),
     fUnparsable(other.fUnparsable),
     mapCurrentMNVotes(other.mapCurrentMNVotes),
+    voteTallies(other.voteTallies),
+    fInconsistentVoteTallies(other.fInconsistentVoteTallies),
     cmmapOrphanVotes(other.cmmapOrphanVotes),
     fileVotes(other.fileVotes)
 {
 }
 
-bool CGovernanceObject::ProcessVote(CNode* pfrom,
+bool CGovernanceObject::ProcessVote(CGovernanceManager& govman,
+    CNode* pfrom,
     const CGovernanceVote& vote,
     CGovernanceException& exception,
     CConnman& connman)
@@ -149,8 +156,11 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         exception = CGovernanceException(ostr.str(), GOVERNANCE_EXCEPTION_PERMANENT_ERROR, 20);
         return false;
     }
-    vote_instance_m_it it2 = voteRecordRef.mapInstances.emplace(vote_instance_m_t::value_type(int(eSignal), vote_instance_t())).first;
-    vote_instance_t& voteInstanceRef = it2->second;
+    auto ret = voteRecordRef.mapInstances.emplace(vote_instance_m_t::value_type(int(eSignal), vote_instance_t()));
+    vote_instance_t& voteInstanceRef = ret.first->second;
+    if (ret.second) {
+        UpdateVoteTally(eSignal, voteInstanceRef.eOutcome, 1);
+    }
 
     // Reject obsolete votes
     if (vote.GetTimestamp() < voteInstanceRef.nCreationTime) {
@@ -178,7 +188,7 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
 
     int64_t nNow = GetAdjustedTime();
     int64_t nVoteTimeUpdate = voteInstanceRef.nTime;
-    if (governance.AreRateChecksEnabled()) {
+    if (govman.AreRateChecksEnabled()) {
         int64_t nTimeDelta = nNow - voteInstanceRef.nTime;
         if (nTimeDelta < GOVERNANCE_UPDATE_MIN) {
             std::ostringstream ostr;
@@ -204,7 +214,7 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
              << ", vote hash = " << vote.GetHash().ToString();
         LogPrintf("%s\n", ostr.str());
         exception = CGovernanceException(ostr.str(), GOVERNANCE_EXCEPTION_PERMANENT_ERROR, 20);
-        governance.AddInvalidVote(vote);
+        govman.AddInvalidVote(vote);
         return false;
     }
 
@@ -218,30 +228,41 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         return false;
     }
 
+    UpdateVoteTally(eSignal, voteInstanceRef.eOutcome, -1);
     voteInstanceRef = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
+    UpdateVoteTally(eSignal, voteInstanceRef.eOutcome, 1);
     fileVotes.AddVote(vote);
+    RepairVoteTallies();
+    govman.AddMasternodeVotedObject(vote);
+    govman.StoreVote(vote);
     fDirtyCache = true;
     return true;
 }
 
-void CGovernanceObject::ClearMasternodeVotes()
+void CGovernanceObject::ClearMasternodeVotes(CGovernanceManager& govman)
 {
     LOCK(cs);
 
     auto mnList = deterministicMNManager->GetListAtChainTip();
+    auto nParentHash = GetHash();
 
     vote_m_it it = mapCurrentMNVotes.begin();
     while (it != mapCurrentMNVotes.end()) {
         if (!mnList.HasMNByCollateral(it->first)) {
             fileVotes.RemoveVotesFromMasternode(it->first);
+            govman.EraseStoredVotes(nParentHash, it->first);
+            for (const auto& instancePair : it->second.mapInstances) {
+                UpdateVoteTally(instancePair.first, instancePair.second.eOutcome, -1);
+            }
             mapCurrentMNVotes.erase(it++);
         } else {
             ++it;
         }
     }
+    RepairVoteTallies();
 }
 
-std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpoint)
+std::set<uint256> CGovernanceObject::RemoveInvalidVotes(CGovernanceManager& govman, const COutPoint& mnOutpoint)
 {
     LOCK(cs);
 
@@ -261,6 +282,8 @@ std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpo
         CGovernanceVote tmpVote(mnOutpoint, nParentHash, (vote_signal_enum_t)jt->first, jt->second.eOutcome);
         tmpVote.SetTime(jt->second.nCreationTime);
         if (removedVotes.count(tmpVote.GetHash())) {
+            govman.EraseStoredVote(nParentHash, mnOutpoint, jt->first);
+            UpdateVoteTally(jt->first, jt->second.eOutcome, -1);
             jt = it->second.mapInstances.erase(jt);
         } else {
             ++jt;
@@ -269,6 +292,7 @@ std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpo
     if (it->second.mapInstances.empty()) {
         mapCurrentMNVotes.erase(it);
     }
+    RepairVoteTallies();
 
     if (!removedVotes.empty()) {
         std::string removedStr;
@@ -613,19 +637,66 @@ bool CGovernanceObject::IsCollateralValid(std::string& strError, bool& fMissingC
     return true;
 }
 
-int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
+void CGovernanceObject::UpdateVoteTally(int nSignal, vote_outcome_enum_t eOutcome, int nDelta)
 {
-    LOCK(cs);
+    // Records with unknown signals or outcomes can only come from disk, they are never counted
+    if (nSignal < 0 || nSignal > MAX_SUPPORTED_VOTE_SIGNAL || eOutcome < VOTE_OUTCOME_NONE || eOutcome > VOTE_OUTCOME_ABSTAIN) {
+        return;
+    }
+    voteTallies[nSignal][eOutcome] += nDelta;
+    if (voteTallies[nSignal][eOutcome] < 0) {
+        // The votes are still being updated by the caller, RepairVoteTallies recounts them afterwards
+        fInconsistentVoteTallies = true;
+    }
+}
 
-    int nCount = 0;
+void CGovernanceObject::RepairVoteTallies()
+{
+    if (!fInconsistentVoteTallies) {
+        return;
+    }
+    LogPrintf("CGovernanceObject::%s -- Vote tallies of %s went negative, recounting them from the stored votes\n", __func__, GetHash().ToString());
+    fInconsistentVoteTallies = false;
+    RebuildCurrentVotes();
+}
+
+void CGovernanceObject::RebuildVoteTallies()
+{
+    voteTallies = vote_tally_t();
     for (const auto& votepair : mapCurrentMNVotes) {
-        const vote_rec_t& recVote = votepair.second;
-        vote_instance_m_cit it2 = recVote.mapInstances.find(eVoteSignalIn);
-        if (it2 != recVote.mapInstances.end() && it2->second.eOutcome == eVoteOutcomeIn) {
-            ++nCount;
+        for (const auto& instancePair : votepair.second.mapInstances) {
+            UpdateVoteTally(instancePair.first, instancePair.second.eOutcome, 1);
+        }
+    }
+}
+
+void CGovernanceObject::RebuildCurrentVotes()
+{
+    LOCK(cs);
+
+    mapCurrentMNVotes.clear();
+    for (const auto& vote : fileVotes.GetVotes()) {
+        vote_rec_t& voteRecordRef = mapCurrentMNVotes[vote.GetMasternodeOutpoint()];
+        auto ret = voteRecordRef.mapInstances.emplace(int(vote.GetSignal()), vote_instance_t(vote.GetOutcome(), vote.GetTimestamp(), vote.GetTimestamp()));
+        vote_instance_t& voteInstanceRef = ret.first->second;
+        // same winner as in ProcessVote: the latest vote, the highest outcome on equal timestamps
+        if (!ret.second && (vote.GetTimestamp() > voteInstanceRef.nCreationTime ||
+                            (vote.GetTimestamp() == voteInstanceRef.nCreationTime && vote.GetOutcome() > voteInstanceRef.eOutcome))) {
+            voteInstanceRef = vote_instance_t(vote.GetOutcome(), vote.GetTimestamp(), vote.GetTimestamp());
         }
     }
-    return nCount;
+    RebuildVoteTallies();
+    fDirtyCache = true;
+}
+
+int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
+{
+    LOCK(cs);
+
+    if (eVoteSignalIn < VOTE_SIGNAL_NONE || eVoteSignalIn > MAX_SUPPORTED_VOTE_SIGNAL || eVoteOutcomeIn < VOTE_OUTCOME_NONE || eVoteOutcomeIn > VOTE_OUTCOME_ABSTAIN) {
+        return 0;
+    }
+    return voteTallies[eVoteSignalIn][eVoteOutcomeIn];
 }
 
 /**
@@ -682,10 +753,14 @@ void CGovernanceObject::Relay(CConnman& connman)
 }
 
 void CGovernanceObject::UpdateSentinelVariables()
+{
+    UpdateSentinelVariables((int)deterministicMNManager->GetListAtChainTip().GetValidMNsCount());
+}
+
+void CGovernanceObject::UpdateSentinelVariables(int nMnCount)
 {
     // CALCULATE MINIMUM SUPPORT LEVELS REQUIRED
 
-    int nMnCount = (int)deterministicMNManager->GetListAtChainTip().GetValidMNsCount();
     if (nMnCount == 0) return;
 
     // CALCULATE THE MINUMUM VOTE COUNT REQUIRED FOR FULL SIGNAL
@@ -715,7 +790,7 @@ void CGovernanceObject::UpdateSentinelVariables()
     if (GetAbsoluteNoCount(VOTE_SIGNAL_VALID) >= nAbsVoteReq) fCachedValid = false;
 }
 
-void CGovernanceObject::CheckOrphanVotes(CConnman& connman)
+void CGovernanceObject::CheckOrphanVotes(CGovernanceManager& govman, CConnman& connman)
 {
     int64_t nNow = GetAdjustedTime();
     auto mnList = deterministicMNManager->GetListAtChainTip();
@@ -733,7 +808,7 @@ void CGovernanceObject::CheckOrphanVotes(CConnman& connman)
             continue;
         }
         CGovernanceException exception;
-        if (!ProcessVote(nullptr, vote, exception, connman)) {
+        if (!ProcessVote(govman, nullptr, vote, exception, connman)) {
             LogPrintf("CGovernanceObject::CheckOrphanVotes -- Failed to add orphan vote: %s\n", exception.what());
         } else {
             vote.Relay(connman);
@@ -18,14 +18,25 @@
 
 #include <univalue.h>
 
+#include <array>
+
 class CGovernanceManager;
 class CGovernanceTriggerManager;
 class CGovernanceObject;
 class CGovernanceVote;
 
-static const int MIN_GOVERNANCE_PEER_PROTO_VERSION = 70213;
-static const int GOVERNANCE_FILTER_PROTO_VERSION = 70206;
-static const int GOVERNANCE_POSE_BANNED_VOTES_VERSION = 70215;
+namespace governance_tests
+{
+    class TestGovernanceManager;
+}
+
+//! vote sync requests carry per-bucket vote digests (govvdigest) instead of bloom filters
+static const int GOVERNANCE_VOTE_DIGEST_PROTO_VERSION = 70017;
+//! governance messages are exchanged with peers running the vote digest sync, older peers only ever
+//! announced Dash's protocol version numbers below which they didn't accept governance messages
+static const int MIN_GOVERNANCE_PEER_PROTO_VERSION = GOVERNANCE_VOTE_DIGEST_PROTO_VERSION;
+static const int GOVERNANCE_FILTER_PROTO_VERSION = GOVERNANCE_VOTE_DIGEST_PROTO_VERSION;
+static const int GOVERNANCE_POSE_BANNED_VOTES_VERSION = GOVERNANCE_VOTE_DIGEST_PROTO_VERSION;
 
 static const double GOVERNANCE_FILTER_FP_RATE = 0.001;
 
@@ -110,6 +121,7 @@ class CGovernanceObject
     friend class CGovernanceManager;
     friend class CGovernanceTriggerManager;
     friend class CSuperblock;
+    friend class governance_tests::TestGovernanceManager; // for test access to the sentinel flags
 
 public: // Types
     typedef std::map<COutPoint, vote_rec_t> vote_m_t;
@@ -120,6 +132,9 @@ public: // Types
 
     typedef CacheMultiMap<COutPoint, vote_time_pair_t> vote_cmm_t;
 
+    /// Number of current votes per signal and outcome
+    typedef std::array<std::array<int, VOTE_OUTCOME_ABSTAIN + 1>, MAX_SUPPORTED_VOTE_SIGNAL + 1> vote_tally_t;
+
 private:
     /// critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -180,6 +195,12 @@ private:
 
     vote_m_t mapCurrentMNVotes;
 
+    /// Tallies of mapCurrentMNVotes, updated along with it
+    vote_tally_t voteTallies;
+
+    /// A tally dropped below zero, so it has to be recounted from fileVotes
+    bool fInconsistentVoteTallies;
+
     /// Limited map of votes orphaned by MN
     vote_cmm_t cmmapOrphanVotes;
 
@@ -321,37 +342,47 @@ public:
         }
         if (s.GetType() & SER_DISK) {
             // Only include these for the disk file format
-            LogPrint(BCLog::GOBJECT, "CGovernanceObject::SerializationOp Reading/writing votes from/to disk\n");
             READWRITE(nDeletionTime);
             READWRITE(fExpired);
-            READWRITE(mapCurrentMNVotes);
-            READWRITE(fileVotes);
-            LogPrint(BCLog::GOBJECT, "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
+            // votes are kept in the governance vote database, see CGovernanceManager::LoadStoredVotes
         }
 
         // AFTER DESERIALIZATION OCCURS, CACHED VARIABLES MUST BE CALCULATED MANUALLY
     }
 
 private:
+    /// Computes the flags for the given count of valid masternodes
+    void UpdateSentinelVariables(int nMnCount);
+
     // FUNCTIONS FOR DEALING WITH DATA STRING
     void LoadData();
     void GetData(UniValue& objResult);
 
-    bool ProcessVote(CNode* pfrom,
+    /// Add nDelta to the tally of votes with the signal and outcome
+    void UpdateVoteTally(int nSignal, vote_outcome_enum_t eOutcome, int nDelta);
+    /// Recount the tallies from mapCurrentMNVotes
+    void RebuildVoteTallies();
+    /// Rebuild mapCurrentMNVotes and the tallies from the votes in fileVotes
+    void RebuildCurrentVotes();
+    /// Rebuild the current votes if a tally went out of sync with them
+    void RepairVoteTallies();
+
+    bool ProcessVote(CGovernanceManager& govman,
+        CNode* pfrom,
         const CGovernanceVote& vote,
         CGovernanceException& exception,
         CConnman& connman);
 
     /// Called when MN's which have voted on this object have been removed
-    void ClearMasternodeVotes();
+    void ClearMasternodeVotes(CGovernanceManager& govman);
 
     // Revalidate all votes from this MN and delete them if validation fails.
     // This is the case for DIP3 MNs that changed voting or operator keys and
     // also for MNs that were removed from the list completely.
     // Returns deleted vote hashes.
-    std::set<uint256> RemoveInvalidVotes(const COutPoint& mnOutpoint);
+    std::set<uint256> RemoveInvalidVotes(CGovernanceManager& govman, const COutPoint& mnOutpoint);
 
-    void CheckOrphanVotes(CConnman& connman);
+    void CheckOrphanVotes(CGovernanceManager& govman, CConnman& connman);
 };
 
 
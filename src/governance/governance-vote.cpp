@@ -147,7 +147,7 @@ void CGovernanceVote::UpdateHash() const
     ss << nVoteSignal;
     ss << nVoteOutcome;
     ss << nTime;
-    *const_cast<uint256*>(&hash) = ss.GetHash();
+    hash = ss.GetHash();
 }
 
 uint256 CGovernanceVote::GetHash() const
@@ -4,19 +4,24 @@
 
 #include <governance/governance-votedb.h>
 
+#include <util/system.h>
+
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile() :
     nMemoryVotes(0),
-    listVotes(),
-    mapVoteIndex()
+    vecVotes(),
+    mapVoteIndex(),
+    mapMasternodeVotes(),
+    vecDigests(VOTE_DIGEST_BUCKETS)
 {
 }
 
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other) :
     nMemoryVotes(other.nMemoryVotes),
-    listVotes(other.listVotes),
-    mapVoteIndex()
+    vecVotes(other.vecVotes),
+    mapVoteIndex(other.mapVoteIndex),
+    mapMasternodeVotes(other.mapMasternodeVotes),
+    vecDigests(other.vecDigests)
 {
-    RebuildIndex();
 }
 
 void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
@@ -25,8 +30,10 @@ void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
     // make sure to never add/update already known votes
     if (HasVote(nHash))
         return;
-    listVotes.push_front(vote);
-    mapVoteIndex.emplace(nHash, listVotes.begin());
+    mapVoteIndex.emplace(nHash, vecVotes.size());
+    mapMasternodeVotes[vote.GetMasternodeOutpoint()].insert(nHash);
+    UpdateDigest(nHash);
+    vecVotes.push_back(vote);
     ++nMemoryVotes;
     RemoveOldVotes(vote);
 }
@@ -42,30 +49,50 @@ bool CGovernanceObjectVoteFile::SerializeVoteToStream(const uint256& nHash, CDat
     if (it == mapVoteIndex.end()) {
         return false;
     }
-    ss << *(it->second);
+    ss << vecVotes[it->second];
     return true;
 }
 
 std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
 {
+    return vecVotes;
+}
+
+std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotesNotMatching(const vote_digest_t& vecDigestsOther) const
+{
+    if (vecDigestsOther.size() != VOTE_DIGEST_BUCKETS) {
+        return vecVotes;
+    }
+
+    std::vector<bool> vecMismatch(VOTE_DIGEST_BUCKETS);
+    bool fAnyMismatch = false;
+    for (size_t i = 0; i < VOTE_DIGEST_BUCKETS; ++i) {
+        vecMismatch[i] = vecDigests[i] != vecDigestsOther[i];
+        fAnyMismatch |= vecMismatch[i];
+    }
+    if (!fAnyMismatch) {
+        return {};
+    }
+
     std::vector<CGovernanceVote> vecResult;
-    for (vote_l_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
-        vecResult.push_back(*it);
+    for (const auto& vote : vecVotes) {
+        if (vecMismatch[GetDigestBucket(vote.GetHash())]) {
+            vecResult.push_back(vote);
+        }
     }
     return vecResult;
 }
 
 void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
 {
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == outpointMasternode) {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
-        } else {
-            ++it;
-        }
+    auto itMn = mapMasternodeVotes.find(outpointMasternode);
+    if (itMn == mapMasternodeVotes.end()) {
+        return;
+    }
+    // Copied as erasing the last vote of the masternode erases the set
+    const std::set<uint256> setHashes = itMn->second;
+    for (const uint256& nHash : setHashes) {
+        EraseVote(mapVoteIndex.find(nHash));
     }
 }
 
@@ -73,19 +100,19 @@ std::set<uint256> CGovernanceObjectVoteFile::RemoveInvalidVotes(const COutPoint&
 {
     std::set<uint256> removedVotes;
 
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == outpointMasternode) {
-            bool useVotingKey = fProposal && (it->GetSignal() == VOTE_SIGNAL_FUNDING);
-            if (!it->IsValid(useVotingKey)) {
-                removedVotes.emplace(it->GetHash());
-                --nMemoryVotes;
-                mapVoteIndex.erase(it->GetHash());
-                listVotes.erase(it++);
-                continue;
-            }
+    auto itMn = mapMasternodeVotes.find(outpointMasternode);
+    if (itMn == mapMasternodeVotes.end()) {
+        return removedVotes;
+    }
+    const std::set<uint256> setHashes = itMn->second;
+    for (const uint256& nHash : setHashes) {
+        vote_m_it it = mapVoteIndex.find(nHash);
+        const CGovernanceVote& vote = vecVotes[it->second];
+        bool useVotingKey = fProposal && (vote.GetSignal() == VOTE_SIGNAL_FUNDING);
+        if (!vote.IsValid(useVotingKey)) {
+            removedVotes.emplace(nHash);
+            EraseVote(it);
         }
-        ++it;
     }
 
     return removedVotes;
@@ -93,36 +120,128 @@ std::set<uint256> CGovernanceObjectVoteFile::RemoveInvalidVotes(const COutPoint&
 
 void CGovernanceObjectVoteFile::RemoveOldVotes(const CGovernanceVote& vote)
 {
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == vote.GetMasternodeOutpoint() // same masternode
-            && it->GetParentHash() == vote.GetParentHash() // same governance object (e.g. same proposal)
-            && it->GetSignal() == vote.GetSignal() // same signal (e.g. "funding", "delete", etc.)
-            && it->GetTimestamp() < vote.GetTimestamp()) // older than new vote
+    auto itMn = mapMasternodeVotes.find(vote.GetMasternodeOutpoint());
+    if (itMn == mapMasternodeVotes.end()) {
+        return;
+    }
+    // The set contains the new vote, so it is never erased here
+    std::set<uint256>& setHashes = itMn->second;
+    auto itHash = setHashes.begin();
+    while (itHash != setHashes.end()) {
+        vote_m_it it = mapVoteIndex.find(*itHash++);
+        const CGovernanceVote& voteOld = vecVotes[it->second];
+        if (voteOld.GetParentHash() == vote.GetParentHash() // same governance object (e.g. same proposal)
+            && voteOld.GetSignal() == vote.GetSignal() // same signal (e.g. "funding", "delete", etc.)
+            && voteOld.GetTimestamp() < vote.GetTimestamp()) // older than new vote
         {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
-        } else {
-            ++it;
+            EraseVote(it);
         }
     }
 }
 
+void CGovernanceObjectVoteFile::EraseVote(vote_m_it it)
+{
+    size_t nPos = it->second;
+    auto itMn = mapMasternodeVotes.find(vecVotes[nPos].GetMasternodeOutpoint());
+    itMn->second.erase(it->first);
+    if (itMn->second.empty()) {
+        mapMasternodeVotes.erase(itMn);
+    }
+    UpdateDigest(it->first);
+    mapVoteIndex.erase(it);
+
+    if (nPos + 1 != vecVotes.size()) {
+        // Unless we're deleting the last vote, move the last vote to the position we're deleting
+        vecVotes[nPos] = std::move(vecVotes.back());
+        mapVoteIndex[vecVotes[nPos].GetHash()] = nPos;
+    }
+    vecVotes.pop_back();
+    --nMemoryVotes;
+}
+
 void CGovernanceObjectVoteFile::RebuildIndex()
 {
     mapVoteIndex.clear();
+    mapMasternodeVotes.clear();
+    vecDigests.assign(VOTE_DIGEST_BUCKETS, 0);
     nMemoryVotes = 0;
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        CGovernanceVote& vote = *it;
+    vote_v_t vecVotesIn;
+    vecVotesIn.swap(vecVotes);
+    vecVotes.reserve(vecVotesIn.size());
+    for (CGovernanceVote& vote : vecVotesIn) {
         uint256 nHash = vote.GetHash();
-        if (mapVoteIndex.find(nHash) == mapVoteIndex.end()) {
-            mapVoteIndex[nHash] = it;
+        if (mapVoteIndex.emplace(nHash, vecVotes.size()).second) {
+            mapMasternodeVotes[vote.GetMasternodeOutpoint()].insert(nHash);
+            UpdateDigest(nHash);
+            vecVotes.push_back(std::move(vote));
             ++nMemoryVotes;
-            ++it;
-        } else {
-            listVotes.erase(it++);
         }
     }
 }
+
+static const std::string DB_GOVERNANCE_VOTE = "gov_v";
+
+CGovernanceVoteDb::CGovernanceVoteDb(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(GetDataDir() / "governance", nCacheSize, fMemory, fWipe)
+{
+}
+
+void CGovernanceVoteDb::WriteVote(const CGovernanceVote& vote)
+{
+    db.Write(std::make_tuple(DB_GOVERNANCE_VOTE, vote.GetParentHash(), vote.GetMasternodeOutpoint(), (int)vote.GetSignal()), vote);
+}
+
+void CGovernanceVoteDb::EraseVote(const uint256& nParentHash, const COutPoint& outpointMasternode, int nSignal)
+{
+    db.Erase(std::make_tuple(DB_GOVERNANCE_VOTE, nParentHash, outpointMasternode, nSignal));
+}
+
+void CGovernanceVoteDb::EraseMasternodeVotes(const uint256& nParentHash, const COutPoint& outpointMasternode)
+{
+    CDBBatch batch(db);
+    for (int nSignal = VOTE_SIGNAL_NONE; nSignal <= MAX_SUPPORTED_VOTE_SIGNAL; nSignal++) {
+        batch.Erase(std::make_tuple(DB_GOVERNANCE_VOTE, nParentHash, outpointMasternode, nSignal));
+    }
+    db.WriteBatch(batch);
+}
+
+void CGovernanceVoteDb::EraseObjectVotes(const uint256& nParentHash)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    auto start = std::make_tuple(DB_GOVERNANCE_VOTE, nParentHash, COutPoint(uint256(), 0), 0);
+    pcursor->Seek(start);
+
+    CDBBatch batch(db);
+    while (pcursor->Valid()) {
+        decltype(start) k;
+        if (!pcursor->GetKey(k) || std::get<0>(k) != DB_GOVERNANCE_VOTE || std::get<1>(k) != nParentHash) {
+            break;
+        }
+        batch.Erase(k);
+        pcursor->Next();
+    }
+    pcursor.reset();
+    db.WriteBatch(batch);
+}
+
+void CGovernanceVoteDb::LoadVotes(const std::function<bool(const CGovernanceVote&)>& f)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    auto start = std::make_tuple(DB_GOVERNANCE_VOTE, uint256(), COutPoint(uint256(), 0), 0);
+    pcursor->Seek(start);
+
+    CDBBatch batch(db);
+    while (pcursor->Valid()) {
+        decltype(start) k;
+        CGovernanceVote vote;
+        if (!pcursor->GetKey(k) || std::get<0>(k) != DB_GOVERNANCE_VOTE) {
+            break;
+        }
+        if (!pcursor->GetValue(vote) || !f(vote)) {
+            batch.Erase(k);
+        }
+        pcursor->Next();
+    }
+    pcursor.reset();
+    db.WriteBatch(batch);
+}
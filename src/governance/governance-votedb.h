@@ -5,9 +5,12 @@
 #ifndef GOVERNANCE_VOTEDB_H
 #define GOVERNANCE_VOTEDB_H
 
-#include <list>
+#include <functional>
 #include <map>
+#include <set>
+#include <vector>
 
+#include <dbwrapper.h>
 #include <governance/governance-vote.h>
 #include <serialize.h>
 #include <streams.h>
@@ -24,27 +27,38 @@
 class CGovernanceObjectVoteFile
 {
 public: // Types
-    typedef std::list<CGovernanceVote> vote_l_t;
+    typedef std::vector<CGovernanceVote> vote_v_t;
 
-    typedef vote_l_t::iterator vote_l_it;
-
-    typedef vote_l_t::const_iterator vote_l_cit;
-
-    typedef std::map<uint256, vote_l_it> vote_m_t;
+    typedef std::map<uint256, size_t> vote_m_t;
 
     typedef vote_m_t::iterator vote_m_it;
 
     typedef vote_m_t::const_iterator vote_m_cit;
 
+    typedef std::map<COutPoint, std::set<uint256>> vote_mn_m_t;
+
+    /// XOR of the vote hashes in each bucket, see GetDigestBucket
+    typedef std::vector<uint64_t> vote_digest_t;
+
+    static const size_t VOTE_DIGEST_BUCKETS = 256;
+
 private:
     static const int MAX_MEMORY_VOTES = -1;
 
     int nMemoryVotes;
 
-    vote_l_t listVotes;
+    /// Votes in no particular order, removed votes are replaced by the last one
+    vote_v_t vecVotes;
 
+    /// Position of each vote in vecVotes
     vote_m_t mapVoteIndex;
 
+    /// Hashes of the votes of each masternode
+    vote_mn_m_t mapMasternodeVotes;
+
+    /// Digests of the votes, updated as votes are added and erased
+    vote_digest_t vecDigests;
+
 public:
     CGovernanceObjectVoteFile();
 
@@ -72,6 +86,18 @@ public:
 
     std::vector<CGovernanceVote> GetVotes() const;
 
+    const vote_digest_t& GetDigests() const
+    {
+        return vecDigests;
+    }
+
+    /**
+     * Return the votes in the buckets in which vecDigestsOther differs from our digests,
+     * i.e. a superset of the votes a peer with these digests doesn't have.
+     * An empty vecDigestsOther stands for a peer without votes.
+     */
+    std::vector<CGovernanceVote> GetVotesNotMatching(const vote_digest_t& vecDigestsOther) const;
+
     void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
     std::set<uint256> RemoveInvalidVotes(const COutPoint& outpointMasternode, bool fProposal);
 
@@ -81,7 +107,7 @@ public:
     inline void SerializationOp(Stream& s, Operation ser_action)
     {
         READWRITE(nMemoryVotes);
-        READWRITE(listVotes);
+        READWRITE(vecVotes);
         if (ser_action.ForRead()) {
             RebuildIndex();
         }
@@ -91,7 +117,42 @@ private:
     // Drop older votes for the same gobject from the same masternode
     void RemoveOldVotes(const CGovernanceVote& vote);
 
+    void EraseVote(vote_m_it it);
+
+    static size_t GetDigestBucket(const uint256& nHash)
+    {
+        return *nHash.begin() % VOTE_DIGEST_BUCKETS;
+    }
+
+    void UpdateDigest(const uint256& nHash)
+    {
+        vecDigests[GetDigestBucket(nHash)] ^= nHash.GetUint64(1);
+    }
+
     void RebuildIndex();
 };
 
+/**
+ * Persists the current vote of every masternode and signal for each governance object.
+ * Votes are written as they are accepted or removed, instead of as part of governance.dat,
+ * so that shutdown doesn't have to rewrite all of them and a crash doesn't lose them.
+ */
+class CGovernanceVoteDb
+{
+private:
+    CDBWrapper db;
+
+public:
+    CGovernanceVoteDb(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    /** Store vote, replacing the previous vote of the masternode for the same object and signal */
+    void WriteVote(const CGovernanceVote& vote);
+    void EraseVote(const uint256& nParentHash, const COutPoint& outpointMasternode, int nSignal);
+    void EraseMasternodeVotes(const uint256& nParentHash, const COutPoint& outpointMasternode);
+    void EraseObjectVotes(const uint256& nParentHash);
+
+    /** Pass every stored vote to f, the votes for which it returns false are erased */
+    void LoadVotes(const std::function<bool(const CGovernanceVote&)>& f);
+};
+
 #endif
@@ -26,7 +26,7 @@ CGovernanceManager governance;
 
 int nSubmittedFinalBudget;
 
-const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-15";
+const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-16";
 const int CGovernanceManager::MAX_TIME_FUTURE_DEVIATION = 60 * 60;
 const int CGovernanceManager::RELIABLE_PROPAGATION_TIME = 60;
 
@@ -37,6 +37,7 @@ CGovernanceManager::CGovernanceManager() :
     mapErasedGovernanceObjects(),
     mapMasternodeOrphanObjects(),
     cmapVoteToObject(MAX_CACHE_SIZE),
+    mapMasternodeVotedObjects(),
     cmapInvalidVotes(MAX_CACHE_SIZE),
     cmmapOrphanVotes(MAX_CACHE_SIZE),
     mapLastMasternodeObject(),
@@ -122,11 +123,38 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
         if (nProp == uint256()) {
             SyncObjects(pfrom, connman);
         } else {
-            SyncSingleObjVotes(pfrom, nProp, filter, connman);
+            SyncSingleObjVotes(pfrom, nProp, filter, {}, connman);
         }
         LogPrint(BCLog::GOBJECT, "MNGOVERNANCESYNC -- syncing governance objects to our peer at %s\n", pfrom->addr.ToString());
     }
 
+    // ANOTHER USER IS ASKING US FOR THE VOTES OF AN OBJECT IT DOESN'T HAVE
+    else if (strCommand == NetMsgType::MNGOVERNANCEVOTEDIGEST) {
+        if (pfrom->nVersion < MIN_GOVERNANCE_PEER_PROTO_VERSION) {
+            LogPrint(BCLog::GOBJECT, "MNGOVERNANCEVOTEDIGEST -- peer=%d using obsolete version %i\n", pfrom->GetId(), pfrom->nVersion);
+            connman.PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::REJECT, strCommand, REJECT_OBSOLETE, strprintf("Version must be %d or greater", MIN_GOVERNANCE_PEER_PROTO_VERSION)));
+            return;
+        }
+
+        // Ignore such requests until we are fully synced, see MNGOVERNANCESYNC
+        if (!masternodeSync.IsSynced()) return;
+
+        uint256 nProp;
+        CGovernanceObjectVoteFile::vote_digest_t vecDigests;
+
+        vRecv >> nProp >> vecDigests;
+
+        if (!vecDigests.empty() && vecDigests.size() != CGovernanceObjectVoteFile::VOTE_DIGEST_BUCKETS) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 20);
+            return;
+        }
+
+        CBloomFilter filter;
+        filter.clear();
+        SyncSingleObjVotes(pfrom, nProp, filter, vecDigests, connman);
+    }
+
     // A NEW GOVERNANCE OBJECT HAS ARRIVED
     else if (strCommand == NetMsgType::MNGOVERNANCEOBJECT) {
         // MAKE SURE WE HAVE A VALID REFERENCE TO THE TIP BEFORE CONTINUING
@@ -286,7 +314,7 @@ void CGovernanceManager::CheckOrphanVotes(CGovernanceObject& govobj, CGovernance
         CGovernanceException exception;
         if (pairVote.second < nNow) {
             fRemove = true;
-        } else if (govobj.ProcessVote(nullptr, vote, exception, connman)) {
+        } else if (govobj.ProcessVote(*this, nullptr, vote, exception, connman)) {
             vote.Relay(connman);
             fRemove = true;
         }
@@ -373,7 +401,7 @@ void CGovernanceManager::UpdateCachesAndClean()
         if (it == mapObjects.end()) {
             continue;
         }
-        it->second.ClearMasternodeVotes();
+        it->second.ClearMasternodeVotes(*this);
         it->second.fDirtyCache = true;
     }
 
@@ -418,6 +446,14 @@ void CGovernanceManager::UpdateCachesAndClean()
             mmetaman.RemoveGovernanceObject(pObj->GetHash());
 
             // Remove vote references
+            for (const auto& votepair : pObj->mapCurrentMNVotes) {
+                auto itVoted = mapMasternodeVotedObjects.find(votepair.first);
+                if (itVoted == mapMasternodeVotedObjects.end()) continue;
+                itVoted->second.erase(nHash);
+                if (itVoted->second.empty()) {
+                    mapMasternodeVotedObjects.erase(itVoted);
+                }
+            }
             const object_ref_cm_t::list_t& listItems = cmapVoteToObject.GetItemList();
             object_ref_cm_t::list_cit lit = listItems.begin();
             while (lit != listItems.end()) {
@@ -429,6 +465,9 @@ void CGovernanceManager::UpdateCachesAndClean()
                     ++lit;
                 }
             }
+            if (pvoteDb) {
+                pvoteDb->EraseObjectVotes(nHash);
+            }
 
             int64_t nTimeExpired{0};
 
@@ -623,7 +662,7 @@ bool CGovernanceManager::ConfirmInventoryRequest(const CInv& inv)
     return true;
 }
 
-void CGovernanceManager::SyncSingleObjVotes(CNode* pnode, const uint256& nProp, const CBloomFilter& filter, CConnman& connman)
+void CGovernanceManager::SyncSingleObjVotes(CNode* pnode, const uint256& nProp, const CBloomFilter& filter, const CGovernanceObjectVoteFile::vote_digest_t& vecDigests, CConnman& connman)
 {
     // do not provide any data until our node is synced
     if (!masternodeSync.IsSynced()) return;
@@ -653,9 +692,8 @@ void CGovernanceManager::SyncSingleObjVotes(CNode* pnode, const uint256& nProp,
         return;
     }
 
-    auto fileVotes = govobj.GetVoteFile();
-
-    for (const auto& vote : fileVotes.GetVotes()) {
+    // Only the votes in the buckets the peer's digests differ in, all of them without digests
+    for (const auto& vote : govobj.GetVoteFile().GetVotesNotMatching(vecDigests)) {
         uint256 nVoteHash = vote.GetHash();
 
         bool onlyVotingKeyAllowed = govobj.GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL && vote.GetSignal() == VOTE_SIGNAL_FUNDING;
@@ -677,14 +715,15 @@ void CGovernanceManager::SyncObjects(CNode* pnode, CConnman& connman) const
     // do not provide any data until our node is synced
     if (!masternodeSync.IsSynced()) return;
 
-    if (netfulfilledman.HasFulfilledRequest(pnode->addr, NetMsgType::MNGOVERNANCESYNC)) {
+    static const int nGovernanceSyncRequestId = netfulfilledman.GetRequestId(NetMsgType::MNGOVERNANCESYNC);
+    if (netfulfilledman.HasFulfilledRequest(pnode->addr, nGovernanceSyncRequestId)) {
         LOCK(cs_main);
         // Asking for the whole list multiple times in a short period of time is no good
         LogPrint(BCLog::GOBJECT, "CGovernanceManager::%s -- peer already asked me for the list\n", __func__);
         Misbehaving(pnode->GetId(), 20);
         return;
     }
-    netfulfilledman.AddFulfilledRequest(pnode->addr, NetMsgType::MNGOVERNANCESYNC);
+    netfulfilledman.AddFulfilledRequest(pnode->addr, nGovernanceSyncRequestId);
 
     int nObjCount = 0;
 
@@ -860,7 +899,7 @@ bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote,
         return false;
     }
 
-    bool fOk = govobj.ProcessVote(pfrom, vote, exception, connman) && cmapVoteToObject.Insert(nHashVote, &govobj);
+    bool fOk = govobj.ProcessVote(*this, pfrom, vote, exception, connman) && cmapVoteToObject.Insert(nHashVote, &govobj);
     LEAVE_CRITICAL_SECTION(cs);
     return fOk;
 }
@@ -872,7 +911,7 @@ void CGovernanceManager::CheckMasternodeOrphanVotes(CConnman& connman)
     ScopedLockBool guard(cs, fRateChecksEnabled, false);
 
     for (auto& objPair : mapObjects) {
-        objPair.second.CheckOrphanVotes(connman);
+        objPair.second.CheckOrphanVotes(*this, connman);
     }
 }
 
@@ -991,6 +1030,21 @@ void CGovernanceManager::RequestGovernanceObject(CNode* pfrom, const uint256& nH
         return;
     }
 
+    if (pfrom->nVersion >= GOVERNANCE_VOTE_DIGEST_PROTO_VERSION) {
+        // The peer only announces the votes in buckets we have different votes in
+        CGovernanceObjectVoteFile::vote_digest_t vecDigests;
+        if (fUseFilter) {
+            LOCK(cs);
+            CGovernanceObject* pObj = FindGovernanceObject(nHash);
+            if (pObj) {
+                vecDigests = pObj->GetVoteFile().GetDigests();
+            }
+        }
+        LogPrint(BCLog::GOBJECT, "CGovernanceManager::RequestGovernanceObject -- nHash %s digests %d peer=%d\n", nHash.ToString(), vecDigests.size(), pfrom->GetId());
+        g_connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNGOVERNANCEVOTEDIGEST, nHash, vecDigests));
+        return;
+    }
+
     CBloomFilter filter;
     filter.clear();
 
@@ -1150,12 +1204,16 @@ void CGovernanceManager::RebuildIndexes()
     LOCK(cs);
 
     cmapVoteToObject.Clear();
+    mapMasternodeVotedObjects.clear();
     for (auto& objPair : mapObjects) {
         CGovernanceObject& govobj = objPair.second;
         std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
         for (size_t i = 0; i < vecVotes.size(); ++i) {
             cmapVoteToObject.Insert(vecVotes[i].GetHash(), &govobj);
         }
+        for (const auto& votepair : govobj.mapCurrentMNVotes) {
+            mapMasternodeVotedObjects[votepair.first].insert(objPair.first);
+        }
     }
 }
 
@@ -1179,6 +1237,33 @@ void CGovernanceManager::AddCachedTriggers()
     }
 }
 
+void CGovernanceManager::LoadStoredVotes()
+{
+    AssertLockHeld(cs);
+
+    if (!pvoteDb) {
+        return;
+    }
+
+    size_t nLoaded = 0, nDropped = 0;
+    pvoteDb->LoadVotes([&](const CGovernanceVote& vote) {
+        auto it = mapObjects.find(vote.GetParentHash());
+        if (it == mapObjects.end()) {
+            // object was erased or not persisted before shutdown
+            nDropped++;
+            return false;
+        }
+        LOCK(it->second.cs);
+        it->second.fileVotes.AddVote(vote);
+        nLoaded++;
+        return true;
+    });
+    for (auto& objPair : mapObjects) {
+        objPair.second.RebuildCurrentVotes();
+    }
+    LogPrintf("CGovernanceManager::%s -- loaded %d votes, dropped %d votes of unknown objects\n", __func__, nLoaded, nDropped);
+}
+
 void CGovernanceManager::InitOnLoad()
 {
     LOCK(cs);
@@ -1190,6 +1275,18 @@ void CGovernanceManager::InitOnLoad()
     LogPrintf("     %s\n", ToString());
 }
 
+void CGovernanceManager::OpenVoteDb(bool fWipe)
+{
+    LOCK(cs);
+    pvoteDb.reset(new CGovernanceVoteDb(VOTE_DB_CACHE_SIZE, false, fWipe));
+}
+
+void CGovernanceManager::CloseVoteDb()
+{
+    LOCK(cs);
+    pvoteDb.reset();
+}
+
 std::string CGovernanceManager::ToString() const
 {
     LOCK(cs);
@@ -1343,17 +1440,34 @@ void CGovernanceManager::RemoveInvalidVotes()
     }
 
     for (const auto& outpoint : changedKeyMNs) {
-        for (auto& p : mapObjects) {
-            auto removed = p.second.RemoveInvalidVotes(outpoint);
-            if (removed.empty()) {
+        auto itVoted = mapMasternodeVotedObjects.find(outpoint);
+        if (itVoted == mapMasternodeVotedObjects.end()) {
+            continue;
+        }
+        // Only the objects this masternode has voted in are revalidated
+        auto itHash = itVoted->second.begin();
+        while (itHash != itVoted->second.end()) {
+            auto itObject = mapObjects.find(*itHash);
+            if (itObject == mapObjects.end()) {
+                itHash = itVoted->second.erase(itHash);
                 continue;
             }
+            CGovernanceObject& govobj = itObject->second;
+            auto removed = govobj.RemoveInvalidVotes(*this, outpoint);
             for (auto& voteHash : removed) {
                 cmapVoteToObject.Erase(voteHash);
                 cmapInvalidVotes.Erase(voteHash);
                 cmmapOrphanVotes.Erase(voteHash);
                 setRequestedVotes.erase(voteHash);
             }
+            if (govobj.mapCurrentMNVotes.count(outpoint)) {
+                ++itHash;
+            } else {
+                itHash = itVoted->second.erase(itHash);
+            }
+        }
+        if (itVoted->second.empty()) {
+            mapMasternodeVotedObjects.erase(itVoted);
         }
     }
 
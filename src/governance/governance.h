@@ -12,6 +12,7 @@
 #include <governance/governance-exceptions.h>
 #include <governance/governance-object.h>
 #include <governance/governance-vote.h>
+#include <governance/governance-votedb.h>
 #include <net.h>
 #include <sync.h>
 #include <timedata.h>
@@ -150,7 +151,7 @@ public:
 //
 class CGovernanceManager
 {
-    friend class CGovernanceObject;
+    friend class governance_tests::TestGovernanceManager; // for test access to mapObjects and the stored votes
 
 public: // Types
     struct last_object_rec {
@@ -202,6 +203,8 @@ public: // Types
 
     typedef std::map<COutPoint, int> txout_int_m_t;
 
+    typedef std::map<COutPoint, std::set<uint256>> txout_hash_s_m_t;
+
     typedef std::set<uint256> hash_s_t;
 
     typedef hash_s_t::iterator hash_s_it;
@@ -223,6 +226,8 @@ public: // Types
 private:
     static const int MAX_CACHE_SIZE = 1000000;
 
+    static const size_t VOTE_DB_CACHE_SIZE = 8 << 20;
+
     static const std::string SERIALIZATION_VERSION_STRING;
 
     static const int MAX_TIME_FUTURE_DEVIATION;
@@ -249,6 +254,9 @@ private:
 
     object_ref_cm_t cmapVoteToObject;
 
+    // hashes of the objects each masternode has votes in, may contain objects the votes were removed from
+    txout_hash_s_m_t mapMasternodeVotedObjects;
+
     vote_cm_t cmapInvalidVotes;
 
     vote_cmm_t cmmapOrphanVotes;
@@ -264,6 +272,9 @@ private:
     // used to check for changed voting keys
     CDeterministicMNList lastMNListForVotingKeys;
 
+    // votes of mapObjects, persisted as they change instead of in governance.dat
+    std::unique_ptr<CGovernanceVoteDb> pvoteDb;
+
     class ScopedLockBool
     {
         bool& ref;
@@ -299,7 +310,7 @@ public:
      */
     bool ConfirmInventoryRequest(const CInv& inv);
 
-    void SyncSingleObjVotes(CNode* pnode, const uint256& nProp, const CBloomFilter& filter, CConnman& connman);
+    void SyncSingleObjVotes(CNode* pnode, const uint256& nProp, const CBloomFilter& filter, const CGovernanceObjectVoteFile::vote_digest_t& vecDigests, CConnman& connman);
     void SyncObjects(CNode* pnode, CConnman& connman) const;
 
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
@@ -326,6 +337,7 @@ public:
         mapObjects.clear();
         mapErasedGovernanceObjects.clear();
         cmapVoteToObject.Clear();
+        mapMasternodeVotedObjects.clear();
         cmapInvalidVotes.Clear();
         cmmapOrphanVotes.Clear();
         mapLastMasternodeObject.clear();
@@ -345,6 +357,8 @@ public:
             Clear();
             READWRITE(strVersion);
             if (strVersion != SERIALIZATION_VERSION_STRING) {
+                // the objects are gone, so are their stored votes
+                LoadStoredVotes();
                 return;
             }
         } else {
@@ -358,6 +372,11 @@ public:
         READWRITE(mapObjects);
         READWRITE(mapLastMasternodeObject);
         READWRITE(lastMNListForVotingKeys);
+
+        if (ser_action.ForRead()) {
+            // before CFlatDB runs CheckAndRemove, which computes the cached flags from the tallies
+            LoadStoredVotes();
+        }
     }
 
     void UpdatedBlockTip(const CBlockIndex* pindex, CConnman& connman);
@@ -416,16 +435,45 @@ public:
 
     void InitOnLoad();
 
-    int RequestGovernanceObjectVotes(NodeId id = -1);
+    /// Open the vote database, must be called before governance.dat is loaded
+    void OpenVoteDb(bool fWipe);
+    void CloseVoteDb();
 
-private:
-    void RequestGovernanceObject(CNode* pfrom, const uint256& nHash, bool fUseFilter = false);
+    int RequestGovernanceObjectVotes(NodeId id = -1);
 
+    // Updates of the vote indexes and the vote database, called by the objects whose votes changed
     void AddInvalidVote(const CGovernanceVote& vote)
     {
         cmapInvalidVotes.Insert(vote.GetHash(), vote);
     }
 
+    void AddMasternodeVotedObject(const CGovernanceVote& vote)
+    {
+        AssertLockHeld(cs);
+        mapMasternodeVotedObjects[vote.GetMasternodeOutpoint()].insert(vote.GetParentHash());
+    }
+
+    void StoreVote(const CGovernanceVote& vote)
+    {
+        if (pvoteDb) pvoteDb->WriteVote(vote);
+    }
+
+    void EraseStoredVote(const uint256& nParentHash, const COutPoint& outpointMasternode, int nSignal)
+    {
+        if (pvoteDb) pvoteDb->EraseVote(nParentHash, outpointMasternode, nSignal);
+    }
+
+    void EraseStoredVotes(const uint256& nParentHash, const COutPoint& outpointMasternode)
+    {
+        if (pvoteDb) pvoteDb->EraseMasternodeVotes(nParentHash, outpointMasternode);
+    }
+
+private:
+    void RequestGovernanceObject(CNode* pfrom, const uint256& nHash, bool fUseFilter = false);
+
+    /// Add the stored votes to their objects, drop the ones of unknown objects
+    void LoadStoredVotes();
+
     void AddOrphanVote(const CGovernanceVote& vote)
     {
         cmmapOrphanVotes.Insert(vote.GetHash(), vote_time_pair_t(vote, GetAdjustedTime() + GOVERNANCE_ORPHAN_EXPIRATION_TIME));
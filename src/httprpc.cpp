@@ -8,6 +8,7 @@
 #include <crypto/hmac_sha256.h>
 #include <httpserver.h>
 #include <key_io.h>
+#include <rpc/jsonstream.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <sync.h>
@@ -80,6 +81,8 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
 
     std::string strReply = JSONRPCReply(NullUniValue, objError, id);
 
+    // Drop what a failed RPC streamed already
+    req->ClearReplyData();
     req->WriteHeader("Content-Type", "application/json");
     req->WriteReply(nStatus, strReply);
 }
@@ -189,7 +192,25 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
+            // RPCs with large results write them into the reply while they produce them
+            JSONStreamWriter writer([req](const char* pch, size_t nSize) { req->WriteReplyData(pch, nSize); });
+            writer.BeginObject();
+            writer.Key("result");
+            jreq.stream = &writer;
             UniValue result = tableRPC.execute(jreq);
+            jreq.stream = nullptr;
+
+            if (!writer.ExpectsValue()) {
+                // The result was streamed, finish the reply like JSONRPCReply does
+                writer.KeyValue("error", NullUniValue);
+                writer.KeyValue("id", jreq.id);
+                writer.EndObject();
+                writer.Raw("\n");
+                writer.Flush();
+                req->WriteHeader("Content-Type", "application/json");
+                req->WriteReply(HTTP_OK);
+                return true;
+            }
 
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
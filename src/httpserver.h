@@ -105,6 +105,18 @@ public:
      */
     void WriteHeader(const std::string& hdr, const std::string& value);
 
+    /**
+     * Append data to the body of the reply, without sending it yet.
+     *
+     * @note This allows writing large replies in chunks, WriteReply sends them.
+     */
+    void WriteReplyData(const char* data, size_t size);
+
+    /**
+     * Discard the data appended by WriteReplyData.
+     */
+    void ClearReplyData();
+
     /**
      * Write HTTP reply.
      * nStatus is the HTTP status code to send.
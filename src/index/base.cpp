@@ -303,7 +303,7 @@ void BaseIndex::Start()
 {
     // Need to register this ValidationInterface before running Init(), so that
     // callbacks are not missed if Init sets m_synced to true.
-    RegisterValidationInterface(this);
+    RegisterValidationInterface(this, GetName());
     if (!Init()) {
         FatalError("%s: %s failed to initialize", __func__, GetName());
         return;
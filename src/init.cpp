@@ -17,6 +17,7 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <coins.h>
+#include <coinsprefetch.h>
 #include <compat/sanity.h>
 #include <consensus/validation.h>
 #include <flat-database.h>
@@ -172,6 +173,9 @@ static std::unique_ptr<ECCVerifyHandle> globalVerifyHandle;
 
 static boost::thread_group threadGroup;
 static CScheduler scheduler;
+// Runs the validation interface callbacks, separate from the scheduler so that slow
+// listeners do not hold up the periodic tasks
+static CScheduler validationScheduler;
 
 void Interrupt()
 {
@@ -253,6 +257,7 @@ void Shutdown(InitInterfaces& interfaces)
         CFlatDB<CSporkManager> flatdb6("sporks.dat", "magicSporkCache");
         flatdb6.Dump(sporkManager);
     }
+    governance.CloseVoteDb();
 
     if (::mempool.IsLoaded() && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool(::mempool);
@@ -290,8 +295,10 @@ void Shutdown(InitInterfaces& interfaces)
         if (pcoinsTip != nullptr) {
             ::ChainstateActive().ForceFlushStateToDisk();
         }
+        g_coins_prefetcher.reset();
         pcoinsTip.reset();
         pcoinscatcher.reset();
+        pcoinsflusher.reset();
         pcoinsdbview.reset();
         pblocktree.reset();
         llmq::DestroyLLMQSystem();
@@ -310,6 +317,11 @@ void Shutdown(InitInterfaces& interfaces)
     }
 #endif
 
+    if (g_txselection_cache) {
+        UnregisterValidationInterface(g_txselection_cache.get());
+        g_txselection_cache.reset();
+    }
+
     if (g_mn_notification_interface) {
         UnregisterValidationInterface(g_mn_notification_interface);
         delete g_mn_notification_interface;
@@ -412,6 +424,7 @@ void SetupServerArgs()
     gArgs.AddArg("-alertnotify=<cmd>", "Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)", false, OptionsCategory::OPTIONS);
 #endif
     gArgs.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-asyncflush", strprintf("Write the chainstate to disk on a background thread unless shutting down or pruning. While a write is in progress its changes are held in memory in addition to -dbcache (default: %u)", DEFAULT_ASYNC_FLUSH), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksdir=<dir>", "Specify directory to hold blocks subdirectory for *.dat files (default: <datadir>)", false, OptionsCategory::OPTIONS);
 #if HAVE_SYSTEM
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", false, OptionsCategory::OPTIONS);
@@ -428,17 +441,22 @@ void SetupServerArgs()
     gArgs.AddArg("-loadblock=<file>", "Imports blocks from external blk000??.dat file on startup", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-maxorphantxperpeer=<n>", strprintf("Keep at most <n> unconnectable transactions received from the same peer in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS_PER_PEER), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCORN_PID_FILENAME), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-prefetchcoins=<n>", strprintf("Number of threads reading the inputs of new blocks from the chainstate database before they are connected (up to %d, 0 to disable, default: %d)", MAX_COINS_PREFETCH_THREADS, DEFAULT_COINS_PREFETCH_THREADS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-rawblockcache=<n>", strprintf("Keep up to <n> recently served blocks in memory in serialized form (0 to disable, default: %u)", DEFAULT_RAW_BLOCK_CACHE_SIZE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead.", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-reindexthreads=<n>", strprintf("Set the number of block files scanned ahead in parallel during -reindex, each kept deserialized in memory until indexed. The files read ahead are also limited to half of -dbcache (up to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
+        MAX_REINDEX_THREADS, DEFAULT_REINDEX_THREADS), false, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg("-sysperms", "Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)", false, OptionsCategory::OPTIONS);
 #else
@@ -468,6 +486,7 @@ void SetupServerArgs()
     gArgs.AddArg("-maxsendbuffer=<n>", strprintf("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXSENDBUFFER), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxtimeadjustment", strprintf("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)", DEFAULT_MAX_TIME_ADJUSTMENT), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxuploadtarget=<n>", strprintf("Tries to keep outbound traffic under the given target (in MiB per 24h), 0 = no limit (default: %d)", DEFAULT_MAX_UPLOAD_TARGET), false, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-msghandlerthreads=<n>", strprintf("Number of threads processing sporks, governance votes, LLMQ messages and pings next to the message handler thread, peers are spread evenly over them (0-%d, default: %d)", MAX_MSG_HANDLER_THREADS, DEFAULT_MSG_HANDLER_THREADS), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onion=<ip:port>", "Use separate SOCKS5 proxy to reach peers via Tor hidden services, set -noonion to disable (default: -proxy)", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onlynet=<net>", "Make outgoing connections only through network <net> (ipv4, ipv6 or onion). Incoming connections are not affected by this option. This option can be specified multiple times to allow multiple networks.", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS), false, OptionsCategory::CONNECTION);
@@ -476,6 +495,7 @@ void SetupServerArgs()
     gArgs.AddArg("-proxy=<ip:port>", "Connect through SOCKS5 proxy, set -noproxy to disable (default: disabled)", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-proxyrandomize", strprintf("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)", DEFAULT_PROXYRANDOMIZE), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-seednode=<ip>", "Connect to a node to retrieve peer addresses, and disconnect. This option can be specified multiple times to connect to multiple nodes.", false, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-socketevents=<mode>", strprintf("Socket events mode, which must be one of: %s (default: %s)", GetSupportedSocketEventsModes(), SocketEventsModeToString(DEFAULT_SOCKETEVENTS)), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-timeout=<n>", strprintf("Specify connection timeout in milliseconds (minimum: 1, default: %d)", DEFAULT_CONNECT_TIMEOUT), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peertimeout=<n>", strprintf("Specify p2p connection timeout in seconds. This option determines the amount of time a peer may be inactive before the connection to it is dropped. (minimum: 1, default: %d)", DEFAULT_PEER_CONNECT_TIMEOUT), true, OptionsCategory::CONNECTION);
     gArgs.AddArg("-torcontrol=<ip>:<port>", strprintf("Tor control port to use if onion listening enabled (default: %s)", DEFAULT_TOR_CONTROL), false, OptionsCategory::CONNECTION);
@@ -508,6 +528,14 @@ void SetupServerArgs()
     gArgs.AddArg("-zmqpubhashtxlock=<address>", "Enable publish hash transaction (locked via InstantSend) in <address>", false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubhashinstantsenddoublespend=<address>", "Enable publish transaction hashes of attempted InstantSend double spend in <address>", false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawinstantsenddoublespend=<address>", "Enable publish raw transactions of attempted InstantSend double spend in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubhashchainlock=<address>", "Enable publish hash block (locked via ChainLocks) in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubrawchainlock=<address>", "Enable publish raw block (locked via ChainLocks) in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubhashgovernancevote=<address>", "Enable publish hash of governance votes in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubrawgovernancevote=<address>", "Enable publish raw governance votes in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubhashgovernanceobject=<address>", "Enable publish hash of governance objects (like proposals) in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubrawgovernanceobject=<address>", "Enable publish raw governance objects (like proposals) in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubhashmnlistdiff=<address>", "Enable publish hash of the block of the new masternode list (the connected block, or the parent of the disconnected one) in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubrawmnlistdiff=<address>", "Enable publish raw masternode list diffs in <address>", false, OptionsCategory::ZMQ);
 
 #else
     hidden_args.emplace_back("-zmqpubhashblock=<address>");
@@ -518,6 +546,18 @@ void SetupServerArgs()
     hidden_args.emplace_back("-zmqpubhashtxhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawtxhwm=<n>");
+    hidden_args.emplace_back("-zmqpubrawtxlock=<address>");
+    hidden_args.emplace_back("-zmqpubhashtxlock=<address>");
+    hidden_args.emplace_back("-zmqpubhashinstantsenddoublespend=<address>");
+    hidden_args.emplace_back("-zmqpubrawinstantsenddoublespend=<address>");
+    hidden_args.emplace_back("-zmqpubhashchainlock=<address>");
+    hidden_args.emplace_back("-zmqpubrawchainlock=<address>");
+    hidden_args.emplace_back("-zmqpubhashgovernancevote=<address>");
+    hidden_args.emplace_back("-zmqpubrawgovernancevote=<address>");
+    hidden_args.emplace_back("-zmqpubhashgovernanceobject=<address>");
+    hidden_args.emplace_back("-zmqpubrawgovernanceobject=<address>");
+    hidden_args.emplace_back("-zmqpubhashmnlistdiff=<address>");
+    hidden_args.emplace_back("-zmqpubrawmnlistdiff=<address>");
 #endif
 
     gArgs.AddArg("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS), true, OptionsCategory::DEBUG_TEST);
@@ -554,6 +594,8 @@ void SetupServerArgs()
     gArgs.AddArg("-printpriority", strprintf("Log transaction fee per kB when mining blocks (default: %u)", DEFAULT_PRINTPRIORITY), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-printtoconsole", "Send trace/debug info to console (default: 1 when no -daemon. To disable logging to file, set -nodebuglogfile)", false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-shrinkdebugfile", "Shrink debug.log file on client startup (default: 1 when no -debug)", false, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-validationcallbackthreads=<n>", strprintf("Number of threads running the validation interface callbacks (1 to 16, default: %u)", DEFAULT_VALIDATION_THREADS), true, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-validationqueuedepth=<n>", strprintf("Number of validation interface callbacks a listener may fall behind before block connection waits for it (default: %u)", DEFAULT_VALIDATION_QUEUE_DEPTH), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-uacomment=<cmt>", "Append comment to the user agent string", false, OptionsCategory::DEBUG_TEST);
 
     SetupChainParamsBaseOptions();
@@ -729,18 +771,14 @@ static void ThreadImport(std::vector<fs::path> vImportFiles)
 
     // -reindex
     if (fReindex) {
-        int nFile = 0;
-        while (true) {
-            FlatFilePos pos(nFile, 0);
-            if (!fs::exists(GetBlockPosFilename(pos)))
-                break; // No block files left to reindex
-            FILE *file = OpenBlockFile(pos, true);
-            if (!file)
-                break; // This error is logged in OpenBlockFile
-            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-            LoadExternalBlockFile(chainparams, file, &pos);
-            nFile++;
-        }
+        // -reindexthreads=0 means autodetect, like -par
+        int nReindexThreads = gArgs.GetArg("-reindexthreads", DEFAULT_REINDEX_THREADS);
+        if (nReindexThreads <= 0)
+            nReindexThreads += GetNumCores();
+        nReindexThreads = std::max(1, std::min(nReindexThreads, MAX_REINDEX_THREADS));
+        // The coins cache stays mostly empty until the chain is activated after
+        // the reindex, so half of it bounds the block files read ahead.
+        ReindexBlockFiles(chainparams, nReindexThreads, nCoinCacheUsage / 2);
         pblocktree->WriteReindexing(false);
         fReindex = false;
         LogPrintf("Reindexing finished\n");
@@ -950,6 +988,7 @@ int nUserMaxConnections;
 int nFD;
 ServiceFlags nLocalServices = ServiceFlags(NODE_NETWORK | NODE_NETWORK_LIMITED);
 int64_t peer_connect_timeout;
+SocketEventsMode socketEventsMode = DEFAULT_SOCKETEVENTS;
 std::vector<BlockFilterType> g_enabled_filter_types;
 
 } // namespace
@@ -1186,6 +1225,11 @@ bool AppInitParameterInteraction()
         return InitError("peertimeout cannot be configured with a negative value.");
     }
 
+    std::string strSocketEventsMode = gArgs.GetArg("-socketevents", SocketEventsModeToString(DEFAULT_SOCKETEVENTS));
+    if (!SocketEventsModeFromString(strSocketEventsMode, socketEventsMode)) {
+        return InitError(strprintf(_("Invalid -socketevents ('%s') specified. Only these modes are supported: %s").translated, strSocketEventsMode, GetSupportedSocketEventsModes()));
+    }
+
     if (gArgs.IsArgSet("-minrelaytxfee")) {
         CAmount n = 0;
         if (!ParseMoney(gArgs.GetArg("-minrelaytxfee", ""), n)) {
@@ -1343,6 +1387,7 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitRawBlockCache(std::max<int64_t>(0, gArgs.GetArg("-rawblockcache", DEFAULT_RAW_BLOCK_CACHE_SIZE)));
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
@@ -1380,7 +1425,15 @@ bool AppInitMain(InitInterfaces& interfaces)
     CScheduler::Function serviceLoop = std::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
 
-    GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+    // Start the threads running the validation interface callbacks
+    const int nValidationThreads = std::max(1, std::min((int)gArgs.GetArg("-validationcallbackthreads", DEFAULT_VALIDATION_THREADS), 16));
+    for (int i = 0; i < nValidationThreads; i++) {
+        CScheduler::Function validationLoop = std::bind(&CScheduler::serviceQueue, &validationScheduler);
+        threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "valcb", validationLoop));
+    }
+
+    GetMainSignals().RegisterBackgroundSignalScheduler(validationScheduler);
+    GetMainSignals().SetMaxQueueDepth(gArgs.GetArg("-validationqueuedepth", DEFAULT_VALIDATION_QUEUE_DEPTH));
     GetMainSignals().RegisterWithMempoolSignals(mempool);
 
     // Create client interfaces for wallets that are supposed to be loaded
@@ -1432,7 +1485,7 @@ bool AppInitMain(InitInterfaces& interfaces)
     g_connman = std::unique_ptr<CConnman>(new CConnman(GetRand(std::numeric_limits<uint64_t>::max()), GetRand(std::numeric_limits<uint64_t>::max())));
 
     peerLogic.reset(new PeerLogicValidation(g_connman.get(), g_banman.get(), scheduler, gArgs.GetBoolArg("-enablebip61", DEFAULT_ENABLE_BIP61)));
-    RegisterValidationInterface(peerLogic.get());
+    RegisterValidationInterface(peerLogic.get(), "peerlogic");
 
     // sanitize comments per BIP-0014, format user agent and check total size
     std::vector<std::string> uacomments;
@@ -1524,12 +1577,15 @@ bool AppInitMain(InitInterfaces& interfaces)
     g_zmq_notification_interface = CZMQNotificationInterface::Create();
 
     if (g_zmq_notification_interface) {
-        RegisterValidationInterface(g_zmq_notification_interface);
+        RegisterValidationInterface(g_zmq_notification_interface, "zmq");
     }
 #endif
 
     g_mn_notification_interface = new CMNNotificationInterface(*g_connman.get());
-    RegisterValidationInterface(g_mn_notification_interface);
+    RegisterValidationInterface(g_mn_notification_interface, "mnnotification");
+
+    g_txselection_cache = MakeUnique<CBlockTxSelectionCache>();
+    RegisterValidationInterface(g_txselection_cache.get(), "txselection");
 
     uint64_t nMaxOutboundLimit = 0; //unlimited unless -maxuploadtarget is set
     uint64_t nMaxOutboundTimeframe = MAX_UPLOAD_TIMEFRAME;
@@ -1590,8 +1646,9 @@ bool AppInitMain(InitInterfaces& interfaces)
                 LOCK(cs_main);
                 UnloadBlockIndex();
                 pcoinsTip.reset();
-                pcoinsdbview.reset();
                 pcoinscatcher.reset();
+                pcoinsflusher.reset();
+                pcoinsdbview.reset();
                 // new CBlockTreeDB tries to delete the existing file, which
                 // fails if it's still open from the previous loop. Close it first:
                 pblocktree.reset();
@@ -1650,7 +1707,8 @@ bool AppInitMain(InitInterfaces& interfaces)
                 // block tree into BlockIndex()!
 
                 pcoinsdbview.reset(new CCoinsViewDB(nCoinDBCache, false, fReset || fReindexChainState));
-                pcoinscatcher.reset(new CCoinsViewErrorCatcher(pcoinsdbview.get()));
+                pcoinsflusher.reset(new CCoinsViewBackgroundFlush(*pcoinsdbview));
+                pcoinscatcher.reset(new CCoinsViewErrorCatcher(pcoinsflusher.get()));
                 pcoinscatcher->AddReadErrCallback([]() {
                     uiInterface.ThreadSafeMessageBox(
                         _("Error reading from database, shutting down.").translated,
@@ -1768,6 +1826,11 @@ bool AppInitMain(InitInterfaces& interfaces)
         ::feeEstimator.Read(est_filein);
     fFeeEstimatesInitialized = true;
 
+    int nPrefetchThreads = gArgs.GetArg("-prefetchcoins", DEFAULT_COINS_PREFETCH_THREADS);
+    if (nPrefetchThreads > 0) {
+        g_coins_prefetcher = MakeUnique<CCoinsPrefetcher>(*pcoinsflusher, std::min(nPrefetchThreads, MAX_COINS_PREFETCH_THREADS));
+    }
+
     // ********************************************************* Step 8-A: start indexers
     if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
         g_txindex = MakeUnique<TxIndex>(nTxIndexCache, false, fReindex);
@@ -1858,7 +1921,7 @@ bool AppInitMain(InitInterfaces& interfaces)
 
         // Create and register activeMasternodeManager, will init later in ThreadImport
         activeMasternodeManager = new CActiveMasternodeManager();
-        RegisterValidationInterface(activeMasternodeManager);
+        RegisterValidationInterface(activeMasternodeManager, "activemasternode");
     }
 
     if (activeMasternodeInfo.blsKeyOperator == nullptr)
@@ -1870,6 +1933,9 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     // LOAD SERIALIZED DAT FILES INTO DATA CACHES FOR INTERNAL USE
     bool fIgnoreCacheFiles = fLiteMode || fReindex || fReindexChainState;
+    if (!fLiteMode) {
+        governance.OpenVoteDb(fIgnoreCacheFiles);
+    }
     if (!fIgnoreCacheFiles) {
         boost::filesystem::path pathDB = GetDataDir();
         std::string strDBName;
@@ -1901,6 +1967,14 @@ bool AppInitMain(InitInterfaces& interfaces)
         scheduler.scheduleEvery(boost::bind(&CMasternodeSync::DoMaintenance, boost::ref(masternodeSync), boost::ref(*g_connman)), 1 * 1000);
         scheduler.scheduleEvery(boost::bind(&CMasternodeUtils::DoMaintenance, boost::ref(*g_connman)), 1 * 1000);
         scheduler.scheduleEvery(boost::bind(&CGovernanceManager::DoMaintenance, boost::ref(governance)), 60 * 5 * 1000);
+        // votes are persisted as they arrive, the objects and masternode metadata are dumped periodically
+        // so that an unclean shutdown loses at most a few minutes of them
+        scheduler.scheduleEvery([]{
+            CFlatDB<CMasternodeMetaMan> flatdb1("mncache.dat", "magicMasternodeCache");
+            flatdb1.Dump(mmetaman);
+            CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
+            flatdb3.Dump(governance);
+        }, 15 * 60 * 1000);
     }
 
     llmq::StartLLMQSystem();
@@ -1962,6 +2036,7 @@ bool AppInitMain(InitInterfaces& interfaces)
         LOCK(cs_main);
         LogPrintf("block tree size = %u\n", ::BlockIndex().size());
         chain_active_height = ::ChainActive().Height();
+        PublishChainSnapshot();
     }
     LogPrintf("nBestHeight = %d\n", chain_active_height);
 
@@ -1987,11 +2062,13 @@ bool AppInitMain(InitInterfaces& interfaces)
     connOptions.m_msgproc = peerLogic.get();
     connOptions.nSendBufferMaxSize = 1000*gArgs.GetArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000*gArgs.GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
+    connOptions.nMsgHandlerThreads = gArgs.GetArg("-msghandlerthreads", DEFAULT_MSG_HANDLER_THREADS);
     connOptions.m_added_nodes = gArgs.GetArgs("-addnode");
 
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
     connOptions.m_peer_connect_timeout = peer_connect_timeout;
+    connOptions.socketEventsMode = socketEventsMode;
 
     for (const std::string& strBind : gArgs.GetArgs("-bind")) {
         CService addrBind;
@@ -5,6 +5,7 @@
 #ifndef BITCORN_INTERFACES_CHAIN_H
 #define BITCORN_INTERFACES_CHAIN_H
 
+#include <blockfilter.h>           // For BlockFilterType and GCSFilter::ElementSet
 #include <optional.h>               // For Optional and nullopt
 #include <primitives/transaction.h> // For CTransactionRef
 
@@ -154,6 +155,13 @@ public:
     //! populates the values.
     virtual void findCoins(std::map<COutPoint, Coin>& coins) = 0;
 
+    //! Return whether the node keeps a block filter index of this type.
+    virtual bool hasBlockFilterIndex(BlockFilterType filter_type) = 0;
+
+    //! Return whether any of the elements match the filter of the block, or
+    //! nullopt if the filter of the block isn't available (yet).
+    virtual Optional<bool> blockFilterMatchesAny(BlockFilterType filter_type, const uint256& block_hash, const GCSFilter::ElementSet& filter_set) = 0;
+
     //! Estimate fraction of total transactions verified if blocks up to
     //! the specified block hash are verified.
     virtual double guessVerificationProgress(const uint256& block_hash) = 0;
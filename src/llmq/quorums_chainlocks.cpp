@@ -135,6 +135,7 @@ void CChainLocksHandler::ProcessNewChainLock(NodeId from, const llmq::CChainLock
 
         bestChainLockHash = hash;
         bestChainLock = clsig;
+        PublishChainSnapshot();
 
         CInv inv(MSG_CLSIG, hash);
         g_connman->RelayInv(inv, PROTOCOL_VERSION);
@@ -573,6 +574,12 @@ void CChainLocksHandler::DoInvalidateBlock(const CBlockIndex* pindex, bool activ
     }
 }
 
+CChainLockSig CChainLocksHandler::GetBestChainLock()
+{
+    LOCK(cs);
+    return bestChainLockWithKnownBlock;
+}
+
 bool CChainLocksHandler::HasChainLock(int nHeight, const uint256& blockHash)
 {
     LOCK(cs);
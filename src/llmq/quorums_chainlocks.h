@@ -87,6 +87,8 @@ public:
 
     bool AlreadyHave(const CInv& inv);
     bool GetChainLockByHash(const uint256& hash, CChainLockSig& ret);
+    /** The best ChainLock of a known block, nHeight is -1 if there is none */
+    CChainLockSig GetBestChainLock();
 
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman);
     void ProcessNewChainLock(NodeId from, const CChainLockSig& clsig, const uint256& hash);
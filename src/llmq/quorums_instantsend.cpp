@@ -43,6 +43,28 @@ uint256 CInstantSendLock::GetRequestId() const
 
 ////////////////
 
+CInstantSendDb::CInstantSendDb(CDBWrapper& _db) : db(_db)
+{
+    auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
+    auto firstKey = std::make_tuple(std::string("is_i"), uint256());
+
+    it->Seek(firstKey);
+
+    size_t cnt = 0;
+    while (it->Valid()) {
+        decltype(firstKey) curKey;
+        if (!it->GetKey(curKey) || std::get<0>(curKey) != "is_i") {
+            break;
+        }
+
+        cnt++;
+
+        it->Next();
+    }
+
+    nInstantSendLockCount = cnt;
+}
+
 void CInstantSendDb::WriteNewInstantSendLock(const uint256& hash, const CInstantSendLock& islock)
 {
     CDBBatch batch(db);
@@ -52,6 +74,8 @@ void CInstantSendDb::WriteNewInstantSendLock(const uint256& hash, const CInstant
         batch.Write(std::make_tuple(std::string("is_in"), in), hash);
     }
     db.WriteBatch(batch);
+    // The callers only write islocks which are not in the database yet
+    nInstantSendLockCount++;
 
     auto p = std::make_shared<CInstantSendLock>(islock);
     islockCache.insert(hash, p);
@@ -75,6 +99,7 @@ void CInstantSendDb::RemoveInstantSendLock(CDBBatch& batch, const uint256& hash,
     for (auto& in : islock->inputs) {
         batch.Erase(std::make_tuple(std::string("is_in"), in));
     }
+    nInstantSendLockCount--;
 
     islockCache.erase(hash);
     txidCache.erase(islock->txid);
@@ -180,24 +205,7 @@ bool CInstantSendDb::HasArchivedInstantSendLock(const uint256& islockHash)
 
 size_t CInstantSendDb::GetInstantSendLockCount()
 {
-    auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
-    auto firstKey = std::make_tuple(std::string("is_i"), uint256());
-
-    it->Seek(firstKey);
-
-    size_t cnt = 0;
-    while (it->Valid()) {
-        decltype(firstKey) curKey;
-        if (!it->GetKey(curKey) || std::get<0>(curKey) != "is_i") {
-            break;
-        }
-
-        cnt++;
-
-        it->Next();
-    }
-
-    return cnt;
+    return nInstantSendLockCount;
 }
 
 CInstantSendLockPtr CInstantSendDb::GetInstantSendLockByHash(const uint256& hash)
@@ -1424,6 +1432,16 @@ bool CInstantSendManager::GetInstantSendLockByHash(const uint256& hash, llmq::CI
     return true;
 }
 
+CInstantSendLockPtr CInstantSendManager::GetInstantSendLockByTxid(const uint256& txid)
+{
+    if (!IsInstantSendEnabled()) {
+        return nullptr;
+    }
+
+    LOCK(cs);
+    return db.GetInstantSendLockByTxid(txid);
+}
+
 bool CInstantSendManager::IsLocked(const uint256& txHash)
 {
     if (!IsInstantSendEnabled()) {
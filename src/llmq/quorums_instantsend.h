@@ -12,6 +12,7 @@
 #include <unordered_lru_cache.h>
 #include <primitives/transaction.h>
 
+#include <atomic>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -50,8 +51,11 @@ private:
     unordered_lru_cache<uint256, uint256, StaticSaltedHasher, 10000> txidCache;
     unordered_lru_cache<COutPoint, uint256, SaltedOutpointHasher, 10000> outpointCache;
 
+    //! Number of islocks in the database, counted once on startup and then kept up to date
+    std::atomic<size_t> nInstantSendLockCount{0};
+
 public:
-    CInstantSendDb(CDBWrapper& _db) : db(_db) {}
+    explicit CInstantSendDb(CDBWrapper& _db);
 
     void WriteNewInstantSendLock(const uint256& hash, const CInstantSendLock& islock);
     void RemoveInstantSendLock(CDBBatch& batch, const uint256& hash, CInstantSendLockPtr islock);
@@ -160,6 +164,7 @@ public:
 
     bool AlreadyHave(const CInv& inv);
     bool GetInstantSendLockByHash(const uint256& hash, CInstantSendLock& ret);
+    CInstantSendLockPtr GetInstantSendLockByTxid(const uint256& txid);
 
     size_t GetInstantSendLockCount();
 
@@ -65,7 +65,7 @@ void CMNNotificationInterface::SyncTransaction(const CTransaction &tx, const CBl
     llmq::chainLocksHandler->SyncTransaction(tx, pindex, posInBlock);
 }
 
-void CMNNotificationInterface::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff)
+void CMNNotificationInterface::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNList& newMNList, const CDeterministicMNListDiff& diff)
 {
     CMNAuth::NotifyMasternodeListChanged(undo, oldMNList, diff);
     // governance.CheckMasternodeOrphanObjects(connman);
@@ -24,7 +24,7 @@ protected:
     void NotifyHeaderTip(const CBlockIndex *pindexNew, bool fInitialDownload) ;
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) ;
     void SyncTransaction(const CTransaction &tx, const CBlockIndex *pindex, int posInBlock) ;
-    void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff) ;
+    void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNList& newMNList, const CDeterministicMNListDiff& diff) ;
     void NotifyChainLock(const CBlockIndex* pindex) ;
 
 private:
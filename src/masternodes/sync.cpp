@@ -77,8 +77,9 @@ void CMasternodeSync::SwitchToNextAsset(CConnman& connman)
             nCurrentAsset = MASTERNODE_SYNC_FINISHED;
             uiInterface.NotifyAdditionalDataSyncProgressChanged(1);
 
+            static const int nFullSyncRequestId = netfulfilledman.GetRequestId("full-sync");
             g_connman->ForEachNode([](CNode* node) {
-                netfulfilledman.AddFulfilledRequest(node->addr, "full-sync");
+                netfulfilledman.AddFulfilledRequest(node->addr, nFullSyncRequestId);
             });
             LogPrintf("CMasternodeSync::SwitchToNextAsset -- Sync has finished\n");
 
@@ -159,6 +160,11 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
     LogPrintf("CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d nTriedPeerCount %d nSyncProgress %f\n", nTick, nCurrentAsset, nTriedPeerCount, nSyncProgress);
     uiInterface.NotifyAdditionalDataSyncProgressChanged(nSyncProgress);
 
+    // Looked up once, the ids of the requests don't change
+    static const int nFullSyncRequestId = netfulfilledman.GetRequestId("full-sync");
+    static const int nSporkSyncRequestId = netfulfilledman.GetRequestId("spork-sync");
+    static const int nGovernanceSyncRequestId = netfulfilledman.GetRequestId("governance-sync");
+
     bool exitNodesLoop;
     connman.ForEachNode([this, &connman, &exitNodesLoop](CNode* pnode) {
         if (exitNodesLoop) return;
@@ -173,7 +179,7 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
 
         // NORMAL NETWORK MODE - TESTNET/MAINNET
         {
-            if (netfulfilledman.HasFulfilledRequest(pnode->addr, "full-sync")) {
+            if (netfulfilledman.HasFulfilledRequest(pnode->addr, nFullSyncRequestId)) {
                 // We already fully synced from this node recently,
                 // disconnect to free this connection slot for another peer.
                 pnode->fDisconnect = true;
@@ -182,9 +188,9 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
             }
 
             // SPORK : ALWAYS ASK FOR SPORKS AS WE SYNC
-            if (!netfulfilledman.HasFulfilledRequest(pnode->addr, "spork-sync")) {
+            if (!netfulfilledman.HasFulfilledRequest(pnode->addr, nSporkSyncRequestId)) {
                 // always get sporks first, only request once from each peer
-                netfulfilledman.AddFulfilledRequest(pnode->addr, "spork-sync");
+                netfulfilledman.AddFulfilledRequest(pnode->addr, nSporkSyncRequestId);
                 // get current network sporks
                 connman.PushMessage(pnode, msgMaker.Make(NetMsgType::GETSPORKS));
                 LogPrintf("CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d -- requesting sporks from peer=%d\n", nTick, nCurrentAsset, pnode->GetId());
@@ -209,7 +215,7 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
             // GOVOBJ : SYNC GOVERNANCE ITEMS FROM OUR PEERS
 
             if(nCurrentAsset == MASTERNODE_SYNC_GOVERNANCE) {
-                LogPrint(BCLog::GOBJECT, "CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d nTimeLastBumped %lld GetTime() %lld diff %lld\n", nTick, nCurrentAsset, nTimeLastBumped, GetTime(), GetTime() - nTimeLastBumped);
+                LogPrint(BCLog::GOBJECT, "CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d nTimeLastBumped %lld GetTime() %lld diff %lld\n", nTick, nCurrentAsset, nTimeLastBumped.load(), GetTime(), GetTime() - nTimeLastBumped);
 
                 // check for timeout first
                 if(GetTime() - nTimeLastBumped > MASTERNODE_SYNC_TIMEOUT_SECONDS) {
@@ -224,7 +230,7 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
                 }
 
                 // only request obj sync once from each peer, then request votes on per-obj basis
-                if(netfulfilledman.HasFulfilledRequest(pnode->addr, "governance-sync")) {
+                if(netfulfilledman.HasFulfilledRequest(pnode->addr, nGovernanceSyncRequestId)) {
                     int nObjsLeftToAsk = governance.RequestGovernanceObjectVotes(pnode->GetId());
                     static int64_t nTimeNoObjectsLeft = 0;
                     // check for data
@@ -255,7 +261,7 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
                     }
                     return;
                 }
-                netfulfilledman.AddFulfilledRequest(pnode->addr, "governance-sync");
+                netfulfilledman.AddFulfilledRequest(pnode->addr, nGovernanceSyncRequestId);
 
                 if (pnode->nVersion < MIN_GOVERNANCE_PEER_PROTO_VERSION) return;
                 nTriedPeerCount++;
@@ -7,6 +7,8 @@
 #include <chain.h>
 #include <net.h>
 
+#include <atomic>
+
 class CMasternodeSync;
 
 static const int MASTERNODE_SYNC_FAILED          = -1;
@@ -36,8 +38,8 @@ private:
 
     // Time when current masternode asset sync started
     int64_t nTimeAssetSyncStarted;
-    // ... last bumped
-    int64_t nTimeLastBumped;
+    // ... last bumped, also by the message worker threads
+    std::atomic<int64_t> nTimeLastBumped;
     // ... or failed
     int64_t nTimeLastFailure;
 
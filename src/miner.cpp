@@ -100,11 +100,42 @@ void BlockAssembler::resetBlock()
 
 Optional<int64_t> BlockAssembler::m_last_block_num_txs{nullopt};
 Optional<int64_t> BlockAssembler::m_last_block_weight{nullopt};
+std::atomic<bool> BlockAssembler::m_last_block_cached_txs{false};
 
 std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, std::shared_ptr<CWallet> pwallet, bool fProofOfStake, bool* pfPoSCancel)
 {
     int64_t nTimeStart = GetTimeMicros();
 
+    // Search a kernel before anything else: most of the time there is none and the
+    // block doesn't need to be assembled, so neither cs_main nor mempool.cs are held
+    // while searching, the chain is only locked for the lookups of the stake coins.
+    CWallet::CStakeKernel stakeKernel;
+    CBlockIndex* pindexKernelPrev = nullptr;
+    unsigned int nKernelBits = 0;
+    if (fProofOfStake)
+    {
+        assert(pwallet);
+        *pfPoSCancel = true;
+        {
+            LOCK(cs_main);
+            pindexKernelPrev = ::ChainActive().Tip();
+            assert(pindexKernelPrev != nullptr);
+            CBlockHeader header;
+            header.nTime = GetAdjustedTime();
+            nKernelBits = GetNextWorkRequired(pindexKernelPrev, &header, chainparams.GetConsensus());
+        }
+        int64_t nSearchTime = GetAdjustedTime(); // search to current time
+        if (nSearchTime <= nLastCoinStakeSearchTime)
+            return nullptr;
+        bool fKernelFound = pwallet->FindStakeKernel(nKernelBits, pindexKernelPrev, nSearchTime - nLastCoinStakeSearchTime, stakeKernel);
+        nLastCoinStakeSearchInterval = nSearchTime - nLastCoinStakeSearchTime;
+        nLastCoinStakeSearchTime = nSearchTime;
+        // make sure coinstake would meet timestamp protocol
+        // as it would be the same as the block timestamp
+        if (!fKernelFound || stakeKernel.nTime < std::max(pindexKernelPrev->GetMedianTimePast()+1, pindexKernelPrev->GetBlockTime() - MAX_FUTURE_BLOCK_TIME))
+            return nullptr; // there is no point to continue if we failed to find a kernel
+    }
+
     resetBlock();
 
     pblocktemplate.reset(new CBlockTemplate());
@@ -121,6 +152,9 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     LOCK(cs_main);
     CBlockIndex* pindexPrev = ::ChainActive().Tip();
     assert(pindexPrev != nullptr);
+    // The kernel is only valid on top of the block it was found for
+    if (fProofOfStake && pindexPrev != pindexKernelPrev)
+        return nullptr;
     nHeight = pindexPrev->nHeight + 1;
 
     pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
@@ -163,40 +197,31 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
+    bool fCachedTxs = false;
 
     {
         LOCK(mempool.cs);
-        addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+        const size_t nFirstTx = pblock->vtx.size();
+        fCachedTxs = addCachedTxs(pindexPrev, nPackagesSelected);
+        if (!fCachedTxs) {
+            lastPackageFeeRate = CFeeRate();
+            addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+            storeSelectedTxs(pindexPrev, nFirstTx, lastPackageFeeRate);
+        }
     }
 
     coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
 
-    if (fProofOfStake) // attemp to find a coinstake
+    if (fProofOfStake) // turn the kernel into the coinstake, now that the fees are known
     {
-        assert(pwallet);
-        *pfPoSCancel = true;
-        pblock->nBits = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus());
+        pblock->nBits = nKernelBits;
         CMutableTransaction txCoinStake;
-        int64_t nSearchTime = pblock->nTime; // search to current time
-        if (nSearchTime > nLastCoinStakeSearchTime)
-        {
-            uint32_t nTxNewTime = 0;
-            if (pwallet->CreateCoinStake(pblock->nBits, nSearchTime-nLastCoinStakeSearchTime, txCoinStake, nTxNewTime, nFees)) // TODO: Fix Fees
-            {
-                if (nTxNewTime >= std::max(pindexPrev->GetMedianTimePast()+1, pindexPrev->GetBlockTime() - MAX_FUTURE_BLOCK_TIME))
-                {   // make sure coinstake would meet timestamp protocol
-                    // as it would be the same as the block timestamp
-                    coinbaseTx.vout[0].SetEmpty();
-                    pblock->nTime = nTxNewTime;
-                    pblock->vtx[1] = MakeTransactionRef(txCoinStake);
-                    *pfPoSCancel = false;
-                }
-            }
-            nLastCoinStakeSearchInterval = nSearchTime - nLastCoinStakeSearchTime;
-            nLastCoinStakeSearchTime = nSearchTime;
-        }
-        if (*pfPoSCancel)
-            return nullptr; // there is no point to continue if we failed to create coinstake
+        if (!pwallet->CreateCoinStake(stakeKernel, pindexPrev, txCoinStake, nFees))
+            return nullptr;
+        coinbaseTx.vout[0].SetEmpty();
+        pblock->nTime = stakeKernel.nTime;
+        pblock->vtx[1] = MakeTransactionRef(txCoinStake);
+        *pfPoSCancel = false;
     } else {
         coinbaseTx.vout[0].nValue = nFees + GetBlockSubsidy(nHeight, chainparams.GetConsensus());
     }
@@ -216,6 +241,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
     m_last_block_num_txs = nBlockTx;
     m_last_block_weight = nBlockWeight;
+    m_last_block_cached_txs = fCachedTxs;
 
     CValidationState state;
 
@@ -254,12 +280,14 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     pblocktemplate->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
 
     if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
+        if (g_txselection_cache)
+            g_txselection_cache->Invalidate();
         throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
     }
     int64_t nTime2 = GetTimeMicros();
 
-    LogPrint(BCLog::BENCHMARK, "%s: packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n",
-        __func__, 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
+    LogPrint(BCLog::BENCHMARK, "%s: packages: %.2fms (%d packages, %d updated descendants%s), validity: %.2fms (total %.2fms)\n",
+        __func__, 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, fCachedTxs ? ", cached" : "", 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
 
     return std::move(pblocktemplate);
 }
@@ -511,12 +539,182 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
         }
 
         ++nPackagesSelected;
+        lastPackageFeeRate = CFeeRate(packageFees, packageSize);
 
         // Update transactions that depend on each of these
         nDescendantsUpdated += UpdatePackagesForAdded(ancestors, mapModifiedTx);
     }
 }
 
+bool BlockAssembler::addCachedTxs(const CBlockIndex* pindexPrev, int &nPackagesSelected)
+{
+    if (!g_txselection_cache)
+        return false;
+
+    CBlockTxSelectionCache::Selection selection;
+    std::vector<CTransactionRef> vQueuedTxs;
+    if (!g_txselection_cache->Take(pindexPrev->GetBlockHash(), nBlockMaxWeight, blockMinFeeRate, fIncludeWitness, selection, vQueuedTxs))
+        return false;
+
+    // Everything selected before must still be in the mempool and safe to mine
+    std::vector<CTxMemPool::txiter> vSelected;
+    vSelected.reserve(selection.vTxHashes.size());
+    for (const uint256& hash : selection.vTxHashes) {
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end() || !llmq::chainLocksHandler->IsTxSafeForMining(hash))
+            return false;
+        vSelected.push_back(it);
+    }
+
+    const size_t nFirstTx = pblock->vtx.size();
+    const size_t nFirstFee = pblocktemplate->vTxFees.size();
+    const size_t nFirstSigOps = pblocktemplate->vTxSigOpsCost.size();
+    auto fullSelection = [&]() {
+        pblock->vtx.resize(nFirstTx);
+        pblocktemplate->vTxFees.resize(nFirstFee);
+        pblocktemplate->vTxSigOpsCost.resize(nFirstSigOps);
+        bool fIncludeWitnessPrev = fIncludeWitness;
+        resetBlock();
+        fIncludeWitness = fIncludeWitnessPrev;
+        return false;
+    };
+
+    for (CTxMemPool::txiter it : vSelected) {
+        AddToBlock(it);
+    }
+
+    // Append the transactions accepted since then which only depend on transactions in the
+    // block. The queue is in the order of acceptance, so parents come before their children.
+    CFeeRate minPackageFeeRate = selection.minPackageFeeRate;
+    for (const CTransactionRef& tx : vQueuedTxs) {
+        CTxMemPool::txiter it = mempool.mapTx.find(tx->GetHash());
+        if (it == mempool.mapTx.end() || inBlock.count(it))
+            continue;
+
+        bool fParentsInBlock = true;
+        for (CTxMemPool::txiter parent : mempool.GetMemPoolParents(it)) {
+            if (!inBlock.count(parent)) {
+                fParentsInBlock = false;
+                break;
+            }
+        }
+        if (!fParentsInBlock) {
+            // Might pay for its parents, which only a full selection finds out
+            if (it->GetModFeesWithAncestors() >= blockMinFeeRate.GetFee(it->GetSizeWithAncestors()))
+                return fullSelection();
+            continue;
+        }
+
+        CFeeRate feeRate(it->GetModifiedFee(), it->GetTxSize());
+        if (feeRate < blockMinFeeRate)
+            continue;
+        if (!TestPackage(it->GetTxSize(), it->GetSigOpCost())) {
+            // The block is full, but would be better with this transaction
+            if (feeRate > minPackageFeeRate)
+                return fullSelection();
+            continue;
+        }
+        if (!TestPackageTransactions({it}))
+            continue;
+
+        AddToBlock(it);
+        ++nPackagesSelected;
+        minPackageFeeRate = std::min(minPackageFeeRate, feeRate);
+    }
+
+    storeSelectedTxs(pindexPrev, nFirstTx, minPackageFeeRate);
+    return true;
+}
+
+void BlockAssembler::storeSelectedTxs(const CBlockIndex* pindexPrev, size_t nFirstTx, const CFeeRate& minPackageFeeRate)
+{
+    if (!g_txselection_cache)
+        return;
+
+    CBlockTxSelectionCache::Selection selection;
+    selection.hashTip = pindexPrev->GetBlockHash();
+    selection.nBlockMaxWeight = nBlockMaxWeight;
+    selection.blockMinFeeRate = blockMinFeeRate;
+    selection.fIncludeWitness = fIncludeWitness;
+    selection.vTxHashes.reserve(pblock->vtx.size() - nFirstTx);
+    for (size_t i = nFirstTx; i < pblock->vtx.size(); i++) {
+        selection.vTxHashes.push_back(pblock->vtx[i]->GetHash());
+    }
+    selection.minPackageFeeRate = minPackageFeeRate;
+    g_txselection_cache->Store(std::move(selection));
+}
+
+std::unique_ptr<CBlockTxSelectionCache> g_txselection_cache;
+
+void CBlockTxSelectionCache::ClearSelection()
+{
+    fHaveSelection = false;
+    selection = Selection();
+    setSelected.clear();
+}
+
+bool CBlockTxSelectionCache::Take(const uint256& hashTip, unsigned int nBlockMaxWeight, const CFeeRate& blockMinFeeRate, bool fIncludeWitness,
+                                  Selection& selectionOut, std::vector<CTransactionRef>& vQueuedTxsOut)
+{
+    LOCK(cs);
+    bool fMatch = fHaveSelection && !fQueueOverflow &&
+                  selection.hashTip == hashTip &&
+                  selection.nBlockMaxWeight == nBlockMaxWeight &&
+                  selection.blockMinFeeRate == blockMinFeeRate &&
+                  selection.fIncludeWitness == fIncludeWitness;
+    if (fMatch) {
+        selectionOut = std::move(selection);
+        vQueuedTxsOut = std::move(vQueuedTxs);
+    }
+    ClearSelection();
+    vQueuedTxs.clear();
+    fQueueOverflow = false;
+    return fMatch;
+}
+
+void CBlockTxSelectionCache::Store(Selection&& selectionIn)
+{
+    LOCK(cs);
+    selection = std::move(selectionIn);
+    setSelected.clear();
+    setSelected.insert(selection.vTxHashes.begin(), selection.vTxHashes.end());
+    fHaveSelection = true;
+}
+
+void CBlockTxSelectionCache::Invalidate()
+{
+    LOCK(cs);
+    ClearSelection();
+}
+
+void CBlockTxSelectionCache::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    LOCK(cs);
+    ClearSelection();
+    vQueuedTxs.clear();
+    fQueueOverflow = false;
+}
+
+void CBlockTxSelectionCache::TransactionAddedToMempool(const CTransactionRef& ptx)
+{
+    LOCK(cs);
+    if (vQueuedTxs.size() >= MAX_QUEUED_TXS) {
+        vQueuedTxs.clear();
+        fQueueOverflow = true;
+    }
+    if (!fQueueOverflow) {
+        vQueuedTxs.push_back(ptx);
+    }
+}
+
+void CBlockTxSelectionCache::TransactionRemovedFromMempool(const CTransactionRef& ptx)
+{
+    LOCK(cs);
+    if (setSelected.count(ptx->GetHash())) {
+        ClearSelection();
+    }
+}
+
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
 {
     // Update nExtraNonce
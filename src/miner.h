@@ -8,11 +8,15 @@
 
 #include <optional.h>
 #include <primitives/block.h>
+#include <sync.h>
 #include <txmempool.h>
 #include <validation.h>
+#include <validationinterface.h>
 
+#include <atomic>
 #include <memory>
 #include <stdint.h>
+#include <unordered_set>
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/ordered_index.hpp>
@@ -153,6 +157,9 @@ private:
     // Stake info
     int64_t nLastCoinStakeSearchTime = 0;
 
+    // Fee rate of the last package added by addPackageTxs
+    CFeeRate lastPackageFeeRate;
+
 public:
     struct Options {
         Options();
@@ -168,6 +175,8 @@ public:
 
     static Optional<int64_t> m_last_block_num_txs;
     static Optional<int64_t> m_last_block_weight;
+    // Whether the last template reused the transaction selection of the one before it
+    static std::atomic<bool> m_last_block_cached_txs;
 
 private:
     // utility functions
@@ -181,6 +190,12 @@ private:
       * Increments nPackagesSelected / nDescendantsUpdated with corresponding
       * statistics from the package selection (for logging statistics). */
     void addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
+    /** Add the transactions selected for the previous template on the same tip, followed
+      * by those accepted to the mempool since. Returns false, leaving the block empty, when
+      * a full selection through addPackageTxs is needed. */
+    bool addCachedTxs(const CBlockIndex* pindexPrev, int &nPackagesSelected) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
+    /** Keep the transactions of the block for the next template */
+    void storeSelectedTxs(const CBlockIndex* pindexPrev, size_t nFirstTx, const CFeeRate& minPackageFeeRate);
 
     // helper functions for addPackageTxs()
     /** Remove confirmed (inBlock) entries from given set */
@@ -203,6 +218,58 @@ private:
     int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set &mapModifiedTx) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
 };
 
+/**
+ * Keeps the transaction selection of the last block template between the calls of
+ * BlockAssembler::CreateNewBlock. Transactions accepted to the mempool meanwhile are
+ * queued and appended to the selection when their parents are selected already, so a
+ * full selection is only needed after a new tip, a removal of a selected transaction,
+ * a fee delta or a transaction which would make a better block than the kept one.
+ */
+class CBlockTxSelectionCache final : public CValidationInterface
+{
+public:
+    struct Selection {
+        uint256 hashTip;
+        unsigned int nBlockMaxWeight{0};
+        CFeeRate blockMinFeeRate;
+        bool fIncludeWitness{false};
+        // Hashes of the selected transactions, in block order
+        std::vector<uint256> vTxHashes;
+        // Fee rate of the worst package which made it into the block
+        CFeeRate minPackageFeeRate;
+    };
+
+    // Transactions queued above this are dropped and the next template is a full selection
+    static const size_t MAX_QUEUED_TXS = 10000;
+
+private:
+    mutable CCriticalSection cs;
+    bool fHaveSelection GUARDED_BY(cs){false};
+    Selection selection GUARDED_BY(cs);
+    std::unordered_set<uint256, SaltedTxidHasher> setSelected GUARDED_BY(cs);
+    std::vector<CTransactionRef> vQueuedTxs GUARDED_BY(cs);
+    bool fQueueOverflow GUARDED_BY(cs){false};
+
+    void ClearSelection() EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+public:
+    /** Move out the kept selection for this tip and configuration and the transactions
+      * queued since. Returns false when there is none, the queue is dropped then too as
+      * a full selection will see all of the mempool. */
+    bool Take(const uint256& hashTip, unsigned int nBlockMaxWeight, const CFeeRate& blockMinFeeRate, bool fIncludeWitness,
+              Selection& selectionOut, std::vector<CTransactionRef>& vQueuedTxsOut);
+    void Store(Selection&& selectionIn);
+    /** Force a full selection for the next template, e.g. after fee deltas changed */
+    void Invalidate();
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override;
+    void TransactionAddedToMempool(const CTransactionRef& ptx) override;
+    void TransactionRemovedFromMempool(const CTransactionRef& ptx) override;
+};
+
+extern std::unique_ptr<CBlockTxSelectionCache> g_txselection_cache;
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
@@ -35,6 +35,10 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -45,6 +49,7 @@
 static_assert(MINIUPNPC_API_VERSION >= 10, "miniUPnPc API version >= 10 assumed");
 #endif
 
+#include <array>
 #include <unordered_map>
 
 #include <math.h>
@@ -77,6 +82,16 @@ enum BindFlags {
 // The sleep time needs to be small to avoid new sockets stalling
 static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 50;
 
+/** Remaining message data from which on recv() writes directly into the message buffer */
+static const unsigned int MIN_DIRECT_RECV_SIZE = 16 * 1024;
+/** Maximum number of bytes received directly into a message buffer at once */
+static const unsigned int MAX_DIRECT_RECV_SIZE = 256 * 1024;
+
+#ifdef USE_EPOLL
+/** Maximum number of readiness events taken from the epoll instance per socket handler iteration */
+static const int MAX_EPOLL_EVENTS = 1024;
+#endif
+
 const std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
@@ -91,6 +106,7 @@ CCriticalSection cs_mapLocalHost;
 std::map<CNetAddr, LocalServiceInfo> mapLocalHost GUARDED_BY(cs_mapLocalHost);
 static bool vfLimited[NET_MAX] GUARDED_BY(cs_mapLocalHost) = {};
 std::string strSubVersion;
+CNetMessageBufferPool g_netmsg_buffer_pool;
 
 void CConnman::AddOneShot(const std::string& strDest)
 {
@@ -571,7 +587,7 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
         // get current incomplete message, or create a new one
         if (vRecvMsg.empty() ||
             vRecvMsg.back().complete())
-            vRecvMsg.push_back(CNetMessage(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION));
+            vRecvMsg.emplace_back(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
 
         CNetMessage& msg = vRecvMsg.back();
 
@@ -613,15 +629,7 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
         nBytes -= handled;
 
         if (msg.complete()) {
-            //store received bytes per message command
-            //to prevent a memory DOS, only allow valid commands
-            mapMsgCmdSize::iterator i = mapRecvBytesPerMsgCmd.find(msg.hdr.pchCommand);
-            if (i == mapRecvBytesPerMsgCmd.end())
-                i = mapRecvBytesPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
-            assert(i != mapRecvBytesPerMsgCmd.end());
-            i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
-
-            msg.nTime = nTimeMicros;
+            MessageComplete(msg, nTimeMicros);
             complete = true;
         }
     }
@@ -629,6 +637,43 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
     return true;
 }
 
+char* CNode::GetRecvDataBuffer(unsigned int& nBytes)
+{
+    if (vRecvMsg.empty() || !vRecvMsg.back().in_data || vRecvMsg.back().complete())
+        return nullptr;
+    return vRecvMsg.back().PrepareData(nBytes);
+}
+
+bool CNode::ReceivedMsgData(unsigned int nBytes, bool& complete)
+{
+    complete = false;
+    int64_t nTimeMicros = GetTimeMicros();
+    LOCK(cs_vRecv);
+    nLastRecv = nTimeMicros / 1000000;
+    nRecvBytes += nBytes;
+
+    CNetMessage& msg = vRecvMsg.back();
+    msg.CommitData(nBytes);
+    if (msg.complete()) {
+        MessageComplete(msg, nTimeMicros);
+        complete = true;
+    }
+    return true;
+}
+
+void CNode::MessageComplete(CNetMessage& msg, int64_t nTimeMicros)
+{
+    //store received bytes per message command
+    //to prevent a memory DOS, only allow valid commands
+    mapMsgCmdSize::iterator i = mapRecvBytesPerMsgCmd.find(msg.hdr.pchCommand);
+    if (i == mapRecvBytesPerMsgCmd.end())
+        i = mapRecvBytesPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
+    assert(i != mapRecvBytesPerMsgCmd.end());
+    i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
+
+    msg.nTime = nTimeMicros;
+}
+
 void CNode::SetSendVersion(int nVersionIn)
 {
     // Send version may only be changed in the version message, and
@@ -688,20 +733,94 @@ int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 }
 
 int CNetMessage::readData(const char *pch, unsigned int nBytes)
+{
+    unsigned int nCopy = nBytes;
+    char* pchData = PrepareData(nCopy);
+    memcpy(pchData, pch, nCopy);
+    CommitData(nCopy);
+
+    return nCopy;
+}
+
+char* CNetMessage::PrepareData(unsigned int& nBytes)
 {
     unsigned int nRemaining = hdr.nMessageSize - nDataPos;
-    unsigned int nCopy = std::min(nRemaining, nBytes);
+    nBytes = std::min(nRemaining, nBytes);
 
-    if (vRecv.size() < nDataPos + nCopy) {
+    if (vRecv.size() < nDataPos + nBytes) {
         // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
+        size_t nSize = std::min(hdr.nMessageSize, nDataPos + nBytes + 256 * 1024);
+        if (vRecv.capacity() < nSize && nDataPos == 0) {
+            CSerializeData buf = g_netmsg_buffer_pool.Get(nSize);
+            vRecv.swap(buf);
+            g_netmsg_buffer_pool.Put(std::move(buf));
+        }
+        vRecv.resize(nSize);
     }
 
-    hasher.Write((const unsigned char*)pch, nCopy);
-    memcpy(&vRecv[nDataPos], pch, nCopy);
-    nDataPos += nCopy;
+    return &vRecv[nDataPos];
+}
 
-    return nCopy;
+void CNetMessage::CommitData(unsigned int nBytes)
+{
+    assert(nDataPos + nBytes <= vRecv.size());
+    hasher.Write((const unsigned char*)&vRecv[nDataPos], nBytes);
+    nDataPos += nBytes;
+}
+
+CNetMessage::~CNetMessage()
+{
+    CSerializeData buf;
+    vRecv.swap(buf);
+    g_netmsg_buffer_pool.Put(std::move(buf));
+}
+
+CSerializeData CNetMessageBufferPool::Get(size_t nSize)
+{
+    CSerializeData buf;
+    int nClass = 0;
+    while (nClass < NUM_CLASSES && (MIN_BUFFER_SIZE << nClass) < nSize)
+        nClass++;
+    if (nClass == NUM_CLASSES) {
+        buf.reserve(nSize);
+        return buf;
+    }
+    {
+        LOCK(cs);
+        if (!vFree[nClass].empty()) {
+            buf.swap(vFree[nClass].back());
+            vFree[nClass].pop_back();
+            nFreeBytes -= buf.capacity();
+            return buf;
+        }
+    }
+    buf.reserve(MIN_BUFFER_SIZE << nClass);
+    return buf;
+}
+
+void CNetMessageBufferPool::Put(CSerializeData&& buf)
+{
+    size_t nCapacity = buf.capacity();
+    if (nCapacity < MIN_BUFFER_SIZE)
+        return;
+    // A buffer serves the largest class it can hold
+    int nClass = 0;
+    while (nClass + 1 < NUM_CLASSES && (MIN_BUFFER_SIZE << (nClass + 1)) <= nCapacity)
+        nClass++;
+    buf.clear();
+
+    // Buffers which are not kept are freed by the caller, outside of the lock
+    LOCK(cs);
+    if (vFree[nClass].size() >= MAX_FREE_PER_CLASS || nFreeBytes + nCapacity > MAX_FREE_BYTES)
+        return;
+    vFree[nClass].push_back(std::move(buf));
+    nFreeBytes += nCapacity;
+}
+
+size_t CNetMessageBufferPool::GetFreeBytes()
+{
+    LOCK(cs);
+    return nFreeBytes;
 }
 
 const uint256& CNetMessage::GetMessageHash() const
@@ -1033,6 +1152,9 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+#ifdef USE_EPOLL
+        RegisterEvents(pnode);
+#endif
     }
 }
 
@@ -1059,6 +1181,9 @@ void CConnman::DisconnectNodes()
             {
                 // remove from vNodes
                 vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+#ifdef USE_EPOLL
+                setReceivableNodes.erase(pnode);
+#endif
 
                 // release outbound grant (if any)
                 pnode->grantOutbound.Release();
@@ -1310,8 +1435,132 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
 }
 #endif
 
+bool SocketEventsModeFromString(const std::string& str, SocketEventsMode& mode)
+{
+#ifdef USE_POLL
+    if (str == "poll") {
+        mode = SOCKETEVENTS_POLL;
+        return true;
+    }
+#else
+    if (str == "select") {
+        mode = SOCKETEVENTS_SELECT;
+        return true;
+    }
+#endif
+#ifdef USE_EPOLL
+    if (str == "epoll") {
+        mode = SOCKETEVENTS_EPOLL;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::string SocketEventsModeToString(SocketEventsMode mode)
+{
+    switch (mode) {
+    case SOCKETEVENTS_SELECT: return "select";
+    case SOCKETEVENTS_POLL: return "poll";
+    case SOCKETEVENTS_EPOLL: return "epoll";
+    }
+    assert(false);
+}
+
+std::string GetSupportedSocketEventsModes()
+{
+#ifdef USE_POLL
+    std::string strModes = "poll";
+#else
+    std::string strModes = "select";
+#endif
+#ifdef USE_EPOLL
+    strModes += ", epoll";
+#endif
+    return strModes;
+}
+
+bool CConnman::SocketRecvData(CNode *pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    char* pchRecv = pchBuf;
+    unsigned int nRecvSize = sizeof(pchBuf);
+
+    // The rest of a large message is received straight into its buffer
+    unsigned int nDirectSize = MAX_DIRECT_RECV_SIZE;
+    char* pchDirect = pnode->GetRecvDataBuffer(nDirectSize);
+    if (pchDirect && nDirectSize >= MIN_DIRECT_RECV_SIZE) {
+        pchRecv = pchDirect;
+        nRecvSize = nDirectSize;
+    }
+
+    int nBytes = 0;
+    {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            return false;
+        nBytes = recv(pnode->hSocket, pchRecv, nRecvSize, MSG_DONTWAIT);
+    }
+    if (nBytes > 0)
+    {
+        bool notify = false;
+        bool fReceived = pchRecv == pchBuf ? pnode->ReceiveMsgBytes(pchBuf, nBytes, notify) : pnode->ReceivedMsgData(nBytes, notify);
+        if (!fReceived)
+            pnode->CloseSocketDisconnect();
+        RecordBytesRecv(nBytes);
+        if (notify) {
+            size_t nSizeAdded = 0;
+            auto it(pnode->vRecvMsg.begin());
+            for (; it != pnode->vRecvMsg.end(); ++it) {
+                if (!it->complete())
+                    break;
+                nSizeAdded += it->GetMemoryUsage();
+            }
+            {
+                LOCK(pnode->cs_vProcessMsg);
+                pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
+                pnode->nProcessQueueSize += nSizeAdded;
+                pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+            }
+            WakeMessageHandler();
+        }
+        // a full buffer means there may be more data waiting
+        return nBytes == (int)nRecvSize && !pnode->fDisconnect;
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect) {
+            LogPrint(BCLog::NET, "socket closed\n");
+        }
+        pnode->CloseSocketDisconnect();
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        } else if (nErr == WSAEINTR) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void CConnman::SocketHandler()
 {
+#ifdef USE_EPOLL
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        SocketHandlerEpoll();
+        return;
+    }
+#endif
+
     std::set<SOCKET> recv_set, send_set, error_set;
     SocketEvents(recv_set, send_set, error_set);
 
@@ -1359,57 +1608,7 @@ void CConnman::SocketHandler()
         }
         if (recvSet || errorSet)
         {
-            // typical socket buffer is 8K-64K
-            char pchBuf[0x10000];
-            int nBytes = 0;
-            {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-            }
-            if (nBytes > 0)
-            {
-                bool notify = false;
-                if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
-                    pnode->CloseSocketDisconnect();
-                RecordBytesRecv(nBytes);
-                if (notify) {
-                    size_t nSizeAdded = 0;
-                    auto it(pnode->vRecvMsg.begin());
-                    for (; it != pnode->vRecvMsg.end(); ++it) {
-                        if (!it->complete())
-                            break;
-                        nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                    }
-                    {
-                        LOCK(pnode->cs_vProcessMsg);
-                        pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                        pnode->nProcessQueueSize += nSizeAdded;
-                        pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                    }
-                    WakeMessageHandler();
-                }
-            }
-            else if (nBytes == 0)
-            {
-                // socket closed gracefully
-                if (!pnode->fDisconnect) {
-                    LogPrint(BCLog::NET, "socket closed\n");
-                }
-                pnode->CloseSocketDisconnect();
-            }
-            else if (nBytes < 0)
-            {
-                // error
-                int nErr = WSAGetLastError();
-                if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                {
-                    if (!pnode->fDisconnect)
-                        LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                    pnode->CloseSocketDisconnect();
-                }
-            }
+            SocketRecvData(pnode);
         }
 
         //
@@ -1433,6 +1632,142 @@ void CConnman::SocketHandler()
     }
 }
 
+#ifdef USE_EPOLL
+void CConnman::RegisterEvents(CNode *pnode)
+{
+    if (socketEventsMode != SOCKETEVENTS_EPOLL)
+        return;
+
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET)
+        return;
+
+    // Edge-triggered: a socket is only reported when it becomes readable or writable, the
+    // socket handler remembers the readable ones which it didn't drain (setReceivableNodes)
+    // and sends blocked writes as soon as the socket reports writability again
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = pnode;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &event) != 0) {
+        LogPrintf("epoll_ctl failed for peer=%d: %s\n", pnode->GetId(), NetworkErrorString(WSAGetLastError()));
+        pnode->fDisconnect = true;
+    }
+}
+
+void CConnman::SocketHandlerEpoll()
+{
+    // Don't wait if a node still has data to read, nodes with a paused receive buffer are
+    // checked again on the next timeout
+    bool fReceivable = false;
+    for (CNode* pnode : setReceivableNodes) {
+        if (!pnode->fPauseRecv) {
+            fReceivable = true;
+            break;
+        }
+    }
+
+    std::array<struct epoll_event, MAX_EPOLL_EVENTS> events;
+    int nEvents = epoll_wait(epollfd, events.data(), events.size(), fReceivable ? 0 : SELECT_TIMEOUT_MILLISECONDS);
+
+    if (interruptNet) return;
+
+    if (nEvents < 0) {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR) {
+            LogPrintf("epoll_wait error %s\n", NetworkErrorString(nErr));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        }
+        return;
+    }
+
+    std::vector<CNode*> vSendableNodes;
+    for (int i = 0; i < nEvents; i++) {
+        const struct epoll_event& event = events[i];
+        const ListenSocket* pListenSocket = nullptr;
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            if (&hListenSocket == event.data.ptr) {
+                pListenSocket = &hListenSocket;
+                break;
+            }
+        }
+        if (pListenSocket) {
+            AcceptConnection(*pListenSocket);
+            continue;
+        }
+
+        CNode* pnode = static_cast<CNode*>(event.data.ptr);
+        if (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+            setReceivableNodes.insert(pnode);
+        }
+        if (event.events & EPOLLOUT) {
+            vSendableNodes.push_back(pnode);
+        }
+    }
+
+    // Check for timeouts once a second instead of visiting every node on every iteration.
+    // Also retry pending sends then, in case an interrupted send() missed its edge.
+    int64_t nTime = GetSystemTimeInSeconds();
+    bool fInactivityCheck = nTime != nLastInactivityCheck;
+    nLastInactivityCheck = nTime;
+
+    std::vector<CNode*> vAllNodes;
+    std::vector<CNode*> vNodesCopy;
+    {
+        LOCK(cs_vNodes);
+        if (fInactivityCheck) {
+            vAllNodes = vNodes;
+            vSendableNodes.insert(vSendableNodes.end(), vAllNodes.begin(), vAllNodes.end());
+        }
+        vNodesCopy.reserve(vSendableNodes.size() + setReceivableNodes.size());
+        vNodesCopy.insert(vNodesCopy.end(), vSendableNodes.begin(), vSendableNodes.end());
+        vNodesCopy.insert(vNodesCopy.end(), setReceivableNodes.begin(), setReceivableNodes.end());
+        for (CNode* pnode : vNodesCopy)
+            pnode->AddRef();
+    }
+
+    //
+    // Send
+    //
+    for (CNode* pnode : vSendableNodes)
+    {
+        if (interruptNet)
+            break;
+
+        LOCK(pnode->cs_vSend);
+        if (pnode->vSendMsg.empty())
+            continue;
+        size_t nBytes = SocketSendData(pnode);
+        if (nBytes) {
+            RecordBytesSent(nBytes);
+        }
+    }
+
+    //
+    // Receive
+    //
+    for (auto it = setReceivableNodes.begin(); it != setReceivableNodes.end() && !interruptNet; )
+    {
+        CNode* pnode = *it;
+        if (pnode->fPauseRecv || SocketRecvData(pnode)) {
+            ++it;
+        } else {
+            it = setReceivableNodes.erase(it);
+        }
+    }
+
+    if (fInactivityCheck && !interruptNet) {
+        for (CNode* pnode : vAllNodes)
+            InactivityCheck(pnode);
+    }
+
+    {
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodesCopy)
+            pnode->Release();
+    }
+}
+#endif
+
 void CConnman::ThreadSocketHandler()
 {
     while (!interruptNet)
@@ -1448,8 +1783,13 @@ void CConnman::WakeMessageHandler()
     {
         std::lock_guard<std::mutex> lock(mutexMsgProc);
         fMsgProcWake = true;
+        nMsgProcWakeSeq++;
+    }
+    if (nMsgHandlerThreads > 0) {
+        condMsgProc.notify_all();
+    } else {
+        condMsgProc.notify_one();
     }
-    condMsgProc.notify_one();
 }
 
 
@@ -2071,6 +2411,9 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+#ifdef USE_EPOLL
+        RegisterEvents(pnode);
+#endif
     }
 }
 
@@ -2099,7 +2442,11 @@ void CConnman::ThreadMessageHandler()
                 continue;
 
             // Receive messages
-            bool fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc);
+            bool fMoreNodeWork;
+            {
+                LOCK(pnode->cs_recvProcessing);
+                fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc);
+            }
             fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
             if (flagInterruptMsgProc)
                 return;
@@ -2127,6 +2474,56 @@ void CConnman::ThreadMessageHandler()
     }
 }
 
+void CConnman::ThreadMessageWorker(int nWorker)
+{
+    uint64_t nWakeSeq = 0;
+    while (!flagInterruptMsgProc)
+    {
+        // Every peer is pinned to one worker, the messages of a peer are never reordered
+        std::vector<CNode*> vNodesCopy;
+        {
+            LOCK(cs_vNodes);
+            for (CNode* pnode : vNodes) {
+                if (pnode->GetId() % nMsgHandlerThreads == nWorker) {
+                    pnode->AddRef();
+                    vNodesCopy.push_back(pnode);
+                }
+            }
+        }
+
+        bool fMoreWork = false;
+
+        for (CNode* pnode : vNodesCopy)
+        {
+            if (pnode->fDisconnect)
+                continue;
+
+            // The message handler thread is busy with a message of this peer, it will pick
+            // up the following ones as well if needed
+            TRY_LOCK(pnode->cs_recvProcessing, lockRecv);
+            if (!lockRecv)
+                continue;
+
+            bool fMoreNodeWork = m_msgproc->ProcessConcurrentMessages(pnode, flagInterruptMsgProc);
+            fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
+            if (flagInterruptMsgProc)
+                break;
+        }
+
+        {
+            LOCK(cs_vNodes);
+            for (CNode* pnode : vNodesCopy)
+                pnode->Release();
+        }
+
+        WAIT_LOCK(mutexMsgProc, lock);
+        if (!fMoreWork) {
+            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [&] { return nMsgProcWakeSeq != nWakeSeq || flagInterruptMsgProc; });
+        }
+        nWakeSeq = nMsgProcWakeSeq;
+    }
+}
+
 
 
 
@@ -2334,6 +2731,31 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         return false;
     }
 
+#ifdef USE_EPOLL
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1) {
+            LogPrintf("epoll_create1 failed: %s\n", NetworkErrorString(WSAGetLastError()));
+            if (clientInterface) {
+                clientInterface->ThreadSafeMessageBox(
+                    _("Failed to set up epoll for the network sockets. Use -socketevents to select another mode.").translated,
+                    "", CClientUIInterface::MSG_ERROR);
+            }
+            return false;
+        }
+        // Listening sockets stay level-triggered, one connection is accepted per iteration
+        for (ListenSocket& hListenSocket : vhListenSocket) {
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.ptr = &hListenSocket;
+            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hListenSocket.socket, &event) != 0) {
+                LogPrintf("epoll_ctl failed for listening socket: %s\n", NetworkErrorString(WSAGetLastError()));
+                return false;
+            }
+        }
+    }
+#endif
+
     for (const auto& strDest : connOptions.vSeedNodes) {
         AddOneShot(strDest);
     }
@@ -2411,6 +2833,12 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     // Process messages
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    for (int i = 0; i < nMsgHandlerThreads; i++) {
+        threadMessageWorkers.emplace_back([this, i] {
+            const std::string strName = strprintf("msgwork.%d", i);
+            TraceThread(strName.c_str(), std::bind(&CConnman::ThreadMessageWorker, this, i));
+        });
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery(std::bind(&CConnman::DumpAddresses, this), DUMP_PEERS_INTERVAL * 1000);
@@ -2468,6 +2896,11 @@ void CConnman::Stop()
 {
     if (threadMessageHandler.joinable())
         threadMessageHandler.join();
+    for (std::thread& threadMessageWorker : threadMessageWorkers) {
+        if (threadMessageWorker.joinable())
+            threadMessageWorker.join();
+    }
+    threadMessageWorkers.clear();
     if (threadOpenMasternodeConnections.joinable())
         threadOpenMasternodeConnections.join();
     if (threadOpenConnections.joinable())
@@ -2503,6 +2936,13 @@ void CConnman::Stop()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+#ifdef USE_EPOLL
+    setReceivableNodes.clear();
+    if (epollfd != -1) {
+        close(epollfd);
+        epollfd = -1;
+    }
+#endif
     semOutbound.reset();
     semAddnode.reset();
     semMasternodeOutbound.reset();
@@ -87,6 +87,31 @@ static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Default for -msghandlerthreads, the number of message worker threads next to the message handler thread */
+static const int DEFAULT_MSG_HANDLER_THREADS = 0;
+/** Maximum for -msghandlerthreads */
+static const int MAX_MSG_HANDLER_THREADS = 16;
+
+/** How the socket handler waits for sockets to become ready, see -socketevents */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT,
+    SOCKETEVENTS_POLL,
+    SOCKETEVENTS_EPOLL,
+};
+
+#if defined(USE_EPOLL)
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_EPOLL;
+#elif defined(USE_POLL)
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_POLL;
+#else
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_SELECT;
+#endif
+
+/** Parse a -socketevents mode, fails for modes which are not available on this platform */
+bool SocketEventsModeFromString(const std::string& str, SocketEventsMode& mode);
+std::string SocketEventsModeToString(SocketEventsMode mode);
+/** Comma separated list of the -socketevents modes available on this platform */
+std::string GetSupportedSocketEventsModes();
 
 typedef int64_t NodeId;
 
@@ -134,6 +159,8 @@ public:
         int nMaxOutbound = 0;
         int nMaxAddnode = 0;
         int nMaxFeeler = 0;
+        int nMsgHandlerThreads = DEFAULT_MSG_HANDLER_THREADS;
+        SocketEventsMode socketEventsMode = DEFAULT_SOCKETEVENTS;
         int nBestHeight = 0;
         CClientUIInterface* uiInterface = nullptr;
         NetEventsInterface* m_msgproc = nullptr;
@@ -158,6 +185,8 @@ public:
         m_use_addrman_outgoing = connOptions.m_use_addrman_outgoing;
         nMaxAddnode = connOptions.nMaxAddnode;
         nMaxFeeler = connOptions.nMaxFeeler;
+        nMsgHandlerThreads = std::max(0, std::min(connOptions.nMsgHandlerThreads, MAX_MSG_HANDLER_THREADS));
+        socketEventsMode = connOptions.socketEventsMode;
         nBestHeight = connOptions.nBestHeight;
         clientInterface = connOptions.uiInterface;
         m_banman = connOptions.m_banman;
@@ -355,6 +384,7 @@ private:
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
     void ThreadMessageHandler();
+    void ThreadMessageWorker(int nWorker);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
@@ -362,6 +392,10 @@ private:
     bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketHandler();
+#ifdef USE_EPOLL
+    void RegisterEvents(CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(cs_vNodes);
+    void SocketHandlerEpoll();
+#endif
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
     void ThreadOpenMasternodeConnections();
@@ -382,6 +416,7 @@ private:
     NodeId GetNewNodeId();
 
     size_t SocketSendData(CNode *pnode) const;
+    bool SocketRecvData(CNode *pnode);
     void DumpAddresses();
 
     // Network stats
@@ -414,6 +449,17 @@ private:
     unsigned int nReceiveFloodSize{0};
 
     std::vector<ListenSocket> vhListenSocket;
+#ifdef USE_EPOLL
+    /** epoll instance of the socket handler, sockets are added once when they are opened */
+    int epollfd{-1};
+    /**
+     * Nodes which may have unread data on their socket. With edge-triggered readiness a
+     * socket is only reported again after new data arrived, so nodes stay here until recv()
+     * drained them. Only used by the socket handler thread.
+     */
+    std::set<CNode*> setReceivableNodes;
+    int64_t nLastInactivityCheck{0};
+#endif
     std::atomic<bool> fNetworkActive{true};
     bool fAddressesInitialized{false};
     CAddrMan addrman;
@@ -440,6 +486,8 @@ private:
     int nMaxOutbound;
     int nMaxAddnode;
     int nMaxFeeler;
+    int nMsgHandlerThreads;
+    SocketEventsMode socketEventsMode;
     bool m_use_addrman_outgoing;
     std::atomic<int> nBestHeight;
     CClientUIInterface* clientInterface;
@@ -451,6 +499,8 @@ private:
 
     /** flag for waking the message processor. */
     bool fMsgProcWake;
+    /** incremented on every wakeup, so that each message worker notices it. */
+    uint64_t nMsgProcWakeSeq GUARDED_BY(mutexMsgProc){0};
 
     std::condition_variable condMsgProc;
     Mutex mutexMsgProc;
@@ -464,6 +514,7 @@ private:
     std::thread threadOpenConnections;
     std::thread threadOpenMasternodeConnections;
     std::thread threadMessageHandler;
+    std::vector<std::thread> threadMessageWorkers;
 
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of nMaxOutbound
@@ -505,6 +556,8 @@ class NetEventsInterface
 {
 public:
     virtual bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) = 0;
+    /** Like ProcessMessages, but only for messages which may be handled off the message handler thread */
+    virtual bool ProcessConcurrentMessages(CNode* pnode, std::atomic<bool>& interrupt) = 0;
     virtual bool SendMessages(CNode* pnode) = 0;
     virtual void InitializeNode(CNode* pnode) = 0;
     virtual void FinalizeNode(NodeId id, bool& update_connection_time) = 0;
@@ -604,6 +657,38 @@ public:
 
 
 
+/**
+ * Recycles the data buffers of received messages. Without it every message allocates its
+ * buffer and zeroes it again when freed, which shows up badly under floods of sig share, DKG
+ * and governance messages. Buffers are kept in power-of-two size classes, so a message never
+ * holds a buffer of more than twice its size.
+ */
+class CNetMessageBufferPool
+{
+private:
+    static const size_t MIN_BUFFER_SIZE = 256;
+    static const size_t MAX_BUFFER_SIZE = 4 * 1024 * 1024;
+    static const int NUM_CLASSES = 15;
+    static_assert(MIN_BUFFER_SIZE << (NUM_CLASSES - 1) == MAX_BUFFER_SIZE, "size classes must end at MAX_BUFFER_SIZE");
+    /** Number of free buffers kept per size class */
+    static const size_t MAX_FREE_PER_CLASS = 64;
+    /** Total size of the free buffers kept */
+    static const size_t MAX_FREE_BYTES = 16 * 1024 * 1024;
+
+    Mutex cs;
+    std::vector<CSerializeData> vFree[NUM_CLASSES] GUARDED_BY(cs);
+    size_t nFreeBytes GUARDED_BY(cs){0};
+
+public:
+    /** Returns an empty buffer with room for at least nSize bytes */
+    CSerializeData Get(size_t nSize);
+    /** Takes back a buffer which is no longer used */
+    void Put(CSerializeData&& buf);
+    size_t GetFreeBytes();
+};
+
+extern CNetMessageBufferPool g_netmsg_buffer_pool;
+
 class CNetMessage {
 private:
     mutable CHash256 hasher;
@@ -627,6 +712,10 @@ public:
         nDataPos = 0;
         nTime = 0;
     }
+    CNetMessage(CNetMessage&&) = default;
+    CNetMessage(const CNetMessage&) = delete;
+    CNetMessage& operator=(const CNetMessage&) = delete;
+    ~CNetMessage();
 
     bool complete() const
     {
@@ -645,6 +734,19 @@ public:
 
     int readHeader(const char *pch, unsigned int nBytes);
     int readData(const char *pch, unsigned int nBytes);
+    /**
+     * Make room for the next nBytes of the message data, at most what is still missing.
+     * Returns where they have to be written, so that recv() can write there directly.
+     */
+    char* PrepareData(unsigned int& nBytes);
+    /** Account for nBytes written to the buffer returned by PrepareData */
+    void CommitData(unsigned int nBytes);
+
+    /** Memory held by the message, which counts against the receive flood size of the node */
+    size_t GetMemoryUsage() const
+    {
+        return vRecv.capacity() + CMessageHeader::HEADER_SIZE;
+    }
 };
 
 
@@ -669,6 +771,8 @@ public:
     size_t nProcessQueueSize{0};
 
     CCriticalSection cs_sendProcessing;
+    // Held while processing received messages, keeps the messages of a peer in order across message handler threads
+    CCriticalSection cs_recvProcessing;
 
     std::deque<CInv> vRecvGetData;
     uint64_t nRecvBytes GUARDED_BY(cs_vRecv){0};
@@ -806,6 +910,8 @@ private:
     int nSendVersion{0};
     std::list<CNetMessage> vRecvMsg;  // Used only by SocketHandler thread
 
+    void MessageComplete(CNetMessage& msg, int64_t nTimeMicros) EXCLUSIVE_LOCKS_REQUIRED(cs_vRecv);
+
     mutable CCriticalSection cs_addrName;
     std::string addrName GUARDED_BY(cs_addrName);
 
@@ -833,6 +939,13 @@ public:
     }
 
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete);
+    /**
+     * If the data of a message is being received, returns where its next bytes go and in
+     * nBytes how many of them fit (at most nBytes), otherwise nullptr
+     */
+    char* GetRecvDataBuffer(unsigned int& nBytes);
+    /** Like ReceiveMsgBytes, for nBytes which were written to the buffer from GetRecvDataBuffer */
+    bool ReceivedMsgData(unsigned int nBytes, bool& complete);
 
     void SetRecvVersion(int nVersionIn)
     {
@@ -20,10 +20,12 @@
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <primitives/block.h>
+#include <prevector.h>
 #include <primitives/transaction.h>
 #include <random.h>
 #include <reverse_iterator.h>
 #include <scheduler.h>
+#include <support/allocators/pool.h>
 #include <tinyformat.h>
 #include <txmempool.h>
 #include <util/init.h>
@@ -48,7 +50,10 @@
 #include <llmq/quorums_signing.h>
 #include <llmq/quorums_signing_shares.h>
 
+#include <deque>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
 
 #if defined(NDEBUG)
 # error "BitCorn cannot be compiled without assertions."
@@ -56,8 +61,6 @@
 
 /** Expiration time for orphan transactions in seconds */
 static constexpr int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
-/** Minimum time between orphan transactions expire time checks in seconds */
-static constexpr int64_t ORPHAN_TX_EXPIRE_INTERVAL = 5 * 60;
 /** Headers download timeout expressed in microseconds
  *  Timeout = base + per_header * (expected number of headers) */
 static constexpr int64_t HEADERS_DOWNLOAD_TIMEOUT_BASE = 15 * 60 * 1000000; // 15 minutes
@@ -110,9 +113,23 @@ struct COrphanTx {
     NodeId fromPeer;
     int64_t nTimeExpire;
     size_t list_pos;
+    size_t peer_pos;
 };
+
+/**
+ * The orphan pool and its indexes are node based containers whose nodes are all carved from
+ * g_orphan_resource, so that bursts of orphans don't go through the general purpose allocator.
+ * The block size is that of the largest node, see CCoinsMap for the calculation.
+ */
+static constexpr size_t ORPHAN_POOL_BLOCK_SIZE = sizeof(std::pair<const uint256, COrphanTx>) + 4 * sizeof(void*);
+template <typename Key, typename T, typename Hash>
+using OrphanPoolMap = std::unordered_map<Key, T, Hash, std::equal_to<Key>,
+                                         PoolAllocator<std::pair<const Key, T>, ORPHAN_POOL_BLOCK_SIZE, alignof(void*)>>;
+typedef OrphanPoolMap<uint256, COrphanTx, SaltedTxidHasher> OrphanMap;
+
 CCriticalSection g_cs_orphans;
-std::map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(g_cs_orphans);
+static OrphanMap::allocator_type::ResourceType g_orphan_resource GUARDED_BY(g_cs_orphans);
+OrphanMap mapOrphanTransactions GUARDED_BY(g_cs_orphans){0, SaltedTxidHasher(), OrphanMap::key_equal(), &g_orphan_resource};
 
 void EraseOrphansFor(NodeId peer);
 
@@ -196,17 +213,17 @@ namespace {
     /** Expiration-time ordered list of (expire time, relay map entry) pairs. */
     std::deque<std::pair<int64_t, MapRelay::iterator>> vRelayExpiration GUARDED_BY(cs_main);
 
-    struct IteratorComparator
-    {
-        template<typename I>
-        bool operator()(const I& a, const I& b) const
-        {
-            return &(*a) < &(*b);
-        }
-    };
-    std::map<COutPoint, std::set<std::map<uint256, COrphanTx>::iterator, IteratorComparator>> mapOrphanTransactionsByPrev GUARDED_BY(g_cs_orphans);
+    /** Orphans are referenced by pointer, which unlike iterators remain valid when the map rehashes */
+    typedef OrphanMap::value_type* OrphanRef;
 
-    std::vector<std::map<uint256, COrphanTx>::iterator> g_orphan_list GUARDED_BY(g_cs_orphans); //! For random eviction
+    /** Almost all prevouts are spent by a single orphan, which is stored inline */
+    typedef OrphanPoolMap<COutPoint, prevector<1, OrphanRef>, SaltedOutpointHasher> OrphanByPrevMap;
+    static_assert(sizeof(OrphanByPrevMap::value_type) <= sizeof(OrphanMap::value_type), "Prevout index nodes must fit into the orphan pool blocks");
+    OrphanByPrevMap mapOrphanTransactionsByPrev GUARDED_BY(g_cs_orphans){0, SaltedOutpointHasher(), OrphanByPrevMap::key_equal(), &g_orphan_resource};
+
+    std::vector<OrphanRef> g_orphan_list GUARDED_BY(g_cs_orphans); //! For random eviction
+    std::unordered_map<NodeId, std::vector<OrphanRef>> g_orphans_by_peer GUARDED_BY(g_cs_orphans); //! For per-peer erasure and quotas
+    std::deque<std::pair<int64_t, uint256>> g_orphan_expiry GUARDED_BY(g_cs_orphans); //! In order of insertion, which is the order of expiry
 
     static size_t vExtraTxnForCompactIt GUARDED_BY(g_cs_orphans) = 0;
     static std::vector<std::pair<uint256, CTransactionRef>> vExtraTxnForCompact GUARDED_BY(g_cs_orphans);
@@ -1020,6 +1037,22 @@ static void AddToCompactExtraTransactions(const CTransactionRef& tx) EXCLUSIVE_L
     vExtraTxnForCompactIt = (vExtraTxnForCompactIt + 1) % max_extra_txn;
 }
 
+/**
+ * Drop the entries of erased orphans from g_orphan_expiry. They are otherwise only
+ * skipped once they expire, so orphans which are erased early, e.g. when their parent
+ * arrives, would let the queue grow without bound.
+ */
+static void CompactOrphanExpiry() EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
+{
+    std::unordered_set<uint256, SaltedTxidHasher> setKept;
+    auto itEnd = std::remove_if(g_orphan_expiry.begin(), g_orphan_expiry.end(), [&setKept](const std::pair<int64_t, uint256>& entry) {
+        // An orphan which was erased and added again keeps the entry of its current expiration time
+        auto it = mapOrphanTransactions.find(entry.second);
+        return it == mapOrphanTransactions.end() || it->second.nTimeExpire != entry.first || !setKept.insert(entry.second).second;
+    });
+    g_orphan_expiry.erase(itEnd, g_orphan_expiry.end());
+}
+
 bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
 {
     const uint256& hash = tx->GetHash();
@@ -1040,11 +1073,22 @@ bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRE
         return false;
     }
 
-    auto ret = mapOrphanTransactions.emplace(hash, COrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, g_orphan_list.size()});
+    std::vector<OrphanRef>& vPeerOrphans = g_orphans_by_peer[peer];
+    int64_t nTimeExpire = GetTime() + ORPHAN_TX_EXPIRE_TIME;
+    auto ret = mapOrphanTransactions.emplace(hash, COrphanTx{tx, peer, nTimeExpire, g_orphan_list.size(), vPeerOrphans.size()});
     assert(ret.second);
-    g_orphan_list.push_back(ret.first);
+    OrphanRef orphan = &(*ret.first);
+    g_orphan_list.push_back(orphan);
+    vPeerOrphans.push_back(orphan);
+    g_orphan_expiry.emplace_back(nTimeExpire, hash);
+    if (g_orphan_expiry.size() > 2 * mapOrphanTransactions.size()) {
+        CompactOrphanExpiry();
+    }
     for (const CTxIn& txin : tx->vin) {
-        mapOrphanTransactionsByPrev[txin.prevout].insert(ret.first);
+        prevector<1, OrphanRef>& vSpenders = mapOrphanTransactionsByPrev[txin.prevout];
+        if (std::find(vSpenders.begin(), vSpenders.end(), orphan) == vSpenders.end()) {
+            vSpenders.push_back(orphan);
+        }
     }
 
     AddToCompactExtraTransactions(tx);
@@ -1054,32 +1098,47 @@ bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRE
     return true;
 }
 
+/** Remove orphan from a vector of orphans which records its position in the member pos */
+static void EraseOrphanRef(std::vector<OrphanRef>& vOrphans, size_t COrphanTx::*pos, OrphanRef orphan)
+{
+    size_t old_pos = orphan->second.*pos;
+    assert(vOrphans[old_pos] == orphan);
+    if (old_pos + 1 != vOrphans.size()) {
+        // Unless we're deleting the last entry, move the last entry to the position we're deleting.
+        OrphanRef last = vOrphans.back();
+        vOrphans[old_pos] = last;
+        last->second.*pos = old_pos;
+    }
+    vOrphans.pop_back();
+}
+
 int static EraseOrphanTx(uint256 hash) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
 {
-    std::map<uint256, COrphanTx>::iterator it = mapOrphanTransactions.find(hash);
+    OrphanMap::iterator it = mapOrphanTransactions.find(hash);
     if (it == mapOrphanTransactions.end())
         return 0;
+    OrphanRef orphan = &(*it);
     for (const CTxIn& txin : it->second.tx->vin)
     {
         auto itPrev = mapOrphanTransactionsByPrev.find(txin.prevout);
         if (itPrev == mapOrphanTransactionsByPrev.end())
             continue;
-        itPrev->second.erase(it);
+        auto itSpender = std::find(itPrev->second.begin(), itPrev->second.end(), orphan);
+        if (itSpender != itPrev->second.end())
+            itPrev->second.erase(itSpender);
         if (itPrev->second.empty())
             mapOrphanTransactionsByPrev.erase(itPrev);
     }
 
-    size_t old_pos = it->second.list_pos;
-    assert(g_orphan_list[old_pos] == it);
-    if (old_pos + 1 != g_orphan_list.size()) {
-        // Unless we're deleting the last entry in g_orphan_list, move the last
-        // entry to the position we're deleting.
-        auto it_last = g_orphan_list.back();
-        g_orphan_list[old_pos] = it_last;
-        it_last->second.list_pos = old_pos;
-    }
-    g_orphan_list.pop_back();
+    EraseOrphanRef(g_orphan_list, &COrphanTx::list_pos, orphan);
 
+    auto itPeer = g_orphans_by_peer.find(it->second.fromPeer);
+    assert(itPeer != g_orphans_by_peer.end());
+    EraseOrphanRef(itPeer->second, &COrphanTx::peer_pos, orphan);
+    if (itPeer->second.empty())
+        g_orphans_by_peer.erase(itPeer);
+
+    // The entry in g_orphan_expiry is skipped when it comes up, or dropped by CompactOrphanExpiry
     mapOrphanTransactions.erase(it);
     return 1;
 }
@@ -1088,44 +1147,56 @@ void EraseOrphansFor(NodeId peer)
 {
     LOCK(g_cs_orphans);
     int nErased = 0;
-    std::map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
-    while (iter != mapOrphanTransactions.end())
-    {
-        std::map<uint256, COrphanTx>::iterator maybeErase = iter++; // increment to avoid iterator becoming invalid
-        if (maybeErase->second.fromPeer == peer)
-        {
-            nErased += EraseOrphanTx(maybeErase->second.tx->GetHash());
+    auto itPeer = g_orphans_by_peer.find(peer);
+    if (itPeer != g_orphans_by_peer.end()) {
+        // Copied as erasing the orphans modifies the vector, and erases it together with the last one
+        const std::vector<OrphanRef> vErase = itPeer->second;
+        for (OrphanRef orphan : vErase) {
+            nErased += EraseOrphanTx(orphan->first);
         }
     }
     if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx from peer=%d\n", nErased, peer);
 }
 
+unsigned int LimitOrphanTxPerPeer(NodeId peer, unsigned int nMaxOrphansPerPeer)
+{
+    LOCK(g_cs_orphans);
+
+    unsigned int nEvicted = 0;
+    auto itPeer = g_orphans_by_peer.find(peer);
+    if (itPeer == g_orphans_by_peer.end()) return 0;
+    FastRandomContext rng;
+    while (itPeer->second.size() > nMaxOrphansPerPeer)
+    {
+        // Evict a random orphan of the peer, so that it can't push out the orphans of others.
+        // The peer's vector is erased together with its last orphan.
+        bool fLast = itPeer->second.size() == 1;
+        size_t randompos = rng.randrange(itPeer->second.size());
+        EraseOrphanTx(itPeer->second[randompos]->first);
+        ++nEvicted;
+        if (fLast) break;
+    }
+    return nEvicted;
+}
 
 unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans)
 {
     LOCK(g_cs_orphans);
 
     unsigned int nEvicted = 0;
-    static int64_t nNextSweep;
     int64_t nNow = GetTime();
-    if (nNextSweep <= nNow) {
-        // Sweep out expired orphan pool entries:
-        int nErased = 0;
-        int64_t nMinExpTime = nNow + ORPHAN_TX_EXPIRE_TIME - ORPHAN_TX_EXPIRE_INTERVAL;
-        std::map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
-        while (iter != mapOrphanTransactions.end())
-        {
-            std::map<uint256, COrphanTx>::iterator maybeErase = iter++;
-            if (maybeErase->second.nTimeExpire <= nNow) {
-                nErased += EraseOrphanTx(maybeErase->second.tx->GetHash());
-            } else {
-                nMinExpTime = std::min(maybeErase->second.nTimeExpire, nMinExpTime);
-            }
+    // Sweep out expired orphan pool entries. Entries are added with a fixed expiration time,
+    // so only the front of the queue has to be looked at.
+    int nErased = 0;
+    while (!g_orphan_expiry.empty() && g_orphan_expiry.front().first <= nNow) {
+        auto it = mapOrphanTransactions.find(g_orphan_expiry.front().second);
+        // The orphan may have been erased already, or erased and added again later
+        if (it != mapOrphanTransactions.end() && it->second.nTimeExpire <= nNow) {
+            nErased += EraseOrphanTx(it->first);
         }
-        // Sweep again 5 minutes after the next entry that expires in order to batch the linear scan.
-        nNextSweep = nMinExpTime + ORPHAN_TX_EXPIRE_INTERVAL;
-        if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx due to expiration\n", nErased);
+        g_orphan_expiry.pop_front();
     }
+    if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx due to expiration\n", nErased);
     FastRandomContext rng;
     while (mapOrphanTransactions.size() > nMaxOrphans)
     {
@@ -1134,6 +1205,9 @@ unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans)
         EraseOrphanTx(g_orphan_list[randompos]->first);
         ++nEvicted;
     }
+    if (mapOrphanTransactions.empty()) {
+        g_orphan_expiry.clear();
+    }
     return nEvicted;
 }
 
@@ -1646,21 +1720,26 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
         std::shared_ptr<const CBlock> pblock;
         if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
             pblock = a_recent_block;
-        } else if (inv.type == MSG_WITNESS_BLOCK) {
-            // Fast-path: in this case it is possible to serve the block directly from disk,
-            // as the network format matches the format on disk
-            std::vector<uint8_t> block_data;
-            if (!ReadRawBlockFromDisk(block_data, pindex, chainparams.MessageStart())) {
-                assert(!"cannot load block from disk");
-            }
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data)));
-            // Don't set pblock as we've sent the block
         } else {
-            // Send block from disk
-            std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
-            if (!ReadBlockFromDisk(*pblockRead, pindex, consensusParams))
-                assert(!"cannot load block from disk");
-            pblock = pblockRead;
+            std::shared_ptr<const std::vector<uint8_t>> block_data;
+            if (inv.type == MSG_WITNESS_BLOCK || inv.type == MSG_BLOCK) {
+                block_data = ReadRawBlockCached(pindex, chainparams.MessageStart());
+                if (!block_data) {
+                    assert(!"cannot load block from disk");
+                }
+            }
+            if (block_data && (inv.type == MSG_WITNESS_BLOCK || !RawBlockHasWitness(*block_data))) {
+                // Fast-path: in this case it is possible to serve the block directly from disk,
+                // as the network format matches the format on disk
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(*block_data)));
+                // Don't set pblock as we've sent the block
+            } else {
+                // Send block from disk
+                std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+                if (!ReadBlockFromDisk(*pblockRead, pindex, consensusParams))
+                    assert(!"cannot load block from disk");
+                pblock = pblockRead;
+            }
         }
         if (pblock) {
             if (inv.type == MSG_BLOCK)
@@ -2192,6 +2271,137 @@ void static ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphan_work_se
     }
 }
 
+namespace {
+
+/** Handler of a BitCorn protocol extension message */
+typedef void (*NetMsgHandler)(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman);
+
+/**
+ * Maps the commands of the protocol extensions to the subsystem handling them. The table
+ * is filled once on first use and is read-only afterwards, so lookups don't need a lock.
+ */
+class CNetMsgDispatcher
+{
+private:
+    struct Entry
+    {
+        std::string strCommand;
+        NetMsgHandler handler;
+        std::atomic<uint64_t> nMessages{0};
+        std::atomic<uint64_t> nBytes{0};
+        std::atomic<int64_t> nTimeMicros{0};
+
+        Entry(const std::string& _strCommand, NetMsgHandler _handler) : strCommand(_strCommand), handler(_handler) {}
+    };
+
+    // deque, as the entries are not movable
+    std::deque<Entry> vEntries;
+    std::unordered_map<std::string, size_t> mapCommandIds;
+
+    void Register(std::initializer_list<const char*> commands, NetMsgHandler handler)
+    {
+        for (const char* strCommand : commands) {
+            bool fInserted = mapCommandIds.emplace(strCommand, vEntries.size()).second;
+            assert(fInserted);
+            vEntries.emplace_back(strCommand, handler);
+        }
+    }
+
+public:
+    CNetMsgDispatcher()
+    {
+        Register({NetMsgType::SPORK, NetMsgType::GETSPORKS}, [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman) {
+            sporkManager.ProcessSpork(pfrom, strCommand, vRecv, *connman);
+        });
+        Register({NetMsgType::SYNCSTATUSCOUNT}, [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman) {
+            masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
+        });
+        Register({NetMsgType::MNGOVERNANCESYNC, NetMsgType::MNGOVERNANCEOBJECT, NetMsgType::MNGOVERNANCEOBJECTVOTE, NetMsgType::MNGOVERNANCEVOTEDIGEST}, [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman) {
+            governance.ProcessMessage(pfrom, strCommand, vRecv, *connman);
+        });
+        Register({NetMsgType::MNAUTH}, [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman) {
+            CMNAuth::ProcessMessage(pfrom, strCommand, vRecv, connman);
+        });
+        Register({NetMsgType::QFCOMMITMENT}, [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman) {
+            llmq::quorumBlockProcessor->ProcessMessage(pfrom, strCommand, vRecv, connman);
+        });
+        Register({NetMsgType::QCONTRIB, NetMsgType::QCOMPLAINT, NetMsgType::QJUSTIFICATION, NetMsgType::QPCOMMITMENT, NetMsgType::QWATCH}, [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman) {
+            llmq::quorumDKGSessionManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
+        });
+        Register({NetMsgType::QSIGSESANN, NetMsgType::QSIGSHARESINV, NetMsgType::QGETSIGSHARES, NetMsgType::QBSIGSHARES}, [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman) {
+            llmq::quorumSigSharesManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
+        });
+        Register({NetMsgType::QSIGREC}, [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman) {
+            llmq::quorumSigningManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
+        });
+        Register({NetMsgType::CLSIG}, [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman) {
+            llmq::chainLocksHandler->ProcessMessage(pfrom, strCommand, vRecv, connman);
+        });
+        Register({NetMsgType::ISLOCK}, [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman) {
+            llmq::quorumInstantSendManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
+        });
+    }
+
+    /** Hand the message to its handler. Returns false if no handler is registered for the command. */
+    bool Dispatch(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman)
+    {
+        auto it = mapCommandIds.find(strCommand);
+        if (it == mapCommandIds.end()) {
+            return false;
+        }
+        Entry& entry = vEntries[it->second];
+        size_t nBytes = vRecv.size();
+        int64_t nTimeStart = GetTimeMicros();
+        entry.handler(pfrom, strCommand, vRecv, connman);
+        entry.nTimeMicros += GetTimeMicros() - nTimeStart;
+        entry.nBytes += nBytes;
+        entry.nMessages++;
+        return true;
+    }
+
+    std::vector<NetMsgHandlerStats> GetStats() const
+    {
+        std::vector<NetMsgHandlerStats> vStats;
+        vStats.reserve(vEntries.size());
+        for (const Entry& entry : vEntries) {
+            vStats.push_back({entry.strCommand, entry.nMessages, entry.nBytes, entry.nTimeMicros});
+        }
+        return vStats;
+    }
+};
+
+CNetMsgDispatcher& GetNetMsgDispatcher()
+{
+    static CNetMsgDispatcher dispatcher;
+    return dispatcher;
+}
+
+/**
+ * Messages which neither need cs_main for long nor touch the state of other peers, so that
+ * the message worker threads (-msghandlerthreads) may process them next to the message
+ * handler thread. Everything else stays on the message handler thread, in particular all
+ * block, transaction and address relay.
+ */
+bool IsConcurrentMessage(const std::string& strCommand)
+{
+    static const std::unordered_set<std::string> setConcurrentCommands = {
+        NetMsgType::PING, NetMsgType::PONG,
+        NetMsgType::SPORK, NetMsgType::GETSPORKS,
+        NetMsgType::MNAUTH,
+        NetMsgType::MNGOVERNANCEOBJECTVOTE,
+        NetMsgType::QCONTRIB, NetMsgType::QCOMPLAINT, NetMsgType::QJUSTIFICATION, NetMsgType::QPCOMMITMENT, NetMsgType::QWATCH,
+        NetMsgType::QSIGSESANN, NetMsgType::QSIGSHARESINV, NetMsgType::QGETSIGSHARES, NetMsgType::QBSIGSHARES,
+    };
+    return setConcurrentCommands.count(strCommand) != 0;
+}
+
+} // namespace
+
+std::vector<NetMsgHandlerStats> GetNetMsgHandlerStats()
+{
+    return GetNetMsgDispatcher().GetStats();
+}
+
 bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc, bool enable_bip61)
 {
     LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->GetId());
@@ -2908,9 +3118,16 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 }
                 AddOrphanTx(ptx, pfrom->GetId());
 
+                // DoS prevention: do not allow a single peer to fill the orphan pool
+                unsigned int nMaxOrphanTxPerPeer = (unsigned int)std::max((int64_t)1, gArgs.GetArg("-maxorphantxperpeer", DEFAULT_MAX_ORPHAN_TRANSACTIONS_PER_PEER));
+                unsigned int nEvicted = LimitOrphanTxPerPeer(pfrom->GetId(), nMaxOrphanTxPerPeer);
+                if (nEvicted > 0) {
+                    LogPrint(BCLog::MEMPOOL, "mapOrphan quota of peer=%d exceeded, removed %u tx\n", pfrom->GetId(), nEvicted);
+                }
+
                 // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
                 unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, gArgs.GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
-                unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx);
+                nEvicted = LimitOrphanTxSize(nMaxOrphanTx);
                 if (nEvicted > 0) {
                     LogPrint(BCLog::MEMPOOL, "mapOrphan overflow, removed %u tx\n", nEvicted);
                 }
@@ -3602,31 +3819,10 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         }
         return true;
     }
-    else {
-        // BitCorn: manage protocol extensions
-        bool found = false;
-        const std::vector<std::string> &allMessages = getAllNetMessageTypes();
-        for (const std::string msg : allMessages) {
-            if (msg == strCommand) {
-                found = true;
-                break;
-            }
-        }
 
-        if (found)
-        {
-            sporkManager.ProcessSpork(pfrom, strCommand, vRecv, *connman);
-            masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
-            governance.ProcessMessage(pfrom, strCommand, vRecv, *connman);
-            CMNAuth::ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::quorumBlockProcessor->ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::quorumDKGSessionManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::quorumSigSharesManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::quorumSigningManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::chainLocksHandler->ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::quorumInstantSendManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
-            return true;
-        }
+    // BitCorn: manage protocol extensions
+    if (GetNetMsgDispatcher().Dispatch(pfrom, strCommand, vRecv, connman)) {
+        return true;
     }
 
     // Ignore unknown commands for extensibility
@@ -3669,6 +3865,19 @@ bool PeerLogicValidation::SendRejectsAndCheckIfBanned(CNode* pnode, bool enable_
 }
 
 bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
+{
+    return ProcessNextMessage(pfrom, interruptMsgProc, false);
+}
+
+bool PeerLogicValidation::ProcessConcurrentMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
+{
+    // The handshake is done on the message handler thread
+    if (!pfrom->fSuccessfullyConnected)
+        return false;
+    return ProcessNextMessage(pfrom, interruptMsgProc, true);
+}
+
+bool PeerLogicValidation::ProcessNextMessage(CNode* pfrom, std::atomic<bool>& interruptMsgProc, bool fConcurrentOnly)
 {
     const CChainParams& chainparams = Params();
     //
@@ -3681,15 +3890,17 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     //
     bool fMoreWork = false;
 
-    if (!pfrom->vRecvGetData.empty())
-        ProcessGetData(pfrom, chainparams, connman, interruptMsgProc);
-
-    if (!pfrom->orphan_work_set.empty()) {
-        std::list<CTransactionRef> removed_txn;
-        LOCK2(cs_main, g_cs_orphans);
-        ProcessOrphanTx(connman, pfrom->orphan_work_set, removed_txn);
-        for (const CTransactionRef& removedTx : removed_txn) {
-            AddToCompactExtraTransactions(removedTx);
+    if (!fConcurrentOnly) {
+        if (!pfrom->vRecvGetData.empty())
+            ProcessGetData(pfrom, chainparams, connman, interruptMsgProc);
+
+        if (!pfrom->orphan_work_set.empty()) {
+            std::list<CTransactionRef> removed_txn;
+            LOCK2(cs_main, g_cs_orphans);
+            ProcessOrphanTx(connman, pfrom->orphan_work_set, removed_txn);
+            for (const CTransactionRef& removedTx : removed_txn) {
+                AddToCompactExtraTransactions(removedTx);
+            }
         }
     }
 
@@ -3698,8 +3909,8 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
 
     // this maintains the order of responses
     // and prevents vRecvGetData to grow unbounded
-    if (!pfrom->vRecvGetData.empty()) return true;
-    if (!pfrom->orphan_work_set.empty()) return true;
+    if (!pfrom->vRecvGetData.empty()) return !fConcurrentOnly;
+    if (!pfrom->orphan_work_set.empty()) return !fConcurrentOnly;
 
     // Don't bother if send buffer is too full to respond anyway
     if (pfrom->fPauseSend)
@@ -3710,9 +3921,12 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         LOCK(pfrom->cs_vProcessMsg);
         if (pfrom->vProcessMsg.empty())
             return false;
+        // Leave the message to the message handler thread
+        if (fConcurrentOnly && !IsConcurrentMessage(pfrom->vProcessMsg.front().hdr.GetCommand()))
+            return false;
         // Just take one message
         msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
-        pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+        pfrom->nProcessQueueSize -= msgs.front().GetMemoryUsage();
         pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
         fMoreWork = !pfrom->vProcessMsg.empty();
     }
@@ -3794,6 +4008,10 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
     }
 
+    // Rejects and bans are picked up by the next SendMessages on the message handler thread
+    if (fConcurrentOnly)
+        return fMoreWork;
+
     LOCK(cs_main);
     SendRejectsAndCheckIfBanned(pfrom, m_enable_bip61);
 
@@ -4586,6 +4804,9 @@ public:
         // orphan transactions
         mapOrphanTransactions.clear();
         mapOrphanTransactionsByPrev.clear();
+        g_orphan_list.clear();
+        g_orphans_by_peer.clear();
+        g_orphan_expiry.clear();
     }
 };
 static CNetProcessingCleanup instance_of_cnetprocessingcleanup;
@@ -15,18 +15,33 @@ extern CCriticalSection cs_main;
 
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
+/** Default for -maxorphantxperpeer, maximum number of orphan transactions kept in memory per peer */
+static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS_PER_PEER = 25;
 /** Default number of orphan+recently-replaced txn to keep around for block reconstruction */
 static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
 /** Default for BIP61 (sending reject messages) */
 static constexpr bool DEFAULT_ENABLE_BIP61{false};
 static const bool DEFAULT_PEERBLOOMFILTERS = false;
 
+/** Counters of the handler of a protocol extension message */
+struct NetMsgHandlerStats
+{
+    std::string strCommand;
+    uint64_t nMessages;
+    uint64_t nBytes;
+    int64_t nTimeMicros;
+};
+
+/** Per-command counters of the protocol extension handlers */
+std::vector<NetMsgHandlerStats> GetNetMsgHandlerStats();
+
 class PeerLogicValidation final : public CValidationInterface, public NetEventsInterface {
 private:
     CConnman* const connman;
     BanMan* const m_banman;
 
     bool SendRejectsAndCheckIfBanned(CNode* pnode, bool enable_bip61) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    bool ProcessNextMessage(CNode* pfrom, std::atomic<bool>& interrupt, bool fConcurrentOnly);
 public:
     PeerLogicValidation(CConnman* connman, BanMan* banman, CScheduler &scheduler, bool enable_bip61);
 
@@ -59,6 +74,14 @@ public:
     */
     bool ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt) override;
     /**
+    * Process the protocol messages received from a given node which don't need the message
+    * handler thread, stops at the first message which does
+    *
+    * @param[in]   pfrom           The node which we have received messages from.
+    * @param[in]   interrupt       Interrupt condition for processing threads
+    */
+    bool ProcessConcurrentMessages(CNode* pfrom, std::atomic<bool>& interrupt) override;
+    /**
     * Send queued protocol messages to be sent to a give node.
     *
     * @param[in]   pto             The node which we are sending messages to.
@@ -7,71 +7,147 @@
 #include <netfulfilledman.h>
 #include <shutdown.h>
 
+#include <algorithm>
+
 CNetFulfilledRequestManager netfulfilledman;
 
-void CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addr, const std::string& strRequest)
+CService CNetFulfilledRequestManager::SquashAddr(const CService& addr) const
+{
+    return Params().AllowMultiplePorts() ? addr : CService(addr, 0);
+}
+
+CNetFulfilledRequestManager::Shard& CNetFulfilledRequestManager::GetShard(const CService& addrSquashed)
 {
-    LOCK(cs_mapFulfilledRequests);
-    CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    mapFulfilledRequests[addrSquashed][strRequest] = GetTime() + Params().FulfilledRequestExpireTime();
+    return shards[addrSquashed.GetHash() % NUM_SHARDS];
 }
 
-bool CNetFulfilledRequestManager::HasFulfilledRequest(const CService& addr, const std::string& strRequest)
+int CNetFulfilledRequestManager::GetRequestId(const std::string& strRequest)
 {
-    LOCK(cs_mapFulfilledRequests);
-    CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
+    {
+        boost::shared_lock<boost::shared_mutex> lock(mutexRequestIds);
+        auto it = mapRequestIds.find(strRequest);
+        if (it != mapRequestIds.end()) {
+            return it->second;
+        }
+    }
+    boost::unique_lock<boost::shared_mutex> lock(mutexRequestIds);
+    auto ret = mapRequestIds.emplace(strRequest, (int)vecRequestNames.size());
+    if (ret.second) {
+        vecRequestNames.push_back(strRequest);
+    }
+    return ret.first->second;
+}
 
-    return  it != mapFulfilledRequests.end() &&
-            it->second.find(strRequest) != it->second.end() &&
-            it->second[strRequest] > GetTime();
+void CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addrSquashed, int nRequestId, int64_t nExpirationTime)
+{
+    Shard& shard = GetShard(addrSquashed);
+    LOCK(shard.cs);
+    auto ret = shard.mapFulfilledRequests[addrSquashed].emplace(nRequestId, nExpirationTime);
+    if (!ret.second) {
+        // Queued already, see CheckAndRemove
+        ret.first->second = nExpirationTime;
+        return;
+    }
+    shard.queueExpiration.emplace_back(nExpirationTime, addrSquashed, nRequestId);
 }
 
-void CNetFulfilledRequestManager::RemoveFulfilledRequest(const CService& addr, const std::string& strRequest)
+void CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addr, int nRequestId)
 {
-    LOCK(cs_mapFulfilledRequests);
-    CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
+    AddFulfilledRequest(SquashAddr(addr), nRequestId, GetTime() + Params().FulfilledRequestExpireTime());
+}
 
-    if (it != mapFulfilledRequests.end()) {
-        it->second.erase(strRequest);
+bool CNetFulfilledRequestManager::HasFulfilledRequest(const CService& addr, int nRequestId)
+{
+    CService addrSquashed = SquashAddr(addr);
+    Shard& shard = GetShard(addrSquashed);
+    LOCK(shard.cs);
+    auto it = shard.mapFulfilledRequests.find(addrSquashed);
+    if (it == shard.mapFulfilledRequests.end()) {
+        return false;
     }
+    auto it_entry = it->second.find(nRequestId);
+    return it_entry != it->second.end() && it_entry->second > GetTime();
 }
 
-void CNetFulfilledRequestManager::CheckAndRemove()
+CNetFulfilledRequestManager::fulfilledreqmap_t CNetFulfilledRequestManager::GetFulfilledRequests()
 {
-    LOCK(cs_mapFulfilledRequests);
+    fulfilledreqmap_t mapFulfilledRequests;
+    boost::shared_lock<boost::shared_mutex> lockIds(mutexRequestIds);
+    for (Shard& shard : shards) {
+        LOCK(shard.cs);
+        for (const auto& addrPair : shard.mapFulfilledRequests) {
+            fulfilledreqmapentry_t& entry = mapFulfilledRequests[addrPair.first];
+            for (const auto& requestPair : addrPair.second) {
+                entry.emplace(vecRequestNames[requestPair.first], requestPair.second);
+            }
+        }
+    }
+    return mapFulfilledRequests;
+}
+
+void CNetFulfilledRequestManager::SetFulfilledRequests(const fulfilledreqmap_t& mapFulfilledRequests)
+{
+    Clear();
+
+    // Queue the requests by expiration time, as they would have been added
+    std::vector<std::tuple<int64_t, CService, int>> vecRequests;
+    for (const auto& addrPair : mapFulfilledRequests) {
+        for (const auto& requestPair : addrPair.second) {
+            vecRequests.emplace_back(requestPair.second, addrPair.first, GetRequestId(requestPair.first));
+        }
+    }
+    std::sort(vecRequests.begin(), vecRequests.end());
+    for (const auto& request : vecRequests) {
+        AddFulfilledRequest(std::get<1>(request), std::get<2>(request), std::get<0>(request));
+    }
+}
 
+void CNetFulfilledRequestManager::CheckAndRemove()
+{
     int64_t now = GetTime();
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.begin();
-
-    while(it != mapFulfilledRequests.end()) {
-        fulfilledreqmapentry_t::iterator it_entry = it->second.begin();
-        while(it_entry != it->second.end()) {
-            if(now > it_entry->second) {
-                it->second.erase(it_entry++);
-            } else {
-                ++it_entry;
+
+    for (Shard& shard : shards) {
+        LOCK(shard.cs);
+        // Only the expired front of the queue is visited instead of all requests
+        while (!shard.queueExpiration.empty() && now > std::get<0>(shard.queueExpiration.front())) {
+            const auto request = std::move(shard.queueExpiration.front());
+            shard.queueExpiration.pop_front();
+            auto it = shard.mapFulfilledRequests.find(std::get<1>(request));
+            assert(it != shard.mapFulfilledRequests.end());
+            auto it_entry = it->second.find(std::get<2>(request));
+            assert(it_entry != it->second.end());
+            if (now <= it_entry->second) {
+                // The request was added again since, it goes to the back of the queue. That
+                // is at most one expiration interval late for the requests queued after it.
+                shard.queueExpiration.emplace_back(it_entry->second, std::get<1>(request), std::get<2>(request));
+                continue;
+            }
+            it->second.erase(it_entry);
+            if (it->second.empty()) {
+                shard.mapFulfilledRequests.erase(it);
             }
-        }
-        if(it->second.size() == 0) {
-            mapFulfilledRequests.erase(it++);
-        } else {
-            ++it;
         }
     }
 }
 
 void CNetFulfilledRequestManager::Clear()
 {
-    LOCK(cs_mapFulfilledRequests);
-    mapFulfilledRequests.clear();
+    for (Shard& shard : shards) {
+        LOCK(shard.cs);
+        shard.mapFulfilledRequests.clear();
+        shard.queueExpiration.clear();
+    }
 }
 
 std::string CNetFulfilledRequestManager::ToString() const
 {
+    size_t nNodes = 0;
+    for (Shard& shard : shards) {
+        LOCK(shard.cs);
+        nNodes += shard.mapFulfilledRequests.size();
+    }
     std::ostringstream info;
-    info << "Nodes with fulfilled requests: " << (int)mapFulfilledRequests.size();
+    info << "Nodes with fulfilled requests: " << (int)nNodes;
     return info.str();
 }
 
@@ -9,22 +9,58 @@
 #include <serialize.h>
 #include <sync.h>
 
+#include <array>
+#include <deque>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <boost/thread/shared_mutex.hpp>
+
 class CNetFulfilledRequestManager;
 extern CNetFulfilledRequestManager netfulfilledman;
 
+namespace netfulfilledman_tests {
+class TestNetFulfilledRequestManager;
+}
+
 // Fulfilled requests are used to prevent nodes from asking for the same data on sync
 // and from being banned for doing so too often.
 class CNetFulfilledRequestManager
 {
 private:
+    // disk format, request names instead of ids
     typedef std::map<std::string, int64_t> fulfilledreqmapentry_t;
     typedef std::map<CService, fulfilledreqmapentry_t> fulfilledreqmap_t;
 
-    //keep track of what node has/was asked for and when
-    fulfilledreqmap_t mapFulfilledRequests;
-    CCriticalSection cs_mapFulfilledRequests;
+    static const size_t NUM_SHARDS = 16;
+
+    // Addresses are spread over the shards by their hash, so that peers handled by
+    // different message handler threads rarely wait for each other
+    struct Shard {
+        CCriticalSection cs;
+        //keep track of what node has/was asked for and when (expiration time per request id)
+        std::map<CService, std::map<int, int64_t>> mapFulfilledRequests GUARDED_BY(cs);
+        // (expiration time, address, request id) in the order the requests were added, as
+        // all requests expire after the same time this is ordered by expiration time too.
+        // Every request is queued once, a request added again is queued again with its new
+        // expiration time when its entry reaches the front.
+        std::deque<std::tuple<int64_t, CService, int>> queueExpiration GUARDED_BY(cs);
+    };
+    mutable std::array<Shard, NUM_SHARDS> shards;
+
+    // Request names are interned, the ids are never reused
+    mutable boost::shared_mutex mutexRequestIds;
+    std::map<std::string, int> mapRequestIds;
+    std::vector<std::string> vecRequestNames;
 
-    void RemoveFulfilledRequest(const CService& addr, const std::string& strRequest);
+    CService SquashAddr(const CService& addr) const;
+    Shard& GetShard(const CService& addrSquashed);
+
+    void AddFulfilledRequest(const CService& addrSquashed, int nRequestId, int64_t nExpirationTime);
+
+    friend class netfulfilledman_tests::TestNetFulfilledRequestManager; // for test access to the shards
 
 public:
     CNetFulfilledRequestManager() {}
@@ -33,12 +69,24 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
-        LOCK(cs_mapFulfilledRequests);
+        fulfilledreqmap_t mapFulfilledRequests;
+        if (!ser_action.ForRead()) {
+            mapFulfilledRequests = GetFulfilledRequests();
+        }
         READWRITE(mapFulfilledRequests);
+        if (ser_action.ForRead()) {
+            SetFulfilledRequests(mapFulfilledRequests);
+        }
     }
 
-    void AddFulfilledRequest(const CService& addr, const std::string& strRequest);
-    bool HasFulfilledRequest(const CService& addr, const std::string& strRequest);
+    /// Id of the request with this name, callers look it up once and keep it
+    int GetRequestId(const std::string& strRequest);
+
+    void AddFulfilledRequest(const CService& addr, int nRequestId);
+    bool HasFulfilledRequest(const CService& addr, int nRequestId);
+
+    fulfilledreqmap_t GetFulfilledRequests();
+    void SetFulfilledRequests(const fulfilledreqmap_t& mapFulfilledRequests);
 
     void CheckAndRemove();
     void Clear();
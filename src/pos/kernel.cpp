@@ -266,6 +266,28 @@ static bool GetKernelStakeModifier(CBlockIndex* pindexPrev, uint256 hashBlockFro
     return GetKernelStakeModifierV03(pindexPrev, hashBlockFrom, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, fPrintProofOfStake);
 }
 
+// v0.3 protocol kernel hash weight starts from 0 at the 30-day min age
+// this change increases active coins participating the hash and helps
+// to secure the network when proof-of-stake difficulty is low
+static arith_uint256 GetStakeKernelCoinDayWeight(const CBlockHeader& blockFrom, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    auto txPrevTime = blockFrom.GetBlockTime();
+    CAmount nValueIn = txPrev->vout[prevout.n].nValue;
+    int64_t nTimeWeight = std::min<int64_t>(nTimeTx - txPrevTime, params.nStakeMaxAge - params.nStakeMinAge);
+    return nValueIn * nTimeWeight / COIN / 200;
+}
+
+static uint256 GetStakeKernelHash(uint64_t nStakeModifier, const CBlockHeader& blockFrom, const COutPoint& prevout, unsigned int nTimeTx)
+{
+    auto txPrevTime = blockFrom.GetBlockTime();
+    unsigned int nTimeBlockFrom = blockFrom.GetBlockTime();
+    CDataStream ss(SER_GETHASH, 0);
+    ss << nStakeModifier;
+    ss << nTimeBlockFrom << txPrevTime << prevout.n << nTimeTx;
+    return Hash(ss.begin(), ss.end());
+}
+
 // peercoin kernel protocol
 // coinstake must meet hash target according to the protocol:
 // kernel (input 0) must meet the formula
@@ -305,13 +327,8 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBl
     arith_uint256 bnTargetPerCoinDay;
     bnTargetPerCoinDay.SetCompact(nBits);
     CAmount nValueIn = txPrev->vout[prevout.n].nValue;
-    // v0.3 protocol kernel hash weight starts from 0 at the 30-day min age
-    // this change increases active coins participating the hash and helps
-    // to secure the network when proof-of-stake difficulty is low
-    int64_t nTimeWeight = std::min<int64_t>(nTimeTx - txPrevTime, params.nStakeMaxAge - params.nStakeMinAge);
-    arith_uint256 bnCoinDayWeight = nValueIn * nTimeWeight / COIN / 200;
+    arith_uint256 bnCoinDayWeight = GetStakeKernelCoinDayWeight(blockFrom, txPrev, prevout, nTimeTx);
     // Calculate hash
-    CDataStream ss(SER_GETHASH, 0);
     uint64_t nStakeModifier = 0;
     int nStakeModifierHeight = 0;
     int64_t nStakeModifierTime = 0;
@@ -319,9 +336,7 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBl
     if (!GetKernelStakeModifier(pindexPrev, blockFrom.GetHash(), nTimeTx, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, fPrintProofOfStake))
         return false;
 
-    ss << nStakeModifier;
-    ss << nTimeBlockFrom << txPrevTime << prevout.n << nTimeTx;
-    hashProofOfStake = Hash(ss.begin(), ss.end());
+    hashProofOfStake = GetStakeKernelHash(nStakeModifier, blockFrom, prevout, nTimeTx);
     if (fPrintProofOfStake)
     {
         LogPrint(BCLog::KERNEL, "%s: using modifier 0x%016x at height=%d timestamp=%s for block from height=%d timestamp=%s\n",
@@ -362,6 +377,27 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBl
     return true;
 }
 
+bool GetKernelStakeModifier(CBlockIndex* pindexPrev, const uint256& hashBlockFrom, uint64_t& nStakeModifier)
+{
+    int nStakeModifierHeight = 0;
+    int64_t nStakeModifierTime = 0;
+    return GetKernelStakeModifier(pindexPrev, hashBlockFrom, 0, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, false);
+}
+
+bool CheckStakeKernelHash(unsigned int nBits, uint64_t nStakeModifier, const CBlockHeader& blockFrom, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    unsigned int nTimeBlockFrom = blockFrom.GetBlockTime();
+    if (nTimeTx < nTimeBlockFrom || nTimeBlockFrom + params.nStakeMinAge > nTimeTx)
+        return false;
+
+    arith_uint256 bnTargetPerCoinDay;
+    bnTargetPerCoinDay.SetCompact(nBits);
+    arith_uint256 bnCoinDayWeight = GetStakeKernelCoinDayWeight(blockFrom, txPrev, prevout, nTimeTx);
+    hashProofOfStake = GetStakeKernelHash(nStakeModifier, blockFrom, prevout, nTimeTx);
+    return UintToArith256(hashProofOfStake) <= bnCoinDayWeight * bnTargetPerCoinDay;
+}
+
 // Check kernel hash target and coinstake signature
 bool CheckProofOfStake(const CBlock &block, CBlockIndex* pindexPrev, uint256& hashProofOfStake)
 {
@@ -25,6 +25,14 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t& nStake
 // Sets hashProofOfStake on success return
 bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBlockHeader blockFrom, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, bool fPrintProofOfStake=false);
 
+// Get the stake modifier to hash for a kernel of a coin from block hashBlockFrom on top of pindexPrev,
+// it doesn't depend on the time of the kernel (requires cs_main)
+bool GetKernelStakeModifier(CBlockIndex* pindexPrev, const uint256& hashBlockFrom, uint64_t& nStakeModifier);
+
+// Check whether stake kernel meets hash target with the stake modifier already known,
+// used by the staker to try many kernel times without looking up the modifier each time
+bool CheckStakeKernelHash(unsigned int nBits, uint64_t nStakeModifier, const CBlockHeader& blockFrom, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake);
+
 // Check kernel hash target and coinstake signature
 // Sets hashProofOfStake on success return
 bool CheckProofOfStake(const CBlock &block, CBlockIndex* pindexPrev, uint256& hashProofOfStake);
@@ -9,11 +9,16 @@
 #include <core_io.h>
 #include <httpserver.h>
 #include <index/txindex.h>
+#include <llmq/quorums.h>
+#include <llmq/quorums_chainlocks.h>
+#include <llmq/quorums_instantsend.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <rpc/blockchain.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
+#include <special/deterministicmns.h>
+#include <special/simplifiedmns.h>
 #include <streams.h>
 #include <sync.h>
 #include <txmempool.h>
@@ -206,6 +211,7 @@ static bool rest_block(HTTPRequest* req,
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
     CBlock block;
+    std::shared_ptr<const std::vector<uint8_t>> block_data;
     CBlockIndex* pblockindex = nullptr;
     CBlockIndex* tip = nullptr;
     {
@@ -219,24 +225,42 @@ static bool rest_block(HTTPRequest* req,
         if (IsBlockPruned(pblockindex))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        if (rf == RetFormat::BINARY || rf == RetFormat::HEX) {
+            // The on-disk format can be returned as-is unless witness data has to be stripped
+            block_data = ReadRawBlockCached(pblockindex, Params().MessageStart());
+            if (block_data && (RPCSerializationFlags() & SERIALIZE_TRANSACTION_NO_WITNESS) && RawBlockHasWitness(*block_data)) {
+                block_data.reset();
+            }
+        }
+
+        if (!block_data && !ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
     }
 
     switch (rf) {
     case RetFormat::BINARY: {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string binaryBlock = ssBlock.str();
+        std::string binaryBlock;
+        if (block_data) {
+            binaryBlock.assign(block_data->begin(), block_data->end());
+        } else {
+            CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+            ssBlock << block;
+            binaryBlock = ssBlock.str();
+        }
         req->WriteHeader("Content-Type", "application/octet-stream");
         req->WriteReply(HTTP_OK, binaryBlock);
         return true;
     }
 
     case RetFormat::HEX: {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
+        std::string strHex;
+        if (block_data) {
+            strHex = HexStr(block_data->begin(), block_data->end()) + "\n";
+        } else {
+            CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+            ssBlock << block;
+            strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
+        }
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
         return true;
@@ -622,6 +646,253 @@ static bool rest_blockhash_by_height(HTTPRequest* req,
     }
 }
 
+/** Reply with the network serialization of obj, for the binary and hex formats */
+template <typename T>
+static bool RESTSerializedReply(HTTPRequest* req, RetFormat rf, const T& obj)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << obj;
+    if (rf == RetFormat::BINARY) {
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, ss.str());
+    } else {
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, HexStr(ss.begin(), ss.end()) + "\n");
+    }
+    return true;
+}
+
+static bool RESTJSONReply(HTTPRequest* req, const UniValue& obj)
+{
+    req->WriteHeader("Content-Type", "application/json");
+    req->WriteReply(HTTP_OK, obj.write() + "\n");
+    return true;
+}
+
+/** Look up a block of the active chain, the caller has to reply if this fails */
+static const CBlockIndex* LookupActiveBlockIndex(HTTPRequest* req, const std::string& hashStr)
+{
+    uint256 hash;
+    if (!ParseHashStr(hashStr, hash)) {
+        RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
+        return nullptr;
+    }
+    LOCK(cs_main);
+    const CBlockIndex* pindex = LookupBlockIndex(hash);
+    if (!pindex || !::ChainActive().Contains(pindex)) {
+        RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        return nullptr;
+    }
+    return pindex;
+}
+
+// The masternode list and LLMQ endpoints are served from the caches of the masternode
+// list, quorum, InstantSend and ChainLocks managers, cs_main is only taken to look up
+// the requested blocks.
+
+static bool rest_mnlist(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string hashStr;
+    const RetFormat rf = ParseDataFormat(hashStr, strURIPart);
+
+    const CBlockIndex* pindex = LookupActiveBlockIndex(req, hashStr);
+    if (!pindex)
+        return false;
+    const CDeterministicMNList mnList = deterministicMNManager->GetListForBlock(pindex);
+
+    switch (rf) {
+    case RetFormat::BINARY:
+    case RetFormat::HEX:
+        return RESTSerializedReply(req, rf, mnList);
+
+    case RetFormat::JSON: {
+        UniValue objList(UniValue::VOBJ);
+        objList.pushKV("blockHash", mnList.GetBlockHash().GetHex());
+        objList.pushKV("height", mnList.GetHeight());
+        objList.pushKV("totalRegisteredCount", (uint64_t)mnList.GetTotalRegisteredCount());
+        UniValue mns(UniValue::VARR);
+        mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+            UniValue objMN(UniValue::VOBJ);
+            dmn->ToJson(objMN);
+            mns.push_back(objMN);
+        });
+        objList.pushKV("mnList", mns);
+        return RESTJSONReply(req, objList);
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+static bool rest_mnlistdiff(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/mnlistdiff/<baseblockhash>/<blockhash>.<ext>");
+
+    uint256 baseBlockHash, blockHash;
+    if (!ParseHashStr(path[0], baseBlockHash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + path[0]);
+    if (!ParseHashStr(path[1], blockHash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + path[1]);
+
+    CSimplifiedMNListDiff mnListDiff;
+    std::string strError;
+    {
+        LOCK(cs_main);
+        if (!BuildSimplifiedMNListDiff(baseBlockHash, blockHash, mnListDiff, strError))
+            return RESTERR(req, HTTP_NOT_FOUND, strError);
+    }
+
+    switch (rf) {
+    case RetFormat::BINARY:
+    case RetFormat::HEX:
+        return RESTSerializedReply(req, rf, mnListDiff);
+
+    case RetFormat::JSON: {
+        UniValue objDiff;
+        mnListDiff.ToJson(objDiff);
+        return RESTJSONReply(req, objDiff);
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+// A bit of a hack - dependency on a function defined in rpc/quorum.cpp
+UniValue BuildQuorumInfo(const llmq::CQuorumCPtr& quorum, bool includeMembers, bool includeSkShare);
+
+static bool rest_quorums(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string typeStr;
+    const RetFormat rf = ParseDataFormat(typeStr, strURIPart);
+
+    // The LLMQ type is given by its name or number
+    const Consensus::LLMQParams* llmqParams = nullptr;
+    int32_t nType;
+    for (const auto& p : Params().GetConsensus().llmqs) {
+        if (p.second.name == typeStr || (ParseInt32(typeStr, &nType) && nType == p.first)) {
+            llmqParams = &p.second;
+        }
+    }
+    if (!llmqParams)
+        return RESTERR(req, HTTP_NOT_FOUND, "LLMQ type " + SanitizeString(typeStr) + " not found");
+
+    const std::vector<llmq::CQuorumCPtr> quorums = llmq::quorumManager->ScanQuorums(llmqParams->type, llmqParams->signingActiveQuorumCount);
+
+    switch (rf) {
+    case RetFormat::BINARY:
+    case RetFormat::HEX: {
+        std::vector<llmq::CFinalCommitment> commitments;
+        for (const auto& quorum : quorums) {
+            commitments.push_back(quorum->qc);
+        }
+        return RESTSerializedReply(req, rf, commitments);
+    }
+
+    case RetFormat::JSON: {
+        UniValue arrQuorums(UniValue::VARR);
+        for (const auto& quorum : quorums) {
+            arrQuorums.push_back(BuildQuorumInfo(quorum, false, false));
+        }
+        return RESTJSONReply(req, arrQuorums);
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+static bool rest_islock(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string hashStr;
+    const RetFormat rf = ParseDataFormat(hashStr, strURIPart);
+
+    uint256 txid;
+    if (!ParseHashStr(hashStr, txid))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
+
+    const llmq::CInstantSendLockPtr islock = llmq::quorumInstantSendManager->GetInstantSendLockByTxid(txid);
+    if (!islock)
+        return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not locked");
+
+    switch (rf) {
+    case RetFormat::BINARY:
+    case RetFormat::HEX:
+        return RESTSerializedReply(req, rf, *islock);
+
+    case RetFormat::JSON: {
+        UniValue objLock(UniValue::VOBJ);
+        objLock.pushKV("txid", islock->txid.GetHex());
+        objLock.pushKV("hash", ::SerializeHash(*islock).GetHex());
+        UniValue inputs(UniValue::VARR);
+        for (const COutPoint& outpoint : islock->inputs) {
+            UniValue objInput(UniValue::VOBJ);
+            objInput.pushKV("txid", outpoint.hash.GetHex());
+            objInput.pushKV("vout", (uint64_t)outpoint.n);
+            inputs.push_back(objInput);
+        }
+        objLock.pushKV("inputs", inputs);
+        objLock.pushKV("signature", islock->sig.Get().ToString());
+        return RESTJSONReply(req, objLock);
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+static bool rest_chainlock(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    // Registered as a prefix for the format suffix, anything else after the path is not this endpoint
+    if (!param.empty())
+        return RESTERR(req, HTTP_NOT_FOUND, "Invalid URI format. Expected /rest/chainlock.<ext>");
+
+    const llmq::CChainLockSig clsig = llmq::chainLocksHandler->GetBestChainLock();
+    if (clsig.nHeight == -1)
+        return RESTERR(req, HTTP_NOT_FOUND, "Unable to find any chainlock");
+
+    switch (rf) {
+    case RetFormat::BINARY:
+    case RetFormat::HEX:
+        return RESTSerializedReply(req, rf, clsig);
+
+    case RetFormat::JSON: {
+        UniValue objLock(UniValue::VOBJ);
+        objLock.pushKV("blockhash", clsig.blockHash.GetHex());
+        objLock.pushKV("height", clsig.nHeight);
+        objLock.pushKV("signature", clsig.sig.ToString());
+        return RESTJSONReply(req, objLock);
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -635,6 +906,11 @@ static const struct {
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/mnlist/", rest_mnlist},
+      {"/rest/mnlistdiff/", rest_mnlistdiff},
+      {"/rest/quorums/", rest_quorums},
+      {"/rest/islock/", rest_islock},
+      {"/rest/chainlock", rest_chainlock},
 };
 
 void StartREST()
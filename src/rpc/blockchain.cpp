@@ -20,6 +20,7 @@
 #include <policy/policy.h>
 #include <policy/rbf.h>
 #include <primitives/transaction.h>
+#include <rpc/jsonstream.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
@@ -125,6 +126,32 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
     return result;
 }
 
+void blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails, JSONStreamWriter& writer)
+{
+    // Everything but the transaction details is small, build it as usual and put the
+    // transactions in at their place
+    const UniValue result = blockToJSON(block, tip, blockindex, false);
+    const std::vector<std::string>& keys = result.getKeys();
+    const std::vector<UniValue>& values = result.getValues();
+
+    writer.BeginObject();
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (txDetails && keys[i] == "tx") {
+            writer.Key(keys[i]);
+            writer.BeginArray();
+            for (const auto& tx : block.vtx) {
+                UniValue objTx(UniValue::VOBJ);
+                TxToUniv(*tx, uint256(), objTx, true, RPCSerializationFlags());
+                writer.Value(objTx);
+            }
+            writer.EndArray();
+        } else {
+            writer.KeyValue(keys[i], values[i]);
+        }
+    }
+    writer.EndObject();
+}
+
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
 {
     // Serialize passed information without accessing chain state of the active chain!
@@ -204,8 +231,7 @@ static UniValue getblockcount(const JSONRPCRequest& request)
                 },
             }.Check(request);
 
-    LOCK(cs_main);
-    return ::ChainActive().Height();
+    return GetChainSnapshot()->nHeight;
 }
 
 static UniValue getbestblockhash(const JSONRPCRequest& request)
@@ -222,8 +248,7 @@ static UniValue getbestblockhash(const JSONRPCRequest& request)
                 },
             }.Check(request);
 
-    LOCK(cs_main);
-    return ::ChainActive().Tip()->GetBlockHash().GetHex();
+    return GetChainSnapshot()->hashTip.GetHex();
 }
 
 void RPCNotifyBlockChange(bool ibd, const CBlockIndex * pindex)
@@ -377,6 +402,44 @@ static UniValue syncwithvalidationinterfacequeue(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+static UniValue getvalidationqueueinfo(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getvalidationqueueinfo",
+                "\nReturns the state of the validation interface callback queue of every listener.\n",
+                {},
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"name\": \"xxxx\",          (string) The name of the listener\n"
+            "    \"pending\": n,              (numeric) Callbacks queued and not run yet\n"
+            "    \"maxpending\": n,           (numeric) Highest number of pending callbacks seen\n"
+            "    \"callbacks\": n,            (numeric) Callbacks run so far\n"
+            "    \"avglatency\": n,           (numeric) Average time from queueing to completion of a callback, in microseconds\n"
+            "    \"maxlatency\": n            (numeric) Longest time from queueing to completion of a callback, in microseconds\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getvalidationqueueinfo","")
+            + HelpExampleRpc("getvalidationqueueinfo","")
+                },
+            }.Check(request);
+
+    UniValue ret(UniValue::VARR);
+    for (const ValidationInterfaceQueueStats& stats : GetMainSignals().GetQueueStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", stats.name);
+        obj.pushKV("pending", (uint64_t)stats.nPending);
+        obj.pushKV("maxpending", (uint64_t)stats.nMaxPending);
+        obj.pushKV("callbacks", stats.nCallbacks);
+        obj.pushKV("avglatency", stats.nAvgLatency);
+        obj.pushKV("maxlatency", stats.nMaxLatency);
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
 static UniValue getdifficulty(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getdifficulty",
@@ -391,8 +454,11 @@ static UniValue getdifficulty(const JSONRPCRequest& request)
                 },
             }.Check(request);
 
-    LOCK(cs_main);
-    return GetDifficulty(::ChainActive().Tip());
+    const CChainSnapshotPtr snapshot = GetChainSnapshot();
+    if (!snapshot->pindexTip) {
+        throw JSONRPCError(RPC_IN_WARMUP, "The chain is not loaded yet");
+    }
+    return GetDifficulty(snapshot->pindexTip);
 }
 
 static std::string EntryDescriptionString()
@@ -518,6 +584,23 @@ UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose)
     }
 }
 
+void MempoolToJSON(const CTxMemPool& pool, bool verbose, JSONStreamWriter& writer)
+{
+    if (!verbose) {
+        writer.Value(MempoolToJSON(pool, false));
+        return;
+    }
+
+    LOCK(pool.cs);
+    writer.BeginObject();
+    for (const CTxMemPoolEntry& e : pool.mapTx) {
+        UniValue info(UniValue::VOBJ);
+        entryToJSON(pool, info, e);
+        writer.KeyValue(e.GetTx().GetHash().ToString(), info);
+    }
+    writer.EndObject();
+}
+
 static UniValue getrawmempool(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getrawmempool",
@@ -548,6 +631,10 @@ static UniValue getrawmempool(const JSONRPCRequest& request)
     if (!request.params[0].isNull())
         fVerbose = request.params[0].get_bool();
 
+    if (request.stream) {
+        MempoolToJSON(::mempool, fVerbose, *request.stream);
+        return NullUniValue;
+    }
     return MempoolToJSON(::mempool, fVerbose);
 }
 
@@ -923,6 +1010,14 @@ static UniValue getblock(const JSONRPCRequest& request)
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
         }
 
+        if (verbosity <= 0 && !IsBlockPruned(pblockindex)) {
+            // Serve the on-disk bytes directly unless witness data has to be stripped
+            std::shared_ptr<const std::vector<uint8_t>> block_data = ReadRawBlockCached(pblockindex, Params().MessageStart());
+            if (block_data && !((RPCSerializationFlags() & SERIALIZE_TRANSACTION_NO_WITNESS) && RawBlockHasWitness(*block_data))) {
+                return HexStr(block_data->begin(), block_data->end());
+            }
+        }
+
         block = GetBlockChecked(pblockindex);
     }
 
@@ -934,6 +1029,10 @@ static UniValue getblock(const JSONRPCRequest& request)
         return strHex;
     }
 
+    if (request.stream && verbosity >= 2) {
+        blockToJSON(block, tip, pblockindex, true, *request.stream);
+        return NullUniValue;
+    }
     return blockToJSON(block, tip, pblockindex, verbosity >= 2);
 }
 
@@ -1342,16 +1441,18 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
     LOCK(cs_main);
 
     const CBlockIndex* tip = ::ChainActive().Tip();
+    // Published under cs_main with every tip change, so it is the snapshot of tip
+    const CChainSnapshotPtr snapshot = GetChainSnapshot();
     UniValue obj(UniValue::VOBJ);
     obj.pushKV("chain",                 Params().NetworkIDString());
     obj.pushKV("blocks",                (int)::ChainActive().Height());
     obj.pushKV("headers",               pindexBestHeader ? pindexBestHeader->nHeight : -1);
     obj.pushKV("bestblockhash",         tip->GetBlockHash().GetHex());
     obj.pushKV("difficulty",            (double)GetDifficulty(tip));
-    obj.pushKV("mediantime",            (int64_t)tip->GetMedianTimePast());
+    obj.pushKV("mediantime",            snapshot->nMedianTimePast);
     obj.pushKV("verificationprogress",  GuessVerificationProgress(Params().TxData(), tip));
     obj.pushKV("initialblockdownload",  ::ChainstateActive().IsInitialBlockDownload());
-    obj.pushKV("chainwork",             tip->nChainWork.GetHex());
+    obj.pushKV("chainwork",             snapshot->nChainWork.GetHex());
     obj.pushKV("size_on_disk",          CalculateCurrentUsage());
     obj.pushKV("pruned",                fPruneMode);
     if (fPruneMode) {
@@ -2378,6 +2479,7 @@ static const CRPCCommand commands[] =
     { "hidden",             "waitforblock",           &waitforblock,           {"blockhash","timeout"} },
     { "hidden",             "waitforblockheight",     &waitforblockheight,     {"height","timeout"} },
     { "hidden",             "syncwithvalidationinterfacequeue", &syncwithvalidationinterfacequeue, {} },
+    { "hidden",             "getvalidationqueueinfo", &getvalidationqueueinfo, {} },
 };
 // clang-format on
 
@@ -13,6 +13,7 @@
 #include <validation.h>
 #include <masternodes/sync.h>
 #include <messagesigner.h>
+#include <rpc/jsonstream.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
@@ -624,7 +625,8 @@ UniValue gobject_vote_alias(const JSONRPCRequest& request)
 }
 #endif
 
-UniValue ListObjects(const std::string& strCachedSignal, const std::string& strType, int nStartTime)
+// The objects are written to stream one by one if it is set, otherwise they are returned
+UniValue ListObjects(const std::string& strCachedSignal, const std::string& strType, int nStartTime, JSONStreamWriter* stream)
 {
     UniValue objResult(UniValue::VOBJ);
 
@@ -637,6 +639,7 @@ UniValue ListObjects(const std::string& strCachedSignal, const std::string& strT
 
     // CREATE RESULTS FOR USER
 
+    if (stream) stream->BeginObject();
     for (const auto& pGovObj : objs) {
         if (strCachedSignal == "valid" && !pGovObj->IsSetCachedValid()) continue;
         if (strCachedSignal == "funding" && !pGovObj->IsSetCachedFunding()) continue;
@@ -673,9 +676,17 @@ UniValue ListObjects(const std::string& strCachedSignal, const std::string& strT
         bObj.pushKV("fCachedDelete",  pGovObj->IsSetCachedDelete());
         bObj.pushKV("fCachedEndorsed",  pGovObj->IsSetCachedEndorsed());
 
-        objResult.pushKV(pGovObj->GetHash().ToString(), bObj);
+        if (stream) {
+            stream->KeyValue(pGovObj->GetHash().ToString(), bObj);
+        } else {
+            objResult.pushKV(pGovObj->GetHash().ToString(), bObj);
+        }
     }
 
+    if (stream) {
+        stream->EndObject();
+        return NullUniValue;
+    }
     return objResult;
 }
 
@@ -705,7 +716,7 @@ UniValue gobject_list(const JSONRPCRequest& request)
     if (strType != "proposals" && strType != "triggers" && strType != "all")
         return "Invalid type, should be 'proposals', 'triggers' or 'all'";
 
-    return ListObjects(strCachedSignal, strType, 0);
+    return ListObjects(strCachedSignal, strType, 0, request.stream);
 }
 
 void gobject_diff_help()
@@ -734,7 +745,7 @@ UniValue gobject_diff(const JSONRPCRequest& request)
     if (strType != "proposals" && strType != "triggers" && strType != "all")
         return "Invalid type, should be 'proposals', 'triggers' or 'all'";
 
-    return ListObjects(strCachedSignal, strType, governance.GetLastDiffTime());
+    return ListObjects(strCachedSignal, strType, governance.GetLastDiffTime(), request.stream);
 }
 
 void gobject_get_help()
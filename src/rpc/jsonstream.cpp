@@ -0,0 +1,94 @@
+// Copyright (c) 2020 The BitCorn Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/jsonstream.h>
+
+#include <univalue.h>
+
+#include <assert.h>
+
+JSONStreamWriter::JSONStreamWriter(Sink sink, size_t nChunkSize) : m_sink(std::move(sink)), m_chunk_size(nChunkSize)
+{
+    m_buffer.reserve(m_chunk_size);
+}
+
+void JSONStreamWriter::BeginElement()
+{
+    if (m_after_key) {
+        // The value of an object member, the separator was written with the key
+        m_after_key = false;
+        return;
+    }
+    if (!m_first.empty()) {
+        if (!m_first.back()) {
+            m_buffer += ',';
+        }
+        m_first.back() = false;
+    }
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    BeginElement();
+    m_buffer += '{';
+    m_first.push_back(true);
+}
+
+void JSONStreamWriter::EndObject()
+{
+    assert(!m_first.empty() && !m_after_key);
+    m_first.pop_back();
+    Append("}");
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    BeginElement();
+    m_buffer += '[';
+    m_first.push_back(true);
+}
+
+void JSONStreamWriter::EndArray()
+{
+    assert(!m_first.empty() && !m_after_key);
+    m_first.pop_back();
+    Append("]");
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!m_first.empty() && !m_after_key);
+    BeginElement();
+    // Escaped the same way UniValue does it
+    m_buffer += UniValue(key).write();
+    m_buffer += ':';
+    m_after_key = true;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    BeginElement();
+    Append(value.write());
+}
+
+void JSONStreamWriter::Raw(const std::string& str)
+{
+    Append(str);
+}
+
+void JSONStreamWriter::Append(const std::string& str)
+{
+    m_buffer += str;
+    if (m_buffer.size() >= m_chunk_size) {
+        Flush();
+    }
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (m_buffer.empty()) return;
+    m_sink(m_buffer.data(), m_buffer.size());
+    m_bytes_written += m_buffer.size();
+    m_buffer.clear();
+}
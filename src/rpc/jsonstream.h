@@ -0,0 +1,70 @@
+// Copyright (c) 2020 The BitCorn Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCORN_RPC_JSONSTREAM_H
+#define BITCORN_RPC_JSONSTREAM_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class UniValue;
+
+/**
+ * Writes JSON text incrementally, without building a UniValue tree of the whole
+ * document first. The text is collected in a buffer which is passed to the sink
+ * in chunks of about nChunkSize bytes, so only the element being written and one
+ * chunk are held in memory.
+ *
+ * Large RPC results are written through this, one element (a transaction, a
+ * masternode, a mempool entry) at a time.
+ */
+class JSONStreamWriter
+{
+public:
+    typedef std::function<void(const char* pch, size_t nSize)> Sink;
+
+    static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    explicit JSONStreamWriter(Sink sink, size_t nChunkSize = DEFAULT_CHUNK_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    /** Write the key of the next member of the current object */
+    void Key(const std::string& key);
+    /** Write a complete value, for an object member this follows Key() */
+    void Value(const UniValue& value);
+    void KeyValue(const std::string& key, const UniValue& value)
+    {
+        Key(key);
+        Value(value);
+    }
+    /** Write text which is already JSON, outside of any value */
+    void Raw(const std::string& str);
+
+    /** Pass the buffered text to the sink */
+    void Flush();
+
+    /** True if a key was written and its value is still missing */
+    bool ExpectsValue() const { return m_after_key; }
+    size_t GetDepth() const { return m_first.size(); }
+    uint64_t GetBytesWritten() const { return m_bytes_written; }
+
+private:
+    Sink m_sink;
+    const size_t m_chunk_size;
+    std::string m_buffer;
+    //! For every open object and array, whether nothing was written to it yet
+    std::vector<bool> m_first;
+    bool m_after_key{false};
+    uint64_t m_bytes_written{0};
+
+    /** Write the separator before a new element of the current object or array */
+    void BeginElement();
+    void Append(const std::string& str);
+};
+
+#endif // BITCORN_RPC_JSONSTREAM_H
@@ -94,7 +94,8 @@ UniValue masternode_count(const JSONRPCRequest& request)
     if (request.fHelp || request.params.size() > 2)
         masternode_count_help();
 
-    auto mnList = deterministicMNManager->GetListAtChainTip();
+    const CChainSnapshotPtr snapshot = GetChainSnapshot();
+    const CDeterministicMNList& mnList = *snapshot->mnList;
     int total = mnList.GetAllMNsCount();
     int enabled = mnList.GetValidMNsCount();
 
@@ -124,7 +125,8 @@ UniValue masternode_count(const JSONRPCRequest& request)
 
 UniValue GetNextMasternodeForPayment(int heightShift)
 {
-    auto mnList = deterministicMNManager->GetListAtChainTip();
+    const CChainSnapshotPtr snapshot = GetChainSnapshot();
+    const CDeterministicMNList& mnList = *snapshot->mnList;
     auto payees = mnList.GetProjectedMNPayees(heightShift);
     if (payees.empty())
         return "unknown";
@@ -267,14 +269,8 @@ UniValue masternode_winners(const JSONRPCRequest& request)
     if (request.fHelp)
         masternode_winners_help();
 
-    int nHeight;
-    {
-        LOCK(cs_main);
-        CBlockIndex* pindex = ChainActive().Tip();
-        if (!pindex) return NullUniValue;
-
-        nHeight = pindex->nHeight;
-    }
+    const int nHeight = GetChainSnapshot()->nHeight;
+    if (nHeight < 0) return NullUniValue;
 
     int nLast = 10;
     std::string strFilter = "";
@@ -374,7 +370,8 @@ UniValue masternodelist(const JSONRPCRequest& request)
 
     UniValue obj(UniValue::VOBJ);
 
-    auto mnList = deterministicMNManager->GetListAtChainTip();
+    const CChainSnapshotPtr snapshot = GetChainSnapshot();
+    const CDeterministicMNList& mnList = *snapshot->mnList;
     auto dmnToStatus = [&](const CDeterministicMNCPtr& dmn) {
         if (mnList.IsMNValid(dmn)) {
             return "ENABLED";
@@ -385,13 +382,13 @@ UniValue masternodelist(const JSONRPCRequest& request)
         return "UNKNOWN";
     };
     auto dmnToLastPaidTime = [&](const CDeterministicMNCPtr& dmn) {
-        if (dmn->pdmnState->nLastPaidHeight == 0) {
+        if (dmn->pdmnState->nLastPaidHeight == 0 || !snapshot->pindexTip) {
             return (int)0;
         }
 
-        LOCK(cs_main);
-        const CBlockIndex* pindex = ChainActive()[dmn->pdmnState->nLastPaidHeight];
-        return (int)pindex->nTime;
+        // The payment is in the chain of the list, no need to lock cs_main for the active chain
+        const CBlockIndex* pindex = snapshot->pindexTip->GetAncestor(dmn->pdmnState->nLastPaidHeight);
+        return pindex ? (int)pindex->nTime : 0;
     };
 
     mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
@@ -248,6 +248,8 @@ static UniValue prioritisetransaction(const JSONRPCRequest& request)
     }
 
     mempool.PrioritiseTransaction(hash, nAmount);
+    if (g_txselection_cache)
+        g_txselection_cache->Invalidate();
     return true;
 }
 
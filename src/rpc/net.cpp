@@ -381,6 +381,15 @@ static UniValue getnettotals(const JSONRPCRequest& request)
             "    \"serve_historical_blocks\": true|false,  (boolean) True if serving historical blocks\n"
             "    \"bytes_left_in_cycle\": t,               (numeric) Bytes left in current time cycle\n"
             "    \"time_left_in_cycle\": t                 (numeric) Seconds left in current time cycle\n"
+            "  },\n"
+            "  \"extmessages\":\n"
+            "  {\n"
+            "    \"command\": {                 (json object) Protocol extension message, only present if received\n"
+            "      \"count\": n,                (numeric) Number of messages handled\n"
+            "      \"bytes\": n,                (numeric) Total payload bytes\n"
+            "      \"time_us\": n               (numeric) Total time spent in the handler in microseconds\n"
+            "    },\n"
+            "    ...\n"
             "  }\n"
             "}\n"
                 },
@@ -405,6 +414,17 @@ static UniValue getnettotals(const JSONRPCRequest& request)
     outboundLimit.pushKV("bytes_left_in_cycle", g_connman->GetOutboundTargetBytesLeft());
     outboundLimit.pushKV("time_left_in_cycle", g_connman->GetMaxOutboundTimeLeftInCycle());
     obj.pushKV("uploadtarget", outboundLimit);
+
+    UniValue extMessages(UniValue::VOBJ);
+    for (const NetMsgHandlerStats& stats : GetNetMsgHandlerStats()) {
+        if (stats.nMessages == 0) continue;
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("count", stats.nMessages);
+        entry.pushKV("bytes", stats.nBytes);
+        entry.pushKV("time_us", stats.nTimeMicros);
+        extMessages.pushKV(stats.strCommand, entry);
+    }
+    obj.pushKV("extmessages", extMessages);
     return obj;
 }
 
@@ -44,7 +44,10 @@ UniValue quorum_list(const JSONRPCRequest& request)
     if (request.fHelp || (request.params.size() != 1 && request.params.size() != 2))
         quorum_list_help();
 
-    LOCK(cs_main);
+    const CChainSnapshotPtr snapshot = GetChainSnapshot();
+    if (!snapshot->pindexTip) {
+        throw JSONRPCError(RPC_IN_WARMUP, "The chain is not loaded yet");
+    }
 
     int count = -1;
     if (request.params.size() > 1) {
@@ -59,7 +62,7 @@ UniValue quorum_list(const JSONRPCRequest& request)
     for (auto& p : Params().GetConsensus().llmqs) {
         UniValue v(UniValue::VARR);
 
-        auto quorums = llmq::quorumManager->ScanQuorums(p.first, ChainActive().Tip(), count > -1 ? count : p.second.signingActiveQuorumCount);
+        auto quorums = llmq::quorumManager->ScanQuorums(p.first, snapshot->pindexTip, count > -1 ? count : p.second.signingActiveQuorumCount);
         for (auto& q : quorums) {
             v.push_back(q->qc.quorumHash.ToString());
         }
@@ -234,13 +237,8 @@ UniValue quorum_memberof(const JSONRPCRequest& request)
         }
     }
 
-    const CBlockIndex* pindexTip;
-    {
-        LOCK(cs_main);
-        pindexTip = ChainActive().Tip();
-    }
-
-    auto mnList = deterministicMNManager->GetListForBlock(pindexTip);
+    const CChainSnapshotPtr snapshot = GetChainSnapshot();
+    const CDeterministicMNList& mnList = *snapshot->mnList;
     auto dmn = mnList.GetMN(protxHash);
     if (!dmn) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "masternode not found");
@@ -10,6 +10,8 @@
 
 #include <univalue.h>
 
+class JSONStreamWriter;
+
 UniValue JSONRPCRequestObj(const std::string& strMethod, const UniValue& params, const UniValue& id);
 UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const UniValue& id);
 std::string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValue& id);
@@ -34,8 +36,13 @@ public:
     std::string URI;
     std::string authUser;
     std::string peerAddr;
+    /**
+     * Set when the result can be streamed to the client. RPCs with large results may
+     * then write their result here, instead of returning it, and return NullUniValue.
+     */
+    JSONStreamWriter* stream;
 
-    JSONRPCRequest() : id(NullUniValue), params(NullUniValue), fHelp(false) {}
+    JSONRPCRequest() : id(NullUniValue), params(NullUniValue), fHelp(false), stream(nullptr) {}
     void parse(const UniValue& valRequest);
 };
 
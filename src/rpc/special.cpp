@@ -9,6 +9,7 @@
 #include <init.h>
 #include <key_io.h>
 #include <messagesigner.h>
+#include <rpc/jsonstream.h>
 #include <rpc/register.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
@@ -979,6 +980,15 @@ UniValue protx_list(const JSONRPCRequest& request)
         type = request.params[1].get_str();
 
     UniValue ret(UniValue::VARR);
+    // Detailed lists of all masternodes are large, write them out entry by entry if possible
+    JSONStreamWriter* const stream = request.stream;
+    auto addEntry = [&](const UniValue& entry) {
+        if (stream) {
+            stream->Value(entry);
+        } else {
+            ret.push_back(entry);
+        }
+    };
 
     LOCK(cs_main);
 
@@ -1005,13 +1015,14 @@ UniValue protx_list(const JSONRPCRequest& request)
             setOutpts.emplace(outpt);
 
         CDeterministicMNList mnList = deterministicMNManager->GetListForBlock(ChainActive()[height]);
+        if (stream) stream->BeginArray();
         mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
             if (setOutpts.count(dmn->collateralOutpoint) ||
                 CheckWalletOwnsKey(pwallet, dmn->pdmnState->keyIDOwner) ||
                 CheckWalletOwnsKey(pwallet, dmn->pdmnState->keyIDVoting) ||
                 CheckWalletOwnsScript(pwallet, dmn->pdmnState->scriptPayout) ||
                 CheckWalletOwnsScript(pwallet, dmn->pdmnState->scriptOperatorPayout)) {
-                ret.push_back(BuildDMNListEntry(pwallet, dmn, detailed));
+                addEntry(BuildDMNListEntry(pwallet, dmn, detailed));
             }
         });
 #endif
@@ -1030,13 +1041,18 @@ UniValue protx_list(const JSONRPCRequest& request)
 
         CDeterministicMNList mnList = deterministicMNManager->GetListForBlock(ChainActive()[height]);
         bool onlyValid = type == "valid";
+        if (stream) stream->BeginArray();
         mnList.ForEachMN(onlyValid, [&](const CDeterministicMNCPtr& dmn) {
-            ret.push_back(BuildDMNListEntry(pwallet, dmn, detailed));
+            addEntry(BuildDMNListEntry(pwallet, dmn, detailed));
         });
     } else {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "invalid type specified");
     }
 
+    if (stream) {
+        stream->EndArray();
+        return NullUniValue;
+    }
     return ret;
 }
 
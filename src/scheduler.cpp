@@ -148,11 +148,10 @@ bool CScheduler::AreThreadsServicingQueue() const {
 void SingleThreadedSchedulerClient::MaybeScheduleProcessQueue() {
     {
         LOCK(m_cs_callbacks_pending);
-        // Try to avoid scheduling too many copies here, but if we
-        // accidentally have two ProcessQueue's scheduled at once its
-        // not a big deal.
         if (m_are_callbacks_running) return;
+        if (m_is_process_queue_scheduled) return;
         if (m_callbacks_pending.empty()) return;
+        m_is_process_queue_scheduled = true;
     }
     m_pscheduler->schedule(std::bind(&SingleThreadedSchedulerClient::ProcessQueue, this));
 }
@@ -161,6 +160,7 @@ void SingleThreadedSchedulerClient::ProcessQueue() {
     std::function<void ()> callback;
     {
         LOCK(m_cs_callbacks_pending);
+        m_is_process_queue_scheduled = false;
         if (m_are_callbacks_running) return;
         if (m_callbacks_pending.empty()) return;
         m_are_callbacks_running = true;
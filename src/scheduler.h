@@ -101,6 +101,9 @@ private:
     CCriticalSection m_cs_callbacks_pending;
     std::list<std::function<void ()>> m_callbacks_pending GUARDED_BY(m_cs_callbacks_pending);
     bool m_are_callbacks_running GUARDED_BY(m_cs_callbacks_pending) = false;
+    //! A ProcessQueue task is scheduled and did not start yet. At most one is, so the
+    //! client may be destroyed by the last callback it runs.
+    bool m_is_process_queue_scheduled GUARDED_BY(m_cs_callbacks_pending) = false;
 
     void MaybeScheduleProcessQueue();
     void ProcessQueue();
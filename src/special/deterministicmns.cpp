@@ -540,7 +540,7 @@ bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockInde
 
     // Don't hold cs while calling signals
     if (diff.HasChanges()) {
-        GetMainSignals().NotifyMasternodeListChanged(false, oldList, diff);
+        GetMainSignals().NotifyMasternodeListChanged(false, oldList, newList, diff);
         uiInterface.NotifyMasternodeListChanged(newList);
     }
 
@@ -576,7 +576,7 @@ bool CDeterministicMNManager::UndoBlock(const CBlock& block, const CBlockIndex*
 
     if (diff.HasChanges()) {
         auto inversedDiff = curList.BuildDiff(prevList);
-        GetMainSignals().NotifyMasternodeListChanged(true, curList, inversedDiff);
+        GetMainSignals().NotifyMasternodeListChanged(true, curList, prevList, inversedDiff);
         uiInterface.NotifyMasternodeListChanged(prevList);
     }
 
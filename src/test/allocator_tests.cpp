@@ -2,12 +2,14 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <support/allocators/pool.h>
 #include <util/memory.h>
 #include <util/system.h>
 
 #include <test/setup_common.h>
 
 #include <memory>
+#include <unordered_map>
 
 #include <boost/test/unit_test.hpp>
 
@@ -233,4 +235,54 @@ BOOST_AUTO_TEST_CASE(lockedpool_tests_live)
     BOOST_CHECK(pool.stats().used == initial.used);
 }
 
+BOOST_AUTO_TEST_CASE(pool_resource_tests)
+{
+    PoolResource<16, 8> resource(1024);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes(), 1024U);
+
+    // Freed blocks are handed out again for the same size class
+    void* a0 = resource.Allocate(8, 8);
+    void* a1 = resource.Allocate(16, 8);
+    BOOST_CHECK(a0 != a1);
+    resource.Deallocate(a0, 8, 8);
+    BOOST_CHECK(resource.Allocate(8, 8) == a0);
+    resource.Deallocate(a1, 16, 8);
+    BOOST_CHECK(resource.Allocate(16, 8) == a1);
+
+    // Oversized blocks don't come from the chunks
+    void* big = resource.Allocate(64, 8);
+    BOOST_CHECK(big);
+    resource.Deallocate(big, 64, 8);
+
+    // Exhausting a chunk allocates the next one
+    for (int i = 0; i < 1024 / 16; ++i) {
+        resource.Allocate(16, 8);
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(pool_allocator_tests)
+{
+    using Map = std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+                                   PoolAllocator<std::pair<const int, int>, sizeof(std::pair<const int, int>) + 4 * sizeof(void*), alignof(void*)>>;
+    Map::allocator_type::ResourceType resource(4096);
+    {
+        Map map{0, Map::hasher{}, Map::key_equal{}, &resource};
+        for (int i = 0; i < 1000; ++i) {
+            map[i] = i * 2;
+        }
+        for (int i = 0; i < 1000; i += 2) {
+            map.erase(i);
+        }
+        for (int i = 0; i < 1000; ++i) {
+            auto it = map.find(i);
+            BOOST_CHECK_EQUAL(it != map.end(), i % 2 == 1);
+            if (it != map.end()) BOOST_CHECK_EQUAL(it->second, i * 2);
+        }
+        BOOST_CHECK(map.get_allocator() == Map::allocator_type(&resource));
+    }
+    BOOST_CHECK(resource.NumAllocatedChunks() > 1U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
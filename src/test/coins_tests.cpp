@@ -8,6 +8,7 @@
 #include <script/standard.h>
 #include <streams.h>
 #include <test/setup_common.h>
+#include <txdb.h>
 #include <uint256.h>
 #include <undo.h>
 #include <util/strencodings.h>
@@ -592,7 +593,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
     InsertCoinsMapEntry(map, value, flags);
     BOOST_CHECK(view.BatchWrite(map, {}));
 }
@@ -776,6 +778,39 @@ BOOST_AUTO_TEST_CASE(ccoins_add)
     CheckAddCoin(VALUE2, VALUE3, VALUE3, DIRTY|FRESH, DIRTY|FRESH, true );
 }
 
+static void CheckAddFetchedCoin(CAmount cache_value, CAmount fetched_value, CAmount expected_value, char cache_flags, char expected_flags)
+{
+    SingleEntryCacheTest test(ABSENT, cache_value, cache_flags);
+
+    Coin coin;
+    SetCoinsValue(fetched_value, coin);
+    test.cache.AddFetchedCoin(OUTPOINT, std::move(coin));
+    test.cache.SelfTest();
+
+    CAmount result_value;
+    char result_flags;
+    GetCoinsMapEntry(test.cache.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, expected_value);
+    BOOST_CHECK_EQUAL(result_flags, expected_flags);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_add_fetched)
+{
+    /* Check AddFetchedCoin behavior, inserting a coin read from the backing
+     * view. Existing entries are never modified.
+     *
+     *                  Cache   Fetched Result  Cache        Result
+     *                  Value   Value   Value   Flags        Flags
+     */
+    CheckAddFetchedCoin(ABSENT, VALUE3, VALUE3, NO_ENTRY   , 0          );
+    CheckAddFetchedCoin(ABSENT, PRUNED, ABSENT, NO_ENTRY   , NO_ENTRY   );
+    CheckAddFetchedCoin(PRUNED, VALUE3, PRUNED, 0          , 0          );
+    CheckAddFetchedCoin(PRUNED, VALUE3, PRUNED, DIRTY      , DIRTY      );
+    CheckAddFetchedCoin(PRUNED, VALUE3, PRUNED, DIRTY|FRESH, DIRTY|FRESH);
+    CheckAddFetchedCoin(VALUE2, VALUE3, VALUE2, 0          , 0          );
+    CheckAddFetchedCoin(VALUE2, VALUE3, VALUE2, DIRTY      , DIRTY      );
+}
+
 void CheckWriteCoins(CAmount parent_value, CAmount child_value, CAmount expected_value, char parent_flags, char child_flags, char expected_flags)
 {
     SingleEntryCacheTest test(ABSENT, parent_value, parent_flags);
@@ -861,4 +896,43 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_background_flush)
+{
+    CCoinsViewDB db(1 << 20, true, true);
+    CCoinsViewBackgroundFlush flusher(db);
+    CCoinsViewCache cache(&flusher);
+
+    const COutPoint spent(InsecureRand256(), 0);
+    const COutPoint unspent(InsecureRand256(), 1);
+    const uint256 best_block = InsecureRand256();
+    uint64_t generation = flusher.GetWriteGeneration();
+
+    Coin coin;
+    coin.out.nValue = InsecureRand32();
+    coin.nHeight = 1;
+    cache.AddCoin(spent, Coin(coin), false);
+    cache.AddCoin(unspent, Coin(coin), false);
+    cache.SetBestBlock(best_block);
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(flusher.GetWriteGeneration() != generation);
+
+    // The flushed state is visible whether or not it reached the database yet
+    BOOST_CHECK(flusher.HaveCoin(unspent));
+    BOOST_CHECK(flusher.GetBestBlock() == best_block);
+
+    BOOST_CHECK(cache.SpendCoin(spent));
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!flusher.HaveCoin(spent));
+    BOOST_CHECK(flusher.HaveCoin(unspent));
+
+    BOOST_CHECK(flusher.Sync());
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    BOOST_CHECK(db.GetBestBlock() == best_block);
+    BOOST_CHECK(!db.HaveCoin(spent));
+    Coin read;
+    BOOST_CHECK(db.GetCoin(unspent, read));
+    BOOST_CHECK(read.out == coin.out);
+    BOOST_CHECK_EQUAL(read.nHeight, coin.nHeight);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,119 @@
+// Copyright (c) 2020 The BitCorn Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <coinsprefetch.h>
+#include <consensus/validation.h>
+#include <key.h>
+#include <script/standard.h>
+#include <txdb.h>
+#include <txmempool.h>
+#include <validation.h>
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(coinsprefetch_tests, TestChain100Setup)
+
+struct CacheSnapshot
+{
+    unsigned int nCacheSize;
+    size_t nMemoryUsage;
+    std::vector<Coin> vCoins;
+};
+
+static CacheSnapshot SnapshotCache(const std::vector<COutPoint>& vOutpoints)
+{
+    LOCK(cs_main);
+    CacheSnapshot snapshot;
+    snapshot.nCacheSize = pcoinsTip->GetCacheSize();
+    snapshot.nMemoryUsage = pcoinsTip->DynamicMemoryUsage();
+    for (const auto& outpoint : vOutpoints) {
+        snapshot.vCoins.emplace_back(pcoinsTip->AccessCoin(outpoint));
+    }
+    return snapshot;
+}
+
+BOOST_AUTO_TEST_CASE(prefetch_connect_block)
+{
+    const CChainParams& chainparams = Params();
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // Spend a few mature coinbases in a single block
+    std::vector<CMutableTransaction> spends(4);
+    std::vector<COutPoint> vInputs;
+    for (size_t i = 0; i < spends.size(); i++) {
+        spends[i].nVersion = 1;
+        spends[i].vin.resize(1);
+        spends[i].vin[0].prevout = COutPoint(m_coinbase_txns[i]->GetHash(), 0);
+        spends[i].vout.resize(1);
+        spends[i].vout[0].nValue = 11 * CENT;
+        spends[i].vout[0].scriptPubKey = scriptPubKey;
+
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, spends[i], 0, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        spends[i].vin[0].scriptSig << vchSig;
+        vInputs.emplace_back(spends[i].vin[0].prevout);
+    }
+    std::vector<COutPoint> vOutpoints = vInputs;
+    for (const auto& tx : spends) {
+        vOutpoints.emplace_back(tx.GetHash(), 0);
+    }
+
+    // Connect the block without the prefetcher, reading the inputs from the database
+    ::ChainstateActive().ForceFlushStateToDisk();
+    const CBlock block = CreateAndProcessBlock(spends, scriptPubKey);
+    CBlockIndex* pindex = WITH_LOCK(cs_main, return LookupBlockIndex(block.GetHash()));
+    BOOST_REQUIRE(pindex);
+    BOOST_REQUIRE_EQUAL(WITH_LOCK(cs_main, return ::ChainActive().Tip()), pindex);
+    const CacheSnapshot expected = SnapshotCache(vOutpoints);
+    for (size_t i = 0; i < vInputs.size(); i++) {
+        BOOST_CHECK(expected.vCoins[i].IsSpent());
+        BOOST_CHECK(!expected.vCoins[vInputs.size() + i].IsSpent());
+    }
+
+    // Disconnect it again and empty the cache
+    CValidationState state;
+    BOOST_CHECK(InvalidateBlock(state, chainparams, pindex));
+    ::ChainstateActive().ForceFlushStateToDisk();
+    mempool.clear();
+    for (const auto& outpoint : vInputs) {
+        BOOST_CHECK(!pcoinsTip->HaveCoinInCache(outpoint));
+    }
+
+    // The prefetcher reads the inputs missing from the cache
+    g_coins_prefetcher = MakeUnique<CCoinsPrefetcher>(*pcoinsflusher, 2);
+    {
+        g_coins_prefetcher->Prefetch(block, *pcoinsTip);
+        CCoinsViewCache cache(pcoinsTip.get());
+        g_coins_prefetcher->Apply(block.GetHash(), cache);
+        BOOST_CHECK_EQUAL(cache.GetCacheSize(), vInputs.size());
+        for (const auto& outpoint : vInputs) {
+            BOOST_CHECK(cache.HaveCoinInCache(outpoint));
+        }
+    }
+
+    // Reconnect the block with the prefetcher running, ConnectTip adds the inputs to the cache
+    g_coins_prefetcher->Prefetch(block, *pcoinsTip);
+    {
+        LOCK(cs_main);
+        ResetBlockFailureFlags(pindex);
+    }
+    BOOST_CHECK(ActivateBestChain(state, chainparams));
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return ::ChainActive().Tip()), pindex);
+
+    const CacheSnapshot prefetched = SnapshotCache(vOutpoints);
+    BOOST_CHECK_EQUAL(prefetched.nCacheSize, expected.nCacheSize);
+    BOOST_CHECK_EQUAL(prefetched.nMemoryUsage, expected.nMemoryUsage);
+    for (size_t i = 0; i < vOutpoints.size(); i++) {
+        BOOST_CHECK(prefetched.vCoins[i].out == expected.vCoins[i].out);
+        BOOST_CHECK_EQUAL(prefetched.vCoins[i].nHeight, expected.vCoins[i].nHeight);
+        BOOST_CHECK_EQUAL(prefetched.vCoins[i].fCoinBase, expected.vCoins[i].fCoinBase);
+    }
+    g_coins_prefetcher.reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -12,6 +12,8 @@
 #include <script/signingprovider.h>
 #include <script/standard.h>
 #include <serialize.h>
+#include <support/allocators/pool.h>
+#include <txmempool.h>
 #include <util/memory.h>
 #include <util/system.h>
 #include <util/time.h>
@@ -20,6 +22,7 @@
 #include <test/setup_common.h>
 
 #include <stdint.h>
+#include <unordered_map>
 
 #include <boost/test/unit_test.hpp>
 
@@ -44,14 +47,20 @@ struct CConnmanTest : public CConnman {
 extern bool AddOrphanTx(const CTransactionRef& tx, NodeId peer);
 extern void EraseOrphansFor(NodeId peer);
 extern unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans);
+extern unsigned int LimitOrphanTxPerPeer(NodeId peer, unsigned int nMaxOrphansPerPeer);
 
 struct COrphanTx {
     CTransactionRef tx;
     NodeId fromPeer;
     int64_t nTimeExpire;
+    size_t list_pos;
+    size_t peer_pos;
 };
+static constexpr size_t ORPHAN_POOL_BLOCK_SIZE = sizeof(std::pair<const uint256, COrphanTx>) + 4 * sizeof(void*);
+typedef std::unordered_map<uint256, COrphanTx, SaltedTxidHasher, std::equal_to<uint256>,
+                           PoolAllocator<std::pair<const uint256, COrphanTx>, ORPHAN_POOL_BLOCK_SIZE, alignof(void*)>> OrphanMap;
 extern CCriticalSection g_cs_orphans;
-extern std::map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(g_cs_orphans);
+extern OrphanMap mapOrphanTransactions GUARDED_BY(g_cs_orphans);
 
 static CService ip(uint32_t i)
 {
@@ -357,14 +366,17 @@ BOOST_AUTO_TEST_CASE(DoS_bantime)
 
 static CTransactionRef RandomOrphan()
 {
-    std::map<uint256, COrphanTx>::iterator it;
     LOCK2(cs_main, g_cs_orphans);
-    it = mapOrphanTransactions.lower_bound(InsecureRand256());
-    if (it == mapOrphanTransactions.end())
-        it = mapOrphanTransactions.begin();
+    auto it = std::next(mapOrphanTransactions.begin(), InsecureRandRange(mapOrphanTransactions.size()));
     return it->second.tx;
 }
 
+static size_t CountOrphansFor(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
+{
+    return std::count_if(mapOrphanTransactions.begin(), mapOrphanTransactions.end(),
+                         [peer](const OrphanMap::value_type& entry) { return entry.second.fromPeer == peer; });
+}
+
 BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
 {
     CKey key;
@@ -435,6 +447,7 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
         size_t sizeBefore = mapOrphanTransactions.size();
         EraseOrphansFor(i);
         BOOST_CHECK(mapOrphanTransactions.size() < sizeBefore);
+        BOOST_CHECK_EQUAL(CountOrphansFor(i), 0U);
     }
 
     // Test LimitOrphanTxSize() function:
@@ -446,4 +459,48 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     BOOST_CHECK(mapOrphanTransactions.empty());
 }
 
+BOOST_AUTO_TEST_CASE(DoS_mapOrphans_quota)
+{
+    // Orphans spending each other's outputs, all from the same peer
+    uint256 hashPrev = InsecureRand256();
+    for (int i = 0; i < 20; i++)
+    {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.n = 0;
+        tx.vin[0].prevout.hash = hashPrev;
+        tx.vin[0].scriptSig << OP_1;
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 1*CENT;
+        tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+        CTransactionRef ptx = MakeTransactionRef(tx);
+        hashPrev = ptx->GetHash();
+
+        LOCK(g_cs_orphans);
+        BOOST_CHECK(AddOrphanTx(ptx, i < 15 ? 1 : 2));
+        BOOST_CHECK(!AddOrphanTx(ptx, 3));
+    }
+
+    LOCK(g_cs_orphans);
+    BOOST_CHECK_EQUAL(mapOrphanTransactions.size(), 20U);
+
+    // Only the orphans of the peer over its quota are evicted
+    BOOST_CHECK_EQUAL(LimitOrphanTxPerPeer(1, 10), 5U);
+    BOOST_CHECK_EQUAL(CountOrphansFor(1), 10U);
+    BOOST_CHECK_EQUAL(CountOrphansFor(2), 5U);
+    BOOST_CHECK_EQUAL(LimitOrphanTxPerPeer(2, 10), 0U);
+    BOOST_CHECK_EQUAL(LimitOrphanTxPerPeer(3, 10), 0U);
+
+    EraseOrphansFor(1);
+    BOOST_CHECK_EQUAL(mapOrphanTransactions.size(), 5U);
+    EraseOrphansFor(1);
+    BOOST_CHECK_EQUAL(mapOrphanTransactions.size(), 5U);
+
+    // Orphans expire after 20 minutes
+    SetMockTime(GetTime() + 20 * 60 + 1);
+    BOOST_CHECK_EQUAL(LimitOrphanTxSize(100), 0U);
+    BOOST_CHECK(mapOrphanTransactions.empty());
+    SetMockTime(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
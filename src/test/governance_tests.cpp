@@ -0,0 +1,294 @@
+// Copyright (c) 2020 The BitCorn Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bls/bls.h>
+#include <chainparams.h>
+#include <crypto/common.h>
+#include <governance/governance.h>
+#include <governance/governance-object.h>
+#include <governance/governance-vote.h>
+#include <governance/governance-votedb.h>
+#include <masternodes/sync.h>
+#include <net.h>
+#include <netbase.h>
+#include <protocol.h>
+#include <special/deterministicmns.h>
+#include <special/specialdb.h>
+#include <streams.h>
+#include <test/setup_common.h>
+#include <timedata.h>
+
+#include <algorithm>
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_tests, TestingSetup)
+
+class TestGovernanceManager
+{
+public:
+    static void AddObject(CGovernanceManager& manager, const CGovernanceObject& govobj)
+    {
+        LOCK(manager.cs);
+        manager.mapObjects.emplace(govobj.GetHash(), govobj);
+    }
+
+    static void LoadStoredVotes(CGovernanceManager& manager)
+    {
+        LOCK(manager.cs);
+        manager.LoadStoredVotes();
+    }
+
+    static void AddVote(CGovernanceManager& manager, const CGovernanceVote& vote)
+    {
+        LOCK(manager.cs);
+        manager.mapObjects.at(vote.GetParentHash()).fileVotes.AddVote(vote);
+    }
+
+    static void RequestGovernanceObject(CGovernanceManager& manager, CNode* pfrom, const uint256& nHash)
+    {
+        manager.RequestGovernanceObject(pfrom, nHash, true);
+    }
+
+    static void UpdateSentinelVariables(CGovernanceObject& govobj, int nMnCount)
+    {
+        govobj.UpdateSentinelVariables(nMnCount);
+    }
+};
+
+static COutPoint MasternodeOutpoint(int n)
+{
+    return COutPoint(uint256S("aa"), n);
+}
+
+BOOST_AUTO_TEST_CASE(stored_votes_reload)
+{
+    const int nQuorum = Params().GetConsensus().nGovernanceMinQuorum;
+    // nMnCount / 10 is the quorum, so the funding flag needs exactly nQuorum more yes than no votes
+    const int nMnCount = nQuorum * 10;
+
+    const CGovernanceObject govobj(uint256(), 1, GetAdjustedTime(), uint256S("01"), "");
+    const uint256 nHash = govobj.GetHash();
+
+    {
+        CGovernanceVoteDb votedb(1 << 20, false, true);
+        for (int i = 0; i < nQuorum + 1; i++) {
+            votedb.WriteVote(CGovernanceVote(MasternodeOutpoint(i), nHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES));
+        }
+        votedb.WriteVote(CGovernanceVote(MasternodeOutpoint(nQuorum + 1), nHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO));
+        votedb.WriteVote(CGovernanceVote(MasternodeOutpoint(0), nHash, VOTE_SIGNAL_DELETE, VOTE_OUTCOME_NO));
+        // the object of this one is not in the cache file
+        votedb.WriteVote(CGovernanceVote(MasternodeOutpoint(0), uint256S("02"), VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES));
+    }
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    {
+        CGovernanceManager manager;
+        TestGovernanceManager::AddObject(manager, govobj);
+        ss << manager;
+    }
+
+    CGovernanceManager manager;
+    manager.OpenVoteDb(false);
+    ss >> manager;
+
+    // the votes are loaded with the objects, before CFlatDB lets CheckAndRemove compute the flags
+    CGovernanceObject* pObj = manager.FindGovernanceObject(nHash);
+    BOOST_REQUIRE(pObj != nullptr);
+    BOOST_CHECK_EQUAL(pObj->GetYesCount(VOTE_SIGNAL_FUNDING), nQuorum + 1);
+    BOOST_CHECK_EQUAL(pObj->GetNoCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(pObj->GetNoCount(VOTE_SIGNAL_DELETE), 1);
+    BOOST_CHECK_EQUAL(pObj->GetVoteFile().GetVotes().size(), (size_t)nQuorum + 3);
+    BOOST_CHECK(pObj->IsSetDirtyCache());
+
+    TestGovernanceManager::UpdateSentinelVariables(*pObj, nMnCount);
+    BOOST_CHECK(!pObj->IsSetDirtyCache());
+    BOOST_CHECK(pObj->IsSetCachedFunding());
+    BOOST_CHECK(pObj->IsSetCachedValid());
+    BOOST_CHECK(!pObj->IsSetCachedDelete());
+    BOOST_CHECK(!pObj->IsSetCachedEndorsed());
+
+    // ten more masternodes raise the quorum above the absolute yes count
+    TestGovernanceManager::UpdateSentinelVariables(*pObj, nMnCount + 10);
+    BOOST_CHECK(!pObj->IsSetCachedFunding());
+
+    // rebuilding the current votes marks the flags for an update
+    TestGovernanceManager::LoadStoredVotes(manager);
+    BOOST_CHECK_EQUAL(pObj->GetVoteFile().GetVotes().size(), (size_t)nQuorum + 3);
+    BOOST_CHECK(pObj->IsSetDirtyCache());
+
+    // the vote of the unknown object was dropped from the database
+    manager.CloseVoteDb();
+    CGovernanceVoteDb votedb(1 << 20);
+    size_t nStored = 0;
+    votedb.LoadVotes([&](const CGovernanceVote& vote) {
+        BOOST_CHECK(vote.GetParentHash() == nHash);
+        nStored++;
+        return true;
+    });
+    BOOST_CHECK_EQUAL(nStored, (size_t)nQuorum + 3);
+}
+
+static size_t DigestBucket(const CGovernanceVote& vote)
+{
+    return *vote.GetHash().begin() % CGovernanceObjectVoteFile::VOTE_DIGEST_BUCKETS;
+}
+
+BOOST_AUTO_TEST_CASE(vote_digests)
+{
+    const uint256 nHash = uint256S("01");
+    // More votes than buckets, so some buckets have several
+    const int nVotes = 600;
+
+    CGovernanceObjectVoteFile file1, file2;
+    for (int i = 0; i < nVotes; i++) {
+        const CGovernanceVote vote(MasternodeOutpoint(i), nHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+        file1.AddVote(vote);
+        file2.AddVote(vote);
+    }
+    BOOST_CHECK_EQUAL(file1.GetDigests().size(), (size_t)CGovernanceObjectVoteFile::VOTE_DIGEST_BUCKETS);
+
+    // The same votes, nothing to send
+    BOOST_CHECK(file1.GetDigests() == file2.GetDigests());
+    BOOST_CHECK(file1.GetVotesNotMatching(file2.GetDigests()).empty());
+
+    // A peer without digests gets all of them
+    BOOST_CHECK_EQUAL(file1.GetVotesNotMatching({}).size(), (size_t)nVotes);
+
+    // One vote the peer doesn't have, only the votes of its bucket are sent
+    const CGovernanceVote voteExtra(MasternodeOutpoint(nVotes), nHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO);
+    file1.AddVote(voteExtra);
+    const size_t nBucket = DigestBucket(voteExtra);
+    size_t nInBucket = 0;
+    for (const auto& vote : file1.GetVotes()) {
+        if (DigestBucket(vote) == nBucket) nInBucket++;
+    }
+    const std::vector<CGovernanceVote> vecSent = file1.GetVotesNotMatching(file2.GetDigests());
+    BOOST_CHECK_EQUAL(vecSent.size(), nInBucket);
+    BOOST_CHECK(std::find(vecSent.begin(), vecSent.end(), voteExtra) != vecSent.end());
+    for (const auto& vote : vecSent) {
+        BOOST_CHECK_EQUAL(DigestBucket(vote), nBucket);
+    }
+    BOOST_CHECK_EQUAL(file1.GetVotesNotMatching({}).size(), (size_t)nVotes + 1);
+
+    // Erasing the vote again restores the digest of the bucket
+    file1.RemoveVotesFromMasternode(MasternodeOutpoint(nVotes));
+    BOOST_CHECK(file1.GetDigests() == file2.GetDigests());
+    BOOST_CHECK(file1.GetVotesNotMatching(file2.GetDigests()).empty());
+}
+
+
+/** Command of the last message pushed to a node, whose header and payload are queued separately */
+static std::string LastCommand(const CNode& node)
+{
+    BOOST_REQUIRE(node.vSendMsg.size() >= 2);
+    CMessageHeader hdr(Params().MessageStart());
+    CDataStream(node.vSendMsg[node.vSendMsg.size() - 2], SER_NETWORK, INIT_PROTO_VERSION) >> hdr;
+    return hdr.GetCommand();
+}
+
+BOOST_AUTO_TEST_CASE(vote_digest_sync)
+{
+    const int nMasternodes = 64;
+
+    // A masternode list at a fake tip, the votes are signed with the operator keys
+    const uint256 tipHash = uint256S("bb");
+    CBlockIndex tip;
+    tip.phashBlock = &tipHash;
+    tip.nHeight = 1;
+    CDeterministicMNList mnList(tipHash, tip.nHeight, nMasternodes);
+    std::vector<CBLSSecretKey> vecOperatorKeys(nMasternodes);
+    for (int i = 0; i < nMasternodes; i++) {
+        vecOperatorKeys[i].MakeNewKey();
+        auto pdmnState = std::make_shared<CDeterministicMNState>();
+        WriteLE32(pdmnState->keyIDOwner.begin(), i);
+        pdmnState->pubKeyOperator.Set(vecOperatorKeys[i].GetPublicKey());
+        auto dmn = std::make_shared<CDeterministicMN>();
+        WriteLE32(dmn->proTxHash.begin(), i);
+        dmn->internalId = i;
+        dmn->collateralOutpoint = MasternodeOutpoint(i);
+        dmn->nOperatorReward = 0;
+        dmn->pdmnState = pdmnState;
+        mnList.AddMN(dmn);
+    }
+    pspecialdb->Write(std::make_pair(std::string("dmn_S"), tipHash), mnList);
+    deterministicMNManager->UpdatedBlockTip(&tip);
+
+    const CGovernanceObject govobj(uint256(), 1, GetAdjustedTime(), uint256S("01"), "");
+    const uint256 nHash = govobj.GetHash();
+    CGovernanceManager server, client;
+    TestGovernanceManager::AddObject(server, govobj);
+    TestGovernanceManager::AddObject(client, govobj);
+
+    // The client misses every eighth vote
+    std::set<uint256> setMissing;
+    std::set<size_t> setMissingBuckets;
+    std::vector<CGovernanceVote> vecVotes;
+    for (int i = 0; i < nMasternodes; i++) {
+        CGovernanceVote vote(MasternodeOutpoint(i), nHash, VOTE_SIGNAL_DELETE, VOTE_OUTCOME_NO);
+        BOOST_REQUIRE(vote.Sign(vecOperatorKeys[i]));
+        BOOST_REQUIRE(vote.IsValid(false));
+        TestGovernanceManager::AddVote(server, vote);
+        if (i % 8 == 0) {
+            setMissing.emplace(vote.GetHash());
+            setMissingBuckets.emplace(DigestBucket(vote));
+        } else {
+            TestGovernanceManager::AddVote(client, vote);
+        }
+        vecVotes.emplace_back(vote);
+    }
+    std::set<uint256> setExpected;
+    for (const auto& vote : vecVotes) {
+        if (setMissingBuckets.count(DigestBucket(vote))) {
+            setExpected.emplace(vote.GetHash());
+        }
+    }
+
+    // Votes are only served once the sync finished
+    masternodeSync.SwitchToNextAsset(*g_connman);
+    masternodeSync.SwitchToNextAsset(*g_connman);
+    masternodeSync.SwitchToNextAsset(*g_connman);
+    BOOST_REQUIRE(masternodeSync.IsSynced());
+
+    const CAddress addr(LookupNumeric("1.2.3.4", Params().GetDefaultPort()), NODE_NONE);
+    CNode clientNode(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", false);
+    clientNode.nVersion = PROTOCOL_VERSION;
+    clientNode.SetSendVersion(PROTOCOL_VERSION);
+    CNode serverNode(1, NODE_NETWORK, 0, INVALID_SOCKET, addr, 1, 1, CAddress(), "", true);
+    serverNode.nVersion = PROTOCOL_VERSION;
+    serverNode.SetSendVersion(PROTOCOL_VERSION);
+
+    // The client asks for the votes of the buckets its digests differ in
+    TestGovernanceManager::RequestGovernanceObject(client, &clientNode, nHash);
+    BOOST_CHECK_EQUAL(LastCommand(clientNode), NetMsgType::MNGOVERNANCEVOTEDIGEST);
+    const std::vector<unsigned char> vchRequest = clientNode.vSendMsg.back();
+
+    CDataStream request(vchRequest, SER_NETWORK, PROTOCOL_VERSION);
+    server.ProcessMessage(&serverNode, NetMsgType::MNGOVERNANCEVOTEDIGEST, request, *g_connman);
+    std::set<uint256> setSent;
+    for (const auto& inv : serverNode.vInventoryOtherToSend) {
+        BOOST_CHECK_EQUAL(inv.type, MSG_GOVERNANCE_OBJECT_VOTE);
+        setSent.emplace(inv.hash);
+    }
+    BOOST_CHECK(setSent == setExpected);
+    for (const auto& nVoteHash : setMissing) {
+        BOOST_CHECK(setSent.count(nVoteHash));
+    }
+    BOOST_CHECK(setSent.size() < vecVotes.size());
+
+    // Peers older than the governance protocol are rejected
+    CNode oldNode(2, NODE_NETWORK, 0, INVALID_SOCKET, addr, 2, 2, CAddress(), "", true);
+    oldNode.nVersion = MIN_GOVERNANCE_PEER_PROTO_VERSION - 1;
+    oldNode.SetSendVersion(MIN_GOVERNANCE_PEER_PROTO_VERSION - 1);
+    CDataStream requestOld(vchRequest, SER_NETWORK, PROTOCOL_VERSION);
+    server.ProcessMessage(&oldNode, NetMsgType::MNGOVERNANCEVOTEDIGEST, requestOld, *g_connman);
+    BOOST_CHECK_EQUAL(LastCommand(oldNode), NetMsgType::REJECT);
+    BOOST_CHECK(oldNode.vInventoryOtherToSend.empty());
+
+    masternodeSync.Reset();
+    deterministicMNManager->UpdatedBlockTip(nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,8 +7,10 @@
 #include <consensus/consensus.h>
 #include <consensus/merkle.h>
 #include <consensus/tx_verify.h>
+#include <consensus/validation.h>
 #include <miner.h>
 #include <policy/policy.h>
+#include <rpc/server.h>
 #include <script/standard.h>
 #include <txmempool.h>
 #include <uint256.h>
@@ -23,6 +25,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+extern UniValue CallRPC(std::string args);
+
 BOOST_FIXTURE_TEST_SUITE(miner_tests, TestingSetup)
 
 // BOOST_CHECK_EXCEPTION predicates to check the specific validation error
@@ -520,4 +524,98 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     fCheckpointsEnabled = true;
 }
 
+static bool ContainsTx(const CBlock& block, const CTransactionRef& tx)
+{
+    for (const CTransactionRef& blockTx : block.vtx) {
+        if (blockTx->GetHash() == tx->GetHash()) return true;
+    }
+    return false;
+}
+
+// Templates on the same tip reuse the transaction selection of the one before, as long as
+// the selected transactions and their fees didn't change
+BOOST_FIXTURE_TEST_CASE(CreateNewBlock_selection_cache, TestChain100Setup)
+{
+    const CChainParams& chainparams = Params();
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    g_txselection_cache = MakeUnique<CBlockTxSelectionCache>();
+    RegisterValidationInterface(g_txselection_cache.get(), "txselection");
+    GetMainSignals().RegisterWithMempoolSignals(mempool);
+
+    // Spends of mature coinbases, the last one without a fee
+    std::vector<CTransactionRef> vSpends;
+    for (int i = 0; i < 3; i++) {
+        CMutableTransaction tx;
+        tx.nVersion = 1;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(m_coinbase_txns[i]->GetHash(), 0);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = m_coinbase_txns[i]->vout[0].nValue - (i < 2 ? 10000 : 0);
+        tx.vout[0].scriptPubKey = scriptPubKey;
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        tx.vin[0].scriptSig << vchSig;
+
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_REQUIRE(AcceptToMemoryPool(mempool, state, MakeTransactionRef(tx), nullptr /* pfMissingInputs */,
+                                         nullptr /* plTxnReplaced */, true /* bypass_limits */, 0 /* nAbsurdFee */));
+        vSpends.push_back(MakeTransactionRef(tx));
+    }
+    SyncWithValidationInterfaceQueue();
+
+    std::unique_ptr<CBlockTemplate> pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK(!BlockAssembler::m_last_block_cached_txs);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 3U);
+    BOOST_CHECK(!ContainsTx(pblocktemplate->block, vSpends[2]));
+
+    // Unchanged mempool, the selection is reused
+    std::unique_ptr<CBlockTemplate> pblocktemplate2 = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK(BlockAssembler::m_last_block_cached_txs);
+    BOOST_REQUIRE_EQUAL(pblocktemplate2->block.vtx.size(), 3U);
+    for (size_t i = 1; i < pblocktemplate->block.vtx.size(); i++) {
+        BOOST_CHECK(pblocktemplate2->block.vtx[i]->GetHash() == pblocktemplate->block.vtx[i]->GetHash());
+    }
+
+    // A fee delta makes the free transaction worth mining, which only a full selection sees
+    CallRPC("prioritisetransaction " + vSpends[2]->GetHash().GetHex() + " 0 10000");
+    pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK(!BlockAssembler::m_last_block_cached_txs);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 4U);
+    BOOST_CHECK(ContainsTx(pblocktemplate->block, vSpends[2]));
+    pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK(BlockAssembler::m_last_block_cached_txs);
+
+    // A selected transaction leaves the mempool
+    {
+        LOCK(mempool.cs);
+        mempool.removeRecursive(*vSpends[0]);
+    }
+    SyncWithValidationInterfaceQueue();
+    pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK(!BlockAssembler::m_last_block_cached_txs);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 3U);
+    BOOST_CHECK(!ContainsTx(pblocktemplate->block, vSpends[0]));
+    pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK(BlockAssembler::m_last_block_cached_txs);
+
+    // A new tip, the transactions stay in the mempool as the block doesn't include them
+    CreateAndProcessBlock({}, scriptPubKey);
+    SyncWithValidationInterfaceQueue();
+    pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK(!BlockAssembler::m_last_block_cached_txs);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 3U);
+    BOOST_CHECK(pblocktemplate->block.hashPrevBlock == WITH_LOCK(cs_main, return ::ChainActive().Tip()->GetBlockHash()));
+    pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK(BlockAssembler::m_last_block_cached_txs);
+
+    GetMainSignals().UnregisterWithMempoolSignals(mempool);
+    UnregisterValidationInterface(g_txselection_cache.get());
+    g_txselection_cache.reset();
+    mempool.clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -13,6 +13,7 @@
 #include <net.h>
 #include <netbase.h>
 #include <chainparams.h>
+#include <hash.h>
 #include <util/memory.h>
 #include <util/system.h>
 
@@ -190,6 +191,101 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+static std::vector<char> MakeRawMessage(const std::string& strCommand, size_t nSize)
+{
+    std::vector<unsigned char> vData(nSize);
+    for (size_t i = 0; i < nSize; i++) vData[i] = (unsigned char)i;
+    CMessageHeader hdr(Params().MessageStart(), strCommand.c_str(), nSize);
+    uint256 hash = Hash(vData.begin(), vData.end());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CDataStream ss(SER_NETWORK, INIT_PROTO_VERSION);
+    ss << hdr;
+    ss.write((const char*)vData.data(), vData.size());
+    return std::vector<char>(ss.begin(), ss.end());
+}
+
+BOOST_AUTO_TEST_CASE(cnode_recv_direct)
+{
+    CAddress addr = CAddress(CService(CNetAddr(), 7777), NODE_NETWORK);
+    CNode nodeCopy(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", true);
+    CNode nodeDirect(1, NODE_NETWORK, 0, INVALID_SOCKET, addr, 1, 1, CAddress(), "", true);
+    // Only small messages are accepted during the handshake
+    nodeCopy.fSuccessfullyConnected = true;
+    nodeDirect.fSuccessfullyConnected = true;
+
+    const std::vector<char> vMsg = MakeRawMessage(NetMsgType::BLOCK, 300 * 1000);
+    bool fComplete = false;
+
+    // Nothing to receive directly while the header is missing
+    unsigned int nBytes = 1000;
+    BOOST_CHECK(nodeDirect.GetRecvDataBuffer(nBytes) == nullptr);
+
+    BOOST_CHECK(nodeCopy.ReceiveMsgBytes(vMsg.data(), vMsg.size(), fComplete));
+    BOOST_CHECK(fComplete);
+
+    // Header and the first bytes as usual, the rest written to the message buffer
+    BOOST_CHECK(nodeDirect.ReceiveMsgBytes(vMsg.data(), CMessageHeader::HEADER_SIZE + 10, fComplete));
+    BOOST_CHECK(!fComplete);
+    size_t nPos = CMessageHeader::HEADER_SIZE + 10;
+    while (nPos < vMsg.size()) {
+        nBytes = 64 * 1024;
+        char* pch = nodeDirect.GetRecvDataBuffer(nBytes);
+        BOOST_REQUIRE(pch != nullptr);
+        BOOST_CHECK_EQUAL(nBytes, std::min<size_t>(64 * 1024, vMsg.size() - nPos));
+        memcpy(pch, vMsg.data() + nPos, nBytes);
+        BOOST_CHECK(nodeDirect.ReceivedMsgData(nBytes, fComplete));
+        nPos += nBytes;
+        BOOST_CHECK_EQUAL(fComplete, nPos == vMsg.size());
+    }
+    nBytes = 1000;
+    BOOST_CHECK(nodeDirect.GetRecvDataBuffer(nBytes) == nullptr);
+
+    CNodeStats statsCopy, statsDirect;
+    nodeCopy.copyStats(statsCopy);
+    nodeDirect.copyStats(statsDirect);
+    BOOST_CHECK_EQUAL(statsCopy.nRecvBytes, vMsg.size());
+    BOOST_CHECK_EQUAL(statsDirect.nRecvBytes, vMsg.size());
+    BOOST_CHECK_EQUAL(statsDirect.mapRecvBytesPerMsgCmd[NetMsgType::BLOCK], vMsg.size());
+}
+
+BOOST_AUTO_TEST_CASE(netmsg_buffer_pool)
+{
+    CNetMessageBufferPool pool;
+
+    CSerializeData buf = pool.Get(1000);
+    BOOST_CHECK_EQUAL(buf.capacity(), 1024U);
+    BOOST_CHECK(buf.empty());
+    buf.resize(1000);
+    const char* pchData = buf.data();
+    pool.Put(std::move(buf));
+    BOOST_CHECK_EQUAL(pool.GetFreeBytes(), 1024U);
+
+    // The buffer serves every request of its size class
+    buf = pool.Get(600);
+    BOOST_CHECK(buf.data() == pchData);
+    BOOST_CHECK(buf.empty());
+    BOOST_CHECK_EQUAL(pool.GetFreeBytes(), 0U);
+
+    // but not larger ones
+    pool.Put(std::move(buf));
+    buf = pool.Get(1025);
+    BOOST_CHECK_EQUAL(buf.capacity(), 2048U);
+    BOOST_CHECK_EQUAL(pool.GetFreeBytes(), 1024U);
+
+    // A buffer grown past a class boundary serves the class below its capacity
+    buf.reserve(3000);
+    pool.Put(std::move(buf));
+    BOOST_CHECK_EQUAL(pool.GetFreeBytes(), 1024U + 3000U);
+    buf = pool.Get(2048);
+    BOOST_CHECK_EQUAL(buf.capacity(), 3000U);
+
+    // Tiny buffers are not kept
+    CSerializeData tiny;
+    tiny.reserve(100);
+    pool.Put(std::move(tiny));
+    BOOST_CHECK_EQUAL(pool.GetFreeBytes(), 1024U);
+}
+
 // prior to PR #14728, this test triggers an undefined behavior
 BOOST_AUTO_TEST_CASE(ipv4_peer_with_ipv6_addrMe_test)
 {
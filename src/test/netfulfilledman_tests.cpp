@@ -0,0 +1,86 @@
+// Copyright (c) 2020 The BitCorn Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <netbase.h>
+#include <netfulfilledman.h>
+#include <test/setup_common.h>
+#include <util/time.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace netfulfilledman_tests {
+
+class TestNetFulfilledRequestManager
+{
+public:
+    static size_t QueueSize(const CNetFulfilledRequestManager& manager)
+    {
+        size_t nSize = 0;
+        for (auto& shard : manager.shards) {
+            LOCK(shard.cs);
+            nSize += shard.queueExpiration.size();
+        }
+        return nSize;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(netfulfilledman_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(expiry_of_readded_requests)
+{
+    const int64_t nStartTime = GetTime();
+    const int64_t nExpireTime = Params().FulfilledRequestExpireTime();
+    const CService addr1 = LookupNumeric("1.2.3.4", Params().GetDefaultPort());
+    const CService addr2 = LookupNumeric("5.6.7.8", Params().GetDefaultPort());
+
+    CNetFulfilledRequestManager manager;
+    const int nRequestId = manager.GetRequestId("test-sync");
+    BOOST_CHECK_EQUAL(manager.GetRequestId("test-sync"), nRequestId);
+
+    SetMockTime(nStartTime);
+    manager.AddFulfilledRequest(addr1, nRequestId);
+    manager.AddFulfilledRequest(addr2, nRequestId);
+
+    // Adding a request again moves its expiration, it is still queued once
+    for (int i = 1; i <= 10; i++) {
+        SetMockTime(nStartTime + i * 60);
+        manager.AddFulfilledRequest(addr1, nRequestId);
+    }
+    BOOST_CHECK_EQUAL(TestNetFulfilledRequestManager::QueueSize(manager), 2U);
+
+    // Past the first expiration only the request which wasn't added again is removed
+    SetMockTime(nStartTime + nExpireTime + 1);
+    manager.CheckAndRemove();
+    BOOST_CHECK(manager.HasFulfilledRequest(addr1, nRequestId));
+    BOOST_CHECK(!manager.HasFulfilledRequest(addr2, nRequestId));
+    BOOST_CHECK_EQUAL(manager.GetFulfilledRequests().size(), 1U);
+    BOOST_CHECK_EQUAL(TestNetFulfilledRequestManager::QueueSize(manager), 1U);
+
+    // Still valid right until the expiration of the last time it was added
+    SetMockTime(nStartTime + 10 * 60 + nExpireTime - 1);
+    manager.CheckAndRemove();
+    BOOST_CHECK(manager.HasFulfilledRequest(addr1, nRequestId));
+    BOOST_CHECK_EQUAL(TestNetFulfilledRequestManager::QueueSize(manager), 1U);
+
+    SetMockTime(nStartTime + 10 * 60 + nExpireTime + 1);
+    BOOST_CHECK(!manager.HasFulfilledRequest(addr1, nRequestId));
+    manager.CheckAndRemove();
+    BOOST_CHECK(manager.GetFulfilledRequests().empty());
+    BOOST_CHECK_EQUAL(TestNetFulfilledRequestManager::QueueSize(manager), 0U);
+
+    // Requests loaded from the cache file are queued once each as well
+    SetMockTime(nStartTime);
+    manager.AddFulfilledRequest(addr1, nRequestId);
+    manager.AddFulfilledRequest(addr1, nRequestId);
+    manager.AddFulfilledRequest(addr2, nRequestId);
+    manager.SetFulfilledRequests(manager.GetFulfilledRequests());
+    BOOST_CHECK_EQUAL(TestNetFulfilledRequestManager::QueueSize(manager), 2U);
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace netfulfilledman_tests
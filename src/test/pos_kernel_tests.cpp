@@ -0,0 +1,63 @@
+// Copyright (c) 2020 The BitCorn Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <chainparams.h>
+#include <pos/kernel.h>
+#include <script/standard.h>
+#include <util/time.h>
+#include <validation.h>
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pos_kernel_tests, TestChain100Setup)
+
+// The overload taking the stake modifier, which the staker checks without holding cs_main, accepts
+// and hashes the same kernels as the one looking the modifier up on top of the tip
+BOOST_AUTO_TEST_CASE(kernel_hash_with_stake_modifier)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    const CScript scriptPubKey = GetScriptForRawPubKey(coinbaseKey.GetPubKey());
+
+    // The coin of the last block is staked, the modifier for it is the first one generated a
+    // selection interval (about 35 minutes on regtest) later, so build an hour of blocks on top
+    const CBlockHeader blockFrom = WITH_LOCK(cs_main, return ::ChainActive().Tip()->GetBlockHeader());
+    const CTransactionRef txPrev = m_coinbase_txns.back();
+    const COutPoint prevout(txPrev->GetHash(), 0);
+    for (int i = 1; i <= 30; i++) {
+        SetMockTime(blockFrom.GetBlockTime() + i * params.nPosTargetSpacing);
+        CreateAndProcessBlock({}, scriptPubKey);
+    }
+
+    LOCK(cs_main);
+    CBlockIndex* pindexPrev = ::ChainActive().Tip();
+    BOOST_CHECK_EQUAL(pindexPrev->nHeight, 130);
+    uint64_t nStakeModifier = 0;
+    BOOST_REQUIRE(GetKernelStakeModifier(pindexPrev, blockFrom.GetHash(), nStakeModifier));
+
+    // A target met by less than half of the kernels at the max age, without overflowing it times
+    // the coin day weight of the coin
+    const unsigned int nBits = arith_uint256(~arith_uint256() / 300).GetCompact();
+
+    int nAccepted = 0, nRejected = 0;
+    for (int64_t nTimeTx = blockFrom.GetBlockTime() - 10; nTimeTx <= blockFrom.GetBlockTime() + params.nStakeMaxAge + 100; nTimeTx++) {
+        uint256 hashProofOfStake, hashProofOfStakeModifier;
+        const bool fAccepted = CheckStakeKernelHash(nBits, pindexPrev, blockFrom, txPrev, prevout, nTimeTx, hashProofOfStake);
+        BOOST_CHECK_EQUAL(CheckStakeKernelHash(nBits, nStakeModifier, blockFrom, txPrev, prevout, nTimeTx, hashProofOfStakeModifier), fAccepted);
+        if (fAccepted) {
+            BOOST_CHECK(hashProofOfStakeModifier == hashProofOfStake);
+            BOOST_CHECK(nTimeTx >= blockFrom.GetBlockTime() + params.nStakeMinAge);
+            nAccepted++;
+        } else {
+            nRejected++;
+        }
+    }
+    BOOST_CHECK(nAccepted > 0);
+    BOOST_CHECK(nRejected > params.nStakeMinAge);
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
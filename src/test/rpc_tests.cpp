@@ -18,6 +18,7 @@
 #include <univalue.h>
 
 #include <rpc/blockchain.h>
+#include <rpc/jsonstream.h>
 
 UniValue CallRPC(std::string args)
 {
@@ -233,6 +234,47 @@ BOOST_AUTO_TEST_CASE(json_parse_errors)
     BOOST_CHECK_THROW(ParseNonRFCJSONValue("3J98t1WpEZ73CNmQviecrnyiWrnqRhWNL"), std::runtime_error);
 }
 
+BOOST_AUTO_TEST_CASE(rpc_json_stream_writer)
+{
+    UniValue entry(UniValue::VOBJ);
+    entry.pushKV("a \"quoted\"\n key", "value");
+    entry.pushKV("number", 42);
+    entry.pushKV("list", ParseNonRFCJSONValue("[1,[],{},null,true]"));
+
+    UniValue expected(UniValue::VOBJ);
+    UniValue list(UniValue::VARR);
+    for (int i = 0; i < 100; i++) {
+        list.push_back(entry);
+    }
+    expected.pushKV("list", list);
+    expected.pushKV("empty", UniValue(UniValue::VARR));
+    expected.pushKV("last", NullUniValue);
+
+    // A small chunk size, the text is passed on while it is written
+    std::string strOut;
+    size_t nChunks = 0;
+    JSONStreamWriter writer([&](const char* pch, size_t nSize) { strOut.append(pch, nSize); nChunks++; }, 100);
+    writer.BeginObject();
+    writer.Key("list");
+    writer.BeginArray();
+    for (int i = 0; i < 100; i++) {
+        writer.Value(entry);
+    }
+    writer.EndArray();
+    BOOST_CHECK(nChunks > 10);
+    writer.Key("empty");
+    writer.BeginArray();
+    writer.EndArray();
+    writer.KeyValue("last", NullUniValue);
+    BOOST_CHECK_EQUAL(writer.GetDepth(), 1U);
+    writer.EndObject();
+    writer.Flush();
+
+    BOOST_CHECK_EQUAL(writer.GetDepth(), 0U);
+    BOOST_CHECK_EQUAL(strOut, expected.write());
+    BOOST_CHECK_EQUAL(writer.GetBytesWritten(), strOut.size());
+}
+
 BOOST_AUTO_TEST_CASE(rpc_ban)
 {
     BOOST_CHECK_NO_THROW(CallRPC(std::string("clearbanned")));
@@ -11,6 +11,7 @@
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
 #include <init.h>
+#include <llmq/quorums_init.h>
 #include <miner.h>
 #include <net.h>
 #include <noui.h>
@@ -18,6 +19,7 @@
 #include <rpc/register.h>
 #include <rpc/server.h>
 #include <script/sigcache.h>
+#include <special/deterministicmns.h>
 #include <special/specialdb.h>
 #include <streams.h>
 #include <txdb.h>
@@ -87,7 +89,11 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
     mempool.setSanityCheck(1.0);
     pblocktree.reset(new CBlockTreeDB(1 << 20, true));
     pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
-    pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+    pcoinsflusher.reset(new CCoinsViewBackgroundFlush(*pcoinsdbview));
+    pcoinsTip.reset(new CCoinsViewCache(pcoinsflusher.get()));
+    pspecialdb.reset(new CSpecialDB(1 << 20, true, true));
+    deterministicMNManager.reset(new CDeterministicMNManager(*pspecialdb));
+    llmq::InitLLMQSystem(*pspecialdb, &scheduler, true, true);
     if (!LoadGenesisBlock(chainparams)) {
         throw std::runtime_error("LoadGenesisBlock failed.");
     }
@@ -103,8 +109,6 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
 
     g_banman = MakeUnique<BanMan>(GetDataDir() / "banlist.dat", nullptr, DEFAULT_MISBEHAVING_BANTIME);
     g_connman = MakeUnique<CConnman>(0x1337, 0x1337); // Deterministic randomness for tests.
-
-    pspecialdb.reset(new CSpecialDB(1 << 20, true, true));
 }
 
 TestingSetup::~TestingSetup()
@@ -117,8 +121,11 @@ TestingSetup::~TestingSetup()
     g_banman.reset();
     UnloadBlockIndex();
     pcoinsTip.reset();
+    pcoinsflusher.reset();
     pcoinsdbview.reset();
     pblocktree.reset();
+    llmq::DestroyLLMQSystem();
+    deterministicMNManager.reset();
     pspecialdb.reset();
 }
 
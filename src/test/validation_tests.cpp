@@ -3,7 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chainparams.h>
+#include <clientversion.h>
 #include <net.h>
+#include <primitives/block.h>
+#include <streams.h>
 #include <validation.h>
 
 #include <test/setup_common.h>
@@ -74,4 +77,43 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+static std::vector<uint8_t> SerializeRawBlock(const CBlock& block)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+    return std::vector<uint8_t>(ss.begin(), ss.end());
+}
+
+BOOST_AUTO_TEST_CASE(raw_block_has_witness)
+{
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << OP_1 << OP_1;
+    coinbase.vout.resize(1);
+    coinbase.vout[0].nValue = 1 * COIN;
+    coinbase.vout[0].scriptPubKey = CScript() << OP_TRUE;
+
+    CMutableTransaction special;
+    special.nVersion = 3;
+    special.nType = TRANSACTION_PROVIDER_REGISTER;
+    special.vin.resize(2);
+    special.vout.resize(1);
+    special.vExtraPayload.assign(300, 0x01);
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    block.vtx.push_back(MakeTransactionRef(special));
+    std::vector<uint8_t> raw = SerializeRawBlock(block);
+    BOOST_CHECK(!RawBlockHasWitness(raw));
+
+    // Truncated data can't be proven witness-free
+    raw.resize(raw.size() - 1);
+    BOOST_CHECK(RawBlockHasWitness(raw));
+
+    special.vin[1].scriptWitness.stack.push_back({0x01});
+    block.vtx[1] = MakeTransactionRef(special);
+    BOOST_CHECK(RawBlockHasWitness(SerializeRawBlock(block)));
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,181 @@
+// Copyright (c) 2020 The BitCorn Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <sync.h>
+#include <test/setup_common.h>
+#include <util/time.h>
+#include <validationinterface.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(validationinterface_tests, TestingSetup)
+
+/** Records the heights of the UpdatedBlockTip callbacks, which wait for m_gate if set */
+class TestListener : public CValidationInterface
+{
+public:
+    std::shared_future<void> m_gate;
+    std::atomic<int> m_entered{0};
+
+    std::vector<int> GetHeights()
+    {
+        LOCK(m_mutex);
+        return m_heights;
+    }
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override
+    {
+        m_entered++;
+        if (m_gate.valid()) m_gate.wait();
+        LOCK(m_mutex);
+        m_heights.push_back(pindexNew->nHeight);
+    }
+
+private:
+    Mutex m_mutex;
+    std::vector<int> m_heights GUARDED_BY(m_mutex);
+};
+
+static std::vector<CBlockIndex> MakeIndexes(int nCount)
+{
+    std::vector<CBlockIndex> vIndexes(nCount);
+    for (int i = 0; i < nCount; i++) {
+        vIndexes[i].nHeight = i;
+    }
+    return vIndexes;
+}
+
+static std::vector<int> Heights(int nCount)
+{
+    std::vector<int> vHeights;
+    for (int i = 0; i < nCount; i++) {
+        vHeights.push_back(i);
+    }
+    return vHeights;
+}
+
+static void WaitFor(const std::function<bool()>& condition)
+{
+    for (int i = 0; i < 10000 && !condition(); i++) {
+        MilliSleep(1);
+    }
+    BOOST_REQUIRE(condition());
+}
+
+BOOST_AUTO_TEST_CASE(listener_order)
+{
+    // A second thread, so the queues of the listeners actually run in parallel
+    threadGroup.create_thread(std::bind(&CScheduler::serviceQueue, &scheduler));
+
+    const std::vector<CBlockIndex> vIndexes = MakeIndexes(100);
+    TestListener listener1, listener2;
+    RegisterValidationInterface(&listener1, "listener1");
+    RegisterValidationInterface(&listener2, "listener2");
+    for (const CBlockIndex& index : vIndexes) {
+        GetMainSignals().UpdatedBlockTip(&index, nullptr, false);
+    }
+    SyncWithValidationInterfaceQueue();
+
+    // Every listener sees all callbacks in the order in which they were queued
+    BOOST_CHECK(listener1.GetHeights() == Heights(100));
+    BOOST_CHECK(listener2.GetHeights() == Heights(100));
+
+    UnregisterValidationInterface(&listener1);
+    UnregisterValidationInterface(&listener2);
+}
+
+BOOST_AUTO_TEST_CASE(barrier_across_queues)
+{
+    threadGroup.create_thread(std::bind(&CScheduler::serviceQueue, &scheduler));
+
+    const std::vector<CBlockIndex> vIndexes = MakeIndexes(10);
+    std::promise<void> gate;
+    TestListener slow, fast;
+    slow.m_gate = gate.get_future().share();
+    RegisterValidationInterface(&slow, "slow");
+    RegisterValidationInterface(&fast, "fast");
+    for (const CBlockIndex& index : vIndexes) {
+        GetMainSignals().UpdatedBlockTip(&index, nullptr, false);
+    }
+
+    // The slow listener does not hold up the other one
+    WaitFor([&] { return fast.GetHeights().size() == 10; });
+    BOOST_CHECK(slow.GetHeights().empty());
+
+    // The function waits for the callbacks queued before it for all listeners
+    std::promise<size_t> barrier;
+    CallFunctionInValidationInterfaceQueue([&] {
+        barrier.set_value(slow.GetHeights().size());
+    });
+    std::future<size_t> barrier_future = barrier.get_future();
+    BOOST_CHECK(barrier_future.wait_for(std::chrono::milliseconds(100)) == std::future_status::timeout);
+
+    gate.set_value();
+    BOOST_CHECK_EQUAL(barrier_future.get(), 10U);
+    BOOST_CHECK(slow.GetHeights() == Heights(10));
+
+    UnregisterValidationInterface(&slow);
+    UnregisterValidationInterface(&fast);
+}
+
+BOOST_AUTO_TEST_CASE(queue_depth_backpressure)
+{
+    const std::vector<CBlockIndex> vIndexes = MakeIndexes(5);
+    std::promise<void> gate;
+    TestListener listener;
+    listener.m_gate = gate.get_future().share();
+    RegisterValidationInterface(&listener, "listener");
+    for (const CBlockIndex& index : vIndexes) {
+        GetMainSignals().UpdatedBlockTip(&index, nullptr, false);
+    }
+    WaitFor([&] { return listener.m_entered == 1; });
+
+    // Four callbacks pending are within the default depth
+    GetMainSignals().LimitQueues();
+
+    // but not within a depth of two, block connection would wait for the listener now
+    GetMainSignals().SetMaxQueueDepth(2);
+    std::future<void> limit_future = std::async(std::launch::async, [] { GetMainSignals().LimitQueues(); });
+    BOOST_CHECK(limit_future.wait_for(std::chrono::milliseconds(100)) == std::future_status::timeout);
+
+    gate.set_value();
+    limit_future.get();
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK(listener.GetHeights() == Heights(5));
+
+    GetMainSignals().SetMaxQueueDepth(DEFAULT_VALIDATION_QUEUE_DEPTH);
+    UnregisterValidationInterface(&listener);
+}
+
+BOOST_AUTO_TEST_CASE(unregister_drops_callbacks)
+{
+    const std::vector<CBlockIndex> vIndexes = MakeIndexes(5);
+    std::promise<void> gate;
+    TestListener listener;
+    listener.m_gate = gate.get_future().share();
+    RegisterValidationInterface(&listener, "listener");
+    for (const CBlockIndex& index : vIndexes) {
+        GetMainSignals().UpdatedBlockTip(&index, nullptr, false);
+    }
+    WaitFor([&] { return listener.m_entered == 1; });
+
+    UnregisterValidationInterface(&listener);
+    BOOST_CHECK(GetMainSignals().GetQueueStats().empty());
+    gate.set_value();
+
+    // The running callback completes, the ones still queued are dropped and the queue
+    // of the listener goes away once they are
+    WaitFor([] { return GetMainSignals().CallbacksPending() == 0; });
+    BOOST_CHECK(listener.GetHeights() == Heights(1));
+    BOOST_CHECK_EQUAL(listener.m_entered.load(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,11 +10,15 @@
 #include <shutdown.h>
 #include <ui_interface.h>
 #include <uint256.h>
+#include <util/memory.h>
 #include <util/system.h>
+#include <util/time.h>
 #include <util/translation.h>
 
 #include <stdint.h>
 
+#include <functional>
+
 #include <boost/thread.hpp>
 
 static const char DB_COIN = 'C';
@@ -79,12 +83,7 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
     return vhashHeadBlocks;
 }
 
-bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
-    CDBBatch batch(db);
-    size_t count = 0;
-    size_t changed = 0;
-    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
-    int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
+void CCoinsViewDB::MarkHeadBlocks(CDBBatch& batch, const uint256& hashBlock) const {
     assert(!hashBlock.IsNull());
 
     uint256 old_tip = GetBestBlock();
@@ -97,14 +96,31 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
         }
     }
 
-    // In the first batch, mark the database as being in the middle of a
-    // transition from old_tip to hashBlock.
+    // Mark the database as being in the middle of a transition from old_tip to hashBlock.
     // A vector is used for future extensibility, as we may want to support
     // interrupting after partial writes from multiple independent reorgs.
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, old_tip});
+}
+
+bool CCoinsViewDB::WriteHeadBlocks(const uint256& hashBlock) {
+    CDBBatch batch(db);
+    MarkHeadBlocks(batch, hashBlock);
+    return db.WriteBatch(batch);
+}
+
+bool CCoinsViewDB::WriteCoins(const CCoinsMap& mapCoins, const uint256& hashBlock) {
+    CDBBatch batch(db);
+    size_t count = 0;
+    size_t changed = 0;
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
+
+    // In the first batch, mark the database as being in the middle of a
+    // transition from old_tip to hashBlock.
+    MarkHeadBlocks(batch, hashBlock);
 
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); ++it) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             CoinEntry entry(&it->first);
             if (it->second.coin.IsSpent())
@@ -114,8 +130,6 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -140,11 +154,167 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     return ret;
 }
 
+bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    bool ret = WriteCoins(mapCoins, hashBlock);
+    mapCoins.clear();
+    return ret;
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
+CCoinsViewBackgroundFlush::CCoinsViewBackgroundFlush(CCoinsViewDB& _db) : db(_db)
+{
+    m_thread = std::thread(&TraceThread<std::function<void()> >, "coinsflush", std::function<void()>(std::bind(&CCoinsViewBackgroundFlush::ThreadFlush, this)));
+}
+
+CCoinsViewBackgroundFlush::~CCoinsViewBackgroundFlush()
+{
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+bool CCoinsViewBackgroundFlush::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    {
+        LOCK(m_mutex);
+        if (m_pending) {
+            CCoinsMap::const_iterator it = m_pending->mapCoins.find(outpoint);
+            if (it != m_pending->mapCoins.end()) {
+                if (it->second.coin.IsSpent()) {
+                    return false;
+                }
+                coin = it->second.coin;
+                return true;
+            }
+        }
+    }
+    // Outpoints which are not part of the pending write are not touched by it
+    return db.GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewBackgroundFlush::HaveCoin(const COutPoint &outpoint) const {
+    {
+        LOCK(m_mutex);
+        if (m_pending) {
+            CCoinsMap::const_iterator it = m_pending->mapCoins.find(outpoint);
+            if (it != m_pending->mapCoins.end()) {
+                return !it->second.coin.IsSpent();
+            }
+        }
+    }
+    return db.HaveCoin(outpoint);
+}
+
+uint256 CCoinsViewBackgroundFlush::GetBestBlock() const {
+    {
+        LOCK(m_mutex);
+        if (m_pending) {
+            return m_pending->hashBlock;
+        }
+    }
+    return db.GetBestBlock();
+}
+
+std::vector<uint256> CCoinsViewBackgroundFlush::GetHeadBlocks() const {
+    Sync();
+    return db.GetHeadBlocks();
+}
+
+bool CCoinsViewBackgroundFlush::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    // Keep at most one write in flight, so the pending entries never exceed one cache worth
+    if (!Sync()) {
+        return false;
+    }
+
+    int64_t nTimeStart = GetTimeMicros();
+    std::unique_ptr<PendingWrite> pending = MakeUnique<PendingWrite>();
+    pending->hashBlock = hashBlock;
+    pending->mapCoins.reserve(mapCoins.size());
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); it = mapCoins.erase(it)) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+            pending->mapCoins.emplace(it->first, std::move(it->second));
+        }
+    }
+
+    // A crash before the entries are on disk rolls the chainstate forward to hashBlock on startup
+    if (!db.WriteHeadBlocks(hashBlock)) {
+        return false;
+    }
+
+    size_t nCoins = pending->mapCoins.size();
+    {
+        LOCK(m_mutex);
+        m_pending = std::move(pending);
+        m_write_queued = true;
+        m_write_generation++;
+    }
+    m_cv.notify_all();
+    LogPrint(BCLog::COINDB, "Queued %u changed transaction outputs for writing in %.2fms\n", (unsigned int)nCoins, (GetTimeMicros() - nTimeStart) * 0.001);
+    return true;
+}
+
+CCoinsViewCursor* CCoinsViewBackgroundFlush::Cursor() const {
+    Sync();
+    return db.Cursor();
+}
+
+size_t CCoinsViewBackgroundFlush::EstimateSize() const {
+    return db.EstimateSize();
+}
+
+bool CCoinsViewBackgroundFlush::Sync() const {
+    WAIT_LOCK(m_mutex, lock);
+    m_cv.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_write_failed || !m_pending; });
+    return !m_write_failed;
+}
+
+void CCoinsViewBackgroundFlush::ThreadFlush()
+{
+    while (true) {
+        const PendingWrite* pending;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cv.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || m_write_queued; });
+            if (!m_write_queued) {
+                return;
+            }
+            m_write_queued = false;
+            pending = m_pending.get();
+        }
+
+        // Readers keep looking at the pending entries until all of them are on disk,
+        // so they are written without being modified.
+        int64_t nTimeStart = GetTimeMicros();
+        bool fOk = false;
+        try {
+            fOk = db.WriteCoins(pending->mapCoins, pending->hashBlock);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+        if (fOk) {
+            LogPrint(BCLog::BENCHMARK, "Wrote %u changed transaction outputs in the background: %.2fms\n", (unsigned int)pending->mapCoins.size(), (GetTimeMicros() - nTimeStart) * 0.001);
+        } else {
+            LogPrintf("%s: failed to write to coin database\n", __func__);
+        }
+
+        {
+            LOCK(m_mutex);
+            if (fOk) {
+                m_pending.reset();
+            } else {
+                m_write_failed = true;
+            }
+        }
+        m_cv.notify_all();
+    }
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(gArgs.IsArgSet("-blocksdir") ? GetDataDir() / "blocks" / "index" : GetBlocksDir() / "index", nCacheSize, fMemory, fWipe) {
 }
 
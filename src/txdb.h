@@ -10,10 +10,14 @@
 #include <dbwrapper.h>
 #include <chain.h>
 #include <primitives/block.h>
+#include <sync.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -23,6 +27,8 @@ class uint256;
 
 //! No need to periodic flush if at least this much space still available.
 static constexpr int MAX_BLOCK_COINSDB_USAGE = 10;
+//! -asyncflush default
+static const bool DEFAULT_ASYNC_FLUSH = true;
 //! -dbcache default (MiB)
 static const int64_t nDefaultDbCache = 450;
 //! -dbbatchsize default (bytes)
@@ -47,6 +53,9 @@ class CCoinsViewDB final : public CCoinsView
 {
 protected:
     CDBWrapper db;
+
+    //! Add the markers of an interrupted transition to hashBlock to batch
+    void MarkHeadBlocks(CDBBatch& batch, const uint256& hashBlock) const;
 public:
     explicit CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
@@ -57,11 +66,66 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    //! Mark the database as being in transition to hashBlock, see ReplayBlocks
+    bool WriteHeadBlocks(const uint256& hashBlock);
+    //! Like BatchWrite, but leaves mapCoins untouched so it can be read concurrently
+    bool WriteCoins(const CCoinsMap& mapCoins, const uint256& hashBlock);
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
 };
 
+/**
+ * CCoinsView on top of the coin database which writes the entries passed to BatchWrite
+ * on a background thread. Until they are on disk, reads of those entries are served
+ * from memory, so the caller can continue with an empty cache right away.
+ *
+ * The database is marked as being in transition to the new best block before BatchWrite
+ * returns, so an interrupted write is completed by ReplayBlocks on the next startup.
+ */
+class CCoinsViewBackgroundFlush final : public CCoinsView
+{
+private:
+    struct PendingWrite
+    {
+        CCoinsMapMemoryResource resource;
+        CCoinsMap mapCoins{0, SaltedOutpointHasher{}, CCoinsMap::key_equal{}, &resource};
+        uint256 hashBlock;
+    };
+
+    CCoinsViewDB& db;
+
+    mutable Mutex m_mutex;
+    mutable std::condition_variable m_cv;
+    //! Entries of the last BatchWrite, kept until all of them are on disk
+    std::unique_ptr<const PendingWrite> m_pending GUARDED_BY(m_mutex);
+    bool m_write_queued GUARDED_BY(m_mutex){false};
+    bool m_write_failed GUARDED_BY(m_mutex){false};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    //! Incremented on every BatchWrite, lets concurrent readers detect that the view changed
+    std::atomic<uint64_t> m_write_generation{0};
+    std::thread m_thread;
+
+    void ThreadFlush();
+
+public:
+    explicit CCoinsViewBackgroundFlush(CCoinsViewDB& _db);
+    ~CCoinsViewBackgroundFlush();
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    uint256 GetBestBlock() const override;
+    std::vector<uint256> GetHeadBlocks() const override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    CCoinsViewCursor *Cursor() const override;
+    size_t EstimateSize() const override;
+
+    //! Wait until the entries of the last BatchWrite are on disk. Returns false if writing them failed.
+    bool Sync() const;
+    uint64_t GetWriteGeneration() const { return m_write_generation; }
+};
+
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
 class CCoinsViewDBCursor: public CCoinsViewCursor
 {
@@ -9,11 +9,13 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <checkqueue.h>
+#include <coinsprefetch.h>
 #include <consensus/consensus.h>
 #include <consensus/merkle.h>
 #include <consensus/tx_check.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <ctpl.h>
 #include <cuckoocache.h>
 #include <flatfile.h>
 #include <hash.h>
@@ -21,6 +23,7 @@
 #include <llmq/quorums_chainlocks.h>
 #include <llmq/quorums_instantsend.h>
 #include <masternodes/payments.h>
+#include <optional.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
@@ -31,11 +34,13 @@
 #include <primitives/transaction.h>
 #include <random.h>
 #include <reverse_iterator.h>
+#include <saltedhasher.h>
 #include <script/script.h>
 #include <script/sigcache.h>
 #include <script/standard.h>
 #include <shutdown.h>
 #include <spork.h>
+#include <special/deterministicmns.h>
 #include <special/specialdb.h>
 #include <special/specialtx.h>
 #include <timedata.h>
@@ -45,10 +50,12 @@
 #include <ui_interface.h>
 #include <uint256.h>
 #include <undo.h>
+#include <unordered_lru_cache.h>
 #include <util/moneystr.h>
 #include <util/rbf.h>
 #include <util/strencodings.h>
 #include <util/system.h>
+#include <util/threadnames.h>
 #include <util/translation.h>
 #include <util/validation.h>
 #include <validationinterface.h>
@@ -184,6 +191,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 std::unique_ptr<CCoinsViewDB> pcoinsdbview;
+std::unique_ptr<CCoinsViewBackgroundFlush> pcoinsflusher;
 std::unique_ptr<CCoinsViewCache> pcoinsTip;
 std::unique_ptr<CBlockTreeDB> pblocktree;
 
@@ -1061,6 +1069,126 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex
     return ReadRawBlockFromDisk(block, block_pos, message_start);
 }
 
+namespace {
+typedef unordered_lru_cache<uint256, std::shared_ptr<const std::vector<uint8_t>>, StaticSaltedHasher> RawBlockCache;
+
+CCriticalSection cs_raw_block_cache;
+std::unique_ptr<RawBlockCache> raw_block_cache GUARDED_BY(cs_raw_block_cache);
+
+/** Forward-only cursor which skips over serialized fields without materializing them */
+class RawBlockCursor
+{
+private:
+    const std::vector<uint8_t>& m_data;
+    size_t m_pos{0};
+
+public:
+    explicit RawBlockCursor(const std::vector<uint8_t>& data) : m_data(data) {}
+
+    const uint8_t* Skip(uint64_t n)
+    {
+        if (n > m_data.size() - m_pos) {
+            throw std::ios_base::failure("RawBlockCursor: end of data");
+        }
+        const uint8_t* p = m_data.data() + m_pos;
+        m_pos += n;
+        return p;
+    }
+
+    uint64_t ReadCompactSize()
+    {
+        uint8_t ch = *Skip(1);
+        if (ch < 253) return ch;
+        if (ch == 253) return ReadLE16(Skip(2));
+        if (ch == 254) return ReadLE32(Skip(4));
+        return ReadLE64(Skip(8));
+    }
+
+    void SkipVector(uint64_t elem_size)
+    {
+        uint64_t n = ReadCompactSize();
+        if (n > MAX_SIZE) {
+            throw std::ios_base::failure("RawBlockCursor: size too large");
+        }
+        Skip(n * elem_size);
+    }
+};
+} // namespace
+
+void InitRawBlockCache(unsigned int nMaxBlocks)
+{
+    LOCK(cs_raw_block_cache);
+    if (nMaxBlocks == 0) {
+        raw_block_cache.reset();
+    } else {
+        raw_block_cache.reset(new RawBlockCache(nMaxBlocks));
+    }
+}
+
+std::shared_ptr<const std::vector<uint8_t>> ReadRawBlockCached(const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start)
+{
+    const uint256 hash = pindex->GetBlockHash();
+    std::shared_ptr<const std::vector<uint8_t>> ret;
+    {
+        LOCK(cs_raw_block_cache);
+        if (raw_block_cache && raw_block_cache->get(hash, ret)) {
+            return ret;
+        }
+    }
+
+    auto block = std::make_shared<std::vector<uint8_t>>();
+    if (!ReadRawBlockFromDisk(*block, pindex, message_start)) {
+        return nullptr;
+    }
+    ret = std::move(block);
+
+    LOCK(cs_raw_block_cache);
+    if (raw_block_cache) {
+        raw_block_cache->insert(hash, ret);
+    }
+    return ret;
+}
+
+bool RawBlockHasWitness(const std::vector<uint8_t>& block)
+{
+    // Mirrors UnserializeTransaction, but only walks the bytes
+    try {
+        RawBlockCursor cursor(block);
+        cursor.Skip(80); // header
+        uint64_t nTx = cursor.ReadCompactSize();
+        for (uint64_t i = 0; i < nTx; i++) {
+            uint32_t n32bitVersion = ReadLE32(cursor.Skip(4));
+            int16_t nVersion = (int16_t)(n32bitVersion & 0xffff);
+            int16_t nType = (int16_t)((n32bitVersion >> 16) & 0xffff);
+            uint64_t nVin = cursor.ReadCompactSize();
+            if (nVin == 0) {
+                // dummy vin, followed by the extended format flags
+                if (*cursor.Skip(1) != 0) {
+                    return true;
+                }
+            } else {
+                for (uint64_t j = 0; j < nVin; j++) {
+                    cursor.Skip(36); // prevout
+                    cursor.SkipVector(1); // scriptSig
+                    cursor.Skip(4); // nSequence
+                }
+                uint64_t nVout = cursor.ReadCompactSize();
+                for (uint64_t j = 0; j < nVout; j++) {
+                    cursor.Skip(8); // nValue
+                    cursor.SkipVector(1); // scriptPubKey
+                }
+            }
+            cursor.Skip(4); // nLockTime
+            if (nVersion >= 2 && nType != TRANSACTION_NORMAL) {
+                cursor.SkipVector(1); // vExtraPayload
+            }
+        }
+    } catch (const std::exception&) {
+        return true;
+    }
+    return false;
+}
+
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams, bool fSuperblockPartOnly)
 {
     if (Params().NetworkIDString() == "regtest")
@@ -2319,10 +2447,17 @@ bool CChainState::FlushStateToDisk(
                 return AbortNode(state, "Disk space is too low!", _("Error: Disk space is too low!").translated, CClientUIInterface::MSG_NOPREFIX);
             }
             // Flush the chainstate (which may refer to block index entries).
+            // Unless we are shutting down or about to prune, the coins are written in the
+            // background while validation continues on the emptied cache.
+            int64_t nTimeFlushStart = GetTimeMicros();
+            bool fAsyncFlush = (mode == FlushStateMode::PERIODIC || mode == FlushStateMode::IF_NEEDED) && !fFlushForPrune && gArgs.GetBoolArg("-asyncflush", DEFAULT_ASYNC_FLUSH);
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            if (!fAsyncFlush && !pcoinsflusher->Sync())
+                return AbortNode(state, "Failed to write to coin database");
             if (!pspecialdb->CommitRootTransaction())
                 return AbortNode(state, "Failed to commit specialDB");
+            LogPrint(BCLog::BENCHMARK, "%s: %s chainstate flush, cs_main held for %.2fms\n", __func__, fAsyncFlush ? "background" : "synchronous", (GetTimeMicros() - nTimeFlushStart) * MILLI);
             nLastFlush = nNow;
             full_flush_completed = true;
         }
@@ -2580,6 +2715,9 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     LogPrint(BCLog::BENCHMARK, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
     {
         auto dbTx = pspecialdb->BeginTransaction();
+        if (g_coins_prefetcher) {
+            g_coins_prefetcher->Apply(pindexNew->GetBlockHash(), *pcoinsTip);
+        }
         CCoinsViewCache view(pcoinsTip.get());
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
         GetMainSignals().BlockChecked(blockConnecting, state);
@@ -2849,9 +2987,8 @@ static void NotifyHeaderTip() LOCKS_EXCLUDED(cs_main) {
 static void LimitValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main) {
     AssertLockNotHeld(cs_main);
 
-    if (GetMainSignals().CallbacksPending() > 10) {
-        SyncWithValidationInterfaceQueue();
-    }
+    // Only waits for the listeners which fell too far behind
+    GetMainSignals().LimitQueues();
 }
 
 /**
@@ -2930,6 +3067,9 @@ bool CChainState::ActivateBestChain(CValidationState &state, const CChainParams&
             } while (!m_chain.Tip() || (starting_tip && CBlockIndexWorkComparator()(m_chain.Tip(), starting_tip)));
             if (!blocks_connected) return true;
 
+            // Readers which learn about the new tip from the notifications must find it in the snapshot
+            PublishChainSnapshot();
+
             const CBlockIndex* pindexFork = m_chain.FindFork(starting_tip);
             bool fInitialDownload = IsInitialBlockDownload();
 
@@ -2968,6 +3108,46 @@ bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams,
     return ::ChainstateActive().ActivateBestChain(state, chainparams, std::move(pblock));
 }
 
+static CChainSnapshotPtr MakeEmptyChainSnapshot()
+{
+    auto snapshot = std::make_shared<CChainSnapshot>();
+    snapshot->mnList = std::make_shared<const CDeterministicMNList>();
+    return snapshot;
+}
+
+// Replaced as a whole and only accessed through std::atomic_load/std::atomic_store
+static CChainSnapshotPtr g_chain_snapshot = MakeEmptyChainSnapshot();
+
+CChainSnapshotPtr GetChainSnapshot()
+{
+    return std::atomic_load(&g_chain_snapshot);
+}
+
+void PublishChainSnapshot()
+{
+    // cs_main orders the writers, so that a newer tip is never replaced by an older one
+    AssertLockHeld(cs_main);
+    auto snapshot = std::make_shared<CChainSnapshot>();
+    const CBlockIndex* pindexTip = ::ChainActive().Tip();
+    snapshot->pindexTip = pindexTip;
+    if (pindexTip) {
+        snapshot->hashTip = pindexTip->GetBlockHash();
+        snapshot->nHeight = pindexTip->nHeight;
+        snapshot->nTime = pindexTip->GetBlockTime();
+        snapshot->nMedianTimePast = pindexTip->GetMedianTimePast();
+        snapshot->nChainWork = pindexTip->nChainWork;
+    }
+    snapshot->mnList = std::make_shared<const CDeterministicMNList>(pindexTip && deterministicMNManager ? deterministicMNManager->GetListForBlock(pindexTip) : CDeterministicMNList());
+    if (llmq::chainLocksHandler) {
+        const llmq::CChainLockSig clsig = llmq::chainLocksHandler->GetBestChainLock();
+        snapshot->nBestChainLockHeight = clsig.nHeight;
+        snapshot->hashBestChainLock = clsig.blockHash;
+    }
+    // A counter kept by the InstantSend database, it doesn't scan it
+    snapshot->nInstantSendLocks = llmq::quorumInstantSendManager ? llmq::quorumInstantSendManager->GetInstantSendLockCount() : 0;
+    std::atomic_store(&g_chain_snapshot, CChainSnapshotPtr(std::move(snapshot)));
+}
+
 bool CChainState::PreciousBlock(CValidationState& state, const CChainParams& params, CBlockIndex *pindex)
 {
     {
@@ -3077,6 +3257,10 @@ bool CChainState::InvalidateBlock(CValidationState& state, const CChainParams& c
         }
 
         InvalidChainFound(to_mark_failed);
+
+        if (pindex_was_in_chain) {
+            PublishChainSnapshot();
+        }
     }
 
     // Only notify about a new block tip if the active chain was modified.
@@ -3877,6 +4061,10 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
         // Ensure that CheckBlock() passes before calling AcceptBlock, as
         // belt-and-suspenders.
         bool ret = CheckBlock(*pblock, state, chainparams.GetConsensus());
+        if (ret && g_coins_prefetcher) {
+            // Start reading the block's inputs from the chainstate while it is being stored
+            g_coins_prefetcher->Prefetch(*pblock, *pcoinsTip);
+        }
         if (ret) {
             // Store to disk
             ret = ::ChainstateActive().AcceptBlock(pblock, state, chainparams, &pindex, fForceProcessing, nullptr, fNewBlock);
@@ -4728,19 +4916,35 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
     return ::ChainstateActive().LoadGenesisBlock(chainparams);
 }
 
-bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFilePos *dbp)
+namespace {
+/** A block located and deserialized from a block file, waiting to be indexed */
+struct ImportedBlock
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
-    int64_t nStart = GetTimeMillis();
+    std::shared_ptr<CBlock> pblock;
+    uint256 hash;
+    FlatFilePos pos;
+};
 
-    int nLoaded = 0;
+// Map of disk positions for blocks with unknown parent (only used for reindex)
+std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
+} // namespace
+
+/**
+ * Locate and deserialize the blocks in a block file, passing each one to fn until it returns false.
+ * The context-free CheckBlock is run here so that it doesn't have to be repeated under cs_main.
+ * nFile is the blk*.dat file number, or -1 for external files whose positions are not recorded.
+ * Does not touch chainstate and may be called from any thread.
+ */
+static void ScanBlockFile(const CChainParams& chainparams, FILE* fileIn, int nFile, const std::function<bool(ImportedBlock&&)>& fn)
+{
     try {
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
         while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
+            if (ShutdownRequested()) {
+                return;
+            }
 
             blkdat.SetPos(nRewind);
             nRewind++; // start one byte further next time, in case of failure
@@ -4764,79 +4968,24 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFi
             }
             try {
                 // read block
+                ImportedBlock imported;
                 uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
+                imported.pos = FlatFilePos(nFile, nBlockPos);
                 blkdat.SetLimit(nBlockPos + nSize);
                 blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
+                imported.pblock = std::make_shared<CBlock>();
+                blkdat >> *imported.pblock;
                 nRewind = blkdat.GetPos();
 
-                uint256 hash = block.GetHash();
-                {
-                    LOCK(cs_main);
-                    // detect out of order blocks, and store them for later
-                    if (hash != chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
-                        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                                block.hashPrevBlock.ToString());
-                        if (dbp)
-                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                        continue;
-                    }
-
-                    // process in case the block isn't known yet
-                    CBlockIndex* pindex = LookupBlockIndex(hash);
-                    if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
-                      CValidationState state;
-                      if (::ChainstateActive().AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr, false)) {
-                          nLoaded++;
-                      }
-                      if (state.IsError()) {
-                          break;
-                      }
-                    } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
-                      LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
-                    }
+                imported.hash = imported.pblock->GetHash();
+                CValidationState state;
+                if (!CheckBlock(*imported.pblock, state, chainparams.GetConsensus())) {
+                    // leave the block unchecked so that AcceptBlock reports the failure
+                    imported.pblock->fChecked = false;
                 }
 
-                // Activate the genesis block so normal node progress can continue
-                if (hash == chainparams.GetConsensus().hashGenesisBlock) {
-                    CValidationState state;
-                    if (!ActivateBestChain(state, chainparams)) {
-                        break;
-                    }
-                }
-
-                NotifyHeaderTip();
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, FlatFilePos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
-                        {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            CValidationState dummy;
-                            if (::ChainstateActive().AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr, false))
-                            {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip();
-                    }
+                if (!fn(std::move(imported))) {
+                    return;
                 }
             } catch (const std::exception& e) {
                 LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
@@ -4845,11 +4994,170 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFi
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
     }
+}
+
+/**
+ * Add a block found in a block file to the block index, together with any earlier
+ * encountered successors. Must be called in file order from a single thread.
+ * Returns false if importing should stop.
+ */
+static bool IndexImportedBlock(const CChainParams& chainparams, ImportedBlock& imported, int& nLoaded)
+{
+    boost::this_thread::interruption_point();
+
+    const CBlock& block = *imported.pblock;
+    const uint256& hash = imported.hash;
+    FlatFilePos* dbp = imported.pos.IsNull() ? nullptr : &imported.pos;
+    {
+        LOCK(cs_main);
+        // detect out of order blocks, and store them for later
+        if (hash != chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
+            LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                    block.hashPrevBlock.ToString());
+            if (dbp)
+                mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+            return true;
+        }
+
+        // process in case the block isn't known yet
+        CBlockIndex* pindex = LookupBlockIndex(hash);
+        if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+          CValidationState state;
+          if (::ChainstateActive().AcceptBlock(imported.pblock, state, chainparams, nullptr, true, dbp, nullptr, false)) {
+              nLoaded++;
+          }
+          if (state.IsError()) {
+              return false;
+          }
+        } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+          LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+        }
+    }
+
+    // Activate the genesis block so normal node progress can continue
+    if (hash == chainparams.GetConsensus().hashGenesisBlock) {
+        CValidationState state;
+        if (!ActivateBestChain(state, chainparams)) {
+            return false;
+        }
+    }
+
+    NotifyHeaderTip();
+
+    // Recursively process earlier encountered successors of this block
+    std::deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+        while (range.first != range.second) {
+            std::multimap<uint256, FlatFilePos>::iterator it = range.first;
+            std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+            if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
+            {
+                LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                        head.ToString());
+                LOCK(cs_main);
+                CValidationState dummy;
+                if (::ChainstateActive().AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr, false))
+                {
+                    nLoaded++;
+                    queue.push_back(pblockrecursive->GetHash());
+                }
+            }
+            range.first++;
+            mapBlocksUnknownParent.erase(it);
+            NotifyHeaderTip();
+        }
+    }
+    return true;
+}
+
+bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFilePos *dbp)
+{
+    int64_t nStart = GetTimeMillis();
+
+    int nLoaded = 0;
+    ScanBlockFile(chainparams, fileIn, dbp ? dbp->nFile : -1, [&](ImportedBlock&& imported) {
+        if (dbp)
+            *dbp = imported.pos;
+        return IndexImportedBlock(chainparams, imported, nLoaded);
+    });
     if (nLoaded > 0)
         LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
     return nLoaded > 0;
 }
 
+void ReindexBlockFiles(const CChainParams& chainparams, int nThreads, size_t nMaxReadAheadMemory)
+{
+    int nFiles = 0;
+    while (fs::exists(GetBlockPosFilename(FlatFilePos(nFiles, 0)))) {
+        nFiles++;
+    }
+
+    // Files are scanned and deserialized ahead of time on the worker pool, while the
+    // blocks are indexed here in file order, as a sequential reindex would do.
+    typedef Optional<std::vector<ImportedBlock>> ScanResult;
+    ctpl::thread_pool workerPool(nThreads);
+    RenameThreadPool(workerPool, "reindex");
+    std::deque<std::pair<std::future<ScanResult>, size_t>> scanQueue;
+    size_t nQueuedMemory = 0;
+    int nNextFile = 0;
+    auto estimateFileMemory = [](int nFile) -> size_t {
+        boost::system::error_code ec;
+        uintmax_t nSize = fs::file_size(GetBlockPosFilename(FlatFilePos(nFile, 0)), ec);
+        if (ec)
+            nSize = MAX_BLOCKFILE_SIZE;
+        return (size_t)nSize * REINDEX_DESERIALIZED_FACTOR;
+    };
+    auto queueNextFile = [&]() {
+        const int nFile = nNextFile++;
+        const size_t nMemory = estimateFileMemory(nFile);
+        nQueuedMemory += nMemory;
+        scanQueue.emplace_back(workerPool.push([&chainparams, nFile](int threadId) -> ScanResult {
+            FILE* file = OpenBlockFile(FlatFilePos(nFile, 0), true);
+            if (!file)
+                return nullopt; // This error is logged in OpenBlockFile
+            std::vector<ImportedBlock> blocks;
+            ScanBlockFile(chainparams, file, nFile, [&blocks](ImportedBlock&& imported) {
+                blocks.emplace_back(std::move(imported));
+                return true;
+            });
+            return blocks;
+        }), nMemory);
+    };
+
+    int64_t nStart = GetTimeMillis();
+    int nLoaded = 0;
+    for (int nFile = 0; nFile < nFiles; nFile++) {
+        // The file about to be indexed is always scanned, the following ones only
+        // while the deserialized blocks held in memory stay within the budget.
+        while (nNextFile < nFiles && nNextFile <= nFile + nThreads &&
+               (scanQueue.empty() || nQueuedMemory + estimateFileMemory(nNextFile) <= nMaxReadAheadMemory)) {
+            queueNextFile();
+        }
+        ScanResult blocks = scanQueue.front().first.get();
+        const size_t nMemory = scanQueue.front().second;
+        scanQueue.pop_front();
+        if (!blocks)
+            break;
+
+        LogPrintf("Reindexing block file blk%05u.dat (%u blocks, %u files read ahead)...\n", (unsigned int)nFile, blocks->size(), scanQueue.size());
+        bool fContinue = true;
+        for (ImportedBlock& imported : *blocks) {
+            if (!(fContinue = IndexImportedBlock(chainparams, imported, nLoaded)))
+                break;
+        }
+        if (!fContinue)
+            break;
+        nQueuedMemory -= nMemory;
+    }
+    // drop scans of files that won't be indexed anymore
+    workerPool.clear_queue();
+    LogPrintf("Reindexed %i blocks from %i block files in %dms using %d threads\n", nLoaded, nFiles, GetTimeMillis() - nStart, nThreads);
+}
+
 void CChainState::CheckBlockIndex(const Consensus::Params& consensusParams)
 {
     if (!fCheckBlockIndex) {
@@ -11,6 +11,7 @@
 #endif
 
 #include <amount.h>
+#include <arith_uint256.h>
 #include <coins.h>
 #include <crypto/common.h> // for ReadLE64
 #include <fs.h>
@@ -37,9 +38,11 @@ class CBlockIndex;
 class CBlockTreeDB;
 class CBlockUndo;
 class CChainParams;
+class CCoinsViewBackgroundFlush;
 class CCoinsViewDB;
 class CInv;
 class CConnman;
+class CDeterministicMNList;
 class CScriptCheck;
 class CBlockPolicyEstimator;
 class CTxMemPool;
@@ -134,6 +137,14 @@ static const int MAX_UNCONNECTING_HEADERS = 10;
 
 /** Default for -stopatheight */
 static const int DEFAULT_STOPATHEIGHT = 0;
+/** Maximum number of block files scanned in parallel during -reindex */
+static const int MAX_REINDEX_THREADS = 16;
+/** -reindexthreads default (0 = auto) */
+static const int DEFAULT_REINDEX_THREADS = 0;
+/** Estimated ratio of the memory used by a deserialized block file to its size on disk */
+static const int REINDEX_DESERIALIZED_FACTOR = 3;
+/** Default for -rawblockcache, the number of serialized blocks kept in memory for serving peers */
+static const unsigned int DEFAULT_RAW_BLOCK_CACHE_SIZE = 32;
 
 struct BlockHasher
 {
@@ -240,6 +251,9 @@ FILE* OpenBlockFile(const FlatFilePos &pos, bool fReadOnly = false);
 fs::path GetBlockPosFilename(const FlatFilePos &pos);
 /** Import blocks from an external file */
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFilePos *dbp = nullptr);
+/** Import all blk*.dat files for -reindex, scanning and deserializing them on nThreads workers ahead of the indexer.
+ *  Files are only read ahead while their estimated deserialized size stays within nMaxReadAheadMemory bytes. */
+void ReindexBlockFiles(const CChainParams& chainparams, int nThreads, size_t nMaxReadAheadMemory);
 /** Ensures we have a genesis block in the block tree, possibly writing one to disk. */
 bool LoadGenesisBlock(const CChainParams& chainparams);
 /** Load the block tree and coins database from disk,
@@ -260,6 +274,37 @@ bool GetTransaction(const uint256& hash, CTransactionRef& tx, const Consensus::P
  * validationinterface callback.
  */
 bool ActivateBestChain(CValidationState& state, const CChainParams& chainparams, std::shared_ptr<const CBlock> pblock = std::shared_ptr<const CBlock>());
+
+/**
+ * Immutable view of the active chain, published whenever the tip changes and when a new
+ * best ChainLock is processed. Readers which only need the tip, its height, time or work
+ * or the masternode list at the tip use it without taking cs_main. The InstantSend lock
+ * count is as of the last publish.
+ */
+struct CChainSnapshot
+{
+    //! Null before the chain is loaded, block indexes are never freed while running
+    const CBlockIndex* pindexTip{nullptr};
+    uint256 hashTip;
+    int nHeight{-1};
+    int64_t nTime{0};
+    int64_t nMedianTimePast{0};
+    arith_uint256 nChainWork;
+    //! Deterministic masternode list at the tip, never null
+    std::shared_ptr<const CDeterministicMNList> mnList;
+    //! Best ChainLock, nBestChainLockHeight is -1 if there is none
+    int nBestChainLockHeight{-1};
+    uint256 hashBestChainLock;
+    size_t nInstantSendLocks{0};
+};
+typedef std::shared_ptr<const CChainSnapshot> CChainSnapshotPtr;
+
+/** The last published snapshot of the active chain, never null */
+CChainSnapshotPtr GetChainSnapshot();
+/** Publish a new snapshot of the active chain, called by validation after the tip changed
+ * and before the tip change is announced, and by the ChainLocks handler */
+void PublishChainSnapshot() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams, bool fSuperblockPartOnly=false);
 CAmount GetMasternodePayment(int nHeight, CAmount blockValue);
 
@@ -375,6 +420,16 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
 
+/** Initializes the LRU cache of serialized blocks (0 disables it) */
+void InitRawBlockCache(unsigned int nMaxBlocks);
+/**
+ * Get the serialized bytes of a block as stored on disk, without constructing a CBlock.
+ * Recently served blocks are kept in the raw block cache. Returns nullptr on read failure.
+ */
+std::shared_ptr<const std::vector<uint8_t>> ReadRawBlockCached(const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
+/** Check whether any transaction in a serialized block carries witness data (also true if it can't be parsed) */
+bool RawBlockHasWitness(const std::vector<uint8_t>& block);
+
 /** Reprocess a number of blocks to try and get on the correct chain again **/
 bool DisconnectBlocks(int blocks);
 void ReprocessBlocks(int nBlocks);
@@ -673,6 +728,9 @@ PrevBlockMap& PrevBlockIndex();
 /** Global variable that points to the coins database (protected by cs_main) */
 extern std::unique_ptr<CCoinsViewDB> pcoinsdbview;
 
+/** Global variable that points to the view writing the coins database in the background (protected by cs_main) */
+extern std::unique_ptr<CCoinsViewBackgroundFlush> pcoinsflusher;
+
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern std::unique_ptr<CCoinsViewCache> pcoinsTip;
 
@@ -5,10 +5,14 @@
 
 #include <validationinterface.h>
 
+#include <governance/governance-vote.h>
 #include <primitives/block.h>
 #include <scheduler.h>
 #include <txmempool.h>
+#include <util/memory.h>
+#include <util/time.h>
 
+#include <algorithm>
 #include <list>
 #include <atomic>
 #include <future>
@@ -16,50 +20,145 @@
 
 #include <boost/signals2/signal.hpp>
 
+// Connections of the callbacks which are called synchronously by validation
 struct ValidationInterfaceConnections {
-    boost::signals2::scoped_connection UpdatedBlockTip;
-    boost::signals2::scoped_connection TransactionAddedToMempool;
-    boost::signals2::scoped_connection BlockConnected;
-    boost::signals2::scoped_connection BlockDisconnected;
-    boost::signals2::scoped_connection TransactionRemovedFromMempool;
-    boost::signals2::scoped_connection ChainStateFlushed;
     boost::signals2::scoped_connection BlockChecked;
     boost::signals2::scoped_connection NewPoWValidBlock;
-    boost::signals2::scoped_connection NotifyGovernanceVote;
     boost::signals2::scoped_connection NotifyGovernanceObject;
-    boost::signals2::scoped_connection NotifyChainLock;
     boost::signals2::scoped_connection NotifyMasternodeListChanged;
     boost::signals2::scoped_connection SyncTransaction;
     boost::signals2::scoped_connection AcceptedBlockHeader;
-    boost::signals2::scoped_connection NotifyTransactionLock;
-    boost::signals2::scoped_connection NotifyInstantSendDoubleSpendAttempt;
+};
+
+/**
+ * The background callbacks of one listener. Every listener has its own queue, so a
+ * slow listener only delays its own callbacks, while the callbacks of one listener
+ * still run in order and one at a time.
+ */
+class ValidationInterfaceQueue
+{
+public:
+    CValidationInterface* const m_listener;
+    const std::string m_name;
+    SingleThreadedSchedulerClient m_client;
+    //! Cleared on unregistration, the callbacks still queued are dropped then
+    std::atomic<bool> m_active{true};
+
+    std::atomic<uint64_t> m_callbacks{0};
+    std::atomic<int64_t> m_total_latency{0};
+    std::atomic<int64_t> m_max_latency{0};
+    std::atomic<size_t> m_max_pending{0};
+
+    ValidationInterfaceQueue(CValidationInterface* listener, const std::string& name, CScheduler* pscheduler)
+        : m_listener(listener), m_name(name), m_client(pscheduler) {}
+
+    void AddFunction(std::function<void ()> func)
+    {
+        const int64_t nTimeQueued = GetTimeMicros();
+        m_client.AddToProcessQueue([this, func, nTimeQueued] {
+            func();
+            const int64_t nLatency = GetTimeMicros() - nTimeQueued;
+            m_callbacks++;
+            m_total_latency += nLatency;
+            int64_t nMaxLatency = m_max_latency;
+            while (nLatency > nMaxLatency && !m_max_latency.compare_exchange_weak(nMaxLatency, nLatency)) {}
+        });
+        const size_t nPending = m_client.CallbacksPending();
+        size_t nMaxPending = m_max_pending;
+        while (nPending > nMaxPending && !m_max_pending.compare_exchange_weak(nMaxPending, nPending)) {}
+    }
+
+    void AddCallback(const std::function<void (CValidationInterface&)>& callback)
+    {
+        AddFunction([this, callback] {
+            if (m_active) callback(*m_listener);
+        });
+    }
 };
 
 struct MainSignalsInstance {
-    boost::signals2::signal<void (const CBlockIndex *, const CBlockIndex *, bool fInitialDownload)> UpdatedBlockTip;
-    boost::signals2::signal<void (const CTransactionRef &)> TransactionAddedToMempool;
-    boost::signals2::signal<void (const std::shared_ptr<const CBlock> &, const CBlockIndex *pindex, const std::vector<CTransactionRef>&)> BlockConnected;
-    boost::signals2::signal<void (const std::shared_ptr<const CBlock> &)> BlockDisconnected;
-    boost::signals2::signal<void (const CTransactionRef &)> TransactionRemovedFromMempool;
-    boost::signals2::signal<void (const CBlockLocator &)> ChainStateFlushed;
     boost::signals2::signal<void (const CBlock&, const CValidationState&)> BlockChecked;
     boost::signals2::signal<void (const CBlockIndex *, const std::shared_ptr<const CBlock>&)> NewPoWValidBlock;
-    boost::signals2::signal<void (const CGovernanceVote &)> NotifyGovernanceVote;
     boost::signals2::signal<void (const CGovernanceObject &)> NotifyGovernanceObject;
-    boost::signals2::signal<void (const CBlockIndex *)> NotifyChainLock;
-    boost::signals2::signal<void (bool, const CDeterministicMNList&, const CDeterministicMNListDiff&)> NotifyMasternodeListChanged;
+    boost::signals2::signal<void (bool, const CDeterministicMNList&, const CDeterministicMNList&, const CDeterministicMNListDiff&)> NotifyMasternodeListChanged;
     boost::signals2::signal<void (const CTransaction, const CBlockIndex *, int)> SyncTransaction;
     boost::signals2::signal<void (const CBlockIndex *)> AcceptedBlockHeader;
-    boost::signals2::signal<void (const CTransaction &)> NotifyTransactionLock;
-    boost::signals2::signal<void (const CTransaction &, const CTransaction &)> NotifyInstantSendDoubleSpendAttempt;
 
-    // We are not allowed to assume the scheduler only runs in one thread,
-    // but must ensure all callbacks happen in-order, so we end up creating
-    // our own queue here :(
-    SingleThreadedSchedulerClient m_schedulerClient;
+    CScheduler* m_pscheduler;
     std::unordered_map<CValidationInterface*, ValidationInterfaceConnections> m_connMainSignals;
 
-    explicit MainSignalsInstance(CScheduler *pscheduler) : m_schedulerClient(pscheduler) {}
+    // Held while callbacks are queued, so every listener sees them in the same order
+    Mutex m_mutex;
+    // The queues of the registered listeners and the default queue, plus the ones of
+    // unregistered listeners until the callbacks still queued for them are done
+    std::list<std::shared_ptr<ValidationInterfaceQueue>> m_queues GUARDED_BY(m_mutex);
+    std::unordered_map<CValidationInterface*, ValidationInterfaceQueue*> m_active_queues GUARDED_BY(m_mutex);
+    // For functions queued while no listener is registered
+    ValidationInterfaceQueue* m_default_queue GUARDED_BY(m_mutex);
+
+    explicit MainSignalsInstance(CScheduler *pscheduler) : m_pscheduler(pscheduler)
+    {
+        LOCK(m_mutex);
+        m_queues.emplace_back(std::make_shared<ValidationInterfaceQueue>(nullptr, "", m_pscheduler));
+        m_default_queue = m_queues.back().get();
+    }
+
+    void AddQueue(CValidationInterface* listener, const std::string& name)
+    {
+        LOCK(m_mutex);
+        RemoveQueue(listener);
+        m_queues.emplace_back(std::make_shared<ValidationInterfaceQueue>(listener, name, m_pscheduler));
+        m_active_queues.emplace(listener, m_queues.back().get());
+    }
+
+    void RemoveQueue(CValidationInterface* listener) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        auto it = m_active_queues.find(listener);
+        if (it != m_active_queues.end()) {
+            RetireQueue(it->second);
+            m_active_queues.erase(it);
+        }
+    }
+
+    void RemoveAllQueues() EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        for (const auto& p : m_active_queues) {
+            RetireQueue(p.second);
+        }
+        m_active_queues.clear();
+    }
+
+    /** Drop the callbacks still queued for an unregistered listener, and erase its queue
+     * once they are done */
+    void RetireQueue(ValidationInterfaceQueue* queue) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        queue->m_active = false;
+        auto it = std::find_if(m_queues.begin(), m_queues.end(), [queue](const std::shared_ptr<ValidationInterfaceQueue>& q) { return q.get() == queue; });
+        assert(it != m_queues.end());
+        // Nothing is added to the queue anymore, so this is the last function it runs. The
+        // function holds the last reference to the queue then, which is released once its
+        // client is done with it.
+        std::shared_ptr<ValidationInterfaceQueue> pqueue = *it;
+        queue->AddFunction([this, pqueue] {
+            LOCK(m_mutex);
+            m_queues.remove(pqueue);
+        });
+    }
+
+    /** Queue a callback for every registered listener */
+    void Enqueue(const std::function<void (CValidationInterface&)>& callback)
+    {
+        LOCK(m_mutex);
+        for (const auto& p : m_active_queues) {
+            p.second->AddCallback(callback);
+        }
+    }
+
+    std::vector<std::shared_ptr<ValidationInterfaceQueue>> GetAllQueues()
+    {
+        LOCK(m_mutex);
+        return std::vector<std::shared_ptr<ValidationInterfaceQueue>>(m_queues.begin(), m_queues.end());
+    }
 };
 
 static CMainSignals g_signals;
@@ -80,13 +179,64 @@ void CMainSignals::UnregisterBackgroundSignalScheduler() {
 
 void CMainSignals::FlushBackgroundCallbacks() {
     if (m_internals) {
-        m_internals->m_schedulerClient.EmptyQueue();
+        for (const auto& queue : m_internals->GetAllQueues()) {
+            queue->m_client.EmptyQueue();
+        }
     }
 }
 
 size_t CMainSignals::CallbacksPending() {
     if (!m_internals) return 0;
-    return m_internals->m_schedulerClient.CallbacksPending();
+    LOCK(m_internals->m_mutex);
+    size_t nPending = 0;
+    for (const auto& queue : m_internals->m_queues) {
+        nPending += queue->m_client.CallbacksPending();
+    }
+    return nPending;
+}
+
+void CMainSignals::SetMaxQueueDepth(size_t nMaxDepth) {
+    m_max_queue_depth = std::max<size_t>(1, nMaxDepth);
+}
+
+void CMainSignals::LimitQueues() {
+    AssertLockNotHeld(cs_main);
+    if (!m_internals) return;
+
+    // Only wait for the listeners which are too far behind, the others keep their pace
+    std::vector<std::future<void>> vFutures;
+    {
+        LOCK(m_internals->m_mutex);
+        for (const auto& p : m_internals->m_active_queues) {
+            ValidationInterfaceQueue* queue = p.second;
+            if (queue->m_client.CallbacksPending() <= m_max_queue_depth) continue;
+            auto promise = std::make_shared<std::promise<void>>();
+            vFutures.push_back(promise->get_future());
+            queue->AddFunction([promise] { promise->set_value(); });
+        }
+    }
+    for (auto& future : vFutures) {
+        future.wait();
+    }
+}
+
+std::vector<ValidationInterfaceQueueStats> CMainSignals::GetQueueStats() {
+    std::vector<ValidationInterfaceQueueStats> vStats;
+    if (!m_internals) return vStats;
+    LOCK(m_internals->m_mutex);
+    for (const auto& p : m_internals->m_active_queues) {
+        const ValidationInterfaceQueue* queue = p.second;
+        ValidationInterfaceQueueStats stats;
+        stats.name = queue->m_name;
+        stats.nPending = const_cast<SingleThreadedSchedulerClient&>(queue->m_client).CallbacksPending();
+        stats.nMaxPending = queue->m_max_pending;
+        stats.nCallbacks = queue->m_callbacks;
+        stats.nAvgLatency = stats.nCallbacks ? queue->m_total_latency / (int64_t)stats.nCallbacks : 0;
+        stats.nMaxLatency = queue->m_max_latency;
+        vStats.push_back(stats);
+    }
+    std::sort(vStats.begin(), vStats.end(), [](const ValidationInterfaceQueueStats& a, const ValidationInterfaceQueueStats& b) { return a.name < b.name; });
+    return vStats;
 }
 
 void CMainSignals::RegisterWithMempoolSignals(CTxMemPool& pool) {
@@ -105,28 +255,23 @@ CMainSignals& GetMainSignals()
     return g_signals;
 }
 
-void RegisterValidationInterface(CValidationInterface* pwalletIn) {
+void RegisterValidationInterface(CValidationInterface* pwalletIn, const std::string& strName) {
+    g_signals.m_internals->AddQueue(pwalletIn, strName);
     ValidationInterfaceConnections& conns = g_signals.m_internals->m_connMainSignals[pwalletIn];
-    conns.UpdatedBlockTip = g_signals.m_internals->UpdatedBlockTip.connect(std::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-    conns.TransactionAddedToMempool = g_signals.m_internals->TransactionAddedToMempool.connect(std::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, std::placeholders::_1));
-    conns.BlockConnected = g_signals.m_internals->BlockConnected.connect(std::bind(&CValidationInterface::BlockConnected, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-    conns.BlockDisconnected = g_signals.m_internals->BlockDisconnected.connect(std::bind(&CValidationInterface::BlockDisconnected, pwalletIn, std::placeholders::_1));
-    conns.TransactionRemovedFromMempool = g_signals.m_internals->TransactionRemovedFromMempool.connect(std::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, std::placeholders::_1));
-    conns.ChainStateFlushed = g_signals.m_internals->ChainStateFlushed.connect(std::bind(&CValidationInterface::ChainStateFlushed, pwalletIn, std::placeholders::_1));
     conns.BlockChecked = g_signals.m_internals->BlockChecked.connect(std::bind(&CValidationInterface::BlockChecked, pwalletIn, std::placeholders::_1, std::placeholders::_2));
     conns.NewPoWValidBlock = g_signals.m_internals->NewPoWValidBlock.connect(std::bind(&CValidationInterface::NewPoWValidBlock, pwalletIn, std::placeholders::_1, std::placeholders::_2));
-    conns.NotifyChainLock = g_signals.m_internals->NotifyChainLock.connect(std::bind(&CValidationInterface::NotifyChainLock, pwalletIn, std::placeholders::_1));
-    conns.NotifyMasternodeListChanged = g_signals.m_internals->NotifyMasternodeListChanged.connect(std::bind(&CValidationInterface::NotifyMasternodeListChanged, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    conns.NotifyMasternodeListChanged = g_signals.m_internals->NotifyMasternodeListChanged.connect(std::bind(&CValidationInterface::NotifyMasternodeListChanged, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
     conns.SyncTransaction = g_signals.m_internals->SyncTransaction.connect(std::bind(&CValidationInterface::SyncTransaction, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
     conns.NotifyGovernanceObject = g_signals.m_internals->NotifyGovernanceObject.connect(std::bind(&CValidationInterface::NotifyGovernanceObject, pwalletIn, std::placeholders::_1));
-    conns.NotifyGovernanceVote = g_signals.m_internals->NotifyGovernanceVote.connect(std::bind(&CValidationInterface::NotifyGovernanceVote, pwalletIn, std::placeholders::_1));
     conns.AcceptedBlockHeader = g_signals.m_internals->AcceptedBlockHeader.connect(std::bind(&CValidationInterface::AcceptedBlockHeader, pwalletIn, std::placeholders::_1));
-    conns.NotifyTransactionLock = g_signals.m_internals->NotifyTransactionLock.connect(std::bind(&CValidationInterface::NotifyTransactionLock, pwalletIn, std::placeholders::_1));
-    conns.NotifyInstantSendDoubleSpendAttempt = g_signals.m_internals->NotifyInstantSendDoubleSpendAttempt.connect(std::bind(&CValidationInterface::NotifyInstantSendDoubleSpendAttempt, pwalletIn, std::placeholders::_1, std::placeholders::_2));
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
     if (g_signals.m_internals) {
+        {
+            LOCK(g_signals.m_internals->m_mutex);
+            g_signals.m_internals->RemoveQueue(pwalletIn);
+        }
         g_signals.m_internals->m_connMainSignals.erase(pwalletIn);
     }
 }
@@ -135,11 +280,27 @@ void UnregisterAllValidationInterfaces() {
     if (!g_signals.m_internals) {
         return;
     }
+    {
+        LOCK(g_signals.m_internals->m_mutex);
+        g_signals.m_internals->RemoveAllQueues();
+    }
     g_signals.m_internals->m_connMainSignals.clear();
 }
 
 void CallFunctionInValidationInterfaceQueue(std::function<void()> func) {
-    g_signals.m_internals->m_schedulerClient.AddToProcessQueue(std::move(func));
+    // Run func once the callbacks queued so far for all listeners are done
+    LOCK(g_signals.m_internals->m_mutex);
+    std::vector<ValidationInterfaceQueue*> vQueues{g_signals.m_internals->m_default_queue};
+    for (const auto& p : g_signals.m_internals->m_active_queues) {
+        vQueues.push_back(p.second);
+    }
+    auto remaining = std::make_shared<std::atomic<size_t>>(vQueues.size());
+    auto shared_func = std::make_shared<std::function<void()>>(std::move(func));
+    for (ValidationInterfaceQueue* queue : vQueues) {
+        queue->AddFunction([remaining, shared_func] {
+            if (--*remaining == 0) (*shared_func)();
+        });
+    }
 }
 
 void SyncWithValidationInterfaceQueue() {
@@ -154,8 +315,8 @@ void SyncWithValidationInterfaceQueue() {
 
 void CMainSignals::MempoolEntryRemoved(CTransactionRef ptx, MemPoolRemovalReason reason) {
     if (reason != MemPoolRemovalReason::BLOCK && reason != MemPoolRemovalReason::CONFLICT) {
-        m_internals->m_schedulerClient.AddToProcessQueue([ptx, this] {
-            m_internals->TransactionRemovedFromMempool(ptx);
+        m_internals->Enqueue([ptx](CValidationInterface& listener) {
+            listener.TransactionRemovedFromMempool(ptx);
         });
     }
 }
@@ -165,32 +326,32 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
     // the chain actually updates. One way to ensure this is for the caller to invoke this signal
     // in the same critical section where the chain is updated
 
-    m_internals->m_schedulerClient.AddToProcessQueue([pindexNew, pindexFork, fInitialDownload, this] {
-        m_internals->UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
+    m_internals->Enqueue([pindexNew, pindexFork, fInitialDownload](CValidationInterface& listener) {
+        listener.UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
     });
 }
 
 void CMainSignals::TransactionAddedToMempool(const CTransactionRef &ptx) {
-    m_internals->m_schedulerClient.AddToProcessQueue([ptx, this] {
-        m_internals->TransactionAddedToMempool(ptx);
+    m_internals->Enqueue([ptx](CValidationInterface& listener) {
+        listener.TransactionAddedToMempool(ptx);
     });
 }
 
 void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindex, const std::shared_ptr<const std::vector<CTransactionRef>>& pvtxConflicted) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pblock, pindex, pvtxConflicted, this] {
-        m_internals->BlockConnected(pblock, pindex, *pvtxConflicted);
+    m_internals->Enqueue([pblock, pindex, pvtxConflicted](CValidationInterface& listener) {
+        listener.BlockConnected(pblock, pindex, *pvtxConflicted);
     });
 }
 
 void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock> &pblock) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pblock, this] {
-        m_internals->BlockDisconnected(pblock);
+    m_internals->Enqueue([pblock](CValidationInterface& listener) {
+        listener.BlockDisconnected(pblock);
     });
 }
 
 void CMainSignals::ChainStateFlushed(const CBlockLocator &locator) {
-    m_internals->m_schedulerClient.AddToProcessQueue([locator, this] {
-        m_internals->ChainStateFlushed(locator);
+    m_internals->Enqueue([locator](CValidationInterface& listener) {
+        listener.ChainStateFlushed(locator);
     });
 }
 
@@ -204,12 +365,14 @@ void CMainSignals::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared
 
 void CMainSignals::NotifyChainLock(const CBlockIndex* pindexChainLock)
 {
-    m_internals->NotifyChainLock(pindexChainLock);
+    m_internals->Enqueue([pindexChainLock](CValidationInterface& listener) {
+        listener.NotifyChainLock(pindexChainLock);
+    });
 }
 
-void CMainSignals::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff)
+void CMainSignals::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNList& newMNList, const CDeterministicMNListDiff& diff)
 {
-    m_internals->NotifyMasternodeListChanged(undo, oldMNList, diff);
+    m_internals->NotifyMasternodeListChanged(undo, oldMNList, newMNList, diff);
 }
 
 void CMainSignals::SyncTransaction(const CTransaction &tx, const CBlockIndex *pindex, int posInBlock)
@@ -224,16 +387,26 @@ void CMainSignals::AcceptedBlockHeader(const CBlockIndex *pindexNew)
 
 void CMainSignals::NotifyTransactionLock(const CTransaction &tx)
 {
-    m_internals->NotifyTransactionLock(tx);
+    CTransactionRef ptx = MakeTransactionRef(tx);
+    m_internals->Enqueue([ptx](CValidationInterface& listener) {
+        listener.NotifyTransactionLock(*ptx);
+    });
 }
+
 void CMainSignals::NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx)
 {
-    m_internals->NotifyInstantSendDoubleSpendAttempt(currentTx, previousTx);
+    CTransactionRef pcurrentTx = MakeTransactionRef(currentTx), ppreviousTx = MakeTransactionRef(previousTx);
+    m_internals->Enqueue([pcurrentTx, ppreviousTx](CValidationInterface& listener) {
+        listener.NotifyInstantSendDoubleSpendAttempt(*pcurrentTx, *ppreviousTx);
+    });
 }
 
 void CMainSignals::NotifyGovernanceVote(const CGovernanceVote &vote)
 {
-    m_internals->NotifyGovernanceVote(vote);
+    auto pvote = std::make_shared<const CGovernanceVote>(vote);
+    m_internals->Enqueue([pvote](CValidationInterface& listener) {
+        listener.NotifyGovernanceVote(*pvote);
+    });
 }
 
 void CMainSignals::NotifyGovernanceObject(const CGovernanceObject &object)
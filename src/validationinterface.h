@@ -11,6 +11,8 @@
 
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 extern CCriticalSection cs_main;
 class CBlock;
@@ -30,15 +32,21 @@ enum class MemPoolRemovalReason;
 
 // These functions dispatch to one or all registered wallets
 
-/** Register a wallet to receive updates from core */
-void RegisterValidationInterface(CValidationInterface* pwalletIn);
+/** Default number of background callbacks a listener may fall behind before block connection waits for it */
+static const size_t DEFAULT_VALIDATION_QUEUE_DEPTH = 10;
+/** Default number of threads running the background callbacks */
+static const int DEFAULT_VALIDATION_THREADS = 2;
+
+/** Register a wallet to receive updates from core, the name identifies its callback queue in the statistics */
+void RegisterValidationInterface(CValidationInterface* pwalletIn, const std::string& strName = "");
 /** Unregister a wallet from core */
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
 void UnregisterAllValidationInterfaces();
 /**
- * Pushes a function to callback onto the notification queue, guaranteeing any
- * callbacks generated prior to now are finished when the function is called.
+ * Pushes a function to callback onto the notification queues, guaranteeing any
+ * callbacks generated prior to now are finished for all listeners when the
+ * function is called.
  *
  * Be very careful blocking on func to be called if any locks are held -
  * validation interface clients may not be able to make progress as they often
@@ -70,7 +78,23 @@ void SyncWithValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main);
  * UpdatedBlockTip() callback may depend on an operation performed in
  * the BlockConnected() callback without worrying about explicit
  * synchronization. No ordering should be assumed across
- * ValidationInterface() subscribers.
+ * ValidationInterface() subscribers: every subscriber has its own queue of
+ * background callbacks, so a slow subscriber does not delay the others.
+ *
+ * The background callbacks of the wallet run concurrently with the ones of
+ * these subscribers, which is safe because none of them takes cs_wallet or
+ * depends on the wallet having seen an event:
+ * - "mnnotification" (CMNNotificationInterface) only takes the locks of the
+ *   masternode sync, the deterministic MN manager and the LLMQ managers. The
+ *   wallet reads InstantSend and ChainLock state through IsLocked() and
+ *   HasChainLock(), which take nothing but the lock of the manager.
+ *   CInstantSendManager updates wallet transactions from its worker thread,
+ *   never from a callback.
+ * - "activemasternode" only takes cs_main and its own lock.
+ * - "txselection" (CBlockTxSelectionCache) only takes its own lock, "zmq" none.
+ * - "peerlogic" takes cs_main and the locks of CConnman.
+ * A subscriber which needs the wallet to have processed the callbacks queued
+ * so far has to wait for them with CallFunctionInValidationInterfaceQueue().
  */
 class CValidationInterface {
 protected:
@@ -147,14 +171,20 @@ protected:
      * Notifies listeners that a block which builds directly on our current tip
      * has been received and connected to the headers tree, though not validated yet */
     virtual void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& block) {};
-    friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend void ::RegisterValidationInterface(CValidationInterface*, const std::string&);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
+    friend class CMainSignals;
 
-    /** Notifies new chain lock block */
+    /**
+     * Notifies new chain lock block
+     *
+     * Called on a background thread.
+     */
     virtual void NotifyChainLock(const CBlockIndex* pindex) {}
-    /** Notifies masternode list changes */
-    virtual void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff) {}
+    /** Notifies masternode list changes, diff turns oldMNList into newMNList (the list of the previous block on undo) */
+    virtual void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNList& newMNList, const CDeterministicMNListDiff& diff) {}
+    /** Called on a background thread. */
     virtual void NotifyGovernanceVote(const CGovernanceVote &vote) {}
     virtual void NotifyGovernanceObject(const CGovernanceObject &object) {}
     /** Notifies listeners of updated transaction data (transaction, and
@@ -166,16 +196,30 @@ protected:
     virtual void SyncTransaction(const CTransaction &tx, const CBlockIndex *pindex, int posInBlock) {}
     virtual void AcceptedBlockHeader(const CBlockIndex *pindexNew) {}
 
+    /** Called on a background thread. */
     virtual void NotifyTransactionLock(const CTransaction &tx) {}
+    /** Called on a background thread. */
     virtual void NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx) {}
 };
 
+/** Statistics of the background callback queue of one listener */
+struct ValidationInterfaceQueueStats {
+    std::string name;
+    size_t nPending;
+    size_t nMaxPending;
+    uint64_t nCallbacks;
+    //! Time from queueing to completion of the callbacks, in microseconds
+    int64_t nAvgLatency;
+    int64_t nMaxLatency;
+};
+
 struct MainSignalsInstance;
 class CMainSignals {
 private:
     std::unique_ptr<MainSignalsInstance> m_internals;
+    size_t m_max_queue_depth{DEFAULT_VALIDATION_QUEUE_DEPTH};
 
-    friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend void ::RegisterValidationInterface(CValidationInterface*, const std::string&);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
     friend void ::CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
@@ -194,7 +238,13 @@ public:
     /** Call any remaining callbacks on the calling thread */
     void FlushBackgroundCallbacks();
 
+    /** Number of background callbacks not run yet, summed over all listeners */
     size_t CallbacksPending();
+    /** Set the number of callbacks a listener may fall behind before LimitQueues waits for it */
+    void SetMaxQueueDepth(size_t nMaxDepth);
+    /** Wait until no listener has more than the max queue depth of callbacks pending */
+    void LimitQueues() LOCKS_EXCLUDED(cs_main);
+    std::vector<ValidationInterfaceQueueStats> GetQueueStats();
 
     /** Register with mempool to call TransactionRemovedFromMempool callbacks */
     void RegisterWithMempoolSignals(CTxMemPool& pool);
@@ -212,8 +262,8 @@ public:
     /** Notifies listeners of a ChainLock. */
     void NotifyChainLock(const CBlockIndex*);
 
-    /** Notifies masternode list changes */
-    void NotifyMasternodeListChanged(bool, const CDeterministicMNList&, const CDeterministicMNListDiff&);
+    /** Notifies masternode list changes, diff turns oldMNList into newMNList (the list of the previous block on undo) */
+    void NotifyMasternodeListChanged(bool, const CDeterministicMNList&, const CDeterministicMNList&, const CDeterministicMNListDiff&);
     void SyncTransaction(const CTransaction &, const CBlockIndex *, int);
     void NotifyGovernanceVote(const CGovernanceVote&);
     void NotifyGovernanceObject(const CGovernanceObject&);
@@ -6,6 +6,7 @@
 #include <wallet/db.h>
 
 #include <util/strencodings.h>
+#include <wallet/ldb.h>
 #include <util/translation.h>
 
 #include <stdint.h>
@@ -71,6 +72,9 @@ static void SplitWalletPath(const fs::path& wallet_path, fs::path& env_directory
 
 bool IsWalletLoaded(const fs::path& wallet_path)
 {
+    if (IsLevelDBWallet(wallet_path)) {
+        return IsLevelDBWalletLoaded(wallet_path);
+    }
     fs::path env_directory;
     std::string database_filename;
     SplitWalletPath(wallet_path, env_directory, database_filename);
@@ -83,6 +87,9 @@ bool IsWalletLoaded(const fs::path& wallet_path)
 
 fs::path WalletDataFilePath(const fs::path& wallet_path)
 {
+    if (IsLevelDBWallet(wallet_path)) {
+        return LevelDBWalletPath(wallet_path);
+    }
     fs::path env_directory;
     std::string database_filename;
     SplitWalletPath(wallet_path, env_directory, database_filename);
@@ -515,7 +522,7 @@ void BerkeleyEnvironment::CheckpointLSN(const std::string& strFile)
 }
 
 
-BerkeleyBatch::BerkeleyBatch(BerkeleyDatabase& database, const char* pszMode, bool fFlushOnCloseIn) : pdb(nullptr), activeTxn(nullptr)
+BerkeleyBatch::BerkeleyBatch(BerkeleyDatabase& database, const char* pszMode, bool fFlushOnCloseIn) : pdb(nullptr), activeTxn(nullptr), m_cursor(nullptr)
 {
     fReadOnly = (!strchr(pszMode, '+') && !strchr(pszMode, 'w'));
     fFlushOnClose = fFlushOnCloseIn;
@@ -609,15 +616,11 @@ void BerkeleyBatch::Flush()
     }
 }
 
-void BerkeleyDatabase::IncrementUpdateCounter()
-{
-    ++nUpdateCounter;
-}
-
 void BerkeleyBatch::Close()
 {
     if (!pdb)
         return;
+    CloseCursor();
     if (activeTxn)
         activeTxn->abort();
     activeTxn = nullptr;
@@ -847,6 +850,11 @@ bool BerkeleyBatch::PeriodicFlush(BerkeleyDatabase& database)
     return ret;
 }
 
+bool BerkeleyDatabase::PeriodicFlush()
+{
+    return BerkeleyBatch::PeriodicFlush(*this);
+}
+
 bool BerkeleyDatabase::Rewrite(const char* pszSkip)
 {
     return BerkeleyBatch::Rewrite(*this, pszSkip);
@@ -918,3 +926,107 @@ void BerkeleyDatabase::ReloadDbEnv()
         env->ReloadDbEnv();
     }
 }
+
+std::unique_ptr<DatabaseBatch> BerkeleyDatabase::MakeBatch(const char* pszMode, bool flush_on_close)
+{
+    return MakeUnique<BerkeleyBatch>(*this, pszMode, flush_on_close);
+}
+
+bool BerkeleyBatch::ReadKey(CDataStream&& key, CDataStream& value)
+{
+    if (!pdb)
+        return false;
+
+    SafeDbt datKey(key.data(), key.size());
+
+    SafeDbt datValue;
+    int ret = pdb->get(activeTxn, datKey, datValue, 0);
+    if (ret == 0 && datValue.get_data() != nullptr) {
+        value.write((char*)datValue.get_data(), datValue.get_size());
+        return true;
+    }
+    return false;
+}
+
+bool BerkeleyBatch::WriteKey(CDataStream&& key, CDataStream&& value, bool overwrite)
+{
+    if (!pdb)
+        return true;
+    if (fReadOnly)
+        assert(!"Write called on database in read-only mode");
+
+    SafeDbt datKey(key.data(), key.size());
+
+    SafeDbt datValue(value.data(), value.size());
+
+    int ret = pdb->put(activeTxn, datKey, datValue, (overwrite ? 0 : DB_NOOVERWRITE));
+    return (ret == 0);
+}
+
+bool BerkeleyBatch::EraseKey(CDataStream&& key)
+{
+    if (!pdb)
+        return false;
+    if (fReadOnly)
+        assert(!"Erase called on database in read-only mode");
+
+    SafeDbt datKey(key.data(), key.size());
+
+    int ret = pdb->del(activeTxn, datKey, 0);
+    return (ret == 0 || ret == DB_NOTFOUND);
+}
+
+bool BerkeleyBatch::HasKey(CDataStream&& key)
+{
+    if (!pdb)
+        return false;
+
+    SafeDbt datKey(key.data(), key.size());
+
+    int ret = pdb->exists(activeTxn, datKey, 0);
+    return ret == 0;
+}
+
+bool BerkeleyBatch::StartCursor()
+{
+    assert(!m_cursor);
+    m_cursor = GetCursor();
+    return m_cursor != nullptr;
+}
+
+bool BerkeleyBatch::ReadAtCursor(CDataStream& ssKey, CDataStream& ssValue, bool& complete)
+{
+    complete = false;
+    if (m_cursor == nullptr) return false;
+    int ret = ReadAtCursor(m_cursor, ssKey, ssValue);
+    if (ret == DB_NOTFOUND) {
+        complete = true;
+    }
+    return ret == 0;
+}
+
+void BerkeleyBatch::CloseCursor()
+{
+    if (!m_cursor) return;
+    m_cursor->close();
+    m_cursor = nullptr;
+}
+
+std::unique_ptr<WalletDatabase> WalletDatabase::Create(const fs::path& path)
+{
+    if (IsLevelDBWallet(path)) {
+        return MakeUnique<LevelDBDatabase>(path);
+    }
+    std::string filename;
+    return MakeUnique<BerkeleyDatabase>(GetWalletEnv(path, filename), std::move(filename));
+}
+
+std::unique_ptr<WalletDatabase> WalletDatabase::CreateDummy()
+{
+    return MakeUnique<BerkeleyDatabase>();
+}
+
+std::unique_ptr<WalletDatabase> WalletDatabase::CreateMock()
+{
+    return MakeUnique<BerkeleyDatabase>(std::make_shared<BerkeleyEnvironment>(), "");
+}
@@ -0,0 +1,363 @@
+// Copyright (c) 2020 The BitCorn Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <wallet/ldb.h>
+
+#include <clientversion.h>
+#include <logging.h>
+#include <util/system.h>
+#include <util/time.h>
+
+#include <set>
+
+#include <string.h>
+
+namespace {
+Mutex g_loaded_mutex;
+//! Paths of the LevelDB wallet databases which are open in this process
+std::set<std::string> g_loaded_wallets GUARDED_BY(g_loaded_mutex);
+
+//! Size of the batches in which records are copied to a backup
+const size_t BACKUP_BATCH_SIZE = 16 << 20;
+
+//! Whether the LevelDB database at path has the version records every wallet has, so it is
+//! an earlier backup which may be replaced
+bool IsWalletBackup(const fs::path& path)
+{
+    if (!fs::is_regular_file(path / "CURRENT")) {
+        return false;
+    }
+    CDBWrapper db(path, WALLET_LDB_CACHE_SIZE);
+    return db.Exists(std::string("minversion")) || db.Exists(std::string("version"));
+}
+} // namespace
+
+fs::path LevelDBWalletPath(const fs::path& wallet_path)
+{
+    return wallet_path / LEVELDB_WALLET_DIR;
+}
+
+bool IsLevelDBWallet(const fs::path& wallet_path)
+{
+    if (fs::is_directory(LevelDBWalletPath(wallet_path))) {
+        return true;
+    }
+    // Berkeley DB wallets keep their format until they are migrated with bitcorn-wallet
+    if (fs::is_regular_file(wallet_path) || fs::exists(wallet_path / "wallet.dat")) {
+        return false;
+    }
+    return gArgs.GetArg("-walletbackend", DEFAULT_WALLET_BACKEND) == "leveldb";
+}
+
+bool IsLevelDBWalletLoaded(const fs::path& wallet_path)
+{
+    LOCK(g_loaded_mutex);
+    return g_loaded_wallets.count(LevelDBWalletPath(wallet_path).string()) != 0;
+}
+
+LevelDBDatabase::LevelDBDatabase(const fs::path& wallet_path, bool in_memory) :
+    WalletDatabase(), m_path(LevelDBWalletPath(wallet_path)), m_in_memory(in_memory)
+{
+}
+
+LevelDBDatabase::~LevelDBDatabase()
+{
+    LOCK(m_mutex);
+    if (m_db && !m_in_memory) {
+        LOCK(g_loaded_mutex);
+        g_loaded_wallets.erase(m_path.string());
+    }
+}
+
+bool LevelDBDatabase::Verify(const fs::path& wallet_path, std::string& errorStr)
+{
+    const fs::path path = LevelDBWalletPath(wallet_path);
+    if (!fs::exists(path)) {
+        return true;
+    }
+    try {
+        CDBWrapper db(path, WALLET_LDB_CACHE_SIZE);
+    } catch (const std::runtime_error& e) {
+        errorStr = strprintf("Error loading wallet database %s: %s", path.string(), e.what());
+        return false;
+    }
+    return true;
+}
+
+CDBWrapper& LevelDBDatabase::Open()
+{
+    LOCK(m_mutex);
+    if (!m_db) {
+        m_db = MakeUnique<CDBWrapper>(m_path, WALLET_LDB_CACHE_SIZE, m_in_memory, false /* wipe */, false /* obfuscate */);
+        if (!m_in_memory) {
+            LOCK(g_loaded_mutex);
+            g_loaded_wallets.insert(m_path.string());
+        }
+    }
+    return *m_db;
+}
+
+bool LevelDBDatabase::Rewrite(const char* pszSkip)
+{
+    CDBWrapper& db = Open();
+    LogPrintf("LevelDBDatabase::Rewrite: Rewriting %s...\n", m_path.string());
+
+    CDBBatch batch(db);
+    if (pszSkip) {
+        const size_t nSkipSize = strlen(pszSkip);
+        CDataStream ssPrefix(pszSkip, pszSkip + nSkipSize, SER_DISK, CLIENT_VERSION);
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        for (pcursor->Seek(ssPrefix); pcursor->Valid(); pcursor->Next()) {
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            pcursor->GetKeyStream(ssKey);
+            if (ssKey.size() < nSkipSize || memcmp(ssKey.data(), pszSkip, nSkipSize) != 0) break;
+            batch.Erase(ssKey);
+        }
+    }
+    // Same as the Berkeley DB rewrite, which updates the version on the way
+    batch.Write(std::string("version"), CLIENT_VERSION);
+    if (!db.WriteBatch(batch, true)) {
+        LogPrintf("LevelDBDatabase::Rewrite: Failed to rewrite database %s\n", m_path.string());
+        return false;
+    }
+
+    // Erased and overwritten records stay in the log and the table files until they are
+    // compacted, which also matters for keys which were replaced by encrypted ones
+    db.CompactFull();
+    return true;
+}
+
+bool LevelDBDatabase::Backup(const std::string& strDest)
+{
+    CDBWrapper& db = Open();
+
+    fs::path pathDest(strDest);
+    if (fs::is_directory(pathDest) && !fs::exists(pathDest / "CURRENT")) {
+        pathDest = LevelDBWalletPath(pathDest);
+    }
+
+    try {
+        if (fs::exists(pathDest)) {
+            if (fs::equivalent(m_path, pathDest)) {
+                LogPrintf("cannot backup to wallet source database %s\n", pathDest.string());
+                return false;
+            }
+            // Only a wallet backup is replaced, the destination could as well be the block
+            // index or the chainstate
+            if (!(fs::is_directory(pathDest) && fs::is_empty(pathDest)) && !IsWalletBackup(pathDest)) {
+                LogPrintf("cannot backup to %s, which exists and is not a wallet backup\n", pathDest.string());
+                return false;
+            }
+        }
+
+        int64_t nStart = GetTimeMillis();
+        size_t nRecords = 0;
+        // Wipe an earlier backup at the same place, the same as overwriting a backup file
+        CDBWrapper dbDest(pathDest, WALLET_LDB_CACHE_SIZE, false /* in memory */, true /* wipe */);
+        CDBBatch batch(dbDest);
+        // The iterator reads from an implicit snapshot, so this is a consistent copy even
+        // while the wallet keeps writing
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next()) {
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            pcursor->GetKeyStream(ssKey);
+            pcursor->GetValueStream(ssValue);
+            batch.Write(ssKey, ssValue);
+            nRecords++;
+            if (batch.SizeEstimate() > BACKUP_BATCH_SIZE) {
+                dbDest.WriteBatch(batch);
+                batch.Clear();
+            }
+        }
+        dbDest.WriteBatch(batch, true);
+        LogPrintf("copied %u records of %s to %s in %dms\n", nRecords, m_path.string(), pathDest.string(), GetTimeMillis() - nStart);
+        return true;
+    } catch (const std::runtime_error& e) {
+        LogPrintf("error copying %s to %s - %s\n", m_path.string(), pathDest.string(), e.what());
+        return false;
+    }
+}
+
+void LevelDBDatabase::Flush(bool shutdown)
+{
+    LOCK(m_mutex);
+    if (m_db) {
+        LogPrint(BCLog::DB, "LevelDBDatabase::Flush: [%s] Flush(%s)\n", m_path.string(), shutdown ? "true" : "false");
+        m_db->Sync();
+    }
+}
+
+bool LevelDBDatabase::PeriodicFlush()
+{
+    LOCK(m_mutex);
+    if (!m_db) {
+        return false;
+    }
+    int64_t nStart = GetTimeMillis();
+    m_db->Sync();
+    LogPrint(BCLog::DB, "Flushed %s %dms\n", m_path.string(), GetTimeMillis() - nStart);
+    return true;
+}
+
+std::unique_ptr<DatabaseBatch> LevelDBDatabase::MakeBatch(const char* pszMode, bool flush_on_close)
+{
+    return MakeUnique<LevelDBBatch>(*this, pszMode, flush_on_close);
+}
+
+LevelDBBatch::LevelDBBatch(LevelDBDatabase& database, const char* pszMode, bool flush_on_close) :
+    m_db(database.Open()),
+    m_read_only(!strchr(pszMode, '+') && !strchr(pszMode, 'w')),
+    m_flush_on_close(flush_on_close)
+{
+}
+
+bool LevelDBBatch::ReadKey(CDataStream&& key, CDataStream& value)
+{
+    if (m_txn_active) {
+        auto it = m_txn_writes.find(CSerializeData(key.begin(), key.end()));
+        if (it != m_txn_writes.end()) {
+            if (!it->second) return false;
+            value.write(it->second->data(), it->second->size());
+            return true;
+        }
+    }
+    return m_db.ReadDataStream(key, value);
+}
+
+bool LevelDBBatch::WriteKey(CDataStream&& key, CDataStream&& value, bool overwrite)
+{
+    if (m_read_only)
+        assert(!"Write called on database in read-only mode");
+
+    if (!overwrite && HasKey(CDataStream(key))) {
+        return false;
+    }
+    if (m_txn_active) {
+        m_txn_writes[CSerializeData(key.begin(), key.end())] = CSerializeData(value.begin(), value.end());
+        return true;
+    }
+    CDBBatch batch(m_db);
+    batch.Write(key, value);
+    m_dirty = true;
+    return m_db.WriteBatch(batch);
+}
+
+bool LevelDBBatch::EraseKey(CDataStream&& key)
+{
+    if (m_read_only)
+        assert(!"Erase called on database in read-only mode");
+
+    if (m_txn_active) {
+        m_txn_writes[CSerializeData(key.begin(), key.end())] = nullopt;
+        return true;
+    }
+    CDBBatch batch(m_db);
+    batch.Erase(key);
+    m_dirty = true;
+    return m_db.WriteBatch(batch);
+}
+
+bool LevelDBBatch::HasKey(CDataStream&& key)
+{
+    if (m_txn_active) {
+        auto it = m_txn_writes.find(CSerializeData(key.begin(), key.end()));
+        if (it != m_txn_writes.end()) {
+            return bool(it->second);
+        }
+    }
+    return m_db.Exists(key);
+}
+
+void LevelDBBatch::Flush()
+{
+    if (m_txn_active || !m_dirty)
+        return;
+
+    // Sync the log, the records themselves are written out by LevelDB's compactions
+    m_db.Sync();
+    m_dirty = false;
+}
+
+void LevelDBBatch::Close()
+{
+    CloseCursor();
+    if (m_txn_active) {
+        TxnAbort();
+    }
+    if (m_flush_on_close) {
+        Flush();
+    }
+}
+
+bool LevelDBBatch::StartCursor()
+{
+    assert(!m_cursor);
+    m_cursor.reset(m_db.NewIterator());
+    m_cursor->SeekToFirst();
+    return true;
+}
+
+bool LevelDBBatch::ReadAtCursor(CDataStream& ssKey, CDataStream& ssValue, bool& complete)
+{
+    complete = false;
+    if (!m_cursor) return false;
+    if (!m_cursor->Valid()) {
+        complete = true;
+        return false;
+    }
+
+    ssKey.SetType(SER_DISK);
+    ssKey.clear();
+    m_cursor->GetKeyStream(ssKey);
+    ssValue.SetType(SER_DISK);
+    ssValue.clear();
+    m_cursor->GetValueStream(ssValue);
+    m_cursor->Next();
+    return true;
+}
+
+void LevelDBBatch::CloseCursor()
+{
+    m_cursor.reset();
+}
+
+bool LevelDBBatch::TxnBegin()
+{
+    if (m_txn_active)
+        return false;
+    m_txn_active = true;
+    return true;
+}
+
+bool LevelDBBatch::TxnCommit()
+{
+    if (!m_txn_active)
+        return false;
+    m_txn_active = false;
+
+    CDBBatch batch(m_db);
+    for (const auto& write : m_txn_writes) {
+        CDataStream ssKey(write.first, SER_DISK, CLIENT_VERSION);
+        if (write.second) {
+            batch.Write(ssKey, CDataStream(*write.second, SER_DISK, CLIENT_VERSION));
+        } else {
+            batch.Erase(ssKey);
+        }
+    }
+    m_txn_writes.clear();
+    if (batch.SizeEstimate() == 0)
+        return true;
+    m_dirty = true;
+    return m_db.WriteBatch(batch);
+}
+
+bool LevelDBBatch::TxnAbort()
+{
+    if (!m_txn_active)
+        return false;
+    m_txn_active = false;
+    m_txn_writes.clear();
+    return true;
+}
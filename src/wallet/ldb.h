@@ -0,0 +1,121 @@
+// Copyright (c) 2020 The BitCorn Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCORN_WALLET_LDB_H
+#define BITCORN_WALLET_LDB_H
+
+#include <dbwrapper.h>
+#include <fs.h>
+#include <optional.h>
+#include <streams.h>
+#include <sync.h>
+#include <wallet/db.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+static const char* const DEFAULT_WALLET_BACKEND = "bdb";
+//! Name of the LevelDB database directory inside a wallet directory
+static const char* const LEVELDB_WALLET_DIR = "wallet.ldb";
+//! Cache of a LevelDB wallet database, half of it for blocks and a quarter for the write buffer
+static const size_t WALLET_LDB_CACHE_SIZE = 8 << 20;
+
+/** Given a wallet directory path, return the path of its LevelDB database. */
+fs::path LevelDBWalletPath(const fs::path& wallet_path);
+
+/** Return whether the wallet at wallet_path is stored in LevelDB. Existing wallets keep
+ * their format, new wallets are created in the format selected by -walletbackend. */
+bool IsLevelDBWallet(const fs::path& wallet_path);
+
+/** Return whether a LevelDB wallet database is currently loaded. */
+bool IsLevelDBWalletLoaded(const fs::path& wallet_path);
+
+/**
+ * A wallet database stored in LevelDB. Every write goes to the LevelDB log first, so
+ * there are no checkpoints which rewrite the whole wallet file: a flush only syncs the
+ * log, and the records are compacted into sorted tables in the background. It is about
+ * the cost of writes: loading a wallet still reads every record into memory, as with
+ * Berkeley DB.
+ *
+ * The database is opened by the first batch, so a wallet can be verified without
+ * creating it.
+ */
+class LevelDBDatabase : public WalletDatabase
+{
+public:
+    explicit LevelDBDatabase(const fs::path& wallet_path, bool in_memory = false);
+    ~LevelDBDatabase() override;
+
+    /** Check that the LevelDB database of wallet_path can be opened, if it exists. */
+    static bool Verify(const fs::path& wallet_path, std::string& errorStr);
+
+    /** Erase the records with the prefix pszSkip if non-zero, then compact the database
+     * so no copies of erased records are left in its files.
+     */
+    bool Rewrite(const char* pszSkip=nullptr) override;
+
+    /** Copy the records to a new LevelDB database at strDest. If that is an existing
+     * directory the database is created inside of it. An existing database is only
+     * replaced if it is a wallet database, i.e. an earlier backup.
+     */
+    bool Backup(const std::string& strDest) override;
+
+    void Flush(bool shutdown) override;
+    bool PeriodicFlush() override;
+
+    /** Nothing to reload, LevelDB has no shared environment */
+    void ReloadDbEnv() override {}
+
+    std::unique_ptr<DatabaseBatch> MakeBatch(const char* pszMode = "r+", bool flush_on_close = true) override;
+
+    /** Open the database if that did not happen yet */
+    CDBWrapper& Open();
+
+private:
+    const fs::path m_path;
+    const bool m_in_memory;
+
+    Mutex m_mutex;
+    std::unique_ptr<CDBWrapper> m_db GUARDED_BY(m_mutex);
+};
+
+/** RAII class that provides access to a LevelDB wallet database */
+class LevelDBBatch : public DatabaseBatch
+{
+private:
+    CDBWrapper& m_db;
+    const bool m_read_only;
+    const bool m_flush_on_close;
+    //! Whether this batch wrote something which was not synced yet
+    bool m_dirty{false};
+
+    std::unique_ptr<CDBIterator> m_cursor;
+
+    //! Records written by the active transaction, erased records have no value. They are
+    //! written in a single LevelDB batch on commit.
+    bool m_txn_active{false};
+    std::map<CSerializeData, Optional<CSerializeData>> m_txn_writes;
+
+    bool ReadKey(CDataStream&& key, CDataStream& value) override;
+    bool WriteKey(CDataStream&& key, CDataStream&& value, bool overwrite = true) override;
+    bool EraseKey(CDataStream&& key) override;
+    bool HasKey(CDataStream&& key) override;
+
+public:
+    explicit LevelDBBatch(LevelDBDatabase& database, const char* pszMode = "r+", bool flush_on_close = true);
+    ~LevelDBBatch() override { Close(); }
+
+    void Flush() override;
+    void Close() override;
+
+    bool StartCursor() override;
+    bool ReadAtCursor(CDataStream& ssKey, CDataStream& ssValue, bool& complete) override;
+    void CloseCursor() override;
+    bool TxnBegin() override;
+    bool TxnCommit() override;
+    bool TxnAbort() override;
+};
+
+#endif // BITCORN_WALLET_LDB_H
@@ -2463,6 +2463,9 @@ static UniValue getwalletinfo(const JSONRPCRequest& request)
             "    {\n"
             "      \"duration\" : xxxx              (numeric) elapsed seconds since scan start\n"
             "      \"progress\" : x.xxxx,           (numeric) scanning progress percentage [0.0, 1.0]\n"
+            "      \"blocks\" : xxxx,                (numeric) number of blocks scanned so far\n"
+            "      \"skipped\" : xxxx,               (numeric) number of blocks skipped because their block filter didn't match the wallet (only with -blockfilterindex)\n"
+            "      \"blocks_per_second\" : x.xx,     (numeric) average number of blocks scanned per second\n"
             "    }\n"
             "}\n"
                 },
@@ -2509,6 +2512,11 @@ static UniValue getwalletinfo(const JSONRPCRequest& request)
         UniValue scanning(UniValue::VOBJ);
         scanning.pushKV("duration", pwallet->ScanningDuration() / 1000);
         scanning.pushKV("progress", pwallet->ScanningProgress());
+        const int64_t scanning_millis = pwallet->ScanningDuration();
+        const int64_t scanning_blocks = pwallet->ScanningBlocks();
+        scanning.pushKV("blocks", scanning_blocks);
+        scanning.pushKV("skipped", pwallet->ScanningSkippedBlocks());
+        scanning.pushKV("blocks_per_second", scanning_millis > 0 ? scanning_blocks * 1000.0 / scanning_millis : 0.0);
         obj.pushKV("scanning", scanning);
     } else {
         obj.pushKV("scanning", false);
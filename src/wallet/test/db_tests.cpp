@@ -2,13 +2,18 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <algorithm>
 #include <memory>
 
 #include <boost/test/unit_test.hpp>
 
 #include <fs.h>
+#include <interfaces/chain.h>
 #include <test/setup_common.h>
 #include <wallet/db.h>
+#include <wallet/ldb.h>
+#include <wallet/wallet.h>
+#include <wallet/walletutil.h>
 
 
 BOOST_FIXTURE_TEST_SUITE(db_tests, BasicTestingSetup)
@@ -69,4 +74,196 @@ BOOST_AUTO_TEST_CASE(getwalletenv_g_dbenvs_free_instance)
     BOOST_CHECK(env_2_a == env_2_b);
 }
 
+BOOST_AUTO_TEST_CASE(leveldb_batch)
+{
+    LevelDBDatabase database(GetDataDir() / "ldb");
+    BOOST_CHECK(!IsLevelDBWalletLoaded(GetDataDir() / "ldb"));
+    std::string value;
+    {
+        std::unique_ptr<DatabaseBatch> batch = database.MakeBatch();
+        BOOST_CHECK(IsLevelDBWalletLoaded(GetDataDir() / "ldb"));
+        BOOST_CHECK(batch->Write(std::string("a"), std::string("1")));
+        BOOST_CHECK(batch->Write(std::string("b"), std::string("2")));
+        BOOST_CHECK(!batch->Write(std::string("b"), std::string("3"), false /* overwrite */));
+        BOOST_CHECK(batch->Read(std::string("b"), value) && value == "2");
+
+        // Transactions read their own writes and are applied on commit only
+        BOOST_CHECK(batch->TxnBegin());
+        BOOST_CHECK(batch->Erase(std::string("a")));
+        BOOST_CHECK(batch->Write(std::string("c"), std::string("3")));
+        BOOST_CHECK(!batch->Exists(std::string("a")));
+        BOOST_CHECK(batch->Read(std::string("c"), value) && value == "3");
+        BOOST_CHECK(batch->TxnAbort());
+        BOOST_CHECK(batch->Exists(std::string("a")));
+        BOOST_CHECK(!batch->Exists(std::string("c")));
+
+        BOOST_CHECK(batch->TxnBegin());
+        BOOST_CHECK(batch->Erase(std::string("a")));
+        BOOST_CHECK(batch->Write(std::string("c"), std::string("3")));
+        BOOST_CHECK(batch->TxnCommit());
+    }
+
+    // The cursor returns the records in key order
+    std::unique_ptr<DatabaseBatch> batch = database.MakeBatch("r");
+    BOOST_CHECK(batch->StartCursor());
+    std::vector<std::string> keys;
+    while (true) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        bool complete;
+        bool ret = batch->ReadAtCursor(ssKey, ssValue, complete);
+        if (complete) break;
+        BOOST_CHECK(ret);
+        std::string key;
+        ssKey >> key;
+        keys.push_back(key);
+    }
+    batch->CloseCursor();
+    BOOST_CHECK(keys == std::vector<std::string>({"b", "c"}));
+
+    // Rewrite drops the records with the skipped prefix
+    batch.reset();
+    BOOST_CHECK(database.Rewrite("\x01" "b"));
+    batch = database.MakeBatch("r");
+    BOOST_CHECK(!batch->Exists(std::string("b")));
+    BOOST_CHECK(batch->Read(std::string("c"), value) && value == "3");
+}
+
+BOOST_AUTO_TEST_CASE(leveldb_backup)
+{
+    LevelDBDatabase database(GetDataDir() / "ldb");
+    {
+        std::unique_ptr<DatabaseBatch> batch = database.MakeBatch();
+        BOOST_CHECK(batch->Write(std::string("minversion"), 1));
+        BOOST_CHECK(batch->Write(std::string("a"), std::string("1")));
+    }
+
+    const fs::path backup_path = GetDataDir() / "backup";
+    BOOST_CHECK(database.Backup(backup_path.string()));
+    {
+        CDBWrapper backup(backup_path, 1 << 20);
+        std::string value;
+        BOOST_CHECK(backup.Read(std::string("a"), value) && value == "1");
+    }
+    // An earlier backup is replaced
+    {
+        std::unique_ptr<DatabaseBatch> batch = database.MakeBatch();
+        BOOST_CHECK(batch->Erase(std::string("a")));
+    }
+    BOOST_CHECK(database.Backup(backup_path.string()));
+    {
+        CDBWrapper backup(backup_path, 1 << 20);
+        BOOST_CHECK(backup.Exists(std::string("minversion")));
+        BOOST_CHECK(!backup.Exists(std::string("a")));
+    }
+
+    // Any other LevelDB database is left alone
+    const fs::path other_path = GetDataDir() / "chainstate";
+    {
+        CDBWrapper other(other_path, 1 << 20);
+        BOOST_CHECK(other.Write(std::string("b"), std::string("2"), true));
+    }
+    BOOST_CHECK(!database.Backup(other_path.string()));
+    {
+        CDBWrapper other(other_path, 1 << 20);
+        BOOST_CHECK(other.Exists(std::string("b")));
+        BOOST_CHECK(!other.Exists(std::string("minversion")));
+    }
+
+    // and so is a file
+    const fs::path file_path = GetDataDir() / "file";
+    std::ofstream f(file_path.BOOST_FILESYSTEM_C_STR);
+    f << "data";
+    f.close();
+    BOOST_CHECK(!database.Backup(file_path.string()));
+    BOOST_CHECK_EQUAL(fs::file_size(file_path), 4U);
+
+    // The source itself can't be the destination
+    BOOST_CHECK(!database.Backup((GetDataDir() / "ldb").string()));
+}
+
+BOOST_FIXTURE_TEST_CASE(leveldb_wallet, TestingSetup)
+{
+    const fs::path wallet_path = GetWalletDir() / "ldb_wallet";
+    fs::create_directories(wallet_path);
+    std::unique_ptr<interfaces::Chain> chain = interfaces::MakeChain();
+    auto make_wallet = [&] {
+        return MakeUnique<CWallet>(chain.get(), WalletLocation("ldb_wallet"), MakeUnique<LevelDBDatabase>(wallet_path));
+    };
+
+    CKey key;
+    key.MakeNewKey(true);
+    const CTxDestination dest = PKHash(key.GetPubKey());
+    uint256 txid;
+    {
+        std::unique_ptr<CWallet> wallet = make_wallet();
+        bool first_run;
+        BOOST_CHECK(wallet->LoadWallet(first_run) == DBErrors::LOAD_OK);
+        BOOST_CHECK(first_run);
+        {
+            LOCK(wallet->cs_wallet);
+            BOOST_CHECK(wallet->AddKeyPubKey(key, key.GetPubKey()));
+        }
+        BOOST_CHECK(wallet->SetAddressBook(dest, "label", "receive"));
+        CMutableTransaction mtx;
+        mtx.vout.emplace_back(COIN, GetScriptForDestination(dest));
+        CWalletTx wtx(wallet.get(), MakeTransactionRef(mtx));
+        txid = wtx.GetHash();
+        BOOST_CHECK(wallet->AddToWallet(wtx));
+    }
+    BOOST_CHECK(fs::is_directory(LevelDBWalletPath(wallet_path)));
+    BOOST_CHECK(!fs::exists(wallet_path / "wallet.dat"));
+
+    // WalletBatch::LoadWallet reads back what was written
+    {
+        std::unique_ptr<CWallet> wallet = make_wallet();
+        bool first_run;
+        BOOST_CHECK(wallet->LoadWallet(first_run) == DBErrors::LOAD_OK);
+        BOOST_CHECK(!first_run);
+        LOCK(wallet->cs_wallet);
+        BOOST_CHECK(wallet->HaveKey(key.GetPubKey().GetID()));
+        BOOST_CHECK(wallet->mapWallet.count(txid));
+        BOOST_CHECK(wallet->mapAddressBook.count(dest) && wallet->mapAddressBook.at(dest).name == "label");
+
+        // Encrypting the wallet rewrites the database
+        BOOST_CHECK(wallet->EncryptWallet("passphrase"));
+    }
+
+    // Only the encrypted key is left in the database
+    {
+        LevelDBDatabase database(wallet_path);
+        std::unique_ptr<DatabaseBatch> batch = database.MakeBatch("r");
+        BOOST_CHECK(batch->StartCursor());
+        size_t nCryptedKeys = 0;
+        while (true) {
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            bool complete;
+            bool ret = batch->ReadAtCursor(ssKey, ssValue, complete);
+            if (complete) break;
+            BOOST_CHECK(ret);
+            std::string strType;
+            ssKey >> strType;
+            BOOST_CHECK(strType != "key");
+            if (strType == "ckey") nCryptedKeys++;
+        }
+        batch->CloseCursor();
+        BOOST_CHECK(nCryptedKeys > 0);
+    }
+    {
+        std::unique_ptr<CWallet> wallet = make_wallet();
+        bool first_run;
+        BOOST_CHECK(wallet->LoadWallet(first_run) == DBErrors::LOAD_OK);
+        BOOST_CHECK(wallet->IsCrypted());
+        BOOST_CHECK(wallet->Unlock("passphrase"));
+        CKey keyOut;
+        BOOST_CHECK(wallet->GetKey(key.GetPubKey().GetID(), keyOut) && keyOut == key);
+    }
+
+    // ListWalletDir lists the directory of the LevelDB database as a wallet
+    const std::vector<fs::path> paths = ListWalletDir();
+    BOOST_CHECK(std::find(paths.begin(), paths.end(), fs::path("ldb_wallet")) != paths.end());
+    BOOST_CHECK(std::find(paths.begin(), paths.end(), fs::path("ldb_wallet") / LEVELDB_WALLET_DIR) == paths.end());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
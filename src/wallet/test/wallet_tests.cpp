@@ -4,14 +4,19 @@
 
 #include <wallet/wallet.h>
 
+#include <map>
 #include <memory>
 #include <stdint.h>
+#include <thread>
 #include <vector>
 
+#include <chainparams.h>
 #include <consensus/validation.h>
+#include <index/blockfilterindex.h>
 #include <interfaces/chain.h>
 #include <policy/policy.h>
 #include <rpc/server.h>
+#include <script/interpreter.h>
 #include <test/setup_common.h>
 #include <validation.h>
 #include <wallet/coincontrol.h>
@@ -111,6 +116,162 @@ BOOST_FIXTURE_TEST_CASE(scan_for_wallet_transactions, TestChain100Setup)
     }
 }
 
+//! Scan the active chain from the genesis block with -rescanthreads set to threads, skipped
+//! is set to the number of blocks skipped by their block filter
+static CWallet::ScanResult RescanWallet(CWallet& wallet, int threads, int64_t& skipped, const uint256& stop_block = uint256())
+{
+    gArgs.ForceSetArg("-rescanthreads", std::to_string(threads));
+    WalletRescanReserver reserver(&wallet);
+    reserver.reserve();
+    CWallet::ScanResult result = wallet.ScanForWalletTransactions(::ChainActive().Genesis()->GetBlockHash(), stop_block, reserver, false /* update */);
+    skipped = wallet.ScanningSkippedBlocks();
+    gArgs.ForceSetArg("-rescanthreads", std::to_string(DEFAULT_RESCAN_THREADS));
+    return result;
+}
+
+//! The transactions of the wallet and the blocks they are in
+static std::map<uint256, uint256> WalletTxBlocks(CWallet& wallet)
+{
+    LOCK(wallet.cs_wallet);
+    std::map<uint256, uint256> txs;
+    for (const auto& entry : wallet.mapWallet) {
+        txs.emplace(entry.first, entry.second.hashBlock);
+    }
+    return txs;
+}
+
+// Reading blocks ahead of the scanner finds the same transactions as reading them one by
+// one, also when blocks are connected while the scan runs
+BOOST_FIXTURE_TEST_CASE(rescan_prefetch, TestChain100Setup)
+{
+    for (int i = 0; i < 100; i++) {
+        CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    }
+    const int initial_height = WITH_LOCK(cs_main, return ::ChainActive().Height());
+
+    auto chain = interfaces::MakeChain();
+    CWallet wallet_prefetch(chain.get(), WalletLocation(), WalletDatabase::CreateMock());
+    AddKey(wallet_prefetch, coinbaseKey);
+
+    // The tip moves once the scan found the first transaction
+    std::thread miner;
+    boost::signals2::scoped_connection connection = wallet_prefetch.NotifyTransactionChanged.connect([&](CWallet*, const uint256&, ChangeType) {
+        if (miner.joinable()) return;
+        miner = std::thread([this] {
+            for (int i = 0; i < 10; i++) {
+                CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+            }
+        });
+    });
+    int64_t skipped;
+    const CWallet::ScanResult result = RescanWallet(wallet_prefetch, DEFAULT_RESCAN_THREADS, skipped);
+    BOOST_REQUIRE(miner.joinable());
+    miner.join();
+    connection.disconnect();
+
+    BOOST_CHECK_EQUAL(result.status, CWallet::ScanResult::SUCCESS);
+    BOOST_CHECK(result.last_failed_block.IsNull());
+    BOOST_REQUIRE(result.last_scanned_height);
+    BOOST_CHECK_GE(*result.last_scanned_height, initial_height);
+    BOOST_CHECK_EQUAL(skipped, 0);
+
+    // The same blocks scanned without prefetching
+    CWallet wallet(chain.get(), WalletLocation(), WalletDatabase::CreateMock());
+    AddKey(wallet, coinbaseKey);
+    const CWallet::ScanResult result_no_prefetch = RescanWallet(wallet, 0 /* threads */, skipped, result.last_scanned_block);
+    BOOST_CHECK_EQUAL(result_no_prefetch.status, CWallet::ScanResult::SUCCESS);
+    BOOST_CHECK(result_no_prefetch.last_scanned_block == result.last_scanned_block);
+    BOOST_CHECK_EQUAL(*result_no_prefetch.last_scanned_height, *result.last_scanned_height);
+    BOOST_CHECK(WalletTxBlocks(wallet) == WalletTxBlocks(wallet_prefetch));
+    BOOST_CHECK_EQUAL(WalletTxBlocks(wallet).size(), (size_t)*result.last_scanned_height);
+
+    // and the rest of them
+    const CWallet::ScanResult result_tip = RescanWallet(wallet_prefetch, DEFAULT_RESCAN_THREADS, skipped);
+    BOOST_CHECK_EQUAL(*result_tip.last_scanned_height, initial_height + 10);
+    BOOST_CHECK_EQUAL(WalletTxBlocks(wallet_prefetch).size(), (size_t)initial_height + 10);
+}
+
+//! A wallet with the HD seed key and a keypool of -keypool keys
+static std::unique_ptr<CWallet> MakeHDWallet(interfaces::Chain& chain, const CKey& key)
+{
+    auto wallet = MakeUnique<CWallet>(&chain, WalletLocation(), WalletDatabase::CreateMock());
+    bool first_run;
+    BOOST_CHECK(wallet->LoadWallet(first_run) == DBErrors::LOAD_OK);
+    wallet->SetMinVersion(FEATURE_LATEST);
+    wallet->SetHDSeed(wallet->DeriveNewSeed(key));
+    BOOST_CHECK(wallet->TopUpKeyPool());
+    return wallet;
+}
+
+// With a block filter index blocks which can't contain wallet transactions are skipped, and
+// blocks skipped before a keypool top-up are matched again with the new keys
+BOOST_FIXTURE_TEST_CASE(rescan_block_filter, TestChain100Setup)
+{
+    gArgs.ForceSetArg("-keypool", "2");
+    auto chain = interfaces::MakeChain();
+    CKey seed_key;
+    seed_key.MakeNewKey(true);
+
+    // The first four receiving keys of every wallet with this seed
+    std::vector<CScript> scripts;
+    {
+        std::unique_ptr<CWallet> wallet = MakeHDWallet(*chain, seed_key);
+        for (int i = 0; i < 4; i++) {
+            CTxDestination dest;
+            std::string error;
+            BOOST_CHECK(wallet->GetNewDestination(OutputType::LEGACY, "", dest, error));
+            scripts.push_back(GetScriptForDestination(dest));
+        }
+    }
+
+    // The second key is in the keypool of a new wallet, using it tops the keypool up with
+    // the third and the fourth key
+    CScript script_foreign = GetScriptForRawPubKey(coinbaseKey.GetPubKey());
+    for (int i = 0; i < 5; i++) CreateAndProcessBlock({}, script_foreign);
+    const CBlock block_key1 = CreateAndProcessBlock({}, scripts[1]);
+    for (int i = 0; i < 5; i++) CreateAndProcessBlock({}, script_foreign);
+    const CBlock block_key3 = CreateAndProcessBlock({}, scripts[3]);
+    for (int i = 0; i < 5; i++) CreateAndProcessBlock({}, script_foreign);
+    const int tip_height = WITH_LOCK(cs_main, return ::ChainActive().Height());
+
+    // Without the index every block is read
+    std::unique_ptr<CWallet> wallet = MakeHDWallet(*chain, seed_key);
+    int64_t skipped;
+    CWallet::ScanResult result = RescanWallet(*wallet, 0 /* threads */, skipped);
+    BOOST_CHECK_EQUAL(result.status, CWallet::ScanResult::SUCCESS);
+    BOOST_CHECK_EQUAL(skipped, 0);
+    const std::map<uint256, uint256> txs = WalletTxBlocks(*wallet);
+    BOOST_CHECK_EQUAL(txs.size(), 2U);
+    BOOST_CHECK(txs.count(block_key1.vtx[0]->GetHash()));
+    BOOST_CHECK(txs.count(block_key3.vtx[0]->GetHash()));
+
+    BOOST_REQUIRE(InitBlockFilterIndex(BlockFilterType::BASIC, 1 << 20, true /* in memory */, false /* wipe */));
+    BlockFilterIndex* filter_index = GetBlockFilterIndex(BlockFilterType::BASIC);
+    filter_index->Start();
+    for (int i = 0; i < 100 && !filter_index->BlockUntilSyncedToCurrentChain(); i++) {
+        MilliSleep(100);
+    }
+    BOOST_REQUIRE(filter_index->BlockUntilSyncedToCurrentChain());
+
+    // With it, on the scanning thread and read ahead
+    for (int threads : {0, DEFAULT_RESCAN_THREADS}) {
+        std::unique_ptr<CWallet> wallet_filter = MakeHDWallet(*chain, seed_key);
+        result = RescanWallet(*wallet_filter, threads, skipped);
+        BOOST_CHECK_EQUAL(result.status, CWallet::ScanResult::SUCCESS);
+        BOOST_CHECK_EQUAL(*result.last_scanned_height, tip_height);
+        BOOST_CHECK(WalletTxBlocks(*wallet_filter) == txs);
+        // All but the two blocks paying to the wallet, leaving some room for false positives
+        // of the filters
+        BOOST_CHECK_LE(skipped, tip_height + 1 - 2);
+        BOOST_CHECK_GE(skipped, tip_height + 1 - 2 - 5);
+    }
+
+    filter_index->Interrupt();
+    filter_index->Stop();
+    DestroyAllBlockFilterIndexes();
+    gArgs.ForceSetArg("-keypool", std::to_string(DEFAULT_KEYPOOL_SIZE));
+}
+
 BOOST_FIXTURE_TEST_CASE(importmulti_rescan, TestChain100Setup)
 {
     // Cap last block file size, and mine new block in a new block file.
@@ -456,6 +617,203 @@ BOOST_FIXTURE_TEST_CASE(ListCoins, ListCoinsTestingSetup)
     BOOST_CHECK_EQUAL(list.begin()->second.size(), 2U);
 }
 
+// The outputs AvailableCoins() returns from setWalletUTXO, and the ones a scan of all of
+// mapWallet with the same filters finds, which have to be the same
+static std::set<COutPoint> CheckAvailableCoins(interfaces::Chain& chain, const CWallet& wallet)
+{
+    auto locked_chain = chain.lock();
+    LOCK(wallet.cs_wallet);
+    std::vector<COutput> coins;
+    wallet.AvailableCoins(*locked_chain, coins, false /* only safe */);
+    std::set<COutPoint> available;
+    for (const COutput& coin : coins) {
+        available.emplace(coin.tx->GetHash(), coin.i);
+    }
+    BOOST_CHECK_EQUAL(available.size(), coins.size());
+
+    std::set<COutPoint> expected;
+    for (const auto& entry : wallet.mapWallet) {
+        const CWalletTx& wtx = entry.second;
+        if (!locked_chain->checkFinalTx(*wtx.tx) || wtx.IsImmatureCoinBase(*locked_chain)) continue;
+        const int nDepth = wtx.GetDepthInMainChain(*locked_chain);
+        if (nDepth < 0 || (nDepth == 0 && !wtx.InMempool())) continue;
+        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+            if (wallet.IsMine(wtx.tx->vout[i]) != ISMINE_NO && !wallet.IsSpent(*locked_chain, entry.first, i) &&
+                !wallet.IsLockedCoin(entry.first, i) && wtx.tx->vout[i].nValue >= 1) {
+                expected.emplace(entry.first, i);
+            }
+        }
+    }
+    BOOST_CHECK(available == expected);
+    return available;
+}
+
+BOOST_FIXTURE_TEST_CASE(AvailableCoinsWalletUTXO, ListCoinsTestingSetup)
+{
+    auto create_tx = [&](const std::vector<CRecipient>& recipients, bool commit) {
+        CTransactionRef tx;
+        CAmount fee;
+        int changePos = -1;
+        std::string error;
+        CCoinControl dummy;
+        {
+            auto locked_chain = m_chain->lock();
+            BOOST_CHECK(wallet->CreateTransaction(*locked_chain, recipients, tx, fee, changePos, error, dummy));
+        }
+        if (commit) {
+            CValidationState state;
+            BOOST_CHECK(wallet->CommitTransaction(tx, {}, {}, state));
+        }
+        return tx;
+    };
+    auto abandon_tx = [&](const CTransactionRef& tx) {
+        wallet->TransactionRemovedFromMempool(tx);
+        auto locked_chain = m_chain->lock();
+        return wallet->AbandonTransaction(*locked_chain, tx->GetHash());
+    };
+
+    BOOST_CHECK_EQUAL(CheckAvailableCoins(*m_chain, *wallet).size(), 1U);
+
+    // An unconfirmed transaction spending the mature coinbase
+    const CTransactionRef txA = create_tx({CRecipient{GetScriptForRawPubKey({}), 1 * COIN, false /* subtract fee */}}, true);
+    const COutPoint coinbase_out = txA->vin[0].prevout;
+    BOOST_CHECK(!CheckAvailableCoins(*m_chain, *wallet).count(coinbase_out));
+
+    // Abandoning it makes the coinbase available again
+    BOOST_CHECK(abandon_tx(txA));
+    BOOST_CHECK(CheckAvailableCoins(*m_chain, *wallet).count(coinbase_out));
+
+    // A transaction conflicting with it, mined further down, which pays to a key and to a
+    // pubkey of someone else
+    CKey key_address, key_pubkey;
+    key_address.MakeNewKey(true);
+    key_pubkey.MakeNewKey(true);
+    const CScript script_address = GetScriptForDestination(PKHash(key_address.GetPubKey()));
+    const CScript script_pubkey = GetScriptForRawPubKey(key_pubkey.GetPubKey());
+    const CTransactionRef txC = create_tx({CRecipient{script_address, 1 * COIN, false}, CRecipient{script_pubkey, 1 * COIN, false}}, false);
+    BOOST_CHECK(txC->vin[0].prevout == coinbase_out);
+
+    // Seeing it in the mempool again un-abandons it
+    wallet->TransactionAddedToMempool(txA);
+    BOOST_CHECK(!CheckAvailableCoins(*m_chain, *wallet).count(coinbase_out));
+
+    // and a descendant spends its change
+    const CTransactionRef txD = create_tx({CRecipient{GetScriptForRawPubKey({}), 1 * COIN, false}}, true);
+    BOOST_CHECK(txD->vin[0].prevout.hash == txA->GetHash());
+    CheckAvailableCoins(*m_chain, *wallet);
+
+    // Mining the conflicting transaction marks both of them conflicted
+    const CBlock block = CreateAndProcessBlock({CMutableTransaction(*txC)}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    wallet->BlockConnected(block, {txA, txD});
+    {
+        auto locked_chain = m_chain->lock();
+        LOCK(wallet->cs_wallet);
+        BOOST_CHECK(wallet->mapWallet.at(txA->GetHash()).GetDepthInMainChain(*locked_chain) < 0);
+        BOOST_CHECK(wallet->mapWallet.at(txD->GetHash()).GetDepthInMainChain(*locked_chain) < 0);
+    }
+    std::set<COutPoint> available = CheckAvailableCoins(*m_chain, *wallet);
+    BOOST_CHECK(!available.count(coinbase_out));
+    for (const COutPoint& outpoint : available) {
+        BOOST_CHECK(outpoint.hash != txA->GetHash() && outpoint.hash != txD->GetHash());
+    }
+
+    // Topping up the keypool leaves the set as it is
+    const uint64_t nKeyStoreGeneration = wallet->GetKeyStoreGeneration();
+    const size_t nKeyCount = wallet->GetKeyCount();
+    {
+        LOCK(wallet->cs_wallet);
+        BOOST_CHECK(wallet->TopUpKeyPool(wallet->GetKeyPoolSize() + 10));
+    }
+    BOOST_CHECK(wallet->GetKeyCount() > nKeyCount);
+    BOOST_CHECK_EQUAL(wallet->GetKeyStoreGeneration(), nKeyStoreGeneration);
+
+    // importaddress
+    auto find_output = [&](const CScript& script) {
+        for (unsigned int i = 0; i < txC->vout.size(); i++) {
+            if (txC->vout[i].scriptPubKey == script) return COutPoint(txC->GetHash(), i);
+        }
+        BOOST_ERROR("output not found");
+        return COutPoint();
+    };
+    {
+        LOCK(wallet->cs_wallet);
+        BOOST_CHECK(wallet->AddWatchOnly(script_address, 0 /* nCreateTime */));
+    }
+    BOOST_CHECK(wallet->GetKeyStoreGeneration() != nKeyStoreGeneration);
+    available = CheckAvailableCoins(*m_chain, *wallet);
+    BOOST_CHECK(available.count(find_output(script_address)));
+    BOOST_CHECK(!available.count(find_output(script_pubkey)));
+
+    // importpubkey in place of it, which leaves the number of watch-only scripts as it was
+    {
+        LOCK(wallet->cs_wallet);
+        BOOST_CHECK(wallet->RemoveWatchOnly(script_address));
+        BOOST_CHECK(wallet->AddWatchOnly(script_pubkey, 0 /* nCreateTime */));
+    }
+    available = CheckAvailableCoins(*m_chain, *wallet);
+    BOOST_CHECK(!available.count(find_output(script_address)));
+    BOOST_CHECK(available.count(find_output(script_pubkey)));
+
+    // Removing the mined transaction leaves the coinbase unspent
+    {
+        LOCK(wallet->cs_wallet);
+        std::vector<uint256> vHashIn{txC->GetHash()}, vHashOut;
+        BOOST_CHECK(wallet->ZapSelectTx(vHashIn, vHashOut) == DBErrors::LOAD_OK);
+        BOOST_CHECK_EQUAL(vHashOut.size(), 1U);
+    }
+    BOOST_CHECK(CheckAvailableCoins(*m_chain, *wallet).count(coinbase_out));
+}
+
+// The coinstake built from a kernel spends it to a pay to pubkey output of the same key, with the
+// block reward and the fees added, as the coinstake built while searching the kernel used to
+BOOST_FIXTURE_TEST_CASE(CreateCoinStake, ListCoinsTestingSetup)
+{
+    const CAmount nFees = 3 * CENT;
+    const CScript script_pubkey = GetScriptForRawPubKey(coinbaseKey.GetPubKey());
+    const CBlockIndex* tip = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    const CAmount nReward = nFees + GetBlockSubsidy(tip->nHeight, Params().GetConsensus());
+    BOOST_CHECK(wallet->GetStakeCoins().empty());
+
+    auto check_coinstake = [&](const CWalletTx& wtx, unsigned int nOut) {
+        CWallet::CStakeKernel kernel;
+        kernel.pwtx = &wtx;
+        kernel.nOut = nOut;
+        kernel.nTime = tip->GetBlockTime() + 60;
+
+        CMutableTransaction txCoinStake;
+        BOOST_REQUIRE(wallet->CreateCoinStake(kernel, tip, txCoinStake, nFees));
+
+        CMutableTransaction expected;
+        expected.nType = TRANSACTION_STAKE;
+        expected.vin.emplace_back(wtx.GetHash(), nOut);
+        expected.vout.emplace_back(0, CScript());
+        expected.vout.emplace_back(wtx.tx->vout[nOut].nValue + nReward, script_pubkey);
+        BOOST_CHECK(CTransaction(txCoinStake).IsCoinStake());
+        BOOST_CHECK_EQUAL(txCoinStake.nVersion, expected.nVersion);
+        BOOST_CHECK_EQUAL(txCoinStake.nType, expected.nType);
+        BOOST_CHECK_EQUAL(txCoinStake.nLockTime, expected.nLockTime);
+        BOOST_REQUIRE_EQUAL(txCoinStake.vin.size(), 1U);
+        BOOST_CHECK(txCoinStake.vin[0].prevout == expected.vin[0].prevout);
+        BOOST_CHECK_EQUAL(txCoinStake.vin[0].nSequence, expected.vin[0].nSequence);
+        BOOST_CHECK(txCoinStake.vout == expected.vout);
+
+        ScriptError err;
+        BOOST_CHECK_MESSAGE(VerifyScript(txCoinStake.vin[0].scriptSig, wtx.tx->vout[nOut].scriptPubKey, &txCoinStake.vin[0].scriptWitness,
+            STANDARD_SCRIPT_VERIFY_FLAGS, MutableTransactionSignatureChecker(&txCoinStake, 0, wtx.tx->vout[nOut].nValue), &err), ScriptErrorString(err));
+    };
+
+    // A mature coinbase paying to the pubkey
+    const CWalletTx* coinbase = WITH_LOCK(wallet->cs_wallet, return &wallet->mapWallet.at(m_coinbase_txns[0]->GetHash()));
+    check_coinstake(*coinbase, 0);
+
+    // A coin paying to the address of the key, the coinstake pays to its pubkey instead
+    CMutableTransaction txPrev;
+    txPrev.vin.emplace_back(COutPoint(m_coinbase_txns[1]->GetHash(), 0));
+    txPrev.vout.emplace_back(1 * COIN, GetScriptForRawPubKey({}));
+    txPrev.vout.emplace_back(2 * COIN, GetScriptForDestination(PKHash(coinbaseKey.GetPubKey())));
+    check_coinstake(CWalletTx(wallet.get(), MakeTransactionRef(txPrev)), 1);
+}
+
 BOOST_FIXTURE_TEST_CASE(wallet_disableprivkeys, TestChain100Setup)
 {
     auto chain = interfaces::MakeChain();
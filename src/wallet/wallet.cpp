@@ -36,10 +36,13 @@
 #include <validation.h>
 #include <wallet/coincontrol.h>
 #include <wallet/fees.h>
+#include <wallet/ldb.h>
 
 #include <algorithm>
 #include <assert.h>
+#include <condition_variable>
 #include <future>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -509,7 +512,13 @@ void CWallet::UpdateTimeFirstKey(int64_t nCreateTime)
 bool CWallet::AddCScript(const CScript& redeemScript)
 {
     WalletBatch batch(*database);
-    return AddCScriptWithDB(batch, redeemScript);
+    if (!AddCScriptWithDB(batch, redeemScript)) {
+        return false;
+    }
+    // addmultisigaddress, outputs to the script may be ours now
+    LOCK(cs_KeyStore);
+    m_keystore_generation++;
+    return true;
 }
 
 bool CWallet::AddCScriptWithDB(WalletBatch& batch, const CScript& redeemScript)
@@ -558,6 +567,7 @@ bool CWallet::AddWatchOnlyInMem(const CScript &dest)
 {
     LOCK(cs_KeyStore);
     setWatchOnly.insert(dest);
+    m_keystore_generation++;
     CPubKey pubKey;
     if (ExtractPubKey(dest, pubKey)) {
         mapWatchKeys[pubKey.GetID()] = pubKey;
@@ -604,6 +614,7 @@ bool CWallet::RemoveWatchOnly(const CScript &dest)
     {
         LOCK(cs_KeyStore);
         setWatchOnly.erase(dest);
+        m_keystore_generation++;
         CPubKey pubKey;
         if (ExtractPubKey(dest, pubKey)) {
             mapWatchKeys.erase(pubKey.GetID());
@@ -637,6 +648,47 @@ bool CWallet::HaveWatchOnly() const
     return (!setWatchOnly.empty());
 }
 
+GCSFilter::ElementSet CWallet::GetScriptPubKeysForFilter() const
+{
+    GCSFilter::ElementSet scripts;
+    auto add_script = [&scripts](const CScript& script) {
+        scripts.emplace(script.begin(), script.end());
+    };
+    auto add_pubkey = [&add_script](const CPubKey& pubkey) {
+        add_script(GetScriptForRawPubKey(pubkey));
+        add_script(GetScriptForDestination(PKHash(pubkey)));
+    };
+
+    LOCK(cs_KeyStore);
+    for (const auto& entry : mapKeys) {
+        add_pubkey(entry.second.GetPubKey());
+    }
+    for (const auto& entry : mapCryptedKeys) {
+        add_pubkey(entry.second.first);
+    }
+    // Witness programs are kept as scripts too, so this covers P2WPKH and P2WSH
+    for (const auto& entry : mapScripts) {
+        add_script(entry.second);
+        add_script(GetScriptForDestination(ScriptHash(entry.second)));
+    }
+    for (const CScript& script : setWatchOnly) {
+        add_script(script);
+    }
+    return scripts;
+}
+
+uint64_t CWallet::GetKeyStoreGeneration() const
+{
+    LOCK(cs_KeyStore);
+    return m_keystore_generation;
+}
+
+size_t CWallet::GetKeyCount() const
+{
+    LOCK(cs_KeyStore);
+    return mapKeys.size() + mapCryptedKeys.size();
+}
+
 bool CWallet::Unlock(const SecureString& strWalletPassphrase, bool accept_no_keys)
 {
     CCrypter crypter;
@@ -1158,6 +1210,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         {
             wtx.hashBlock = wtxIn.hashBlock;
             fUpdated = true;
+            for (const CTxIn& txin : wtx.tx->vin) {
+                setWalletUTXO.erase(txin.prevout);
+            }
         }
         if (wtxIn.nIndex != -1 && (wtxIn.nIndex != wtx.nIndex))
         {
@@ -1305,6 +1360,32 @@ void CWallet::MarkInputsDirty(const CTransactionRef& tx)
     }
 }
 
+void CWallet::AddInputsToWalletUTXO(interfaces::Chain::Lock& locked_chain, const CTransactionRef& tx)
+{
+    for (const CTxIn& txin : tx->vin) {
+        auto it = mapWallet.find(txin.prevout.hash);
+        if (it != mapWallet.end() && txin.prevout.n < it->second.tx->vout.size() &&
+            IsMine(it->second.tx->vout[txin.prevout.n]) && !IsSpent(locked_chain, txin.prevout.hash, txin.prevout.n)) {
+            setWalletUTXO.insert(txin.prevout);
+        }
+    }
+}
+
+void CWallet::RebuildWalletUTXO(interfaces::Chain::Lock& locked_chain) const
+{
+    AssertLockHeld(cs_wallet);
+
+    setWalletUTXO.clear();
+    nWalletUTXOKeyStoreGeneration = GetKeyStoreGeneration();
+    for (const auto& entry : mapWallet) {
+        for (unsigned int i = 0; i < entry.second.tx->vout.size(); ++i) {
+            if (IsMine(entry.second.tx->vout[i]) && !IsSpent(locked_chain, entry.first, i)) {
+                setWalletUTXO.insert(COutPoint(entry.first, i));
+            }
+        }
+    }
+}
+
 bool CWallet::AbandonTransaction(interfaces::Chain::Lock& locked_chain, const uint256& hashTx)
 {
     auto locked_chain_recursive = chain().lock();  // Temporary. Removed in upcoming lock cleanup
@@ -1355,6 +1436,7 @@ bool CWallet::AbandonTransaction(interfaces::Chain::Lock& locked_chain, const ui
             // If a transaction changes 'conflicted' state, that changes the balance
             // available of the outputs it spends. So force those to be recomputed
             MarkInputsDirty(wtx.tx);
+            AddInputsToWalletUTXO(locked_chain, wtx.tx);
         }
     }
 
@@ -1408,6 +1490,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             // If a transaction changes 'conflicted' state, that changes the balance
             // available of the outputs it spends. So force those to be recomputed
             MarkInputsDirty(wtx.tx);
+            AddInputsToWalletUTXO(*locked_chain, wtx.tx);
         }
     }
 }
@@ -1819,6 +1902,7 @@ bool CWallet::ImportScripts(const std::set<CScript> scripts, int64_t timestamp)
         if (!AddCScriptWithDB(batch, entry)) {
             return false;
         }
+        WITH_LOCK(cs_KeyStore, m_keystore_generation++);
 
         if (timestamp > 0) {
             m_script_metadata[CScriptID(entry)].nCreateTime = timestamp;
@@ -1849,6 +1933,7 @@ bool CWallet::ImportPrivKeys(const std::map<CKeyID, CKey>& privkey_map, const in
         if (!AddKeyPubKeyWithDB(batch, key, pubkey)) {
             return false;
         }
+        WITH_LOCK(cs_KeyStore, m_keystore_generation++);
         UpdateTimeFirstKey(timestamp);
     }
     return true;
@@ -2062,6 +2147,182 @@ int64_t CWallet::RescanFromTime(int64_t startTime, const WalletRescanReserver& r
     return startTime;
 }
 
+namespace {
+
+//! Blocks each prefetch thread may read ahead of the scanner
+static const int RESCAN_PREFETCH_BLOCKS_PER_THREAD = 8;
+
+/**
+ * Reads the blocks of a rescan ahead of the scanner on a few threads. If the
+ * node keeps a basic block filter index, the filter of every block is matched
+ * against the scripts of the wallet first, and blocks which can't contain a
+ * wallet transaction aren't read at all.
+ */
+class RescanPrefetcher
+{
+public:
+    struct Entry
+    {
+        //! Null if the height wasn't in the active chain
+        uint256 hash;
+        //! The block filter didn't match the wallet scripts of filter_version
+        bool skipped{false};
+        int filter_version{0};
+        bool found{false};
+        CBlock block;
+    };
+
+    RescanPrefetcher(interfaces::Chain& chain, int start_height, int stop_height, int threads, std::shared_ptr<const GCSFilter::ElementSet> filter_scripts)
+        : m_chain(chain), m_window(std::max(1, threads) * RESCAN_PREFETCH_BLOCKS_PER_THREAD),
+          m_filter_scripts(std::move(filter_scripts)), m_next_height(start_height),
+          m_stop_height(stop_height), m_scan_height(start_height)
+    {
+        for (int i = 0; i < threads; i++) {
+            m_threads.emplace_back(&TraceThread<std::function<void()> >, "rescan", std::function<void()>(std::bind(&RescanPrefetcher::ThreadPrefetch, this)));
+        }
+    }
+
+    ~RescanPrefetcher()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    //! Blocks above this height aren't read ahead
+    void SetStopHeight(int height)
+    {
+        {
+            LOCK(m_mutex);
+            m_stop_height = height;
+        }
+        m_cv.notify_all();
+    }
+
+    //! Replace the scripts matched against the block filters, after keys were added to the wallet
+    void SetFilterScripts(std::shared_ptr<const GCSFilter::ElementSet> filter_scripts)
+    {
+        LOCK(m_mutex);
+        if (!m_filter_scripts) return;
+        m_filter_scripts = std::move(filter_scripts);
+        m_filter_version++;
+    }
+
+    int GetFilterVersion()
+    {
+        LOCK(m_mutex);
+        return m_filter_version;
+    }
+
+    //! Wait for the block at this height, heights have to be requested in ascending order
+    Entry Get(int height)
+    {
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_scan_height = height;
+            m_ready.erase(m_ready.begin(), m_ready.lower_bound(height));
+            if (height < m_next_height) {
+                m_cv.notify_all();
+                m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_ready.count(height) > 0; });
+                Entry entry = std::move(m_ready.at(height));
+                m_ready.erase(height);
+                return entry;
+            }
+            // Not read ahead (yet), read on this thread and let the prefetch threads continue after it
+            m_next_height = height + 1;
+        }
+        m_cv.notify_all();
+        return FetchHeight(height);
+    }
+
+    //! Read the block with this hash, skipping it if its filter doesn't match the current scripts
+    Entry Fetch(const uint256& hash)
+    {
+        Entry entry;
+        entry.hash = hash;
+
+        std::shared_ptr<const GCSFilter::ElementSet> filter_scripts;
+        {
+            LOCK(m_mutex);
+            filter_scripts = m_filter_scripts;
+            entry.filter_version = m_filter_version;
+        }
+        if (filter_scripts) {
+            const Optional<bool> match = m_chain.blockFilterMatchesAny(BlockFilterType::BASIC, hash, *filter_scripts);
+            if (match && !*match) {
+                entry.skipped = true;
+                return entry;
+            }
+        }
+        entry.found = m_chain.findBlock(hash, &entry.block) && !entry.block.IsNull();
+        return entry;
+    }
+
+private:
+    interfaces::Chain& m_chain;
+    const int m_window;
+
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    //! Null if the node has no block filter index
+    std::shared_ptr<const GCSFilter::ElementSet> m_filter_scripts GUARDED_BY(m_mutex);
+    int m_filter_version GUARDED_BY(m_mutex){0};
+    //! Next height to be read by any thread
+    int m_next_height GUARDED_BY(m_mutex);
+    int m_stop_height GUARDED_BY(m_mutex);
+    //! Height the scanner waits for or processes
+    int m_scan_height GUARDED_BY(m_mutex);
+    std::map<int, Entry> m_ready GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    Entry FetchHeight(int height)
+    {
+        uint256 hash;
+        {
+            auto locked_chain = m_chain.lock();
+            const Optional<int> tip_height = locked_chain->getHeight();
+            if (tip_height && height <= *tip_height) {
+                hash = locked_chain->getBlockHash(height);
+            }
+        }
+        if (hash.IsNull()) return Entry();
+        return Fetch(hash);
+    }
+
+    void ThreadPrefetch()
+    {
+        while (true) {
+            int height;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cv.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+                    return m_stop || (m_next_height <= m_stop_height && m_next_height < m_scan_height + m_window);
+                });
+                if (m_stop) return;
+                height = m_next_height++;
+            }
+
+            Entry entry = FetchHeight(height);
+
+            {
+                LOCK(m_mutex);
+                if (height >= m_scan_height) {
+                    m_ready.emplace(height, std::move(entry));
+                }
+            }
+            m_cv.notify_all();
+        }
+    }
+};
+
+} // namespace
+
 /**
  * Scan the block chain (starting in start_block) for transactions
  * from or to us. If fUpdate is true, found transactions that already
@@ -2112,6 +2373,30 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
         progress_end = chain().guessVerificationProgress(stop_block.IsNull() ? tip_hash : stop_block);
     }
     double progress_current = progress_begin;
+
+    // Blocks are read ahead on -rescanthreads threads, and skipped without being read
+    // if their filter in the block filter index doesn't match any of our scripts
+    std::unique_ptr<RescanPrefetcher> prefetcher;
+    uint64_t nKeyStoreGeneration = GetKeyStoreGeneration();
+    size_t nKeyCount = GetKeyCount();
+    if (block_height) {
+        const int nThreads = std::max(0, std::min<int>(gArgs.GetArg("-rescanthreads", DEFAULT_RESCAN_THREADS), MAX_RESCAN_THREADS));
+        std::shared_ptr<const GCSFilter::ElementSet> filter_scripts;
+        if (chain().hasBlockFilterIndex(BlockFilterType::BASIC)) {
+            filter_scripts = std::make_shared<const GCSFilter::ElementSet>(GetScriptPubKeysForFilter());
+        }
+        if (nThreads > 0 || filter_scripts) {
+            int stop_height = *block_height;
+            {
+                auto locked_chain = chain().lock();
+                if (Optional<int> height = locked_chain->getBlockHeight(stop_block.IsNull() ? tip_hash : stop_block)) {
+                    stop_height = std::max(stop_height, *height);
+                }
+            }
+            prefetcher = MakeUnique<RescanPrefetcher>(chain(), *block_height, stop_height, nThreads, std::move(filter_scripts));
+        }
+    }
+
     while (block_height && !fAbortRescan && !chain().shutdownRequested()) {
         m_scanning_progress = (progress_current - progress_begin) / (progress_end - progress_begin);
         if (*block_height % 100 == 0 && progress_end - progress_begin > 0.0) {
@@ -2122,8 +2407,26 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
             WalletLogPrintf("Still rescanning. At block %d. Progress=%f\n", *block_height, progress_current);
         }
 
-        CBlock block;
-        if (chain().findBlock(block_hash, &block) && !block.IsNull()) {
+        RescanPrefetcher::Entry entry;
+        if (prefetcher) {
+            entry = prefetcher->Get(*block_height);
+            if (entry.hash != block_hash || (entry.skipped && entry.filter_version != prefetcher->GetFilterVersion())) {
+                // Read ahead from another chain, or skipped before keys were added to the wallet
+                entry = prefetcher->Fetch(block_hash);
+            }
+        } else {
+            entry.hash = block_hash;
+            entry.found = chain().findBlock(block_hash, &entry.block) && !entry.block.IsNull();
+        }
+        m_scanning_blocks++;
+
+        if (entry.skipped) {
+            // none of our scripts are in the block
+            m_scanning_skipped++;
+            result.last_scanned_block = block_hash;
+            result.last_scanned_height = *block_height;
+        } else if (entry.found) {
+            const CBlock& block = entry.block;
             auto locked_chain = chain().lock();
             LOCK(cs_wallet);
             if (!locked_chain->getBlockHeight(block_hash)) {
@@ -2141,6 +2444,13 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
             // scan succeeded, record block as most recent successfully scanned
             result.last_scanned_block = block_hash;
             result.last_scanned_height = *block_height;
+
+            // A transaction using a key of the keypool tops it up, match the new keys from now on
+            if (prefetcher && (GetKeyStoreGeneration() != nKeyStoreGeneration || GetKeyCount() != nKeyCount)) {
+                nKeyStoreGeneration = GetKeyStoreGeneration();
+                nKeyCount = GetKeyCount();
+                prefetcher->SetFilterScripts(std::make_shared<const GCSFilter::ElementSet>(GetScriptPubKeysForFilter()));
+            }
         } else {
             // could not scan block, keep scanning but record this block as the most recent failure
             result.last_failed_block = block_hash;
@@ -2168,9 +2478,11 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
             if (stop_block.IsNull() && prev_tip_hash != tip_hash) {
                 // in case the tip has changed, update progress max
                 progress_end = chain().guessVerificationProgress(tip_hash);
+                if (prefetcher) prefetcher->SetStopHeight(*tip_height);
             }
         }
     }
+    prefetcher.reset();
     ShowProgress(strprintf("%s " + _("Rescanning...").translated, GetDisplayName()), 100); // hide progress dialog in GUI
     if (block_height && fAbortRescan) {
         WalletLogPrintf("Rescan aborted at block %d. Progress=%f\n", *block_height, progress_current);
@@ -2179,7 +2491,7 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
         WalletLogPrintf("Rescan interrupted by shutdown request at block %d. Progress=%f\n", *block_height, progress_current);
         result.status = ScanResult::USER_ABORT;
     } else {
-        WalletLogPrintf("Rescan completed in %15dms\n", GetTimeMillis() - start_time);
+        WalletLogPrintf("Rescan completed in %15dms, %d blocks scanned, %d skipped by their block filter\n", GetTimeMillis() - start_time, m_scanning_blocks.load(), m_scanning_skipped.load());
     }
     return result;
 }
@@ -2522,32 +2834,34 @@ void CWallet::AvailableCoins(interfaces::Chain::Lock& locked_chain, std::vector<
     bool allow_used_addresses = !IsWalletFlagSet(WALLET_FLAG_AVOID_REUSE) || (coinControl && !coinControl->m_avoid_address_reuse);
     int nInstantSendConfirmationsRequired = Params().GetConsensus().nInstantSendConfirmationsRequired;
 
-    for (const auto& entry : mapWallet)
-    {
-        const uint256& wtxid = entry.first;
-        const CWalletTx& wtx = entry.second;
+    // Outputs may have become ours through imports
+    if (nWalletUTXOKeyStoreGeneration != GetKeyStoreGeneration()) {
+        RebuildWalletUTXO(locked_chain);
+    }
 
+    // Whether the outputs of a transaction can be used, with its depth and whether it is safe
+    auto check_tx = [&](const CWalletTx& wtx, int& nDepth, bool& safeTx) {
         if (!locked_chain.checkFinalTx(*wtx.tx)) {
-            continue;
+            return false;
         }
 
         if (wtx.IsImmatureCoinBase(locked_chain))
-            continue;
+            return false;
 
-        int nDepth = wtx.GetDepthInMainChain(locked_chain);
+        nDepth = wtx.GetDepthInMainChain(locked_chain);
         // do not use IX for inputs that have less then nInstantSendConfirmationsRequired blockchain confirmations
         if (fUseInstantSend && nDepth < nInstantSendConfirmationsRequired)
-            continue;
+            return false;
 
         if (nDepth < 0)
-            continue;
+            return false;
 
         // We should not consider coins which aren't at least in our mempool
         // It's possible for these to be conflicted via ancestors which we may never be able to detect
         if (nDepth == 0 && !wtx.InMempool())
-            continue;
+            return false;
 
-        bool safeTx = wtx.IsTrusted(locked_chain);
+        safeTx = wtx.IsTrusted(locked_chain);
 
         // We should not consider coins from transactions that are replacing
         // other transactions.
@@ -2581,57 +2895,81 @@ void CWallet::AvailableCoins(interfaces::Chain::Lock& locked_chain, std::vector<
         }
 
         if (fOnlySafe && !safeTx) {
-            continue;
+            return false;
         }
 
         if (nDepth < nMinDepth || nDepth > nMaxDepth)
-            continue;
+            return false;
 
-        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
-            // Check masternode collateral
-            if (nCoinType == ONLY_COLLATERALS && wtx.tx->vout[i].nValue != 10000000 * COIN)
-                continue;
+        return true;
+    };
+
+    // The outputs of a transaction are next to each other in setWalletUTXO, its checks are
+    // done once for all of them
+    const CWalletTx* pwtx = nullptr;
+    bool fUsable = false;
+    int nDepth = 0;
+    bool safeTx = false;
+    for (const COutPoint& outpoint : setWalletUTXO)
+    {
+        const uint256& wtxid = outpoint.hash;
+        const unsigned int i = outpoint.n;
 
-            if (wtx.tx->vout[i].nValue < nMinimumAmount || wtx.tx->vout[i].nValue > nMaximumAmount)
+        if (!pwtx || pwtx->GetHash() != wtxid) {
+            auto it = mapWallet.find(wtxid);
+            if (it == mapWallet.end()) {
+                pwtx = nullptr;
                 continue;
+            }
+            pwtx = &it->second;
+            fUsable = check_tx(*pwtx, nDepth, safeTx);
+        }
+        if (!fUsable) continue;
+        const CWalletTx& wtx = *pwtx;
 
-            if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(COutPoint(entry.first, i)))
-                continue;
+        // Check masternode collateral
+        if (nCoinType == ONLY_COLLATERALS && wtx.tx->vout[i].nValue != 10000000 * COIN)
+            continue;
 
-            if (IsLockedCoin(entry.first, i) && nCoinType != ONLY_COLLATERALS)
-                continue;
+        if (wtx.tx->vout[i].nValue < nMinimumAmount || wtx.tx->vout[i].nValue > nMaximumAmount)
+            continue;
 
-            if (IsSpent(locked_chain, wtxid, i))
-                continue;
+        if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(outpoint))
+            continue;
 
-            isminetype mine = IsMine(wtx.tx->vout[i]);
+        if (IsLockedCoin(wtxid, i) && nCoinType != ONLY_COLLATERALS)
+            continue;
 
-            if (mine == ISMINE_NO)
-                continue;
+        if (IsSpent(locked_chain, wtxid, i))
+            continue;
 
-            if (!allow_used_addresses && IsUsedDestination(wtxid, i)) {
-                continue;
-            }
+        isminetype mine = IsMine(wtx.tx->vout[i]);
+
+        if (mine == ISMINE_NO)
+            continue;
 
-            bool solvable = IsSolvable(*this, wtx.tx->vout[i].scriptPubKey);
-            bool spendable = ((mine & ISMINE_SPENDABLE) != ISMINE_NO) || (((mine & ISMINE_WATCH_ONLY) != ISMINE_NO) && (coinControl && coinControl->fAllowWatchOnly && solvable));
+        if (!allow_used_addresses && IsUsedDestination(wtxid, i)) {
+            continue;
+        }
 
-            vCoins.push_back(COutput(&wtx, i, nDepth, spendable, solvable, safeTx, (coinControl && coinControl->fAllowWatchOnly)));
+        bool solvable = IsSolvable(*this, wtx.tx->vout[i].scriptPubKey);
+        bool spendable = ((mine & ISMINE_SPENDABLE) != ISMINE_NO) || (((mine & ISMINE_WATCH_ONLY) != ISMINE_NO) && (coinControl && coinControl->fAllowWatchOnly && solvable));
 
-            // Checks the sum amount of all UTXO's.
-            if (nMinimumSumAmount != MAX_MONEY) {
-                nTotal += wtx.tx->vout[i].nValue;
+        vCoins.push_back(COutput(&wtx, i, nDepth, spendable, solvable, safeTx, (coinControl && coinControl->fAllowWatchOnly)));
 
-                if (nTotal >= nMinimumSumAmount) {
-                    return;
-                }
-            }
+        // Checks the sum amount of all UTXO's.
+        if (nMinimumSumAmount != MAX_MONEY) {
+            nTotal += wtx.tx->vout[i].nValue;
 
-            // Checks the maximum number of UTXO's.
-            if (nMaximumCount > 0 && vCoins.size() >= nMaximumCount) {
+            if (nTotal >= nMinimumSumAmount) {
                 return;
             }
         }
+
+        // Checks the maximum number of UTXO's.
+        if (nMaximumCount > 0 && vCoins.size() >= nMaximumCount) {
+            return;
+        }
     }
 }
 
@@ -3429,13 +3767,7 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
         }
     }
 
-    for (auto& pair : mapWallet) {
-        for(size_t i = 0; i < pair.second.tx->vout.size(); ++i) {
-            if (IsMine(pair.second.tx->vout[i]) && !IsSpent(*locked_chain, pair.first, i)) {
-                setWalletUTXO.insert(COutPoint(pair.first, i));
-            }
-        }
-    }
+    RebuildWalletUTXO(*locked_chain);
 
     {
         LOCK(cs_KeyStore);
@@ -3459,6 +3791,11 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
         wtxOrdered.erase(it->second.m_it_wtxOrdered);
         mapWallet.erase(it);
     }
+    if (!vHashOut.empty()) {
+        // The outputs spent by the removed transactions are unspent again
+        auto locked_chain = chain().lock();
+        RebuildWalletUTXO(*locked_chain);
+    }
 
     if (nZapSelectTxRet == DBErrors::NEED_REWRITE)
     {
@@ -4368,6 +4705,10 @@ bool CWallet::Verify(interfaces::Chain& chain, const WalletLocation& location, b
     }
 
     if (salvage_wallet) {
+        if (IsLevelDBWallet(wallet_path)) {
+            error_string = strprintf(_("Error loading wallet %s. -salvagewallet is not supported for LevelDB wallets.").translated, location.GetName());
+            return false;
+        }
         // Recover readable keypairs:
         CWallet dummyWallet(&chain, WalletLocation(), WalletDatabase::CreateDummy());
         std::string backup_filename;
@@ -4858,7 +5199,8 @@ void CWallet::LearnRelatedScripts(const CPubKey& key, OutputType type)
         CScript witprog = GetScriptForDestination(witdest);
         // Make sure the resulting program is solvable.
         assert(IsSolvable(*this, witprog));
-        AddCScript(witprog);
+        WalletBatch batch(*database);
+        AddCScriptWithDB(batch, witprog);
     }
 }
 
@@ -5158,39 +5500,19 @@ bool CWallet::SelectStakeCoins(StakeCoinsSet& setCoins, CAmount nTargetAmount) c
     return true;
 }
 
-// proof-of-stake: create coin stake transaction
 typedef std::vector<unsigned char> valtype;
-bool CWallet::CreateCoinStake(unsigned int nBits,
-                              int64_t nSearchInterval,
-                              CMutableTransaction& txNew,
-                              uint32_t& nTxNewTime,
-                              CAmount nFees)
+
+// proof-of-stake: search the stake coins for a kernel
+bool CWallet::FindStakeKernel(unsigned int nBits, CBlockIndex* pindexPrev, int64_t nSearchInterval, CStakeKernel& kernel)
 {
     // Transaction index is required to get to block header
     if (!g_txindex)
         return error("%s: transaction index unavailable", __func__);
 
-//    LOCK2(cs_main, cs_wallet);
-    txNew.vin.clear();
-    txNew.vout.clear();
-
-    txNew.nType = TRANSACTION_STAKE;
-
-    // Mark coin stake transaction
-    CScript scriptEmpty;
-    scriptEmpty.clear();
-    txNew.vout.push_back(CTxOut(0, scriptEmpty));
-
-    // Choose coins to use
-    CAmount nBalance = GetAvailableBalance();
-
-    // presstab HyperStake - Initialize as static and don't update the set on every run of CreateCoinStake() in order to lighten resource use
-    static StakeCoinsSet setStakeCoins;
-    static int nLastStakeSetUpdate = 0;
-
+    // presstab HyperStake - Initialize once and don't update the set on every run of FindStakeKernel() in order to lighten resource use
     if (GetTime() - nLastStakeSetUpdate > nStakeSetUpdateTime) {
         setStakeCoins.clear();
-        if (!SelectStakeCoins(setStakeCoins, nBalance))
+        if (!SelectStakeCoins(setStakeCoins, GetAvailableBalance()))
             return false;
 
         nLastStakeSetUpdate = GetTime();
@@ -5199,105 +5521,123 @@ bool CWallet::CreateCoinStake(unsigned int nBits,
     if (setStakeCoins.empty())
         return false; // error("%s: no coins to stake", __func__);
 
-    std::vector<const CWalletTx*> vwtxPrev;
-    CAmount nCredit = 0;
-    CScript scriptPubKeyKernel;
-
     // prevent staking a time that won't be accepted
-    if (GetAdjustedTime() <= ChainActive().Tip()->nTime)
+    if (GetAdjustedTime() <= pindexPrev->nTime)
         MilliSleep(10000);
 
+    static int nMaxStakeSearchInterval = 60;
     for (const auto& pcoin : setStakeCoins) {
-        //make sure that enough time has elapsed between
-        CBlockIndex* pindex = nullptr;
-        BlockMap::iterator it = ::BlockIndex().find(pcoin.first->hashBlock);
-        if (it != ::BlockIndex().end())
-            pindex = it->second;
-        else {
-            LogPrint(BCLog::KERNEL, "%s: failed to find block index\n", __func__);
+        // only support pay to public key, pay to address and pay to witness keyhash
+        std::vector<valtype> vSolutions;
+        txnouttype whichType = Solver(pcoin.first->tx->vout[pcoin.second].scriptPubKey, vSolutions);
+        if (whichType != TX_PUBKEY && whichType != TX_PUBKEYHASH && whichType != TX_WITNESS_V0_KEYHASH) {
+            LogPrint(BCLog::KERNEL, "%s: no support for kernel type=%d\n", __func__, whichType);
             continue;
         }
 
-        // Read block header
-        CBlockHeader block = pindex->GetBlockHeader();
+        // The block of the coin and the stake modifier are the only parts of the search which need
+        // the chain, the kernel hashes below are tried without holding cs_main
+        CBlockHeader block;
+        uint64_t nStakeModifier = 0;
+        {
+            LOCK(cs_main);
+            BlockMap::iterator it = ::BlockIndex().find(pcoin.first->hashBlock);
+            if (it == ::BlockIndex().end()) {
+                LogPrint(BCLog::KERNEL, "%s: failed to find block index\n", __func__);
+                continue;
+            }
+            block = it->second->GetBlockHeader();
 
-        static int nMaxStakeSearchInterval = 60;
-        if (block.GetBlockTime() + Params().GetConsensus().nStakeMinAge > nTxNewTime - nMaxStakeSearchInterval)
-            continue; // only count coins meeting min age requirement
+            //make sure that enough time has elapsed between
+            if (block.GetBlockTime() + Params().GetConsensus().nStakeMinAge > GetAdjustedTime() - nMaxStakeSearchInterval)
+                continue; // only count coins meeting min age requirement
 
-        nTxNewTime = GetAdjustedTime();
-        unsigned int nTryTime = 0;
-        bool fKernelFound = false;
+            if (!GetKernelStakeModifier(pindexPrev, block.GetHash(), nStakeModifier))
+                continue;
+        }
 
-        for (unsigned int n = 0; n < std::min(nSearchInterval, (int64_t)nMaxStakeSearchInterval) && !fKernelFound; n++)
+        uint32_t nTxNewTime = GetAdjustedTime();
+        COutPoint prevoutStake = COutPoint(pcoin.first->GetHash(), pcoin.second);
+        for (unsigned int n = 0; n < std::min(nSearchInterval, (int64_t)nMaxStakeSearchInterval); n++)
         {
             // Search backward in time from the given txNew timestamp
             // Search nSearchInterval seconds back up to nMaxStakeSearchInterval
-            uint256 hashProofOfStake = uint256();
-            COutPoint prevoutStake = COutPoint(pcoin.first->GetHash(), pcoin.second);
-            nTryTime = nTxNewTime + 45 - n; // TODO: change 45 to nHashDrift
+            uint256 hashProofOfStake;
+            unsigned int nTryTime = nTxNewTime + 45 - n; // TODO: change 45 to nHashDrift
 
-            if (CheckStakeKernelHash(nBits, ChainActive().Tip(), block, pcoin.first->tx, prevoutStake, nTryTime, hashProofOfStake, false))  // nTxNewTime - n
+            if (CheckStakeKernelHash(nBits, nStakeModifier, block, pcoin.first->tx, prevoutStake, nTryTime, hashProofOfStake))
             {
                 // Found a kernel
                 LogPrint(BCLog::KERNEL, "%s: kernel found\n", __func__);
-
-                nTxNewTime = nTryTime;
-                std::vector<valtype> vSolutions;
-                txnouttype whichType;
-                CScript scriptPubKeyOut;
-                scriptPubKeyKernel = pcoin.first->tx->vout[pcoin.second].scriptPubKey;
-                whichType = Solver(scriptPubKeyKernel, vSolutions);
-                LogPrint(BCLog::KERNEL, "%s: parsed kernel type=%d\n", __func__, whichType);
-                if (whichType != TX_PUBKEY && whichType != TX_PUBKEYHASH && whichType != TX_WITNESS_V0_KEYHASH)
-                {
-                    LogPrint(BCLog::KERNEL, "%s: no support for kernel type=%d\n", __func__, whichType);
-                    break;  // only support pay to public key and pay to address and pay to witness keyhash
-                }
-                if (whichType == TX_PUBKEYHASH || whichType == TX_WITNESS_V0_KEYHASH) // pay to address type or witness keyhash
-                {
-                    // convert to pay to public key type
-                    CKey key;
-                    if (!GetKey(CKeyID(uint160(vSolutions[0])), key))
-                    {
-                        LogPrint(BCLog::KERNEL, "%s: failed to get key for kernel type=%d\n", whichType);
-                        break;  // unable to find corresponding public key
-                    }
-                    scriptPubKeyOut << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
-                }
-                else
-                    scriptPubKeyOut = scriptPubKeyKernel;
-
-                // nTxNewTime -= n;
-                txNew.vin.push_back(CTxIn(pcoin.first->GetHash(), pcoin.second));
-                nCredit += pcoin.first->tx->vout[pcoin.second].nValue;
-                vwtxPrev.push_back(pcoin.first);
-                txNew.vout.push_back(CTxOut(0, scriptPubKeyOut));
-
-                //presstab HyperStake - calculate the total size of our new output including the stake reward so that we can use it to decide whether to split the stake outputs
-                const CBlockIndex* pIndex0 = ChainActive().Tip();
-                uint64_t nTotalSize = pcoin.first->tx->vout[pcoin.second].nValue + nFees + GetBlockSubsidy(pIndex0->nHeight, Params().GetConsensus());
-
-                //presstab HyperStake - if MultiSend is set to send in coinstake we will add our outputs here (values asigned further down)
-                // TODO: BitCorn - check if threshold split conflicts with masternode payment.
-                if (nStakeSplitThreshold >= 100 && nTotalSize / 2 > nStakeSplitThreshold * COIN)
-                    txNew.vout.push_back(CTxOut(0, scriptPubKeyOut)); //split stake
-
-                LogPrint(BCLog::KERNEL, "%s: added kernel type=%d\n", __func__, whichType);
-                fKernelFound = true;
-                break;
+                kernel.pwtx = pcoin.first;
+                kernel.nOut = pcoin.second;
+                kernel.nTime = nTryTime;
+                return true;
             }
         }
-        if (fKernelFound)
-            break; // if kernel is found stop searching
     }
+    return false;
+}
+
+// proof-of-stake: create coin stake transaction
+bool CWallet::CreateCoinStake(const CStakeKernel& kernel,
+                              const CBlockIndex* pindexPrev,
+                              CMutableTransaction& txNew,
+                              CAmount nFees)
+{
+//    LOCK2(cs_main, cs_wallet);
+    txNew.vin.clear();
+    txNew.vout.clear();
+
+    txNew.nType = TRANSACTION_STAKE;
+
+    // Mark coin stake transaction
+    CScript scriptEmpty;
+    scriptEmpty.clear();
+    txNew.vout.push_back(CTxOut(0, scriptEmpty));
+
+    CAmount nBalance = GetAvailableBalance();
+    CAmount nCredit = 0;
+
+    std::vector<valtype> vSolutions;
+    CScript scriptPubKeyOut;
+    CScript scriptPubKeyKernel = kernel.pwtx->tx->vout[kernel.nOut].scriptPubKey;
+    txnouttype whichType = Solver(scriptPubKeyKernel, vSolutions);
+    LogPrint(BCLog::KERNEL, "%s: parsed kernel type=%d\n", __func__, whichType);
+    if (whichType == TX_PUBKEYHASH || whichType == TX_WITNESS_V0_KEYHASH) // pay to address type or witness keyhash
+    {
+        // convert to pay to public key type
+        CKey key;
+        if (!GetKey(CKeyID(uint160(vSolutions[0])), key))
+        {
+            LogPrint(BCLog::KERNEL, "%s: failed to get key for kernel type=%d\n", __func__, whichType);
+            return false;  // unable to find corresponding public key
+        }
+        scriptPubKeyOut << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+    }
+    else
+        scriptPubKeyOut = scriptPubKeyKernel;
+
+    txNew.vin.push_back(CTxIn(kernel.pwtx->GetHash(), kernel.nOut));
+    nCredit += kernel.pwtx->tx->vout[kernel.nOut].nValue;
+    txNew.vout.push_back(CTxOut(0, scriptPubKeyOut));
+
+    //presstab HyperStake - calculate the total size of our new output including the stake reward so that we can use it to decide whether to split the stake outputs
+    uint64_t nTotalSize = kernel.pwtx->tx->vout[kernel.nOut].nValue + nFees + GetBlockSubsidy(pindexPrev->nHeight, Params().GetConsensus());
+
+    //presstab HyperStake - if MultiSend is set to send in coinstake we will add our outputs here (values asigned further down)
+    // TODO: BitCorn - check if threshold split conflicts with masternode payment.
+    if (nStakeSplitThreshold >= 100 && nTotalSize / 2 > nStakeSplitThreshold * COIN)
+        txNew.vout.push_back(CTxOut(0, scriptPubKeyOut)); //split stake
+
+    LogPrint(BCLog::KERNEL, "%s: added kernel type=%d\n", __func__, whichType);
+
     if (nCredit == 0 || nCredit > nBalance)
         return false;
 
     // Calculate reward
     CAmount nReward;
-    const CBlockIndex* pIndex0 = ChainActive().Tip();
-    nReward = nFees + GetBlockSubsidy(pIndex0->nHeight, Params().GetConsensus());
+    nReward = nFees + GetBlockSubsidy(pindexPrev->nHeight, Params().GetConsensus());
     nCredit += nReward;
 
     CAmount nMinFee = 0;
@@ -5332,16 +5672,13 @@ bool CWallet::CreateCoinStake(unsigned int nBits,
 
     // Update coinbase transaction with additional info about masternode and governance payments,
     // get some info back to pass to getblocktemplate
-    FillBlockPayments(txNew, pIndex0->nHeight+1, nReward, voutMasternodePayments, voutSuperblockPayments);
+    FillBlockPayments(txNew, pindexPrev->nHeight+1, nReward, voutMasternodePayments, voutSuperblockPayments);
     LogPrintf("CreateNewBlock -- nBlockHeight %d blockReward %lld coinbaseTx %s",
-                pIndex0->nHeight+1, nReward, CTransaction(txNew).ToString());
+                pindexPrev->nHeight+1, nReward, CTransaction(txNew).ToString());
 
     // Sign
-    int nIn = 0;
-    for (const CWalletTx* pcoin : vwtxPrev) {
-        if (!SignSignature(*this, *pcoin->tx, txNew, nIn++, SIGHASH_ALL))
-            return error("CreateCoinStake : failed to sign coinstake");
-    }
+    if (!SignSignature(*this, *kernel.pwtx->tx, txNew, 0, SIGHASH_ALL))
+        return error("CreateCoinStake : failed to sign coinstake");
 
     // Successfully generated coinstake
     nLastStakeSetUpdate = 0; //this will trigger stake set to repopulate next round
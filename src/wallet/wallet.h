@@ -88,6 +88,9 @@ static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 6;
 static const bool DEFAULT_WALLET_RBF = false;
 static const bool DEFAULT_WALLETBROADCAST = true;
 static const bool DEFAULT_DISABLE_WALLET = false;
+//! -rescanthreads default, the number of threads reading blocks ahead of a rescan
+static const int DEFAULT_RESCAN_THREADS = 4;
+static const int MAX_RESCAN_THREADS = 16;
 //! -maxtxfee default
 constexpr CAmount DEFAULT_TRANSACTION_MAXFEE{COIN / 10};
 //! Discourage users to set fees higher than this amount (in satoshis) per kB
@@ -763,6 +766,9 @@ private:
     CryptedKeyMap mapCryptedKeys GUARDED_BY(cs_KeyStore);
     WatchOnlySet setWatchOnly GUARDED_BY(cs_KeyStore);
     WatchKeyMap mapWatchKeys GUARDED_BY(cs_KeyStore);
+    //! Bumped whenever keys, scripts or watch-only scripts are imported or watch-only scripts
+    //! removed, not for the keys derived into the keypool, which have no outputs yet
+    uint64_t m_keystore_generation GUARDED_BY(cs_KeyStore){0};
 
     bool AddCryptedKeyInner(const CPubKey &vchPubKey, const std::vector<unsigned char> &vchCryptedSecret);
     bool AddKeyPubKeyInner(const CKey& key, const CPubKey &pubkey);
@@ -771,6 +777,8 @@ private:
     std::atomic<bool> fScanningWallet{false}; // controlled by WalletRescanReserver
     std::atomic<int64_t> m_scanning_start{0};
     std::atomic<double> m_scanning_progress{0};
+    std::atomic<int64_t> m_scanning_blocks{0};
+    std::atomic<int64_t> m_scanning_skipped{0};
     std::mutex mutexScanning;
     friend class WalletRescanReserver;
 
@@ -819,6 +827,10 @@ private:
     /* Mark a transaction's inputs dirty, thus forcing the outputs to be recomputed */
     void MarkInputsDirty(const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    /** Add the outputs spent by a transaction back to setWalletUTXO, after it was abandoned or conflicted */
+    void AddInputsToWalletUTXO(interfaces::Chain::Lock& locked_chain, const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void RebuildWalletUTXO(interfaces::Chain::Lock& locked_chain) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
     /* Used by TransactionAddedToMemorypool/BlockConnected/Disconnected/ScanForWalletTransactions.
@@ -968,7 +980,13 @@ public:
 
     std::map<CTxDestination, CAddressBookData> mapAddressBook GUARDED_BY(cs_wallet);
 
-    std::set<COutPoint> setWalletUTXO;
+    //! Outputs of wallet transactions which are ours and not spent by another wallet transaction,
+    //! AvailableCoins() looks at these instead of all of mapWallet. May contain a few spent
+    //! outputs, those are filtered when they are looked up.
+    mutable std::set<COutPoint> setWalletUTXO GUARDED_BY(cs_wallet);
+    //! GetKeyStoreGeneration() when setWalletUTXO was built, outputs may become ours when it changes.
+    //! Keys topped up into the keypool don't change it, outputs to them are added with their transactions
+    mutable uint64_t nWalletUTXOKeyStoreGeneration GUARDED_BY(cs_wallet){0};
     std::set<COutPoint> setLockedCoins GUARDED_BY(cs_wallet);
 
     /** Registered interfaces::Chain::Notifications handler. */
@@ -1035,6 +1053,9 @@ public:
     bool IsScanning() { return fScanningWallet; }
     int64_t ScanningDuration() const { return fScanningWallet ? GetTimeMillis() - m_scanning_start : 0; }
     double ScanningProgress() const { return fScanningWallet ? (double) m_scanning_progress : 0; }
+    //! Blocks scanned so far, including the ones skipped because of their block filter
+    int64_t ScanningBlocks() const { return fScanningWallet ? (int64_t) m_scanning_blocks : 0; }
+    int64_t ScanningSkippedBlocks() const { return fScanningWallet ? (int64_t) m_scanning_skipped : 0; }
 
     /**
      * keystore implementation
@@ -1088,6 +1109,14 @@ public:
     //! Fetches a pubkey from mapWatchKeys if it exists there
     bool GetWatchPubKey(const CKeyID &address, CPubKey &pubkey_out) const;
 
+    //! Every scriptPubKey IsMine() could consider ours, to be matched against block filters
+    GCSFilter::ElementSet GetScriptPubKeysForFilter() const;
+    //! Changes whenever keys, scripts or watch-only scripts are imported or removed, and with them
+    //! outputs of transactions already in the wallet may become ours or stop being ours
+    uint64_t GetKeyStoreGeneration() const;
+    //! Number of private keys, grows as well when the keypool is topped up
+    size_t GetKeyCount() const;
+
     //! Holds a timestamp at which point the wallet is scheduled (externally) to be relocked. Caller must arrange for actual relocking to occur via Lock().
     int64_t nRelockTime = 0;
 
@@ -1435,13 +1464,29 @@ public:
     int nStakeSetUpdateTime = 300; // 5 minutes
     uint64_t nStakeSplitThreshold = 2000;
     using StakeCoinsSet = std::set<std::pair<const CWalletTx*, unsigned int>>;
+    /** The coins FindStakeKernel searched for kernels the last time */
+    const StakeCoinsSet& GetStakeCoins() const { return setStakeCoins; }
+    /** A coin which meets the stake target at nTime, found by FindStakeKernel */
+    struct CStakeKernel {
+        const CWalletTx* pwtx = nullptr;
+        unsigned int nOut = 0;
+        uint32_t nTime = 0;
+    };
     bool MintableCoins();
     bool SelectStakeCoins(StakeCoinsSet& setCoins, CAmount nTargetAmount) const;
-    bool CreateCoinStake(unsigned int nBits, int64_t nSearchInterval, CMutableTransaction& txNew, uint32_t& nTxNewTime, CAmount nFees);
+    /** Search the stake coins for a kernel on top of pindexPrev, only locks cs_main for the lookups of the coins' blocks */
+    bool FindStakeKernel(unsigned int nBits, CBlockIndex* pindexPrev, int64_t nSearchInterval, CStakeKernel& kernel);
+    /** Create and sign the coinstake spending kernel, nFees are the fees of the block's other transactions */
+    bool CreateCoinStake(const CStakeKernel& kernel, const CBlockIndex* pindexPrev, CMutableTransaction& txNew, CAmount nFees);
     void GetScriptForMining(CScript& script);
 
     void NotifyTransactionLock(const CTransaction &tx);
     void NotifyChainLock(const CBlockIndex* pindexChainLock);
+
+private:
+    /** Coins searched for kernels, refreshed every nStakeSetUpdateTime seconds and after staking */
+    StakeCoinsSet setStakeCoins;
+    int64_t nLastStakeSetUpdate = 0;
 };
 
 /**
@@ -1468,6 +1513,8 @@ public:
         }
         m_wallet->m_scanning_start = GetTimeMillis();
         m_wallet->m_scanning_progress = 0;
+        m_wallet->m_scanning_blocks = 0;
+        m_wallet->m_scanning_skipped = 0;
         m_wallet->fScanningWallet = true;
         m_could_reserve = true;
         return true;
@@ -4,6 +4,8 @@
 
 #include <fs.h>
 #include <util/system.h>
+#include <util/time.h>
+#include <wallet/ldb.h>
 #include <wallet/wallet.h>
 #include <wallet/walletutil.h>
 
@@ -100,6 +102,102 @@ static void WalletShowInfo(CWallet* wallet_instance)
     tfm::format(std::cout, "Address Book: %zu\n", wallet_instance->mapAddressBook.size());
 }
 
+static bool MigrateWallet(const std::string& name, const fs::path& path)
+{
+    if (fs::is_directory(LevelDBWalletPath(path))) {
+        tfm::format(std::cerr, "Error: %s is a LevelDB wallet already\n", name.c_str());
+        return false;
+    }
+    // Only wallet directories are migrated, a legacy data file with another name shares
+    // its directory with other wallets and the LevelDB database would clash with theirs
+    const fs::path source_path = path / "wallet.dat";
+    if (!fs::is_directory(path) || !fs::is_regular_file(source_path)) {
+        tfm::format(std::cerr, "Error: no wallet directory with a wallet.dat at %s\n", name.c_str());
+        return false;
+    }
+    std::string error;
+    if (!WalletBatch::VerifyEnvironment(path, error)) {
+        tfm::format(std::cerr, "Error loading %s. Is wallet being used by other process?\n", name.c_str());
+        return false;
+    }
+
+    int64_t nStart = GetTimeMillis();
+    size_t nRecords = 0;
+    bool fSuccess = true;
+    {
+        std::unique_ptr<WalletDatabase> source = WalletDatabase::Create(path);
+        LevelDBDatabase dest(path);
+        try {
+            std::unique_ptr<DatabaseBatch> source_batch = source->MakeBatch("r", false /* flush on close */);
+            std::unique_ptr<DatabaseBatch> dest_batch = dest.MakeBatch("cr+");
+            fSuccess = source_batch->StartCursor();
+            while (fSuccess) {
+                CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+                CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+                bool complete;
+                fSuccess = source_batch->ReadAtCursor(ssKey, ssValue, complete);
+                if (complete) {
+                    fSuccess = true;
+                    break;
+                }
+                // Streams are written as they are, the records keep their serialization
+                fSuccess = fSuccess && dest_batch->Write(ssKey, ssValue);
+                nRecords++;
+            }
+            source_batch->CloseCursor();
+
+            // Read the copy back before the Berkeley DB file is moved away. Both databases
+            // return the records ordered by the bytes of their keys, so the cursors walk the
+            // same records side by side.
+            size_t nVerified = 0;
+            fSuccess = fSuccess && source_batch->StartCursor() && dest_batch->StartCursor();
+            while (fSuccess) {
+                CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+                CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+                CDataStream ssKeyCopy(SER_DISK, CLIENT_VERSION);
+                CDataStream ssValueCopy(SER_DISK, CLIENT_VERSION);
+                bool complete, complete_copy;
+                bool fRead = source_batch->ReadAtCursor(ssKey, ssValue, complete);
+                bool fReadCopy = dest_batch->ReadAtCursor(ssKeyCopy, ssValueCopy, complete_copy);
+                if (complete && complete_copy) {
+                    break;
+                }
+                if (!fRead || !fReadCopy || ssKey.str() != ssKeyCopy.str() || ssValue.str() != ssValueCopy.str()) {
+                    tfm::format(std::cerr, "Error: record %u of the copy differs from the wallet\n", nVerified);
+                    fSuccess = false;
+                    break;
+                }
+                nVerified++;
+            }
+            source_batch->CloseCursor();
+            dest_batch->CloseCursor();
+            if (fSuccess && nVerified != nRecords) {
+                tfm::format(std::cerr, "Error: %u of %u records were copied\n", nVerified, nRecords);
+                fSuccess = false;
+            }
+        } catch (const std::runtime_error& e) {
+            tfm::format(std::cerr, "Error migrating %s: %s\n", name.c_str(), e.what());
+            fSuccess = false;
+        }
+        source->Flush(true);
+        dest.Flush(true);
+    }
+    if (!fSuccess) {
+        tfm::format(std::cerr, "Error migrating %s, the wallet was not changed\n", name.c_str());
+        fs::remove_all(LevelDBWalletPath(path));
+        return false;
+    }
+
+    // Keep the Berkeley DB file as a backup, under a name which is not loaded anymore. The
+    // environment was closed with a checkpoint, the file doesn't need its log directory.
+    fs::rename(source_path, path / "wallet.dat.migrated");
+    fs::remove_all(path / "database");
+    fs::remove(path / "db.log");
+    tfm::format(std::cout, "Migrated %u records to %s in %dms, the Berkeley DB file was renamed to wallet.dat.migrated\n",
+        nRecords, LevelDBWalletPath(path).string().c_str(), GetTimeMillis() - nStart);
+    return true;
+}
+
 bool ExecuteWalletToolFunc(const std::string& command, const std::string& name)
 {
     fs::path path = fs::absolute(name, GetWalletDir());
@@ -124,6 +222,8 @@ bool ExecuteWalletToolFunc(const std::string& command, const std::string& name)
         if (!wallet_instance) return false;
         WalletShowInfo(wallet_instance.get());
         wallet_instance->Flush(true);
+    } else if (command == "migrate") {
+        if (!MigrateWallet(name, path)) return false;
     } else {
         tfm::format(std::cerr, "Invalid command: %s\n", command.c_str());
         return false;
@@ -6,6 +6,7 @@
 
 #include <logging.h>
 #include <util/system.h>
+#include <wallet/ldb.h>
 
 fs::path GetWalletDir()
 {
@@ -71,7 +72,14 @@ std::vector<fs::path> ListWalletDir()
         // This can be replaced by boost::filesystem::lexically_relative once boost is bumped to 1.60.
         const fs::path path = it->path().string().substr(offset);
 
-        if (it->status().type() == fs::directory_file && IsBerkeleyBtree(it->path() / "wallet.dat")) {
+        if (it->status().type() == fs::directory_file && it->path().filename() == LEVELDB_WALLET_DIR) {
+            // Found a LevelDB wallet database, add the directory containing it as a wallet.
+            paths.emplace_back(it.level() == 0 ? fs::path() : path.parent_path());
+            it.no_push();
+        } else if (it->status().type() == fs::directory_file && fs::is_directory(LevelDBWalletPath(it->path()))) {
+            // A wallet.dat next to a LevelDB database is not used, the wallet is added
+            // when its database is found above.
+        } else if (it->status().type() == fs::directory_file && IsBerkeleyBtree(it->path() / "wallet.dat")) {
             // Found a directory which contains wallet.dat btree file, add it as a wallet.
             paths.emplace_back(path);
         } else if (it.level() == 0 && it->symlink_status().type() == fs::regular_file && IsBerkeleyBtree(it->path())) {
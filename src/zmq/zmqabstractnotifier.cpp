@@ -30,3 +30,23 @@ bool CZMQAbstractNotifier::NotifyChainLock(const CBlockIndex * /*CBlockIndex*/)
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyGovernanceVote(const CGovernanceVote &/*vote*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyGovernanceObject(const CGovernanceObject &/*object*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyInstantSendDoubleSpendAttempt(const CTransaction &/*currentTx*/, const CTransaction &/*previousTx*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyMasternodeListChanged(bool /*undo*/, const CDeterministicMNList &/*oldMNList*/, const CDeterministicMNList &/*newMNList*/, const CDeterministicMNListDiff &/*diff*/)
+{
+    return true;
+}
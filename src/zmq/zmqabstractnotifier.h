@@ -8,6 +8,10 @@
 #include <zmq/zmqconfig.h>
 
 class CBlockIndex;
+class CDeterministicMNList;
+class CDeterministicMNListDiff;
+class CGovernanceObject;
+class CGovernanceVote;
 class CZMQAbstractNotifier;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
@@ -44,6 +48,10 @@ public:
     virtual bool NotifyTransaction(const CTransaction &transaction);
     virtual bool NotifyTransactionLock(const CTransaction &transaction);
     virtual bool NotifyChainLock(const CBlockIndex *pindex);
+    virtual bool NotifyGovernanceVote(const CGovernanceVote &vote);
+    virtual bool NotifyGovernanceObject(const CGovernanceObject &object);
+    virtual bool NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx);
+    virtual bool NotifyMasternodeListChanged(bool undo, const CDeterministicMNList &oldMNList, const CDeterministicMNList &newMNList, const CDeterministicMNListDiff &diff);
 
 protected:
     void *psocket;
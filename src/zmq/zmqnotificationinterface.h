@@ -33,6 +33,10 @@ protected:
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
     void NotifyChainLock(const CBlockIndex *pindex) override;
     void NotifyTransactionLock(const CTransaction &tx) override;
+    void NotifyGovernanceVote(const CGovernanceVote &vote) override;
+    void NotifyGovernanceObject(const CGovernanceObject &object) override;
+    void NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx) override;
+    void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNList& newMNList, const CDeterministicMNListDiff& diff) override;
 
 private:
     CZMQNotificationInterface();
@@ -4,14 +4,48 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <governance/governance-object.h>
+#include <governance/governance-vote.h>
+#include <special/deterministicmns.h>
 #include <streams.h>
+#include <sync.h>
 #include <zmq/zmqpublishnotifier.h>
 #include <validation.h>
 #include <util/system.h>
 #include <rpc/server.h>
 
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
+namespace {
+struct QueuedMessage
+{
+    CZMQAbstractPublishNotifier* notifier;
+    const char* command;
+    std::vector<unsigned char> data;
+    uint32_t sequence;
+};
+
+//! Size of the messages queued or being sent, above which further notifications are dropped
+constexpr size_t MAX_PUBLISH_QUEUE_MEMORY = 64 * 1024 * 1024;
+
+// Messages are serialized by the validation interface callbacks and sent by the publisher
+// thread, so slow sockets don't hold up the callbacks of the other listeners
+Mutex g_publish_mutex;
+std::condition_variable g_publish_cv;
+std::deque<QueuedMessage> g_publish_queue GUARDED_BY(g_publish_mutex);
+size_t g_publish_queue_memory GUARDED_BY(g_publish_mutex){0};
+uint64_t g_publish_dropped GUARDED_BY(g_publish_mutex){0};
+bool g_publish_stop GUARDED_BY(g_publish_mutex){false};
+std::thread g_publish_thread;
+
+// Held by the publisher thread while sending and by Shutdown while closing sockets
+Mutex g_socket_mutex;
+} // namespace
+
 static const char *MSG_HASHBLOCK     = "hashblock";
 static const char *MSG_HASHTX        = "hashtx";
 static const char *MSG_HASHTXLOCK    = "hashtxlock";
@@ -20,6 +54,14 @@ static const char *MSG_RAWTX         = "rawtx";
 static const char *MSG_RAWTXLOCK     = "rawtxlock";
 static const char *MSG_HASHCHAINLOCK = "hashchainlock";
 static const char *MSG_RAWCHAINLOCK  = "rawchainlock";
+static const char *MSG_HASHGVOTE     = "hashgovernancevote";
+static const char *MSG_RAWGVOTE      = "rawgovernancevote";
+static const char *MSG_HASHGOBJ      = "hashgovernanceobject";
+static const char *MSG_RAWGOBJ       = "rawgovernanceobject";
+static const char *MSG_HASHISCON     = "hashinstantsenddoublespend";
+static const char *MSG_RAWISCON      = "rawinstantsenddoublespend";
+static const char *MSG_HASHMNLIST    = "hashmnlistdiff";
+static const char *MSG_RAWMNLIST     = "rawmnlistdiff";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -116,6 +158,7 @@ bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
 
 void CZMQAbstractPublishNotifier::Shutdown()
 {
+    LOCK(g_socket_mutex);
     assert(psocket);
 
     int count = mapPublishNotifiers.count(address);
@@ -146,21 +189,98 @@ void CZMQAbstractPublishNotifier::Shutdown()
 
 bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size)
 {
-    assert(psocket);
+    if (fSendFailed)
+        return false;
+
+    const unsigned char* pch = static_cast<const unsigned char*>(data);
+    {
+        LOCK(g_publish_mutex);
+        // A dropped message still takes its sequence number, so listeners can detect it was lost
+        uint32_t sequence = nSequence++;
+        if (g_publish_queue_memory + size > MAX_PUBLISH_QUEUE_MEMORY) {
+            if (g_publish_dropped++ == 0) {
+                LogPrintf("zmq: Publish queue full, dropping notifications until it is sent\n");
+            }
+            return true;
+        }
+        if (g_publish_dropped > 0) {
+            LogPrintf("zmq: Dropped %u notifications while the publish queue was full\n", g_publish_dropped);
+            g_publish_dropped = 0;
+        }
+        g_publish_queue_memory += size;
+        g_publish_queue.push_back(QueuedMessage{this, command, std::vector<unsigned char>(pch, pch + size), sequence});
+    }
+    g_publish_cv.notify_one();
+    return true;
+}
+
+bool CZMQAbstractPublishNotifier::SendQueuedMessage(const char *command, const std::vector<unsigned char>& data, uint32_t sequence)
+{
+    // The notifier was shut down after the message had been queued
+    if (!psocket || fSendFailed)
+        return false;
 
     /* send three parts, command & data & a LE 4byte sequence number */
     unsigned char msgseq[sizeof(uint32_t)];
-    WriteLE32(&msgseq[0], nSequence);
-    int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), nullptr);
-    if (rc == -1)
+    WriteLE32(&msgseq[0], sequence);
+    int rc = zmq_send_multipart(psocket, command, strlen(command), data.data(), data.size(), msgseq, (size_t)sizeof(uint32_t), nullptr);
+    if (rc == -1) {
+        fSendFailed = true;
         return false;
-
-    /* increment memory only sequence number after sending */
-    nSequence++;
+    }
 
     return true;
 }
 
+void CZMQAbstractPublishNotifier::ThreadPublish()
+{
+    while (true) {
+        std::deque<QueuedMessage> queueBatch;
+        size_t nBatchMemory;
+        {
+            WAIT_LOCK(g_publish_mutex, lock);
+            g_publish_cv.wait(lock, []() EXCLUSIVE_LOCKS_REQUIRED(g_publish_mutex) { return g_publish_stop || !g_publish_queue.empty(); });
+            if (g_publish_queue.empty()) {
+                return;
+            }
+            queueBatch.swap(g_publish_queue);
+            nBatchMemory = g_publish_queue_memory;
+        }
+
+        {
+            LOCK(g_socket_mutex);
+            for (const QueuedMessage& msg : queueBatch) {
+                msg.notifier->SendQueuedMessage(msg.command, msg.data, msg.sequence);
+            }
+        }
+
+        LOCK(g_publish_mutex);
+        g_publish_queue_memory -= nBatchMemory;
+    }
+}
+
+void CZMQAbstractPublishNotifier::StartPublisher()
+{
+    assert(!g_publish_thread.joinable());
+    {
+        LOCK(g_publish_mutex);
+        g_publish_stop = false;
+    }
+    g_publish_thread = std::thread(&TraceThread<void (*)()>, "zmqpub", &CZMQAbstractPublishNotifier::ThreadPublish);
+}
+
+void CZMQAbstractPublishNotifier::StopPublisher()
+{
+    if (!g_publish_thread.joinable())
+        return;
+    {
+        LOCK(g_publish_mutex);
+        g_publish_stop = true;
+    }
+    g_publish_cv.notify_all();
+    g_publish_thread.join();
+}
+
 bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     uint256 hash = pindex->GetBlockHash();
@@ -260,3 +380,82 @@ bool CZMQPublishRawChainLockNotifier::NotifyChainLock(const CBlockIndex *pindex)
 
     return SendMessage(MSG_RAWCHAINLOCK, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishHashGovernanceVoteNotifier::NotifyGovernanceVote(const CGovernanceVote &vote)
+{
+    uint256 hash = vote.GetHash();
+    LogPrint(BCLog::ZMQ, "zmq: Publish hashgovernancevote %s\n", hash.GetHex());
+    char data[32];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    return SendMessage(MSG_HASHGVOTE, data, 32);
+}
+
+bool CZMQPublishRawGovernanceVoteNotifier::NotifyGovernanceVote(const CGovernanceVote &vote)
+{
+    uint256 hash = vote.GetHash();
+    LogPrint(BCLog::ZMQ, "zmq: Publish rawgovernancevote %s\n", hash.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << vote;
+    return SendMessage(MSG_RAWGVOTE, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishHashGovernanceObjectNotifier::NotifyGovernanceObject(const CGovernanceObject &object)
+{
+    uint256 hash = object.GetHash();
+    LogPrint(BCLog::ZMQ, "zmq: Publish hashgovernanceobject %s\n", hash.GetHex());
+    char data[32];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    return SendMessage(MSG_HASHGOBJ, data, 32);
+}
+
+bool CZMQPublishRawGovernanceObjectNotifier::NotifyGovernanceObject(const CGovernanceObject &object)
+{
+    uint256 hash = object.GetHash();
+    LogPrint(BCLog::ZMQ, "zmq: Publish rawgovernanceobject %s\n", hash.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << object;
+    return SendMessage(MSG_RAWGOBJ, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishHashInstantSendDoubleSpendNotifier::NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx)
+{
+    uint256 currentHash = currentTx.GetHash(), previousHash = previousTx.GetHash();
+    LogPrint(BCLog::ZMQ, "zmq: Publish hashinstantsenddoublespend %s conflicts against %s\n", currentHash.ToString(), previousHash.ToString());
+    // The hash of the rejected transaction followed by the hash of the locked one
+    char data[64];
+    for (unsigned int i = 0; i < 32; i++) {
+        data[31 - i] = currentHash.begin()[i];
+        data[63 - i] = previousHash.begin()[i];
+    }
+    return SendMessage(MSG_HASHISCON, data, 64);
+}
+
+bool CZMQPublishRawInstantSendDoubleSpendNotifier::NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish rawinstantsenddoublespend %s conflicts with %s\n", currentTx.GetHash().ToString(), previousTx.GetHash().ToString());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << currentTx << previousTx;
+    return SendMessage(MSG_RAWISCON, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishHashMasternodeListDiffNotifier::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList &oldMNList, const CDeterministicMNList &newMNList, const CDeterministicMNListDiff &diff)
+{
+    // The block of the list the diff leads to: the connected block, or the parent of the
+    // disconnected one on undo
+    uint256 hash = newMNList.GetBlockHash();
+    LogPrint(BCLog::ZMQ, "zmq: Publish hashmnlistdiff %s (undo=%d)\n", hash.GetHex(), undo);
+    char data[32];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    return SendMessage(MSG_HASHMNLIST, data, 32);
+}
+
+bool CZMQPublishRawMasternodeListDiffNotifier::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList &oldMNList, const CDeterministicMNList &newMNList, const CDeterministicMNListDiff &diff)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish rawmnlistdiff %s (undo=%d)\n", newMNList.GetBlockHash().GetHex(), undo);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << undo << newMNList.GetBlockHash() << newMNList.GetHeight() << oldMNList.GetBlockHash() << diff;
+    return SendMessage(MSG_RAWMNLIST, &(*ss.begin()), ss.size());
+}
@@ -7,25 +7,40 @@
 
 #include <zmq/zmqabstractnotifier.h>
 
+#include <atomic>
+#include <vector>
+
 class CBlockIndex;
 
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
 private:
-    uint32_t nSequence {0U}; //!< upcounting per message sequence number
+    uint32_t nSequence {0U}; //!< upcounting per message sequence number, taken when the message is queued
+    std::atomic<bool> fSendFailed {false};
+
+    bool SendQueuedMessage(const char *command, const std::vector<unsigned char>& data, uint32_t sequence);
+    static void ThreadPublish();
 
 public:
 
-    /* send zmq multipart message
+    /* queue zmq multipart message for the publisher thread, which sends
+       all queued messages at once
        parts:
           * command
           * data
           * message sequence number
+       the message is dropped, skipping its sequence number, while the queue is full
+       returns false once sending a previous message of this notifier failed
     */
     bool SendMessage(const char *command, const void* data, size_t size);
 
     bool Initialize(void *pcontext) override;
     void Shutdown() override;
+
+    /** Start the thread which sends the queued messages of all publish notifiers */
+    static void StartPublisher();
+    /** Send the messages still queued and stop the publisher thread */
+    static void StopPublisher();
 };
 
 class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
@@ -76,4 +91,52 @@ public:
     bool NotifyChainLock(const CBlockIndex *pindex) override;
 };
 
+class CZMQPublishHashGovernanceVoteNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyGovernanceVote(const CGovernanceVote &vote) override;
+};
+
+class CZMQPublishRawGovernanceVoteNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyGovernanceVote(const CGovernanceVote &vote) override;
+};
+
+class CZMQPublishHashGovernanceObjectNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyGovernanceObject(const CGovernanceObject &object) override;
+};
+
+class CZMQPublishRawGovernanceObjectNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyGovernanceObject(const CGovernanceObject &object) override;
+};
+
+class CZMQPublishHashInstantSendDoubleSpendNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx) override;
+};
+
+class CZMQPublishRawInstantSendDoubleSpendNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx) override;
+};
+
+class CZMQPublishHashMasternodeListDiffNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyMasternodeListChanged(bool undo, const CDeterministicMNList &oldMNList, const CDeterministicMNList &newMNList, const CDeterministicMNListDiff &diff) override;
+};
+
+class CZMQPublishRawMasternodeListDiffNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyMasternodeListChanged(bool undo, const CDeterministicMNList &oldMNList, const CDeterministicMNList &newMNList, const CDeterministicMNListDiff &diff) override;
+};
+
 #endif // BITCORN_ZMQ_ZMQPUBLISHNOTIFIER_H
@@ -7,10 +7,15 @@
 - Start a single node and generate 3 blocks.
 - Stop the node and restart it with -reindex. Verify that the node has reindexed up to block 3.
 - Stop the node and restart it with -reindex-chainstate. Verify that the node has reindexed up to block 3.
+- Spread the blocks over several block files, out of order, and reindex them with -reindexthreads=4.
+  Verify that the node ends up on the same chain.
 """
 
+import os
+import struct
+
 from test_framework.test_framework import BitCornTestFramework
-from test_framework.util import wait_until
+from test_framework.util import assert_equal, wait_until
 
 class ReindexTest(BitCornTestFramework):
 
@@ -27,11 +32,52 @@ class ReindexTest(BitCornTestFramework):
         wait_until(lambda: self.nodes[0].getblockcount() == blockcount)
         self.log.info("Success")
 
+    def split_block_files(self, num_files):
+        """Move the blocks of blk00000.dat into num_files block files.
+
+        blk00000.dat only keeps the genesis block. The other blocks are written in
+        reverse order, both across and within the following files, so that they
+        can only be linked once the last file has been indexed."""
+        blocks_dir = os.path.join(self.nodes[0].datadir, 'regtest', 'blocks')
+        with open(os.path.join(blocks_dir, 'blk00000.dat'), 'rb') as f:
+            data = f.read()
+        magic = data[:4]
+        records = []
+        pos = 0
+        while data.startswith(magic, pos):
+            size = struct.unpack('<I', data[pos + 4:pos + 8])[0]
+            records.append(data[pos:pos + 8 + size])
+            pos += 8 + size
+        genesis, children = records[0], records[:0:-1]
+        per_file = (len(children) + num_files - 2) // (num_files - 1)
+        files = [[genesis]] + [children[i:i + per_file] for i in range(0, len(children), per_file)]
+        assert_equal(len(files), num_files)
+        for n, file_records in enumerate(files):
+            with open(os.path.join(blocks_dir, 'blk%05d.dat' % n), 'wb') as f:
+                f.write(b''.join(file_records))
+
+    def parallel_reindex(self):
+        self.nodes[0].generatetoaddress(40, self.nodes[0].get_deterministic_priv_key().address)
+        blockcount = self.nodes[0].getblockcount()
+        besthash = self.nodes[0].getbestblockhash()
+        self.stop_nodes()
+        self.split_block_files(5)
+        with self.nodes[0].assert_debug_log([
+            "Reindexing block file blk00000.dat (1 blocks, 4 files read ahead)",
+            "Processing out of order child",
+            "from 5 block files in",
+        ]):
+            self.start_nodes([["-reindex", "-reindexthreads=4", "-debug=reindex"]])
+            wait_until(lambda: self.nodes[0].getblockcount() == blockcount)
+        assert_equal(self.nodes[0].getbestblockhash(), besthash)
+        self.log.info("Success")
+
     def run_test(self):
         self.reindex(False)
         self.reindex(True)
         self.reindex(False)
         self.reindex(True)
+        self.parallel_reindex()
 
 if __name__ == '__main__':
     ReindexTest().main()
@@ -324,5 +324,77 @@ class RESTTest (BitCornTestFramework):
         json_obj = self.test_rest_request("/chaininfo")
         assert_equal(json_obj['bestblockhash'], bb_hash)
 
+        self.test_masternode_llmq_uris()
+
+    def test_rest_formats(self, uri):
+        """Request uri in all formats, check that the binary and hex ones agree and return the binary and json ones"""
+        response_bytes = self.test_rest_request(uri, req_type=ReqType.BIN, ret_type=RetType.BYTES)
+        response_hex = self.test_rest_request(uri, req_type=ReqType.HEX, ret_type=RetType.BYTES)
+        assert_equal(response_hex.decode('utf-8').rstrip(), response_bytes.hex())
+        return response_bytes, self.test_rest_request(uri)
+
+    def test_rest_error(self, uri, status, message):
+        for req_type in ReqType:
+            resp = self.test_rest_request(uri, req_type=req_type, status=status, ret_type=RetType.OBJ)
+            assert_equal(resp.read().decode('utf-8').rstrip(), message)
+
+    def test_masternode_llmq_uris(self):
+        # A plain regtest chain, without masternodes, quorums or locks
+        bb_hash = self.nodes[0].getbestblockhash()
+        height = self.nodes[0].getblockcount()
+        genesis_hash = self.nodes[0].getblockhash(0)
+        unknown_hash = "00" * 32
+        bad_hash = "abc"
+
+        self.log.info("Test the /mnlist URI")
+        response_bytes, json_obj = self.test_rest_formats("/mnlist/{}".format(bb_hash))
+        assert_equal(json_obj['blockHash'], bb_hash)
+        assert_equal(json_obj['height'], height)
+        assert_equal(json_obj['totalRegisteredCount'], 0)
+        assert_equal(json_obj['mnList'], [])
+        # blockHash, nHeight, nTotalRegisteredCount and the empty list of masternodes
+        assert_equal(len(response_bytes), 32 + 4 + 4 + 1)
+        assert_equal(response_bytes[:32][::-1].hex(), bb_hash)
+        assert_equal(unpack("<iI", response_bytes[32:40]), (height, 0))
+        self.test_rest_error("/mnlist/{}".format(unknown_hash), 404, "{} not found".format(unknown_hash))
+        self.test_rest_error("/mnlist/{}".format(bad_hash), 400, "Invalid hash: {}".format(bad_hash))
+
+        self.log.info("Test the /mnlistdiff URI")
+        response_bytes, json_obj = self.test_rest_formats("/mnlistdiff/{}/{}".format(genesis_hash, bb_hash))
+        assert_equal(json_obj['baseBlockHash'], genesis_hash)
+        assert_equal(json_obj['blockHash'], bb_hash)
+        assert_equal(json_obj['deletedMNs'], [])
+        assert_equal(json_obj['mnList'], [])
+        assert_equal(response_bytes[:32][::-1].hex(), genesis_hash)
+        assert_equal(response_bytes[32:64][::-1].hex(), bb_hash)
+        self.test_rest_error("/mnlistdiff/{}/{}".format(genesis_hash, unknown_hash), 404, "block {} not found".format(unknown_hash))
+        self.test_rest_error("/mnlistdiff/{}/{}".format(unknown_hash, bb_hash), 404, "block {} not found".format(unknown_hash))
+        self.test_rest_error("/mnlistdiff/{}/{}".format(bad_hash, bb_hash), 400, "Invalid hash: {}".format(bad_hash))
+        self.test_rest_error("/mnlistdiff/{}/{}".format(genesis_hash, bad_hash), 400, "Invalid hash: {}".format(bad_hash))
+        self.test_rest_error("/mnlistdiff/{}".format(bb_hash), 400, "Invalid URI format. Expected /rest/mnlistdiff/<baseblockhash>/<blockhash>.<ext>")
+
+        self.log.info("Test the /quorums URI")
+        # The type is given by its name or number
+        for llmq_type in ["llmq_5_60", "100"]:
+            response_bytes, json_obj = self.test_rest_formats("/quorums/{}".format(llmq_type))
+            assert_equal(json_obj, [])
+            # An empty vector of commitments
+            assert_equal(response_bytes, b'\x00')
+        self.test_rest_error("/quorums/llmq_unknown", 404, "LLMQ type llmq_unknown not found")
+        self.test_rest_error("/quorums/99", 404, "LLMQ type 99 not found")
+
+        self.log.info("Test the /islock URI")
+        # Nothing is locked without quorums, in any format
+        txid = self.nodes[0].sendtoaddress(self.nodes[1].getnewaddress(), 0.1)
+        self.test_rest_error("/islock/{}".format(txid), 404, "{} not locked".format(txid))
+        self.test_rest_error("/islock/{}".format(unknown_hash), 404, "{} not locked".format(unknown_hash))
+        self.test_rest_error("/islock/{}".format(bad_hash), 400, "Invalid hash: {}".format(bad_hash))
+
+        self.log.info("Test the /chainlock URI")
+        self.test_rest_error("/chainlock", 404, "Unable to find any chainlock")
+        # Only the exact path, not everything starting with it
+        self.test_rest_error("/chainlocks", 404, "Invalid URI format. Expected /rest/chainlock.<ext>")
+        self.test_rest_error("/chainlock/{}".format(bb_hash), 404, "Invalid URI format. Expected /rest/chainlock.<ext>")
+
 if __name__ == '__main__':
     RESTTest().main()
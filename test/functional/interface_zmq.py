@@ -3,7 +3,9 @@
 # Distributed under the MIT software license, see the accompanying
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
 """Test the ZMQ notification interface."""
+import json
 import struct
+import time
 
 from test_framework.address import ADDRESS_BCRT1_UNSPENDABLE
 from test_framework.test_framework import BitCornTestFramework
@@ -11,10 +13,13 @@ from test_framework.messages import CTransaction
 from test_framework.util import (
     assert_equal,
     hash256,
+    p2p_port,
 )
 from io import BytesIO
 
 ADDRESS = "tcp://127.0.0.1:28332"
+# The InstantSend, ChainLocks, governance and masternode list topics
+ADDRESS_BITCORN = "tcp://127.0.0.1:28333"
 
 class ZMQSubscriber:
     def __init__(self, socket, topic):
@@ -62,8 +67,27 @@ class ZMQTest (BitCornTestFramework):
         self.rawblock = ZMQSubscriber(socket, b"rawblock")
         self.rawtx = ZMQSubscriber(socket, b"rawtx")
 
+        # The other topics are received in their own socket, so the order of
+        # their messages doesn't depend on the transactions and blocks
+        socket_bitcorn = self.zmq_context.socket(zmq.SUB)
+        socket_bitcorn.set(zmq.RCVTIMEO, 60000)
+        socket_bitcorn.connect(ADDRESS_BITCORN)
+        self.hashtxlock = ZMQSubscriber(socket_bitcorn, b"hashtxlock")
+        self.rawtxlock = ZMQSubscriber(socket_bitcorn, b"rawtxlock")
+        self.hashchainlock = ZMQSubscriber(socket_bitcorn, b"hashchainlock")
+        self.rawchainlock = ZMQSubscriber(socket_bitcorn, b"rawchainlock")
+        self.hashgovernanceobject = ZMQSubscriber(socket_bitcorn, b"hashgovernanceobject")
+        self.rawgovernanceobject = ZMQSubscriber(socket_bitcorn, b"rawgovernanceobject")
+        self.hashmnlistdiff = ZMQSubscriber(socket_bitcorn, b"hashmnlistdiff")
+        self.rawmnlistdiff = ZMQSubscriber(socket_bitcorn, b"rawmnlistdiff")
+        self.bitcorn_subscribers = [
+            self.hashtxlock, self.rawtxlock, self.hashchainlock, self.rawchainlock,
+            self.hashgovernanceobject, self.rawgovernanceobject, self.hashmnlistdiff, self.rawmnlistdiff,
+        ]
+
         self.extra_args = [
-            ["-zmqpub%s=%s" % (sub.topic.decode(), ADDRESS) for sub in [self.hashblock, self.hashtx, self.rawblock, self.rawtx]],
+            ["-zmqpub%s=%s" % (sub.topic.decode(), ADDRESS) for sub in [self.hashblock, self.hashtx, self.rawblock, self.rawtx]] +
+            ["-zmqpub%s=%s" % (sub.topic.decode(), ADDRESS_BITCORN) for sub in self.bitcorn_subscribers],
             [],
         ]
         self.add_nodes(self.num_nodes, self.extra_args)
@@ -118,16 +142,104 @@ class ZMQTest (BitCornTestFramework):
             hex = self.rawtx.receive()
             assert_equal(payment_txid, hash256(hex).hex())
 
+            self._zmq_test_governance()
+            self._zmq_test_mnlistdiff()
 
         self.log.info("Test the getzmqnotifications RPC")
-        assert_equal(self.nodes[0].getzmqnotifications(), [
+        assert_equal(sorted(self.nodes[0].getzmqnotifications(), key=lambda n: n["type"]), sorted([
             {"type": "pubhashblock", "address": ADDRESS, "hwm": 1000},
             {"type": "pubhashtx", "address": ADDRESS, "hwm": 1000},
             {"type": "pubrawblock", "address": ADDRESS, "hwm": 1000},
             {"type": "pubrawtx", "address": ADDRESS, "hwm": 1000},
-        ])
+        ] + [
+            {"type": "pub%s" % sub.topic.decode(), "address": ADDRESS_BITCORN, "hwm": 1000} for sub in self.bitcorn_subscribers
+        ], key=lambda n: n["type"]))
 
         assert_equal(self.nodes[1].getzmqnotifications(), [])
 
+    def _zmq_test_governance(self):
+        node = self.nodes[0]
+        self.log.info("Test the governance object notifications")
+        while not node.mnsync("status")["IsBlockchainSynced"]:
+            node.mnsync("next")
+
+        proposal_time = int(time.time())
+        proposal = {
+            "type": 1,
+            "name": "zmq_proposal",
+            "start_epoch": proposal_time,
+            "end_epoch": proposal_time + 24 * 60 * 60,
+            "payment_amount": 5,
+            "payment_address": node.getnewaddress("", "legacy"),
+            "url": "https://bitcorn.org",
+        }
+        data_hex = json.dumps(proposal).encode().hex()
+        collateral_txid = node.gobject("prepare", "0", "1", str(proposal_time), data_hex)
+        # The collateral needs six confirmations before the object is accepted
+        node.generatetoaddress(6, ADDRESS_BCRT1_UNSPENDABLE)
+        self.sync_all()
+        self.drain_block_topics()
+        object_hash = node.gobject("submit", "0", "1", str(proposal_time), data_hex, collateral_txid)
+
+        assert_equal(self.hashgovernanceobject.receive().hex(), object_hash)
+        assert bytes.fromhex(data_hex) in self.rawgovernanceobject.receive()
+
+    def _zmq_test_mnlistdiff(self):
+        node = self.nodes[0]
+        self.log.info("Test the masternode list diff notifications")
+        # Mature enough coins for the collateral
+        node.generatetoaddress(160, node.getnewaddress())
+        self.sync_all()
+        self.drain_block_topics()
+
+        operator_key = node.bls("generate")
+        node.protx("register_fund", node.getnewaddress("", "legacy"), "127.0.0.1:%d" % p2p_port(2),
+                   node.getnewaddress("", "legacy"), operator_key["public"], node.getnewaddress("", "legacy"), 0,
+                   node.getnewaddress("", "legacy"))
+        parent_hash = node.getbestblockhash()
+        register_hash = node.generatetoaddress(1, ADDRESS_BCRT1_UNSPENDABLE)[0]
+        height = node.getblockcount()
+
+        def check_mnlistdiff(undo, new_hash, new_height, old_hash):
+            # The hash is the one of the block of the new list
+            assert_equal(self.hashmnlistdiff.receive().hex(), new_hash)
+            body = self.rawmnlistdiff.receive()
+            assert_equal(body[0], 1 if undo else 0)
+            assert_equal(body[1:33][::-1].hex(), new_hash)
+            assert_equal(struct.unpack('<i', body[33:37])[0], new_height)
+            assert_equal(body[37:69][::-1].hex(), old_hash)
+
+        # The registering block adds the masternode, undoing it removes it again
+        check_mnlistdiff(False, register_hash, height, parent_hash)
+        node.invalidateblock(register_hash)
+        check_mnlistdiff(True, parent_hash, height - 1, register_hash)
+        node.reconsiderblock(register_hash)
+        check_mnlistdiff(False, register_hash, height, parent_hash)
+        self.sync_all()
+        self.drain_block_topics()
+
+        # None of the above was locked, there are no quorums to sign InstantSend or ChainLocks
+        # locks on regtest without masternodes taking part in them
+        for sub in [self.hashtxlock, self.rawtxlock, self.hashchainlock, self.rawchainlock]:
+            assert_equal(sub.sequence, 0)
+
+    def drain_block_topics(self):
+        """Receive the transaction and block notifications sent so far, checking their sequence."""
+        import zmq
+        socket = self.hashblock.socket
+        subscribers = {sub.topic: sub for sub in [self.hashblock, self.hashtx, self.rawblock, self.rawtx]}
+        while True:
+            try:
+                topic, body, seq = socket.recv_multipart(flags=zmq.NOBLOCK)
+            except zmq.Again:
+                time.sleep(0.5)
+                try:
+                    topic, body, seq = socket.recv_multipart(flags=zmq.NOBLOCK)
+                except zmq.Again:
+                    return
+            sub = subscribers[topic]
+            assert_equal(struct.unpack('<I', seq)[-1], sub.sequence)
+            sub.sequence += 1
+
 if __name__ == '__main__':
     ZMQTest().main()
@@ -21,11 +21,23 @@ class InvalidateTest(BitCornTestFramework):
     def setup_network(self):
         self.setup_nodes()
 
+    def check_chain_snapshot(self, node):
+        """getblockcount, getbestblockhash, getdifficulty and the median time and chain work of
+        getblockchaininfo read the published chain snapshot, which must agree with the active chain"""
+        info = node.getblockchaininfo()
+        assert_equal(node.getblockcount(), info['blocks'])
+        assert_equal(node.getbestblockhash(), info['bestblockhash'])
+        assert_equal(node.getdifficulty(), info['difficulty'])
+        header = node.getblockheader(info['bestblockhash'])
+        assert_equal(info['mediantime'], header['mediantime'])
+        assert_equal(info['chainwork'], header['chainwork'])
+
     def run_test(self):
         self.log.info("Make sure we repopulate setBlockIndexCandidates after InvalidateBlock:")
         self.log.info("Mine 4 blocks on Node 0")
         self.nodes[0].generatetoaddress(4, self.nodes[0].get_deterministic_priv_key().address)
         assert_equal(self.nodes[0].getblockcount(), 4)
+        self.check_chain_snapshot(self.nodes[0])
         besthash_n0 = self.nodes[0].getbestblockhash()
 
         self.log.info("Mine competing 6 blocks on Node 1")
@@ -42,6 +54,7 @@ class InvalidateTest(BitCornTestFramework):
         self.nodes[0].invalidateblock(badhash)
         assert_equal(self.nodes[0].getblockcount(), 4)
         assert_equal(self.nodes[0].getbestblockhash(), besthash_n0)
+        self.check_chain_snapshot(self.nodes[0])
 
         self.log.info("Make sure we won't reorg to a lower work chain:")
         connect_nodes_bi(self.nodes, 1, 2)
@@ -51,6 +64,7 @@ class InvalidateTest(BitCornTestFramework):
         self.log.info("Invalidate block 5 on node 1 so its tip is now at 4")
         self.nodes[1].invalidateblock(self.nodes[1].getblockhash(5))
         assert_equal(self.nodes[1].getblockcount(), 4)
+        self.check_chain_snapshot(self.nodes[1])
         self.log.info("Invalidate block 3 on node 2, so its tip is now 2")
         self.nodes[2].invalidateblock(self.nodes[2].getblockhash(3))
         assert_equal(self.nodes[2].getblockcount(), 2)
@@ -68,10 +82,12 @@ class InvalidateTest(BitCornTestFramework):
         self.nodes[1].invalidateblock(blocks[-1])
         self.nodes[1].invalidateblock(blocks[-2])
         assert_equal(self.nodes[1].getbestblockhash(), blocks[-3])
+        self.check_chain_snapshot(self.nodes[1])
         # Reconsider only the previous tip
         self.nodes[1].reconsiderblock(blocks[-1])
         # Should be back at the tip by now
         assert_equal(self.nodes[1].getbestblockhash(), blocks[-1])
+        self.check_chain_snapshot(self.nodes[1])
 
         self.log.info("Verify that we reconsider all descendants")
         blocks = self.nodes[1].generatetoaddress(10, ADDRESS_BCRT1_UNSPENDABLE)
@@ -84,6 +100,7 @@ class InvalidateTest(BitCornTestFramework):
         self.nodes[1].reconsiderblock(blocks[-4])
         # Should be back at the tip by now
         assert_equal(self.nodes[1].getbestblockhash(), blocks[-1])
+        self.check_chain_snapshot(self.nodes[1])
 
 
 if __name__ == '__main__':
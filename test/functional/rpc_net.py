@@ -58,6 +58,12 @@ class NetTest(BitCornTestFramework):
         assert_greater_than_or_equal(peers_sent, net_totals_before['totalbytessent'])
         assert_greater_than_or_equal(net_totals_after['totalbytessent'], peers_sent)
 
+        # Only protocol extension messages which were received are listed
+        for stats in net_totals_after['extmessages'].values():
+            assert_greater_than_or_equal(stats['count'], 1)
+            assert_greater_than_or_equal(stats['bytes'], 0)
+            assert_greater_than_or_equal(stats['time_us'], 0)
+
         # test getnettotals and getpeerinfo by doing a ping
         # the bytes sent/received should change
         # note ping and pong are 32 bytes each
@@ -196,6 +196,48 @@ class ToolWalletTest(BitCornTestFramework):
         assert_equal(shasum_after, shasum_before)
         self.log.debug('Wallet file shasum unchanged\n')
 
+    def test_tool_wallet_migrate(self):
+        self.log.info('Migrating wallet "foo" to LevelDB')
+        self.start_node(0, ['-wallet=foo'])
+        address = self.nodes[0].getnewaddress()
+        info_before = self.nodes[0].getwalletinfo()
+        self.stop_node(0)
+
+        foo_path = os.path.join(self.nodes[0].datadir, 'regtest', 'wallets', 'foo')
+        p = self.bitcorn_wallet_process('-wallet=foo', 'migrate')
+        stdout, stderr = p.communicate()
+        assert_equal(stderr, '')
+        assert_equal(p.poll(), 0)
+        assert stdout.startswith('Migrated ')
+        assert os.path.isdir(os.path.join(foo_path, 'wallet.ldb'))
+        assert os.path.isfile(os.path.join(foo_path, 'wallet.dat.migrated'))
+        assert not os.path.exists(os.path.join(foo_path, 'wallet.dat'))
+        assert not os.path.exists(os.path.join(foo_path, 'database'))
+        assert not os.path.exists(os.path.join(foo_path, 'db.log'))
+        self.assert_raises_tool_error('Error: foo is a LevelDB wallet already', '-wallet=foo', 'migrate')
+
+        self.log.info('Loading the migrated wallet')
+        self.start_node(0, ['-wallet=foo'])
+        assert {'name': 'foo'} in self.nodes[0].listwalletdir()['wallets']
+        info_after = self.nodes[0].getwalletinfo()
+        for key in ['walletversion', 'txcount', 'keypoolsize', 'keypoolsize_hd_internal', 'hdseedid']:
+            assert_equal(info_after[key], info_before[key])
+        assert self.nodes[0].getaddressinfo(address)['ismine']
+
+        self.log.info('Encrypting the migrated wallet')
+        self.nodes[0].encryptwallet('passphrase')
+        self.nodes[0].walletpassphrase('passphrase', 60)
+        privkey = self.nodes[0].dumpprivkey(address)
+        self.stop_node(0)
+        self.start_node(0, ['-wallet=foo'])
+        assert 'unlocked_until' in self.nodes[0].getwalletinfo()
+        self.nodes[0].walletpassphrase('passphrase', 60)
+        assert_equal(self.nodes[0].dumpprivkey(address), privkey)
+        self.stop_node(0)
+
+        self.log.info('Refusing to salvage the migrated wallet')
+        self.nodes[0].assert_start_raises_init_error(['-wallet=foo', '-salvagewallet'], 'Error: Error loading wallet foo. -salvagewallet is not supported for LevelDB wallets.')
+
     def run_test(self):
         self.wallet_path = os.path.join(self.nodes[0].datadir, 'regtest', 'wallets', 'wallet.dat')
         self.test_invalid_tool_commands_and_args()
@@ -204,6 +246,7 @@ class ToolWalletTest(BitCornTestFramework):
         self.test_tool_wallet_info_after_transaction()
         self.test_tool_wallet_create_on_existing_wallet()
         self.test_getwalletinfo_on_different_wallet()
+        self.test_tool_wallet_migrate()
 
 
 if __name__ == '__main__':